@@ -371,6 +371,35 @@ static int decode_interrupt_cb(void *ctx)
 
 const AVIOInterruptCB int_cb = { decode_interrupt_cb, NULL };
 
+static void print_filter_benchmark(void)
+{
+    int i, j;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+        if (!graph)
+            continue;
+        for (j = 0; j < graph->filter_count; j++) {
+            AVFilterContext *f = graph->filters[j];
+            AVFilterStats *st  = f->stats;
+            if (!st)
+                continue;
+            printf("bench: filter %d:%s (%s) in=%"PRId64" out=%"PRId64
+                   " start_frame=%0.3fs draw_slice=%0.3fs end_frame=%0.3fs"
+                   " filter_samples=%0.3fs allocs=%"PRId64" copies=%"PRId64,
+                   i, f->name, f->filter->name, st->frames_in, st->frames_out,
+                   st->start_frame_time    / 1000000.0,
+                   st->draw_slice_time     / 1000000.0,
+                   st->end_frame_time      / 1000000.0,
+                   st->filter_samples_time / 1000000.0,
+                   st->buffer_allocs, st->buffer_copies);
+            if (st->max_queued)
+                printf(" max_queued=%d", st->max_queued);
+            printf("\n");
+        }
+    }
+}
+
 void av_noreturn exit_program(int ret)
 {
     int i, j;
@@ -3126,6 +3155,7 @@ int main(int argc, char **argv)
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
         printf("bench: utime=%0.3fs maxrss=%ikB\n", ti / 1000000.0, maxrss);
+        print_filter_benchmark();
     }
 
     exit_program(0);
@@ -372,6 +372,7 @@ extern int qp_hist;
 extern int same_quant;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
+extern int filter_threads;
 extern AVIOContext *progress_avio;
 
 extern const AVIOInterruptCB int_cb;
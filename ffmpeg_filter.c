@@ -727,6 +727,9 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    avfilter_graph_set_pipeline(fg->graph, filter_threads);
+    if (do_benchmark && (ret = avfilter_graph_set_profiling(fg->graph, 1)) < 0)
+        return ret;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -28,6 +28,7 @@
  * output.
  */
 
+#include "config.h"
 #include "libavutil/audioconvert.h"
 #include "libavutil/audio_fifo.h"
 #include "libavutil/avassert.h"
@@ -37,6 +38,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 
+#include "amix.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -154,15 +156,20 @@ static int frame_list_add_frame(FrameList *frame_list, int nb_samples, int64_t p
 typedef struct MixContext {
     const AVClass *class;       /**< class for AVOptions */
     AVFloatDSPContext fdsp;
+    AMixDSPContext dsp;
 
     int nb_inputs;              /**< number of inputs */
     int active_inputs;          /**< number of input currently active */
     int duration_mode;          /**< mode for determining duration */
     float dropout_transition;   /**< transition time when an input drops out */
+    int fixed;                  /**< mix integer input in fixed point */
 
     int nb_channels;            /**< number of channels */
     int sample_rate;            /**< sample rate */
     int planar;
+    enum AVSampleFormat sample_fmt; /**< packed sample format of the output */
+    void *acc;                  /**< fixed-point accumulator */
+    int acc_size;               /**< allocated size of acc, in bytes */
     AVAudioFifo **fifos;        /**< audio fifo for each input */
     uint8_t *input_state;       /**< current state of each input */
     float *input_scale;         /**< mixing scale factor for each input */
@@ -184,6 +191,9 @@ static const AVOption amix_options[] = {
     { "dropout_transition", "Transition time, in seconds, for volume "
                             "renormalization when an input stream ends.",
             OFFSET(dropout_transition), AV_OPT_TYPE_FLOAT, { 2.0 }, 0, INT_MAX, A },
+    { "fixed", "Mix 16 and 32-bit integer input in fixed point instead of "
+               "converting it to float.",
+            OFFSET(fixed), AV_OPT_TYPE_INT, { 0 }, 0, 1, A },
     { NULL },
 };
 
@@ -213,6 +223,40 @@ static void calculate_scales(MixContext *s, int nb_samples)
     }
 }
 
+static void mix_s16_c(int32_t *acc, const int16_t *src, int scale, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        acc[i] += src[i] * scale;
+}
+
+static void clip_s16_c(int16_t *dst, const int32_t *acc, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = av_clip_int16((acc[i] + (1 << (AMIX_SCALE_BITS - 1))) >>
+                               AMIX_SCALE_BITS);
+}
+
+static void mix_s32(int64_t *acc, const int32_t *src, int scale, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        acc[i] += (int64_t)src[i] * scale;
+}
+
+static void clip_s32(int32_t *dst, const int64_t *acc, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = av_clipl_int32((acc[i] + (1 << (AMIX_SCALE_BITS - 1))) >>
+                                AMIX_SCALE_BITS);
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -221,6 +265,7 @@ static int config_output(AVFilterLink *outlink)
     char buf[64];
 
     s->planar          = av_sample_fmt_is_planar(outlink->format);
+    s->sample_fmt      = av_get_packed_sample_fmt(outlink->format);
     s->sample_rate     = outlink->sample_rate;
     outlink->time_base = (AVRational){ 1, outlink->sample_rate };
     s->next_pts        = AV_NOPTS_VALUE;
@@ -269,10 +314,27 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
     AVFilterBufferRef *out_buf, *in_buf;
-    int i;
+    int i, planes, plane_size, p;
 
     calculate_scales(s, nb_samples);
 
+    planes     = s->planar ? s->nb_channels : 1;
+    plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
+    plane_size = FFALIGN(plane_size, 16);
+
+    if (s->sample_fmt != AV_SAMPLE_FMT_FLT) {
+        int acc_size = planes * plane_size *
+                       (s->sample_fmt == AV_SAMPLE_FMT_S16 ? 4 : 8);
+        if (acc_size > s->acc_size) {
+            av_freep(&s->acc);
+            s->acc_size = 0;
+            if (!(s->acc = av_malloc(acc_size)))
+                return AVERROR(ENOMEM);
+            s->acc_size = acc_size;
+        }
+        memset(s->acc, 0, acc_size);
+    }
+
     out_buf = ff_get_audio_buffer(outlink, AV_PERM_WRITE, nb_samples);
     if (!out_buf)
         return AVERROR(ENOMEM);
@@ -283,24 +345,47 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
 
     for (i = 0; i < s->nb_inputs; i++) {
         if (s->input_state[i] == INPUT_ON) {
-            int planes, plane_size, p;
+            int scale = lrintf(s->input_scale[i] * (1 << AMIX_SCALE_BITS));
 
             av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
                                nb_samples);
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
-
             for (p = 0; p < planes; p++) {
-                s->fdsp.vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                           (float *) in_buf->extended_data[p],
-                                           s->input_scale[i], plane_size);
+                switch (s->sample_fmt) {
+                case AV_SAMPLE_FMT_FLT:
+                    s->fdsp.vector_fmac_scalar((float *)out_buf->extended_data[p],
+                                               (float *) in_buf->extended_data[p],
+                                               s->input_scale[i], plane_size);
+                    break;
+                case AV_SAMPLE_FMT_S16:
+                    s->dsp.mix_s16((int32_t *)s->acc + p * plane_size,
+                                   (int16_t *)in_buf->extended_data[p],
+                                   scale, plane_size);
+                    break;
+                case AV_SAMPLE_FMT_S32:
+                    mix_s32((int64_t *)s->acc + p * plane_size,
+                            (int32_t *)in_buf->extended_data[p],
+                            scale, plane_size);
+                    break;
+                }
             }
         }
     }
     avfilter_unref_buffer(in_buf);
 
+    for (p = 0; p < planes; p++) {
+        switch (s->sample_fmt) {
+        case AV_SAMPLE_FMT_S16:
+            s->dsp.clip_s16((int16_t *)out_buf->extended_data[p],
+                            (int32_t *)s->acc + p * plane_size, plane_size);
+            break;
+        case AV_SAMPLE_FMT_S32:
+            clip_s32((int32_t *)out_buf->extended_data[p],
+                     (int64_t *)s->acc + p * plane_size, plane_size);
+            break;
+        }
+    }
+
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
         s->next_pts += nb_samples;
@@ -504,6 +589,10 @@ static int init(AVFilterContext *ctx, const char *args)
     }
 
     avpriv_float_dsp_init(&s->fdsp, 0);
+    s->dsp.mix_s16  = mix_s16_c;
+    s->dsp.clip_s16 = clip_s16_c;
+    if (HAVE_MMX)
+        ff_amix_init_x86(&s->dsp);
 
     return 0;
 }
@@ -522,6 +611,7 @@ static void uninit(AVFilterContext *ctx)
     av_freep(&s->frame_list);
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
+    av_freep(&s->acc);
 
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
@@ -529,9 +619,16 @@ static void uninit(AVFilterContext *ctx)
 
 static int query_formats(AVFilterContext *ctx)
 {
+    MixContext *s = ctx->priv;
     AVFilterFormats *formats = NULL;
     ff_add_format(&formats, AV_SAMPLE_FMT_FLT);
     ff_add_format(&formats, AV_SAMPLE_FMT_FLTP);
+    if (s->fixed) {
+        ff_add_format(&formats, AV_SAMPLE_FMT_S16);
+        ff_add_format(&formats, AV_SAMPLE_FMT_S16P);
+        ff_add_format(&formats, AV_SAMPLE_FMT_S32);
+        ff_add_format(&formats, AV_SAMPLE_FMT_S32P);
+    }
     ff_set_common_formats(ctx, formats);
     ff_set_common_channel_layouts(ctx, ff_all_channel_layouts());
     ff_set_common_samplerates(ctx, ff_all_samplerates());
@@ -554,3 +651,164 @@ AVFilter avfilter_af_amix = {
                                           .request_frame = request_frame },
                                         { .name = NULL}},
 };
+
+#ifdef TEST
+
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+
+#undef printf
+
+#define BENCH_INPUTS   4
+#define BENCH_SAMPLES (44100 * 60 * 2)  // one minute of stereo
+#define BENCH_BLOCK   (1024 * 2)
+#define CHECK_SAMPLES (BENCH_BLOCK * 4)
+
+/**
+ * Mix through float like a graph without the fixed option does:
+ * convert the inputs to float, mix, and convert the result back.
+ */
+static int64_t bench_float(AVFloatDSPContext *fdsp, int16_t **src,
+                           int16_t *dst, float **tmp, float scale,
+                           int nb_samples)
+{
+    int64_t t = av_gettime();
+    int i, j, k;
+
+    for (k = 0; k < nb_samples; k += BENCH_BLOCK) {
+        memset(tmp[BENCH_INPUTS], 0, BENCH_BLOCK * sizeof(float));
+        for (i = 0; i < BENCH_INPUTS; i++) {
+            for (j = 0; j < BENCH_BLOCK; j++)
+                tmp[i][j] = src[i][k + j] * (1.0f / (1 << 15));
+            fdsp->vector_fmac_scalar(tmp[BENCH_INPUTS], tmp[i], scale, BENCH_BLOCK);
+        }
+        for (j = 0; j < BENCH_BLOCK; j++)
+            dst[k + j] = av_clip_int16(lrintf(tmp[BENCH_INPUTS][j] * (1 << 15)));
+    }
+    return av_gettime() - t;
+}
+
+static int64_t bench_fixed(AMixDSPContext *dsp, int16_t **src,
+                           int16_t *dst, int32_t *acc, float scale,
+                           int nb_samples)
+{
+    int64_t t = av_gettime();
+    int q = lrintf(scale * (1 << AMIX_SCALE_BITS));
+    int i, k;
+
+    for (k = 0; k < nb_samples; k += BENCH_BLOCK) {
+        memset(acc, 0, BENCH_BLOCK * sizeof(*acc));
+        for (i = 0; i < BENCH_INPUTS; i++)
+            dsp->mix_s16(acc, src[i] + k, q, BENCH_BLOCK);
+        dsp->clip_s16(dst + k, acc, BENCH_BLOCK);
+    }
+    return av_gettime() - t;
+}
+
+/**
+ * Compare the optimized functions with the C ones on every length they
+ * accept up to 4 blocks of 16, for the extreme scales and full scale
+ * input, so that the clipping is exercised too.
+ */
+static int check_dsp(const AMixDSPContext *dsp, int16_t **src, int32_t *acc)
+{
+    static const int scales[] = { 0, 1, 1 << (AMIX_SCALE_BITS - 2),
+                                  (1 << AMIX_SCALE_BITS) - 1, 1 << AMIX_SCALE_BITS };
+    DECLARE_ALIGNED(16, int32_t, acc_c)[64];
+    DECLARE_ALIGNED(16, int16_t, dst_c)[64];
+    DECLARE_ALIGNED(16, int16_t, dst)[64];
+    int s, len, i, mismatch = 0;
+
+    for (s = 0; s < FF_ARRAY_ELEMS(scales); s++) {
+        for (len = 16; len <= 64; len += 16) {
+            memset(acc_c, 0, sizeof(acc_c));
+            memset(acc,   0, sizeof(acc_c));
+            for (i = 0; i < BENCH_INPUTS; i++) {
+                mix_s16_c(acc_c, src[i], scales[s], len);
+                dsp->mix_s16(acc, src[i], scales[s], len);
+            }
+            clip_s16_c(dst_c, acc_c, len);
+            dsp->clip_s16(dst, acc, len);
+            mismatch |= memcmp(acc_c, acc, len * sizeof(*acc)) ||
+                        memcmp(dst_c, dst, len * sizeof(*dst));
+        }
+    }
+    return mismatch;
+}
+
+/**
+ * Check the optimized fixed-point functions and the rounding of the
+ * fixed-point path against float, or benchmark them with -bench.
+ */
+int main(int argc, char **argv)
+{
+    AVFloatDSPContext fdsp;
+    AMixDSPContext dsp;
+    AVLFG lfg;
+    int16_t *src[BENCH_INPUTS], *dst[3];
+    float *tmp[BENCH_INPUTS + 1];
+    int32_t *acc;
+    int64_t time[3];
+    int bench = argc > 1 && !strcmp(argv[1], "-bench");
+    int nb_samples = bench ? BENCH_SAMPLES : CHECK_SAMPLES;
+    int i, j, max_diff = 0, mismatch;
+
+    av_lfg_init(&lfg, 0xA41C);
+
+    for (i = 0; i < BENCH_INPUTS; i++) {
+        src[i] = av_malloc(nb_samples * sizeof(*src[i]));
+        if (!src[i])
+            return 1;
+        for (j = 0; j < nb_samples; j++)
+            src[i][j] = av_lfg_get(&lfg);
+        /* full scale on the first samples, to clip the sums */
+        for (j = 0; j < 32; j++)
+            src[i][j] = j & 1 ? INT16_MAX : INT16_MIN;
+    }
+    for (i = 0; i <= BENCH_INPUTS; i++)
+        if (!(tmp[i] = av_malloc(BENCH_BLOCK * sizeof(*tmp[i]))))
+            return 1;
+    for (i = 0; i < 3; i++)
+        if (!(dst[i] = av_malloc(nb_samples * sizeof(*dst[i]))))
+            return 1;
+    if (!(acc = av_malloc(BENCH_BLOCK * sizeof(*acc))))
+        return 1;
+
+    avpriv_float_dsp_init(&fdsp, 0);
+    time[0] = bench_float(&fdsp, src, dst[0], tmp, 1.0f / BENCH_INPUTS, nb_samples);
+
+    dsp.mix_s16  = mix_s16_c;
+    dsp.clip_s16 = clip_s16_c;
+    time[1] = bench_fixed(&dsp, src, dst[1], acc, 1.0f / BENCH_INPUTS, nb_samples);
+    if (HAVE_MMX)
+        ff_amix_init_x86(&dsp);
+    time[2] = bench_fixed(&dsp, src, dst[2], acc, 1.0f / BENCH_INPUTS, nb_samples);
+
+    for (j = 0; j < nb_samples; j++)
+        max_diff = FFMAX(max_diff, FFABS(dst[0][j] - dst[1][j]));
+
+    mismatch = memcmp(dst[1], dst[2], nb_samples * sizeof(*dst[1])) ||
+               check_dsp(&dsp, src, acc);
+
+    if (bench) {
+        printf("%d s16 inputs: float %6.1f ms, fixed C %6.1f ms, fixed optimized %6.1f ms\n",
+               BENCH_INPUTS, time[0] / 1000.0, time[1] / 1000.0, time[2] / 1000.0);
+        printf("max difference to the float path: %d\n", max_diff);
+    }
+    if (max_diff > 1)
+        printf("fixed-point mixing differs from float by %d\n", max_diff);
+    if (mismatch)
+        printf("optimized fixed-point mixing MISMATCH\n");
+
+    for (i = 0; i < BENCH_INPUTS; i++)
+        av_freep(&src[i]);
+    for (i = 0; i <= BENCH_INPUTS; i++)
+        av_freep(&tmp[i]);
+    for (i = 0; i < 3; i++)
+        av_freep(&dst[i]);
+    av_freep(&acc);
+    return mismatch || max_diff > 1;
+}
+
+#endif
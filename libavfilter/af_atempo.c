@@ -39,6 +39,7 @@
  */
 
 #include <float.h>
+#include "config.h"
 #include "libavcodec/avfft.h"
 #include "libavutil/audioconvert.h"
 #include "libavutil/avassert.h"
@@ -48,6 +49,7 @@
 #include "libavutil/samplefmt.h"
 #include "avfilter.h"
 #include "audio.h"
+#include "atempo.h"
 #include "internal.h"
 
 /**
@@ -114,6 +116,9 @@ typedef struct {
     // fragment window size, power-of-two integer:
     int window;
 
+    // optimized down-mix and blending functions:
+    ATempoDSPContext dsp;
+
     // Hann window coefficients, for feathering
     // (blending) the overlapping fragment region:
     float *hann;
@@ -289,6 +294,10 @@ static int yae_reset(ATempoContext *atempo,
         atempo->hann[i] = (float)h;
     }
 
+    memset(&atempo->dsp, 0, sizeof(atempo->dsp));
+    if (HAVE_MMX)
+        ff_atempo_init_x86(&atempo->dsp, format, channels);
+
     yae_clear(atempo);
     return 0;
 }
@@ -331,9 +340,8 @@ inline static AudioFragment *yae_prev_frag(ATempoContext *atempo)
 #define yae_init_xdat(scalar_type, scalar_max)                          \
     do {                                                                \
         const uint8_t *src_end = src +                                  \
-            frag->nsamples * atempo->channels * sizeof(scalar_type);    \
+            nsamples * atempo->channels * sizeof(scalar_type);          \
                                                                         \
-        FFTSample *xdat = frag->xdat;                                   \
         scalar_type tmp;                                                \
                                                                         \
         if (atempo->channels == 1) {                                    \
@@ -382,10 +390,20 @@ static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
 {
     // shortcuts:
     const uint8_t *src = frag->data;
+    FFTSample *xdat = frag->xdat;
+    int nsamples = frag->nsamples;
 
     // init complex data buffer used for FFT and Correlation:
     memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
 
+    if (atempo->dsp.downmix && nsamples >= 4) {
+        const int n = nsamples & ~3;
+        atempo->dsp.downmix(xdat, src, n);
+        src      += n * atempo->stride;
+        xdat     += n;
+        nsamples -= n;
+    }
+
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_init_xdat(uint8_t, 127);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -708,12 +726,10 @@ static int yae_adjust_position(ATempoContext *atempo)
         const scalar_type *aaa = (const scalar_type *)a;                \
         const scalar_type *bbb = (const scalar_type *)b;                \
                                                                         \
-        scalar_type *out     = (scalar_type *)dst;                      \
-        scalar_type *out_end = (scalar_type *)dst_end;                  \
-        int64_t i;                                                      \
+        scalar_type *out = (scalar_type *)dst;                          \
+        int i;                                                          \
                                                                         \
-        for (i = 0; i < overlap && out < out_end;                       \
-             i++, atempo->position[1]++, wa++, wb++) {                  \
+        for (i = 0; i < nblend; i++, wa++, wb++) {                      \
             float w0 = *wa;                                             \
             float w1 = *wb;                                             \
             int j;                                                      \
@@ -723,10 +739,7 @@ static int yae_adjust_position(ATempoContext *atempo)
                 float t0 = (float)*aaa;                                 \
                 float t1 = (float)*bbb;                                 \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                *out = (scalar_type)(t0 * w0 + t1 * w1);                \
             }                                                           \
         }                                                               \
         dst = (uint8_t *)out;                                           \
@@ -767,10 +780,35 @@ static int yae_overlap_add(ATempoContext *atempo,
 
     uint8_t *dst = *dst_ref;
 
+    int nframes, ncopy, nblend;
+
     av_assert0(start_here <= stop_here &&
                frag->position[1] <= start_here &&
                overlap <= frag->nsamples);
 
+    nframes = FFMIN(overlap, (dst_end - dst) / atempo->stride);
+
+    // samples preceding the start of the stream are not blended:
+    ncopy = FFMAX(0, FFMIN(-frag->position[0], nframes));
+    memcpy(dst, a, ncopy * atempo->stride);
+    a   += ncopy * atempo->stride;
+    b   += ncopy * atempo->stride;
+    dst += ncopy * atempo->stride;
+    wa  += ncopy;
+    wb  += ncopy;
+
+    nblend = nframes - ncopy;
+    if (atempo->dsp.blend && nblend >= 4) {
+        const int n = nblend & ~3;
+        atempo->dsp.blend(dst, a, b, wa, wb, n);
+        a      += n * atempo->stride;
+        b      += n * atempo->stride;
+        dst    += n * atempo->stride;
+        wa     += n;
+        wb     += n;
+        nblend -= n;
+    }
+
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_blend(uint8_t);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -783,6 +821,8 @@ static int yae_overlap_add(ATempoContext *atempo,
         yae_blend(double);
     }
 
+    atempo->position[1] += nframes;
+
     // pass-back the updated destination buffer pointer:
     *dst_ref = dst;
 
@@ -1159,3 +1199,115 @@ AVFilter avfilter_af_atempo = {
         { .name = NULL}
     },
 };
+
+#ifdef TEST
+
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+
+#undef printf
+
+#define BENCH_RATE     44100
+#define BENCH_SAMPLES (BENCH_RATE * 60)
+#define CHECK_SAMPLES (BENCH_RATE * 2)
+
+static int64_t bench_run(ATempoContext *atempo, const uint8_t *src,
+                         int nb_samples, uint8_t *dst, int *nb_out)
+{
+    const uint8_t *src_end = src + nb_samples * atempo->stride;
+    uint8_t *dst_start = dst;
+    uint8_t *dst_end   = dst + *nb_out * atempo->stride;
+    int64_t t = av_gettime();
+
+    // feed the filter in chunks, like a typical decoder would:
+    while (src < src_end) {
+        const uint8_t *chunk_end = FFMIN(src + 1024 * atempo->stride, src_end);
+        yae_apply(atempo, &src, chunk_end, &dst, dst_end);
+    }
+    yae_flush(atempo, &dst, dst_end);
+
+    *nb_out = (dst - dst_start) / atempo->stride;
+    return av_gettime() - t;
+}
+
+int main(int argc, char **argv)
+{
+    static const enum AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLT
+    };
+    static const double tempos[] = { 0.5, 0.8, 1.25, 1.5, 2.0 };
+    ATempoContext atempo = { 0 };
+    AVLFG lfg;
+    uint8_t *src, *dst[2];
+    int bench = argc > 1 && !strcmp(argv[1], "-bench");
+    int nb_samples = bench ? BENCH_SAMPLES : CHECK_SAMPLES;
+    int f, channels, t, i, c, ret = 0;
+
+    av_lfg_init(&lfg, 0xA7E5);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        for (channels = 1; channels <= 2; channels++) {
+            const int stride = av_get_bytes_per_sample(formats[f]) * channels;
+            const int max_out = nb_samples * 2 + BENCH_RATE;
+
+            src    = av_malloc(nb_samples * stride);
+            dst[0] = av_malloc(max_out * stride);
+            dst[1] = av_malloc(max_out * stride);
+            if (!src || !dst[0] || !dst[1])
+                return 1;
+
+            // a few partials with some noise, different in each channel:
+            for (i = 0; i < nb_samples; i++) {
+                for (c = 0; c < channels; c++) {
+                    double s = 0.4 * sin(2 * M_PI * 220 * (c + 1) * i / BENCH_RATE) +
+                               0.2 * sin(2 * M_PI * 1375 * i / BENCH_RATE) +
+                               0.1 * ((int)(av_lfg_get(&lfg) & 0xffff) - 32768) / 32768.0;
+                    if (formats[f] == AV_SAMPLE_FMT_S16)
+                        ((int16_t *)src)[i * channels + c] = lrint(s * 32767);
+                    else
+                        ((float *)src)[i * channels + c] = s;
+                }
+            }
+
+            for (t = 0; t < FF_ARRAY_ELEMS(tempos); t++) {
+                int64_t time[2];
+                int nb_out[2], mismatch;
+
+                for (i = 0; i < 2; i++) {
+                    // first pass with the C code, second with the
+                    // optimized code if any:
+                    av_force_cpu_flags(i ? -1 : 0);
+                    if (yae_reset(&atempo, formats[f], BENCH_RATE, channels) < 0)
+                        return 1;
+                    atempo.tempo = tempos[t];
+
+                    nb_out[i] = max_out;
+                    time[i] = bench_run(&atempo, src, nb_samples, dst[i], &nb_out[i]);
+                }
+
+                mismatch = nb_out[0] != nb_out[1] ||
+                           memcmp(dst[0], dst[1], nb_out[0] * stride);
+                if (bench)
+                    printf("%s %d channel(s) tempo %4.2f: C %6.1f ms, optimized %6.1f ms%s\n",
+                           av_get_sample_fmt_name(formats[f]), channels, tempos[t],
+                           time[0] / 1000.0, time[1] / 1000.0,
+                           mismatch ? " MISMATCH" : "");
+                else
+                    printf("%s %d channel(s) tempo %4.2f: %s\n",
+                           av_get_sample_fmt_name(formats[f]), channels, tempos[t],
+                           mismatch ? "MISMATCH" : "ok");
+                ret |= mismatch;
+            }
+
+            av_freep(&src);
+            av_freep(&dst[0]);
+            av_freep(&dst[1]);
+        }
+    }
+
+    yae_release_buffers(&atempo);
+    return ret;
+}
+
+#endif
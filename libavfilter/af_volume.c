@@ -24,16 +24,13 @@
  * based on ffmpeg.c code
  */
 
+#include "config.h"
 #include "libavutil/audioconvert.h"
 #include "libavutil/eval.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
-
-typedef struct {
-    double volume;
-    int    volume_i;
-} VolumeContext;
+#include "volume.h"
 
 static av_cold int init(AVFilterContext *ctx, const char *args)
 {
@@ -89,6 +86,11 @@ static int query_formats(AVFilterContext *ctx)
         AV_SAMPLE_FMT_S32,
         AV_SAMPLE_FMT_FLT,
         AV_SAMPLE_FMT_DBL,
+        AV_SAMPLE_FMT_U8P,
+        AV_SAMPLE_FMT_S16P,
+        AV_SAMPLE_FMT_S32P,
+        AV_SAMPLE_FMT_FLTP,
+        AV_SAMPLE_FMT_DBLP,
         AV_SAMPLE_FMT_NONE
     };
 
@@ -110,65 +112,109 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static int filter_samples(AVFilterLink *inlink, AVFilterBufferRef *insamples)
+static void scale_samples(uint8_t *data, int nb_samples, const VolumeContext *vol)
 {
-    VolumeContext *vol = inlink->dst->priv;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
-    const int nb_samples = insamples->audio->nb_samples *
-        av_get_channel_layout_nb_channels(insamples->audio->channel_layout);
     const double volume   = vol->volume;
     const int    volume_i = vol->volume_i;
     int i;
 
-    if (volume_i != 256) {
-        switch (insamples->format) {
-        case AV_SAMPLE_FMT_U8:
-        {
-            uint8_t *p = (void *)insamples->data[0];
-            for (i = 0; i < nb_samples; i++) {
-                int v = (((*p - 128) * volume_i + 128) >> 8) + 128;
-                *p++ = av_clip_uint8(v);
-            }
-            break;
+    switch (vol->sample_fmt) {
+    case AV_SAMPLE_FMT_U8:
+    {
+        uint8_t *p = (void *)data;
+        for (i = 0; i < nb_samples; i++) {
+            int v = (((*p - 128) * volume_i + 128) >> 8) + 128;
+            *p++ = av_clip_uint8(v);
         }
-        case AV_SAMPLE_FMT_S16:
-        {
-            int16_t *p = (void *)insamples->data[0];
-            for (i = 0; i < nb_samples; i++) {
-                int v = ((int64_t)*p * volume_i + 128) >> 8;
-                *p++ = av_clip_int16(v);
-            }
-            break;
+        break;
+    }
+    case AV_SAMPLE_FMT_S16:
+    {
+        int16_t *p = (void *)data;
+        for (i = 0; i < nb_samples; i++) {
+            int v = ((int64_t)*p * volume_i + 128) >> 8;
+            *p++ = av_clip_int16(v);
         }
-        case AV_SAMPLE_FMT_S32:
-        {
-            int32_t *p = (void *)insamples->data[0];
-            for (i = 0; i < nb_samples; i++) {
-                int64_t v = (((int64_t)*p * volume_i + 128) >> 8);
-                *p++ = av_clipl_int32(v);
-            }
-            break;
+        break;
+    }
+    case AV_SAMPLE_FMT_S32:
+    {
+        int32_t *p = (void *)data;
+        for (i = 0; i < nb_samples; i++) {
+            int64_t v = (((int64_t)*p * volume_i + 128) >> 8);
+            *p++ = av_clipl_int32(v);
         }
-        case AV_SAMPLE_FMT_FLT:
-        {
-            float *p = (void *)insamples->data[0];
-            float scale = (float)volume;
-            for (i = 0; i < nb_samples; i++) {
-                *p++ *= scale;
-            }
-            break;
+        break;
+    }
+    case AV_SAMPLE_FMT_FLT:
+    {
+        float *p = (void *)data;
+        float scale = (float)volume;
+        for (i = 0; i < nb_samples; i++) {
+            *p++ *= scale;
         }
-        case AV_SAMPLE_FMT_DBL:
-        {
-            double *p = (void *)insamples->data[0];
-            for (i = 0; i < nb_samples; i++) {
-                *p *= volume;
-                p++;
-            }
-            break;
+        break;
+    }
+    case AV_SAMPLE_FMT_DBL:
+    {
+        double *p = (void *)data;
+        for (i = 0; i < nb_samples; i++) {
+            *p *= volume;
+            p++;
         }
+        break;
+    }
+    }
+}
+
+static void init_scale_samples(VolumeContext *vol, enum AVSampleFormat format)
+{
+    vol->sample_fmt    = av_get_packed_sample_fmt(format);
+    vol->scale_samples = NULL;
+    if (HAVE_MMX)
+        ff_volume_init_x86(vol);
+}
+
+/**
+ * Scale nb_samples samples in each plane, with the optimized function
+ * for the largest multiple of 8 samples and the C code for the rest.
+ */
+static void scale_planes(const VolumeContext *vol, uint8_t **data,
+                         int planes, int nb_samples)
+{
+    int bps = av_get_bytes_per_sample(vol->sample_fmt);
+    int p;
+
+    for (p = 0; p < planes; p++) {
+        int n = 0;
+
+        if (vol->scale_samples && nb_samples >= 8) {
+            n = nb_samples & ~7;
+            vol->scale_samples(data[p], n, vol);
         }
+        scale_samples(data[p] + n * bps, nb_samples - n, vol);
     }
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    VolumeContext *vol = inlink->dst->priv;
+
+    init_scale_samples(vol, inlink->format);
+
+    return 0;
+}
+
+static int filter_samples(AVFilterLink *inlink, AVFilterBufferRef *insamples)
+{
+    VolumeContext *vol = inlink->dst->priv;
+    AVFilterLink *outlink = inlink->dst->outputs[0];
+    int nb_channels = av_get_channel_layout_nb_channels(insamples->audio->channel_layout);
+    int planar      = av_sample_fmt_is_planar(insamples->format);
+
+    if (vol->volume_i != 256)
+        scale_planes(vol, insamples->extended_data, planar ? nb_channels : 1,
+                     insamples->audio->nb_samples * (planar ? 1 : nb_channels));
     return ff_filter_samples(outlink, insamples);
 }
 
@@ -182,6 +228,7 @@ AVFilter avfilter_af_volume = {
     .inputs  = (const AVFilterPad[])  {{ .name     = "default",
                                    .type           = AVMEDIA_TYPE_AUDIO,
                                    .filter_samples = filter_samples,
+                                   .config_props   = config_input,
                                    .min_perms      = AV_PERM_READ|AV_PERM_WRITE},
                                  { .name = NULL}},
 
@@ -189,3 +236,91 @@ AVFilter avfilter_af_volume = {
                                    .type           = AVMEDIA_TYPE_AUDIO, },
                                  { .name = NULL}},
 };
+
+#ifdef TEST
+
+#include "libavutil/lfg.h"
+
+#undef printf
+
+/**
+ * Check that the optimized functions give the same output as the C code,
+ * for planar and packed stereo input of all the formats, with sample
+ * counts around the multiples of 8.
+ */
+int main(void)
+{
+    static const enum AVSampleFormat formats[] = {
+        AV_SAMPLE_FMT_U8,  AV_SAMPLE_FMT_S16,  AV_SAMPLE_FMT_S32,
+        AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL,
+        AV_SAMPLE_FMT_U8P, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P,
+        AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_DBLP,
+    };
+    /* the largest volumes the s16 and s32 functions accept */
+    static const double volumes[] = { 0.1, 0.5, 1.5, 7.9, 127.99, 16383.99 };
+    static const int sizes[] = { 1, 7, 8, 9, 1023, 4099 };
+    enum { CHANNELS = 2, MAX_SIZE = 4099 * CHANNELS };
+    uint8_t *ref[CHANNELS], *out[CHANNELS];
+    AVLFG lfg;
+    int f, v, n, p, i, ret = 0;
+
+    av_lfg_init(&lfg, 0x0170);
+
+    for (p = 0; p < CHANNELS; p++) {
+        ref[p] = av_malloc(MAX_SIZE * sizeof(double));
+        out[p] = av_malloc(MAX_SIZE * sizeof(double));
+        if (!ref[p] || !out[p])
+            return 1;
+    }
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        int planar  = av_sample_fmt_is_planar(formats[f]);
+        int planes  = planar ? CHANNELS : 1;
+        int bps     = av_get_bytes_per_sample(formats[f]);
+        int mismatch = 0, optimized = 0;
+
+        for (v = 0; v < FF_ARRAY_ELEMS(volumes); v++) {
+            VolumeContext vol = { .volume   = volumes[v],
+                                  .volume_i = (int)(volumes[v] * 256 + 0.5) };
+
+            for (n = 0; n < FF_ARRAY_ELEMS(sizes); n++) {
+                int nb_samples = sizes[n] * (planar ? 1 : CHANNELS);
+
+                for (p = 0; p < planes; p++) {
+                    for (i = 0; i < nb_samples; i++) {
+                        uint32_t r = av_lfg_get(&lfg);
+                        switch (av_get_packed_sample_fmt(formats[f])) {
+                        case AV_SAMPLE_FMT_U8:  ref[p][i]              = r;  break;
+                        case AV_SAMPLE_FMT_S16: ((int16_t *)ref[p])[i] = r;  break;
+                        case AV_SAMPLE_FMT_S32: ((int32_t *)ref[p])[i] = r;  break;
+                        case AV_SAMPLE_FMT_FLT: ((float   *)ref[p])[i] = (int32_t)r / (float)INT32_MAX;  break;
+                        case AV_SAMPLE_FMT_DBL: ((double  *)ref[p])[i] = (int32_t)r / (double)INT32_MAX; break;
+                        }
+                    }
+                    memcpy(out[p], ref[p], nb_samples * bps);
+                }
+
+                vol.sample_fmt    = av_get_packed_sample_fmt(formats[f]);
+                vol.scale_samples = NULL;
+                scale_planes(&vol, ref, planes, nb_samples);
+                init_scale_samples(&vol, formats[f]);
+                optimized |= !!vol.scale_samples;
+                scale_planes(&vol, out, planes, nb_samples);
+
+                for (p = 0; p < planes; p++)
+                    mismatch |= memcmp(ref[p], out[p], nb_samples * bps);
+            }
+        }
+        printf("%-5s %s: %s\n", av_get_sample_fmt_name(formats[f]),
+               optimized ? "optimized" : "C only", mismatch ? "MISMATCH" : "ok");
+        ret |= mismatch;
+    }
+
+    for (p = 0; p < CHANNELS; p++) {
+        av_free(ref[p]);
+        av_free(out[p]);
+    }
+    return !!ret;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_AMIX_H
+#define AVFILTER_AMIX_H
+
+#include <stdint.h>
+
+/** fractional bits of the fixed-point input scale factors */
+#define AMIX_SCALE_BITS 14
+
+/**
+ * Fixed-point mixing functions of the amix filter. len is a multiple of
+ * 16 and the accumulator is 16-byte aligned.
+ */
+typedef struct AMixDSPContext {
+    /**
+     * acc[i] += src[i] * scale, with scale in [0, 1 << AMIX_SCALE_BITS].
+     */
+    void (*mix_s16)(int32_t *acc, const int16_t *src, int scale, int len);
+
+    /**
+     * dst[i] = av_clip_int16((acc[i] + (1 << (AMIX_SCALE_BITS - 1))) >>
+     *                        AMIX_SCALE_BITS)
+     */
+    void (*clip_s16)(int16_t *dst, const int32_t *acc, int len);
+} AMixDSPContext;
+
+void ff_amix_init_x86(AMixDSPContext *dsp);
+
+#endif /* AVFILTER_AMIX_H */
@@ -0,0 +1,52 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_ATEMPO_H
+#define AVFILTER_ATEMPO_H
+
+#include <stdint.h>
+#include "libavcodec/avfft.h"
+#include "libavutil/samplefmt.h"
+
+/**
+ * Optimized kernels used by the atempo filter for a given sample format
+ * and number of channels. A NULL function means that the generic C code
+ * is used. The kernels process a multiple of 4 samples, the caller takes
+ * care of the remainder.
+ */
+typedef struct {
+    /**
+     * Down-mix nsamples packed samples to mono: for each sample keep the
+     * channel with the largest magnitude, clipped to the maximum of the
+     * sample format, the first channel winning ties.
+     */
+    void (*downmix)(FFTSample *dst, const uint8_t *src, int nsamples);
+
+    /**
+     * Blend nsamples packed samples of two fragments,
+     * dst = a * wa + b * wb computed in float, with one pair of weights
+     * per sample shared by all the channels.
+     */
+    void (*blend)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                  const float *wa, const float *wb, int nsamples);
+} ATempoDSPContext;
+
+void ff_atempo_init_x86(ATempoDSPContext *dsp, enum AVSampleFormat format,
+                        int channels);
+
+#endif /* AVFILTER_ATEMPO_H */
@@ -54,6 +54,8 @@ AVFilterBufferRef *ff_default_get_audio_buffer(AVFilterLink *link, int perms,
     if (!samplesref)
         goto fail;
 
+    if (link->src->stats)
+        link->src->stats->buffer_allocs++;
     av_freep(&data);
 
 fail:
@@ -164,6 +166,7 @@ int ff_filter_samples_framed(AVFilterLink *link, AVFilterBufferRef *samplesref)
     int64_t pts;
     AVFilterBufferRef *buf_out;
     int ret;
+    FFProfileTimer timer;
 
     FF_TPRINTF_START(NULL, filter_samples); ff_tlog_link(NULL, link, 1);
 
@@ -194,6 +197,8 @@ int ff_filter_samples_framed(AVFilterLink *link, AVFilterBufferRef *samplesref)
                         0, 0, samplesref->audio->nb_samples,
                         av_get_channel_layout_nb_channels(link->channel_layout),
                         link->format);
+        if (link->dst->stats)
+            link->dst->stats->buffer_copies++;
 
         avfilter_unref_buffer(samplesref);
     } else
@@ -201,7 +206,14 @@ int ff_filter_samples_framed(AVFilterLink *link, AVFilterBufferRef *samplesref)
 
     link->cur_buf = buf_out;
     pts = buf_out->pts;
+    if (link->src->stats)
+        link->src->stats->frames_out++;
+    if (link->dst->stats)
+        link->dst->stats->frames_in++;
+    ff_profile_start(link, &timer);
     ret = filter_samples(link, buf_out);
+    if (link->dst->stats)
+        link->dst->stats->filter_samples_time += ff_profile_stop(link, &timer);
     ff_update_link_current_pts(link, pts);
     return ret;
 }
@@ -24,6 +24,7 @@
 #include "libavutil/audioconvert.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/time.h"
 
 #include "avfilter.h"
 #include "formats.h"
@@ -295,6 +296,32 @@ int avfilter_config_links(AVFilterContext *filter)
     return 0;
 }
 
+void ff_profile_start(AVFilterLink *link, FFProfileTimer *timer)
+{
+    AVFilterStats *stats = link->dst->stats;
+
+    if (!stats)
+        return;
+    stats->depth++;
+    timer->nested_time = stats->nested_time;
+    timer->start       = av_gettime();
+}
+
+int64_t ff_profile_stop(AVFilterLink *link, FFProfileTimer *timer)
+{
+    AVFilterStats *stats = link->dst->stats, *src_stats = link->src->stats;
+    int64_t time;
+
+    if (!stats)
+        return 0;
+    time = av_gettime() - timer->start;
+    stats->depth--;
+    /* the depth of a pipeline fifo belongs to the thread feeding it */
+    if (src_stats && !src_stats->split_thread && src_stats->depth)
+        src_stats->nested_time += time;
+    return time - (stats->nested_time - timer->nested_time);
+}
+
 void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
 {
     if (link->type == AVMEDIA_TYPE_VIDEO) {
@@ -580,6 +607,7 @@ void avfilter_free(AVFilterContext *filter)
     av_freep(&filter->inputs);
     av_freep(&filter->outputs);
     av_freep(&filter->priv);
+    av_freep(&filter->stats);
     while(filter->command_queue){
         ff_command_queue_pop(filter);
     }
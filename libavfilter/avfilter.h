@@ -509,8 +509,49 @@ struct AVFilterContext {
     void *priv;                     ///< private data for use by the filter
 
     struct AVFilterCommand *command_queue;
+
+    /**
+     * profiling counters, NULL unless profiling was enabled on the graph
+     * with avfilter_graph_set_profiling()
+     */
+    struct AVFilterStats *stats;
 };
 
+/**
+ * Profiling counters of a filter instance.
+ *
+ * Times are in microseconds and do not include the time spent in the
+ * callbacks of the filters called from this one, so that the times of all
+ * the filters of a graph add up to the time spent in the graph.
+ *
+ * In a pipelined graph, each counter is only updated by the thread running
+ * the filter, or for the fifos cutting the graph, by the thread on the
+ * side of the fifo it counts. The time spent after such a fifo is not
+ * accounted to the filters before it.
+ */
+typedef struct AVFilterStats {
+    int64_t frames_in;           ///< video frames and audio buffers received on the inputs
+    int64_t frames_out;          ///< video frames and audio buffers sent on the outputs
+    int64_t start_frame_time;    ///< time spent in start_frame()
+    int64_t draw_slice_time;     ///< time spent in draw_slice()
+    int64_t end_frame_time;      ///< time spent in end_frame()
+    int64_t filter_samples_time; ///< time spent in filter_samples()
+    int64_t buffer_allocs;       ///< buffers newly allocated for the output links
+    int64_t buffer_copies;       ///< input buffers copied because of their permissions
+    int max_queued;              ///< fifo filters: maximum number of queued buffers
+
+    /**
+     * Private fields
+     *
+     * The following fields are for internal use only.
+     * Their type, offset, number and semantic can change without notice.
+     */
+
+    int depth;                   ///< number of callbacks of the filter running
+    int64_t nested_time;         ///< time spent in other filters called from this one
+    int split_thread;            ///< the inputs and the outputs are run by different threads
+} AVFilterStats;
+
 /**
  * A link between two filters. This contains pointers to the source and
  * destination filters between which this link exists, and the indexes of
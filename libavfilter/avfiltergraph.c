@@ -23,8 +23,11 @@
 #include <ctype.h>
 #include <string.h>
 
+#include "config.h"
+
 #include "libavutil/audioconvert.h"
 #include "libavutil/avassert.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavcodec/avcodec.h" // avcodec_find_best_pix_fmt2()
 #include "avfilter.h"
@@ -54,8 +57,16 @@ AVFilterGraph *avfilter_graph_alloc(void)
 
 void avfilter_graph_free(AVFilterGraph **graph)
 {
+    int i;
+
     if (!*graph)
         return;
+    /* stop all the pipeline threads before any filter they use is freed */
+#if CONFIG_FIFO_FILTER
+    for (i = 0; i < (*graph)->nb_pipeline_fifos; i++)
+        ff_fifo_stop((*graph)->pipeline_fifos[i]);
+#endif
+    av_freep(&(*graph)->pipeline_fifos);
     for (; (*graph)->filter_count > 0; (*graph)->filter_count--)
         avfilter_free((*graph)->filters[(*graph)->filter_count - 1]);
     av_freep(&(*graph)->sink_links);
@@ -103,6 +114,48 @@ void avfilter_graph_set_auto_convert(AVFilterGraph *graph, unsigned flags)
     graph->disable_auto_convert = flags;
 }
 
+void avfilter_graph_set_pipeline(AVFilterGraph *graph, int nb_threads)
+{
+#if HAVE_PTHREADS && HAVE_ATOMICS_GCC
+    graph->pipeline_threads = nb_threads;
+#endif
+}
+
+static int is_pipeline_fifo(AVFilterGraph *graph, AVFilterContext *f)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_pipeline_fifos; i++)
+        if (graph->pipeline_fifos[i] == f)
+            return 1;
+    return 0;
+}
+
+static int graph_alloc_stats(AVFilterGraph *graph)
+{
+    int i;
+
+    for (i = 0; i < graph->filter_count; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        if (!filter->stats && !(filter->stats = av_mallocz(sizeof(*filter->stats))))
+            return AVERROR(ENOMEM);
+        filter->stats->split_thread = is_pipeline_fifo(graph, filter);
+    }
+    return 0;
+}
+
+int avfilter_graph_set_profiling(AVFilterGraph *graph, int enable)
+{
+    int i;
+
+    graph->profiling = enable;
+    if (enable)
+        return graph_alloc_stats(graph);
+    for (i = 0; i < graph->filter_count; i++)
+        av_freep(&graph->filters[i]->stats);
+    return 0;
+}
+
 /**
  * Check for the validity of graph.
  *
@@ -204,66 +257,9 @@ static int filter_query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static int insert_conv_filter(AVFilterGraph *graph, AVFilterLink *link,
-                              const char *filt_name, const char *filt_args)
-{
-    static int auto_count = 0, ret;
-    char inst_name[32];
-    AVFilterContext *filt_ctx;
-
-    if (graph->disable_auto_convert) {
-        av_log(NULL, AV_LOG_ERROR,
-               "The filters '%s' and '%s' do not have a common format "
-               "and automatic conversion is disabled.\n",
-               link->src->name, link->dst->name);
-        return AVERROR(EINVAL);
-    }
-
-    snprintf(inst_name, sizeof(inst_name), "auto-inserted %s %d",
-            filt_name, auto_count++);
-
-    if ((ret = avfilter_graph_create_filter(&filt_ctx,
-                                            avfilter_get_by_name(filt_name),
-                                            inst_name, filt_args, NULL, graph)) < 0)
-        return ret;
-    if ((ret = avfilter_insert_filter(link, filt_ctx, 0, 0)) < 0)
-        return ret;
-
-    filter_query_formats(filt_ctx);
-
-    if ( ((link = filt_ctx-> inputs[0]) &&
-           !ff_merge_formats(link->in_formats, link->out_formats)) ||
-         ((link = filt_ctx->outputs[0]) &&
-           !ff_merge_formats(link->in_formats, link->out_formats))
-       ) {
-        av_log(NULL, AV_LOG_ERROR,
-               "Impossible to convert between the formats supported by the filter "
-               "'%s' and the filter '%s'\n", link->src->name, link->dst->name);
-        return AVERROR(EINVAL);
-    }
-
-    if (link->type == AVMEDIA_TYPE_AUDIO &&
-         (((link = filt_ctx-> inputs[0]) &&
-           !ff_merge_channel_layouts(link->in_channel_layouts, link->out_channel_layouts)) ||
-         ((link = filt_ctx->outputs[0]) &&
-           !ff_merge_channel_layouts(link->in_channel_layouts, link->out_channel_layouts)))
-       ) {
-        av_log(NULL, AV_LOG_ERROR,
-               "Impossible to convert between the channel layouts formats supported by the filter "
-               "'%s' and the filter '%s'\n", link->src->name, link->dst->name);
-        return AVERROR(EINVAL);
-    }
-
-    return 0;
-}
-
 static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
 {
     int i, j, ret;
-    char filt_args[128];
-    AVFilterFormats *formats;
-    AVFilterChannelLayouts *chlayouts;
-    AVFilterFormats *samplerates;
     int scaler_count = 0, resampler_count = 0;
 
     for (j = 0; j < 2; j++) {
@@ -272,7 +268,7 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
         /* Call query_formats on sources first.
            This is a temporary workaround for amerge,
            until format renegociation is implemented. */
-        if (!graph->filters[i]->nb_inputs == j)
+        if (!!graph->filters[i]->nb_inputs != j)
             continue;
         if (graph->filters[i]->filter->query_formats)
             ret = filter_query_formats(graph->filters[i]);
@@ -289,36 +285,6 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
 
         for (j = 0; j < filter->nb_inputs; j++) {
             AVFilterLink *link = filter->inputs[j];
-#if 0
-            if (!link) continue;
-
-            if (!link->in_formats || !link->out_formats)
-                return AVERROR(EINVAL);
-
-            if (link->type == AVMEDIA_TYPE_VIDEO &&
-                !ff_merge_formats(link->in_formats, link->out_formats)) {
-
-                /* couldn't merge format lists, auto-insert scale filter */
-                snprintf(filt_args, sizeof(filt_args), "0:0:%s",
-                         graph->scale_sws_opts);
-                if (ret = insert_conv_filter(graph, link, "scale", filt_args))
-                    return ret;
-            }
-            else if (link->type == AVMEDIA_TYPE_AUDIO) {
-                if (!link->in_channel_layouts || !link->out_channel_layouts)
-                    return AVERROR(EINVAL);
-
-                /* Merge all three list before checking: that way, in all
-                 * three categories, aconvert will use a common format
-                 * whenever possible. */
-                formats     = ff_merge_formats(link->in_formats,   link->out_formats);
-                chlayouts   = ff_merge_channel_layouts(link->in_channel_layouts  , link->out_channel_layouts);
-                samplerates = ff_merge_samplerates    (link->in_samplerates, link->out_samplerates);
-
-                if (!formats || !chlayouts || !samplerates)
-                    if (ret = insert_conv_filter(graph, link, "aresample", NULL))
-                       return ret;
-#else
             int convert_needed = 0;
 
             if (!link)
@@ -408,7 +374,6 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                            "'%s' and the filter '%s'\n", link->src->name, link->dst->name);
                     return ret;
                 }
-#endif
             }
         }
     }
@@ -761,6 +726,260 @@ static void swap_sample_fmts(AVFilterGraph *graph)
 
 }
 
+/* cost of one conversion pass; the losses of the conversion are added to it */
+#define CONVERSION_COST 1000
+
+/* same order as in avcodec_find_best_pix_fmt2() */
+static const int pix_fmt_loss_order[] = {
+    ~0,
+    ~FF_LOSS_ALPHA,
+    ~FF_LOSS_RESOLUTION,
+    ~FF_LOSS_COLORSPACE,
+    ~(FF_LOSS_COLORSPACE | FF_LOSS_RESOLUTION),
+    ~FF_LOSS_COLORQUANT,
+    ~FF_LOSS_DEPTH,
+    ~(FF_LOSS_DEPTH | FF_LOSS_COLORSPACE),
+    ~(FF_LOSS_RESOLUTION | FF_LOSS_DEPTH | FF_LOSS_COLORSPACE | FF_LOSS_ALPHA |
+      FF_LOSS_COLORQUANT | FF_LOSS_CHROMA),
+};
+
+/**
+ * Return the size of a pixel in bits, including padding, as compared by
+ * avcodec_find_best_pix_fmt2().
+ */
+static int padded_bits_per_pixel(enum PixelFormat pix_fmt)
+{
+    const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[pix_fmt];
+    int i, planes = 0, bits = 0;
+
+    for (i = 0; i < desc->nb_components; i++)
+        planes = FFMAX(planes, desc->comp[i].plane + 1);
+    if (desc->flags & (PIX_FMT_PAL | PIX_FMT_PSEUDOPAL))
+        planes = 1;
+    for (i = 0; i < planes; i++) {
+        int vsub = i == 1 || i == 2 ? desc->log2_chroma_h : 0;
+        bits += FFMAX(av_image_get_linesize(pix_fmt, 64, i), 0) * 8 >> vsub;
+    }
+    return bits / 64;
+}
+
+/**
+ * Estimate the cost of converting frames of format src to format dst.
+ * Conversions are ranked like avcodec_find_best_pix_fmt2() and
+ * swap_sample_fmts_on_filter() do, so that for a single conversion the
+ * cheapest format is the one they would pick.
+ */
+static int conversion_cost(enum AVMediaType type, int src, int dst)
+{
+    int rank;
+
+    if (src == dst)
+        return 0;
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        int has_alpha = av_pix_fmt_descriptors[src].nb_components % 2 == 0;
+        int loss      = avcodec_get_pix_fmt_loss(dst, src, has_alpha);
+
+        for (rank = 0; rank < FF_ARRAY_ELEMS(pix_fmt_loss_order); rank++)
+            if (!(loss & pix_fmt_loss_order[rank]))
+                break;
+        /* among equivalent formats, prefer the smallest */
+        return CONVERSION_COST + 100 * rank + padded_bits_per_pixel(dst);
+    } else {
+        int bps     = av_get_bytes_per_sample(src);
+        int dst_bps = av_get_bytes_per_sample(dst);
+
+        /* planar <-> packed only */
+        if (av_get_packed_sample_fmt(src) == av_get_packed_sample_fmt(dst))
+            return CONVERSION_COST / 2;
+        if (bps == 4 && dst_bps == 8)
+            rank = 1;
+        else if (dst_bps >= bps)
+            rank = 2 + dst_bps - bps;
+        else
+            rank = 20 + bps - dst_bps;
+        return CONVERSION_COST + 100 * rank;
+    }
+}
+
+/**
+ * Links sharing the same list of formats after merging; they will all get
+ * the same format.
+ */
+typedef struct FormatGroup {
+    AVFilterFormats *formats;
+    enum AVMediaType type;
+    int choice;                 ///< index of the chosen format in formats
+} FormatGroup;
+
+/**
+ * A filter whose input and output have different lists of formats, and
+ * which converts its input format to its output format.
+ */
+typedef struct FormatEdge {
+    AVFilterContext *filter;
+    int src, dst;               ///< indexes of the input and output groups
+} FormatEdge;
+
+static int find_format_group(FormatGroup *groups, int *nb_groups,
+                             AVFilterLink *link)
+{
+    int i;
+
+    if (!link || !link->in_formats ||
+        (link->type != AVMEDIA_TYPE_VIDEO && link->type != AVMEDIA_TYPE_AUDIO))
+        return -1;
+    for (i = 0; i < *nb_groups; i++)
+        if (groups[i].formats == link->in_formats)
+            return i;
+    groups[i].formats = link->in_formats;
+    groups[i].type    = link->type;
+    groups[i].choice  = 0;
+    return (*nb_groups)++;
+}
+
+/**
+ * Compute the cost of the conversions around group g if it used the format
+ * of index idx. If nbr_best is set, assume the other groups use their best
+ * format for it, instead of their current choice.
+ */
+static int group_cost(FormatGroup *groups, FormatEdge *edges, int nb_edges,
+                      int g, int idx, int nbr_best)
+{
+    int fmt = groups[g].formats->formats[idx];
+    int i, k, cost = 0;
+
+    for (i = 0; i < nb_edges; i++) {
+        int nbr = edges[i].src == g ? edges[i].dst :
+                  edges[i].dst == g ? edges[i].src : -1;
+        AVFilterFormats *nbr_fmts;
+        int best = INT_MAX;
+
+        if (nbr < 0)
+            continue;
+        nbr_fmts = groups[nbr].formats;
+        for (k = 0; k < nbr_fmts->format_count; k++) {
+            int c;
+            if (!nbr_best && k != groups[nbr].choice)
+                continue;
+            c = edges[i].src == g ?
+                conversion_cost(groups[g].type, fmt, nbr_fmts->formats[k]) :
+                conversion_cost(groups[g].type, nbr_fmts->formats[k], fmt);
+            best = FFMIN(best, c);
+        }
+        if (best != INT_MAX)
+            cost += best;
+    }
+    return cost;
+}
+
+/**
+ * Choose the formats of the links so that the total cost of the
+ * conversions done in the graph is minimal, instead of choosing each
+ * format independently.
+ *
+ * Every group starts with the format which would be the best if its
+ * neighbours could adapt to it, then the groups are improved one at a time
+ * until no change lowers the cost.
+ */
+static int choose_formats(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    FormatGroup *groups;
+    FormatEdge  *edges;
+    int nb_links = 0, nb_groups = 0, nb_edges = 0, nb_conversions = 0;
+    int i, j, k, pass, changed;
+
+    for (i = 0; i < graph->filter_count; i++)
+        nb_links += graph->filters[i]->nb_outputs;
+    groups = av_malloc(nb_links * sizeof(*groups));
+    edges  = av_malloc(nb_links * sizeof(*edges));
+    if (nb_links && (!groups || !edges)) {
+        av_free(groups);
+        av_free(edges);
+        return AVERROR(ENOMEM);
+    }
+
+    for (i = 0; i < graph->filter_count; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        int src;
+
+        for (j = 0; j < filter->nb_outputs; j++)
+            find_format_group(groups, &nb_groups, filter->outputs[j]);
+        if (!filter->nb_inputs ||
+            (src = find_format_group(groups, &nb_groups, filter->inputs[0])) < 0)
+            continue;
+        for (j = 0; j < filter->nb_outputs; j++) {
+            int dst = find_format_group(groups, &nb_groups, filter->outputs[j]);
+            if (dst < 0 || dst == src || groups[dst].type != groups[src].type)
+                continue;
+            edges[nb_edges].filter = filter;
+            edges[nb_edges].src    = src;
+            edges[nb_edges].dst    = dst;
+            nb_edges++;
+        }
+    }
+
+    for (i = 0; i < nb_groups; i++) {
+        int best_cost = INT_MAX;
+        for (k = 0; k < groups[i].formats->format_count; k++) {
+            int cost = group_cost(groups, edges, nb_edges, i, k, 1);
+            if (cost < best_cost) {
+                best_cost        = cost;
+                groups[i].choice = k;
+            }
+        }
+    }
+
+    for (pass = 0; pass < 16; pass++) {
+        changed = 0;
+        for (i = 0; i < nb_groups; i++) {
+            int best_cost = group_cost(groups, edges, nb_edges, i, groups[i].choice, 0);
+            for (k = 0; k < groups[i].formats->format_count; k++) {
+                int cost = group_cost(groups, edges, nb_edges, i, k, 0);
+                if (cost < best_cost) {
+                    best_cost        = cost;
+                    groups[i].choice = k;
+                    changed          = 1;
+                }
+            }
+        }
+        if (!changed)
+            break;
+    }
+
+    for (i = 0; i < nb_groups; i++) {
+        AVFilterFormats *fmts = groups[i].formats;
+        if (!fmts->format_count)
+            continue;
+        fmts->formats[0]   = fmts->formats[groups[i].choice];
+        fmts->format_count = 1;
+    }
+
+    for (i = 0; i < nb_edges; i++) {
+        enum AVMediaType type = groups[edges[i].src].type;
+        int src = groups[edges[i].src].formats->formats[0];
+        int dst = groups[edges[i].dst].formats->formats[0];
+
+        if (!groups[edges[i].src].formats->format_count ||
+            !groups[edges[i].dst].formats->format_count || src == dst)
+            continue;
+        nb_conversions++;
+        av_log(log_ctx, AV_LOG_VERBOSE, "'%s' converts %s to %s\n",
+               edges[i].filter->name,
+               type == AVMEDIA_TYPE_VIDEO ? av_get_pix_fmt_name(src) :
+                                            av_get_sample_fmt_name(src),
+               type == AVMEDIA_TYPE_VIDEO ? av_get_pix_fmt_name(dst) :
+                                            av_get_sample_fmt_name(dst));
+    }
+    if (nb_edges)
+        av_log(log_ctx, AV_LOG_VERBOSE, "%d format conversion(s) in the graph\n",
+               nb_conversions);
+
+    av_free(groups);
+    av_free(edges);
+    return 0;
+}
+
 static int pick_formats(AVFilterGraph *graph)
 {
     int i, j, ret;
@@ -832,6 +1051,10 @@ static int graph_config_formats(AVFilterGraph *graph, AVClass *log_ctx)
     swap_samplerates(graph);
     swap_channel_layouts(graph);
 
+    /* choose the pixel and sample formats for the whole graph at once */
+    if ((ret = choose_formats(graph, log_ctx)) < 0)
+        return ret;
+
     if ((ret = pick_formats(graph)) < 0)
         return ret;
 
@@ -855,6 +1078,9 @@ static int ff_avfilter_graph_config_pointers(AVFilterGraph *graph,
         for (j = 0; j < f->nb_outputs; j++) {
             f->outputs[j]->graph    = graph;
             f->outputs[j]->age_index= -1;
+            /* buffers allocated while configuring the links */
+            if (graph->nb_pipeline_fifos && f->outputs[j]->pool)
+                ff_pool_set_threaded(f->outputs[j]->pool);
         }
         if (!f->nb_outputs) {
             if (f->nb_inputs > INT_MAX - sink_links_count)
@@ -918,6 +1144,123 @@ static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+#define PIPELINE_QUEUE_SIZE 4
+
+/**
+ * Check that the part of the graph feeding f, up to the sources or the
+ * pipeline fifos, is only reachable through f, so that it can be driven by
+ * a single thread.
+ */
+static int can_run_in_thread(AVFilterGraph *graph, AVFilterContext *f)
+{
+    int i;
+
+    if (is_pipeline_fifo(graph, f))
+        return 1;
+    if (f->nb_outputs != 1)
+        return 0;
+    for (i = 0; i < f->nb_inputs; i++)
+        if (!can_run_in_thread(graph, f->inputs[i]->src))
+            return 0;
+    return 1;
+}
+
+/**
+ * Cut video links with threaded fifos, so that the filters before each
+ * of them are run by a worker thread.
+ */
+static int graph_insert_pipeline_fifos(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int i, j, ret, nb_filters = graph->filter_count;
+    char args[16];
+
+    snprintf(args, sizeof(args), "%d", PIPELINE_QUEUE_SIZE);
+
+    for (i = 0; i < nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        /* cutting in front of a sink or a fifo only adds a copy of the queue */
+        if (!f->nb_outputs || !strcmp(f->filter->name, "fifo"))
+            continue;
+
+        for (j = 0; j < f->nb_inputs; j++) {
+            AVFilterLink *link = f->inputs[j];
+            AVFilterContext *fifo_ctx, **fifos;
+            char name[32];
+
+            if (graph->nb_pipeline_fifos >= graph->pipeline_threads - 1)
+                return 0;
+            if (link->type != AVMEDIA_TYPE_VIDEO || !link->src->nb_inputs ||
+                !can_run_in_thread(graph, link->src))
+                continue;
+
+            fifos = av_realloc(graph->pipeline_fifos,
+                               (graph->nb_pipeline_fifos + 1) * sizeof(*fifos));
+            if (!fifos)
+                return AVERROR(ENOMEM);
+            graph->pipeline_fifos = fifos;
+
+            snprintf(name, sizeof(name), "pipeline fifo %d",
+                     graph->nb_pipeline_fifos);
+            ret = avfilter_graph_create_filter(&fifo_ctx,
+                                               avfilter_get_by_name("fifo"),
+                                               name, args, NULL, graph);
+            if (ret < 0)
+                return ret;
+            ret = avfilter_insert_filter(link, fifo_ctx, 0, 0);
+            if (ret < 0)
+                return ret;
+
+            graph->pipeline_fifos[graph->nb_pipeline_fifos++] = fifo_ctx;
+            av_log(log_ctx, AV_LOG_VERBOSE, "Running '%s' and its inputs "
+                   "in a separate thread\n", link->src->name);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Count the pipeline fifos before f. The filters run by a pipeline thread
+ * have a single output, so the graph is walked as a tree.
+ */
+static int count_pipeline_fifos_before(AVFilterGraph *graph, AVFilterContext *f)
+{
+    int i, n = 0;
+
+    for (i = 0; i < f->nb_inputs; i++)
+        n += is_pipeline_fifo(graph, f->inputs[i]->src) +
+             count_pipeline_fifos_before(graph, f->inputs[i]->src);
+    return n;
+}
+
+/**
+ * Sort the pipeline fifos from the sinks to the sources: a pipeline thread
+ * waits for the fifos before its own, so pausing them in this order cannot
+ * deadlock.
+ */
+static int sort_pipeline_fifos(AVFilterGraph *graph)
+{
+    AVFilterContext **fifos = graph->pipeline_fifos;
+    int i, j, *depth = av_malloc(graph->nb_pipeline_fifos * sizeof(*depth));
+
+    if (!depth)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < graph->nb_pipeline_fifos; i++) {
+        AVFilterContext *f = fifos[i];
+        int d = count_pipeline_fifos_before(graph, f);
+
+        for (j = i; j > 0 && depth[j - 1] < d; j--) {
+            fifos[j] = fifos[j - 1];
+            depth[j] = depth[j - 1];
+        }
+        fifos[j] = f;
+        depth[j] = d;
+    }
+    av_free(depth);
+    return 0;
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
@@ -926,25 +1269,53 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = graph_insert_fifos(graphctx, log_ctx)) < 0)
         return ret;
+    if (CONFIG_FIFO_FILTER && graphctx->pipeline_threads > 1) {
+        if ((ret = graph_insert_pipeline_fifos(graphctx, log_ctx)) < 0 ||
+            (ret = sort_pipeline_fifos(graphctx)) < 0)
+            return ret;
+    }
     if ((ret = graph_config_formats(graphctx, log_ctx)))
         return ret;
     if ((ret = graph_config_links(graphctx, log_ctx)))
         return ret;
     if ((ret = ff_avfilter_graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if (graphctx->profiling && (ret = graph_alloc_stats(graphctx)) < 0)
+        return ret;
 
     return 0;
 }
 
-int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
+/**
+ * Keep the pipeline threads out of the filters, so that the caller can
+ * change their state.
+ */
+static void pause_pipeline(AVFilterGraph *graph)
 {
-    int i, r = AVERROR(ENOSYS);
+#if CONFIG_FIFO_FILTER
+    int i;
 
-    if(!graph)
-        return r;
+    for (i = 0; i < graph->nb_pipeline_fifos; i++)
+        ff_fifo_pause(graph->pipeline_fifos[i]);
+#endif
+}
+
+static void resume_pipeline(AVFilterGraph *graph)
+{
+#if CONFIG_FIFO_FILTER
+    int i;
+
+    for (i = graph->nb_pipeline_fifos - 1; i >= 0; i--)
+        ff_fifo_resume(graph->pipeline_fifos[i]);
+#endif
+}
+
+static int send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
+{
+    int i, r = AVERROR(ENOSYS);
 
     if((flags & AVFILTER_CMD_FLAG_ONE) && !(flags & AVFILTER_CMD_FLAG_FAST)) {
-        r=avfilter_graph_send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
+        r=send_command(graph, target, cmd, arg, res, res_len, flags | AVFILTER_CMD_FLAG_FAST);
         if(r != AVERROR(ENOSYS))
             return r;
     }
@@ -966,6 +1337,20 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     return r;
 }
 
+int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
+{
+    int r;
+
+    if(!graph)
+        return AVERROR(ENOSYS);
+
+    pause_pipeline(graph);
+    r = send_command(graph, target, cmd, arg, res, res_len, flags);
+    resume_pipeline(graph);
+
+    return r;
+}
+
 int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
 {
     int i;
@@ -973,6 +1358,7 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
     if(!graph)
         return 0;
 
+    pause_pipeline(graph);
     for (i = 0; i < graph->filter_count; i++) {
         AVFilterContext *filter = graph->filters[i];
         if(filter && (!strcmp(target, "all") || !strcmp(target, filter->name) || !strcmp(target, filter->filter->name))){
@@ -987,9 +1373,10 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
             (*que)->flags   = flags;
             (*que)->next    = next;
             if(flags & AVFILTER_CMD_FLAG_ONE)
-                return 0;
+                break;
         }
     }
+    resume_pipeline(graph);
 
     return 0;
 }
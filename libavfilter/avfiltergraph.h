@@ -43,6 +43,12 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    int pipeline_threads;             ///< set by avfilter_graph_set_pipeline()
+    AVFilterContext **pipeline_fifos; ///< threaded fifos inserted by avfilter_graph_config()
+    int nb_pipeline_fifos;
+
+    int profiling;
 } AVFilterGraph;
 
 /**
@@ -93,6 +99,40 @@ int avfilter_graph_create_filter(AVFilterContext **filt_ctx, AVFilter *filt,
  */
 void avfilter_graph_set_auto_convert(AVFilterGraph *graph, unsigned flags);
 
+/**
+ * Run the graph as a pipeline of up to nb_threads threads.
+ *
+ * When the graph is configured, threaded fifo filters are inserted on
+ * video links so that each part of the graph between them is driven by
+ * its own thread, and consecutive frames can be processed by different
+ * filters at the same time. Frames leave the graph in the same order and
+ * with the same timestamps as without pipelining.
+ *
+ * Must be called before avfilter_graph_config(). It has no effect when
+ * libavfilter is built without threads or atomic operations.
+ *
+ * @param nb_threads  maximum number of threads, including the caller's;
+ *                    0 or 1 disable pipelining (the default)
+ */
+void avfilter_graph_set_pipeline(AVFilterGraph *graph, int nb_threads);
+
+/**
+ * Enable or disable the profiling counters of the filters of a graph.
+ *
+ * When enabled, each filter of the graph, including the ones inserted
+ * automatically by avfilter_graph_config(), gets an AVFilterStats in its
+ * stats field, updated as the frames go through the graph. Disabling
+ * profiling frees the counters.
+ *
+ * Must not be called while frames are being processed. In a pipelined
+ * graph, the worker threads keep updating the counters of their filters
+ * until they are stopped by avfilter_graph_free(), so the counters read
+ * before are only a snapshot.
+ *
+ * @return >= 0 on success, a negative AVERROR code on failure
+ */
+int avfilter_graph_set_profiling(AVFilterGraph *graph, int enable);
+
 enum {
     AVFILTER_AUTO_CONVERT_ALL  =  0, /**< all automatic conversions enabled */
     AVFILTER_AUTO_CONVERT_NONE = -1, /**< all automatic conversions disabled */
@@ -213,6 +253,9 @@ int avfilter_graph_parse2(AVFilterGraph *graph, const char *filters,
  * @param arg    the argument for the command
  * @param res    a buffer with size res_size where the filter(s) can return a response.
  *
+ * In a pipelined graph, the pipeline threads are kept out of the filters
+ * while the command is processed.
+ *
  * @returns >=0 on success otherwise an error code.
  *              AVERROR(ENOSYS) on unsupported commands
  */
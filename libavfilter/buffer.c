@@ -20,6 +20,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
 #include "libavutil/audioconvert.h"
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
@@ -30,6 +32,42 @@
 #include "audio.h"
 #include "avcodec.h"
 
+/* Buffers can be referenced and released by the threads of a pipelined
+ * graph at the same time, so their reference count is updated atomically
+ * when possible; avfilter_graph_set_pipeline() is a no-op otherwise. */
+static unsigned buffer_ref_add(AVFilterBuffer *buf, int n)
+{
+#if HAVE_ATOMICS_GCC
+    return __sync_add_and_fetch(&buf->refcount, n);
+#else
+    return buf->refcount += n;
+#endif
+}
+
+void ff_pool_set_threaded(AVFilterPool *pool)
+{
+#if HAVE_PTHREADS
+    if (!pool->threaded && !pthread_mutex_init(&pool->lock, NULL))
+        pool->threaded = 1;
+#endif
+}
+
+void ff_pool_lock(AVFilterPool *pool)
+{
+#if HAVE_PTHREADS
+    if (pool->threaded)
+        pthread_mutex_lock(&pool->lock);
+#endif
+}
+
+void ff_pool_unlock(AVFilterPool *pool)
+{
+#if HAVE_PTHREADS
+    if (pool->threaded)
+        pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
 void ff_avfilter_default_free_buffer(AVFilterBuffer *ptr)
 {
     if (ptr->extended_data != ptr->data)
@@ -74,11 +112,12 @@ AVFilterBufferRef *avfilter_ref_buffer(AVFilterBufferRef *ref, int pmask)
             ret->extended_data = ret->data;
     }
     ret->perms &= pmask;
-    ret->buf->refcount ++;
+    buffer_ref_add(ret->buf, 1);
     return ret;
 }
 
-void ff_free_pool(AVFilterPool *pool)
+/* must be called with the pool locked, unlocks it */
+static void free_pool(AVFilterPool *pool)
 {
     int i;
 
@@ -103,8 +142,15 @@ void ff_free_pool(AVFilterPool *pool)
 
     if (!--pool->refcount) {
         av_assert0(!pool->count);
+        ff_pool_unlock(pool);
+#if HAVE_PTHREADS
+        if (pool->threaded)
+            pthread_mutex_destroy(&pool->lock);
+#endif
         av_free(pool);
+        return;
     }
+    ff_pool_unlock(pool);
 }
 
 static void store_in_pool(AVFilterBufferRef *ref)
@@ -112,6 +158,7 @@ static void store_in_pool(AVFilterBufferRef *ref)
     int i;
     AVFilterPool *pool= ref->buf->priv;
 
+    ff_pool_lock(pool);
     av_assert0(ref->buf->data[0]);
     av_assert0(pool->refcount>0);
 
@@ -135,23 +182,33 @@ static void store_in_pool(AVFilterBufferRef *ref)
         }
     }
     if (pool->draining) {
-        ff_free_pool(pool);
-    } else
+        free_pool(pool);
+    } else {
         --pool->refcount;
+        ff_pool_unlock(pool);
+    }
+}
+
+void ff_free_pool(AVFilterPool *pool)
+{
+    ff_pool_lock(pool);
+    free_pool(pool);
 }
 
 void avfilter_unref_buffer(AVFilterBufferRef *ref)
 {
+    int last;
+
     if (!ref)
         return;
     av_assert0(ref->buf->refcount > 0);
-    if (!(--ref->buf->refcount)) {
-        if (!ref->buf->free) {
-            store_in_pool(ref);
-            return;
-        }
-        ref->buf->free(ref->buf);
+    last = !buffer_ref_add(ref->buf, -1);
+    if (last && !ref->buf->free) {
+        store_in_pool(ref);
+        return;
     }
+    if (last)
+        ref->buf->free(ref->buf);
     if (ref->extended_data != ref->data)
         av_freep(&ref->extended_data);
     av_freep(&ref->video);
@@ -31,15 +31,48 @@
 #include "video.h"
 #include "avcodec.h"
 
+#include "config.h"
 #include "libavutil/audioconvert.h"
 #include "libavutil/fifo.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#if HAVE_PTHREADS
+/**
+ * Buffers pushed with a free callback of the caller may be released by a
+ * pipeline thread, which the callback is not prepared for. The callback is
+ * swapped for one queueing the buffers, and they are freed by the next
+ * call to av_buffersrc_add_ref() instead, in the caller's thread.
+ */
+typedef struct ReleasedBuffer {
+    AVFilterBuffer *buf;
+    void (*free)(AVFilterBuffer *buf);  ///< free callback of the caller
+    void *priv;                         ///< private data of the caller
+    struct ReleaseQueue   *queue;
+    struct ReleasedBuffer *next;
+} ReleasedBuffer;
+
+typedef struct ReleaseQueue {
+    pthread_mutex_t lock;
+    int refcount;                       ///< the buffer source and its buffers
+    int orphan;                         ///< the buffer source was freed
+    ReleasedBuffer *released;
+} ReleaseQueue;
+#endif
+
 typedef struct {
     const AVClass    *class;
     AVFifoBuffer     *fifo;
+#if HAVE_PTHREADS
+    /* frames can be added while a pipeline thread requests them */
+    pthread_mutex_t   lock;
+    ReleaseQueue     *release;
+#endif
     AVRational        time_base;     ///< time_base to set in the output link
     AVRational        frame_rate;    ///< frame_rate to set in the output link
     unsigned          nb_failed_requests;
@@ -74,6 +107,145 @@ typedef struct {
         return AVERROR(EINVAL);\
     }
 
+static void lock(BufferSourceContext *c)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&c->lock);
+#endif
+}
+
+static void unlock(BufferSourceContext *c)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&c->lock);
+#endif
+}
+
+static int is_pipelined(AVFilterContext *s)
+{
+    return s->outputs[0]->graph && s->outputs[0]->graph->nb_pipeline_fifos;
+}
+
+static void input_pushed(AVFilterContext *s, int eof)
+{
+#if CONFIG_FIFO_FILTER
+    AVFilterGraph *graph = s->outputs[0]->graph;
+    int i;
+
+    for (i = 0; i < graph->nb_pipeline_fifos; i++)
+        ff_fifo_input_pushed(graph->pipeline_fifos[i], eof);
+#endif
+}
+
+static void input_taken(AVFilterContext *s)
+{
+#if CONFIG_FIFO_FILTER
+    AVFilterGraph *graph = s->outputs[0]->graph;
+    int i;
+
+    for (i = 0; i < graph->nb_pipeline_fifos; i++)
+        ff_fifo_input_taken(graph->pipeline_fifos[i]);
+#endif
+}
+
+#if HAVE_PTHREADS
+static void release_queue_unref(ReleaseQueue *q)
+{
+    int refcount;
+
+    pthread_mutex_lock(&q->lock);
+    refcount = --q->refcount;
+    pthread_mutex_unlock(&q->lock);
+    if (!refcount) {
+        pthread_mutex_destroy(&q->lock);
+        av_free(q);
+    }
+}
+
+static void free_released_buffer(ReleasedBuffer *r)
+{
+    AVFilterBuffer *buf = r->buf;
+    ReleaseQueue   *q   = r->queue;
+
+    buf->free = r->free;
+    buf->priv = r->priv;
+    av_free(r);
+    buf->free(buf);
+    release_queue_unref(q);
+}
+
+static void queue_released_buffer(AVFilterBuffer *buf)
+{
+    ReleasedBuffer *r = buf->priv;
+    ReleaseQueue   *q = r->queue;
+    int orphan;
+
+    pthread_mutex_lock(&q->lock);
+    if (!(orphan = q->orphan)) {
+        r->next     = q->released;
+        q->released = r;
+    }
+    pthread_mutex_unlock(&q->lock);
+    /* the buffer outlived the graph, nobody will free it later */
+    if (orphan)
+        free_released_buffer(r);
+}
+#endif
+
+static void free_released_buffers(BufferSourceContext *c, int orphan)
+{
+#if HAVE_PTHREADS
+    ReleasedBuffer *r, *next;
+
+    if (!c->release)
+        return;
+    pthread_mutex_lock(&c->release->lock);
+    r = c->release->released;
+    c->release->released = NULL;
+    c->release->orphan  |= orphan;
+    pthread_mutex_unlock(&c->release->lock);
+
+    for (; r; r = next) {
+        next = r->next;
+        free_released_buffer(r);
+    }
+#endif
+}
+
+/**
+ * Make the buffer freed by the caller's thread if its last reference is
+ * released by a pipeline thread.
+ */
+static int defer_caller_free(BufferSourceContext *c, AVFilterBuffer *buf)
+{
+#if HAVE_PTHREADS
+    ReleasedBuffer *r;
+
+    if (!buf->free || buf->free == ff_avfilter_default_free_buffer ||
+        buf->free == queue_released_buffer)
+        return 0;
+    if (!c->release) {
+        if (!(c->release = av_mallocz(sizeof(*c->release))))
+            return AVERROR(ENOMEM);
+        pthread_mutex_init(&c->release->lock, NULL);
+        c->release->refcount = 1;
+    }
+    if (!(r = av_mallocz(sizeof(*r))))
+        return AVERROR(ENOMEM);
+    r->buf   = buf;
+    r->free  = buf->free;
+    r->priv  = buf->priv;
+    r->queue = c->release;
+    pthread_mutex_lock(&c->release->lock);
+    c->release->refcount++;
+    pthread_mutex_unlock(&c->release->lock);
+
+    buf->free = queue_released_buffer;
+    buf->priv = r;
+#endif
+    return 0;
+}
+
 int av_buffersrc_add_frame(AVFilterContext *buffer_src,
                            const AVFrame *frame, int flags)
 {
@@ -104,17 +276,18 @@ int av_buffersrc_add_ref(AVFilterContext *s, AVFilterBufferRef *buf, int flags)
     AVFilterBufferRef *to_free = NULL;
     int ret;
 
+    free_released_buffers(c, 0);
+
     if (!buf) {
+        lock(c);
         c->eof = 1;
+        unlock(c);
+        if (is_pipelined(s))
+            input_pushed(s, 1);
         return 0;
     } else if (c->eof)
         return AVERROR(EINVAL);
 
-    if (!av_fifo_space(c->fifo) &&
-        (ret = av_fifo_realloc2(c->fifo, av_fifo_size(c->fifo) +
-                                         sizeof(buf))) < 0)
-        return ret;
-
     if (!(flags & AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT)) {
         switch (s->outputs[0]->type) {
         case AVMEDIA_TYPE_VIDEO:
@@ -128,15 +301,21 @@ int av_buffersrc_add_ref(AVFilterContext *s, AVFilterBufferRef *buf, int flags)
             return AVERROR(EINVAL);
         }
     }
-    if (!(flags & AV_BUFFERSRC_FLAG_NO_COPY))
+    if (!(flags & AV_BUFFERSRC_FLAG_NO_COPY)) {
         to_free = buf = ff_copy_buffer_ref(s->outputs[0], buf);
+    } else if (is_pipelined(s) && (ret = defer_caller_free(c, buf->buf)) < 0) {
+        return ret;
+    }
     if(!buf)
         return -1;
 
-    if ((ret = av_fifo_generic_write(c->fifo, &buf, sizeof(buf), NULL)) < 0) {
-        avfilter_unref_buffer(to_free);
-        return ret;
-    }
+    lock(c);
+    if (!av_fifo_space(c->fifo) &&
+        (ret = av_fifo_realloc2(c->fifo, av_fifo_size(c->fifo) +
+                                         sizeof(buf))) < 0)
+        goto fail;
+    if ((ret = av_fifo_generic_write(c->fifo, &buf, sizeof(buf), NULL)) < 0)
+        goto fail;
     c->nb_failed_requests = 0;
     if (c->warning_limit &&
         av_fifo_size(c->fifo) / sizeof(buf) >= c->warning_limit) {
@@ -146,8 +325,15 @@ int av_buffersrc_add_ref(AVFilterContext *s, AVFilterBufferRef *buf, int flags)
                (char *)av_x_if_null(s->name, s->filter->name));
         c->warning_limit *= 10;
     }
+    unlock(c);
+    if (is_pipelined(s))
+        input_pushed(s, 0);
 
     return 0;
+fail:
+    unlock(c);
+    avfilter_unref_buffer(to_free);
+    return ret;
 }
 
 #ifdef FF_API_BUFFERSRC_BUFFER
@@ -159,7 +345,13 @@ int av_buffersrc_buffer(AVFilterContext *s, AVFilterBufferRef *buf)
 
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src)
 {
-    return ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
+    BufferSourceContext *c = buffer_src->priv;
+    unsigned ret;
+
+    lock(c);
+    ret = c->nb_failed_requests;
+    unlock(c);
+    return ret;
 }
 
 #define OFFSET(x) offsetof(BufferSourceContext, x)
@@ -184,6 +376,9 @@ static av_cold int init_video(AVFilterContext *ctx, const char *args)
     int ret, n = 0;
 
     c->class = &buffer_class;
+#if HAVE_PTHREADS
+    pthread_mutex_init(&c->lock, NULL);
+#endif
 
     if (!args) {
         av_log(ctx, AV_LOG_ERROR, "Arguments required\n");
@@ -250,6 +445,9 @@ static av_cold int init_audio(AVFilterContext *ctx, const char *args)
 
     s->class = &abuffer_class;
     av_opt_set_defaults(s);
+#if HAVE_PTHREADS
+    pthread_mutex_init(&s->lock, NULL);
+#endif
 
     if ((ret = av_set_options_string(s, args, "=", ":")) < 0)
         goto fail;
@@ -300,6 +498,12 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_fifo_free(s->fifo);
     s->fifo = NULL;
     av_freep(&s->sws_param);
+#if HAVE_PTHREADS
+    free_released_buffers(s, 1);
+    if (s->release)
+        release_queue_unref(s->release);
+    pthread_mutex_destroy(&s->lock);
+#endif
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -360,13 +564,23 @@ static int request_frame(AVFilterLink *link)
     AVFilterBufferRef *buf;
     int ret = 0;
 
+    lock(c);
     if (!av_fifo_size(c->fifo)) {
-        if (c->eof)
-            return AVERROR_EOF;
-        c->nb_failed_requests++;
-        return AVERROR(EAGAIN);
+        ret = c->eof ? AVERROR_EOF : AVERROR(EAGAIN);
+        if (!c->eof)
+            c->nb_failed_requests++;
+        unlock(c);
+        return ret;
     }
     av_fifo_generic_read(c->fifo, &buf, sizeof(buf), NULL);
+    /* A pipeline thread only asks for the next frame once this one went
+     * through its filters, while the caller already looks for the input
+     * the graph needs: count the request in advance. */
+    if (is_pipelined(link->src) && !av_fifo_size(c->fifo) && !c->eof)
+        c->nb_failed_requests++;
+    unlock(c);
+    if (is_pipelined(link->src))
+        input_taken(link->src);
 
     switch (link->type) {
     case AVMEDIA_TYPE_VIDEO:
@@ -389,8 +603,13 @@ static int request_frame(AVFilterLink *link)
 static int poll_frame(AVFilterLink *link)
 {
     BufferSourceContext *c = link->src->priv;
-    int size = av_fifo_size(c->fifo);
-    if (!size && c->eof)
+    int size, eof;
+
+    lock(c);
+    size = av_fifo_size(c->fifo);
+    eof  = c->eof;
+    unlock(c);
+    if (!size && eof)
         return AVERROR_EOF;
     return size/sizeof(AVFilterBufferRef*);
 }
@@ -23,6 +23,8 @@
  * FIFO buffering filter
  */
 
+#include "config.h"
+
 #include "libavutil/avassert.h"
 #include "libavutil/audioconvert.h"
 #include "libavutil/mathematics.h"
@@ -33,6 +35,10 @@
 #include "internal.h"
 #include "video.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 typedef struct Buf {
     AVFilterBufferRef *buf;
     struct Buf        *next;
@@ -48,6 +54,28 @@ typedef struct {
      */
     AVFilterBufferRef *buf_out;
     int allocated_samples;      ///< number of samples buf_out was allocated for
+
+    /**
+     * Maximum number of frames buffered by the worker thread, 0 if the
+     * fifo is not threaded
+     */
+    int queue_size;
+    int nb_queued;              ///< number of frames in the queue
+#if HAVE_PTHREADS
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    pthread_mutex_t run_lock;   ///< held by the worker while it runs the filters before the fifo
+    AVFilterBufferRef *pending; ///< frame being received by the worker
+    int thread_started;
+    int starved;                ///< the worker got EAGAIN and waits to be woken up
+    unsigned wakeups;           ///< number of times the worker was woken up for new input
+    int pushed;                 ///< frames pushed into the buffer sources and not taken yet
+    int push_mode;              ///< the caller pushes the input and wakes the worker up
+    int draining;               ///< a buffer source of the graph reached EOF
+    int status;                 ///< error returned to the worker, e.g. AVERROR_EOF
+    int stop;                   ///< the worker must exit
+#endif
 } FifoContext;
 
 static av_cold int init(AVFilterContext *ctx, const char *args)
@@ -55,14 +83,120 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     FifoContext *fifo = ctx->priv;
     fifo->last = &fifo->root;
 
+    if (args && ctx->filter->inputs[0].type == AVMEDIA_TYPE_VIDEO) {
+        char *tail;
+        fifo->queue_size = strtol(args, &tail, 10);
+        if (*tail || fifo->queue_size < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid queue size '%s'\n", args);
+            return AVERROR(EINVAL);
+        }
+#if HAVE_PTHREADS
+        if (fifo->queue_size) {
+            pthread_mutex_init(&fifo->lock, NULL);
+            pthread_cond_init(&fifo->cond, NULL);
+            pthread_mutex_init(&fifo->run_lock, NULL);
+        }
+#else
+        if (fifo->queue_size)
+            av_log(ctx, AV_LOG_WARNING, "Threads are not supported, "
+                   "running without a worker thread.\n");
+        fifo->queue_size = 0;
+#endif
+    }
+
     return 0;
 }
 
+void ff_fifo_stop(AVFilterContext *ctx)
+{
+#if HAVE_PTHREADS
+    FifoContext *fifo = ctx->priv;
+
+    if (!fifo->queue_size || !fifo->thread_started)
+        return;
+    pthread_mutex_lock(&fifo->lock);
+    fifo->stop = 1;
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+    pthread_join(fifo->thread, NULL);
+    fifo->thread_started = 0;
+#endif
+}
+
+#if HAVE_PTHREADS
+static void wake_worker(FifoContext *fifo, int pushed, int eof)
+{
+    pthread_mutex_lock(&fifo->lock);
+    fifo->wakeups++;
+    fifo->starved    = 0;
+    fifo->pushed    += pushed;
+    fifo->push_mode |= pushed > 0;
+    fifo->draining  |= eof;
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+}
+#endif
+
+void ff_fifo_input_pushed(AVFilterContext *ctx, int eof)
+{
+#if HAVE_PTHREADS
+    FifoContext *fifo = ctx->priv;
+
+    if (fifo->queue_size)
+        wake_worker(fifo, !eof, eof);
+#endif
+}
+
+void ff_fifo_input_taken(AVFilterContext *ctx)
+{
+#if HAVE_PTHREADS
+    FifoContext *fifo = ctx->priv;
+
+    if (!fifo->queue_size)
+        return;
+    pthread_mutex_lock(&fifo->lock);
+    if (fifo->pushed > 0)
+        fifo->pushed--;
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+#endif
+}
+
+void ff_fifo_pause(AVFilterContext *ctx)
+{
+#if HAVE_PTHREADS
+    FifoContext *fifo = ctx->priv;
+
+    if (fifo->queue_size)
+        pthread_mutex_lock(&fifo->run_lock);
+#endif
+}
+
+void ff_fifo_resume(AVFilterContext *ctx)
+{
+#if HAVE_PTHREADS
+    FifoContext *fifo = ctx->priv;
+
+    if (fifo->queue_size)
+        pthread_mutex_unlock(&fifo->run_lock);
+#endif
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     FifoContext *fifo = ctx->priv;
     Buf *buf, *tmp;
 
+#if HAVE_PTHREADS
+    if (fifo->queue_size) {
+        ff_fifo_stop(ctx);
+        avfilter_unref_bufferp(&fifo->pending);
+        pthread_cond_destroy(&fifo->cond);
+        pthread_mutex_destroy(&fifo->lock);
+        pthread_mutex_destroy(&fifo->run_lock);
+    }
+#endif
+
     for (buf = fifo->root.next; buf; buf = tmp) {
         tmp = buf->next;
         avfilter_unref_bufferp(&buf->buf);
@@ -77,6 +211,13 @@ static int add_to_queue(AVFilterLink *inlink, AVFilterBufferRef *buf)
     FifoContext *fifo = inlink->dst->priv;
 
     inlink->cur_buf = NULL;
+#if HAVE_PTHREADS
+    if (fifo->queue_size) {
+        /* the frame is complete only in end_frame() */
+        fifo->pending = buf;
+        return 0;
+    }
+#endif
     fifo->last->next = av_mallocz(sizeof(Buf));
     if (!fifo->last->next) {
         avfilter_unref_buffer(buf);
@@ -85,10 +226,25 @@ static int add_to_queue(AVFilterLink *inlink, AVFilterBufferRef *buf)
 
     fifo->last = fifo->last->next;
     fifo->last->buf = buf;
+    fifo->nb_queued++;
+    if (inlink->dst->stats)
+        inlink->dst->stats->max_queued = FFMAX(inlink->dst->stats->max_queued,
+                                               fifo->nb_queued);
 
     return 0;
 }
 
+static AVFilterBufferRef *get_video_buffer(AVFilterLink *inlink, int perms,
+                                           int w, int h)
+{
+    FifoContext *fifo = inlink->dst->priv;
+
+    /* the next filter runs in another thread, do not call into it */
+    if (fifo->queue_size)
+        return ff_default_get_video_buffer(inlink, perms, w, h);
+    return ff_null_get_video_buffer(inlink, perms, w, h);
+}
+
 static void queue_pop(FifoContext *s)
 {
     Buf *tmp = s->root.next->next;
@@ -96,10 +252,42 @@ static void queue_pop(FifoContext *s)
         s->last = &s->root;
     av_freep(&s->root.next);
     s->root.next = tmp;
+    s->nb_queued--;
 }
 
 static int end_frame(AVFilterLink *inlink)
 {
+#if HAVE_PTHREADS
+    FifoContext *fifo = inlink->dst->priv;
+    AVFilterGraph *graph = inlink->graph;
+    Buf *entry;
+    int i;
+
+    if (!fifo->pending)
+        return 0;
+    entry = av_mallocz(sizeof(Buf));
+    if (!entry) {
+        avfilter_unref_bufferp(&fifo->pending);
+        return AVERROR(ENOMEM);
+    }
+    entry->buf    = fifo->pending;
+    fifo->pending = NULL;
+
+    pthread_mutex_lock(&fifo->lock);
+    fifo->last->next = entry;
+    fifo->last       = entry;
+    fifo->nb_queued++;
+    if (inlink->dst->stats)
+        inlink->dst->stats->max_queued = FFMAX(inlink->dst->stats->max_queued,
+                                               fifo->nb_queued);
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+
+    /* the workers reading from this fifo may be starved */
+    for (i = 0; i < graph->nb_pipeline_fifos; i++)
+        if (graph->pipeline_fifos[i] != inlink->dst)
+            wake_worker(graph->pipeline_fifos[i]->priv, 0, 0);
+#endif
     return 0;
 }
 
@@ -230,11 +418,126 @@ static int return_audio_frame(AVFilterContext *ctx)
     return ff_filter_samples(link, buf_out);
 }
 
+#if HAVE_PTHREADS
+/**
+ * Pull frames from the input into the queue until it is full, so that the
+ * filters before the fifo run concurrently with the ones after it.
+ */
+static void *worker(void *arg)
+{
+    AVFilterContext *ctx = arg;
+    FifoContext *fifo = ctx->priv;
+    unsigned wakeups;
+    int ret;
+
+    pthread_mutex_lock(&fifo->lock);
+    while (!fifo->stop) {
+        if (fifo->starved || fifo->nb_queued >= fifo->queue_size) {
+            pthread_cond_wait(&fifo->cond, &fifo->lock);
+            continue;
+        }
+        wakeups = fifo->wakeups;
+        pthread_mutex_unlock(&fifo->lock);
+        pthread_mutex_lock(&fifo->run_lock);
+        ret = ff_request_frame(ctx->inputs[0]);
+        pthread_mutex_unlock(&fifo->run_lock);
+        pthread_mutex_lock(&fifo->lock);
+
+        if (ret == AVERROR(EAGAIN)) {
+            /* unless input arrived while the request was failing */
+            if (wakeups == fifo->wakeups)
+                fifo->starved = 1;
+        } else if (ret < 0) {
+            fifo->status = ret;
+            pthread_cond_broadcast(&fifo->cond);
+            break;
+        }
+        pthread_cond_broadcast(&fifo->cond);
+    }
+    pthread_mutex_unlock(&fifo->lock);
+
+    return NULL;
+}
+
+static int request_frame_threaded(AVFilterLink *outlink)
+{
+    FifoContext *fifo = outlink->src->priv;
+    AVFilterBufferRef *buf;
+    int ret, woken = 0;
+
+    pthread_mutex_lock(&fifo->lock);
+    if (!fifo->thread_started) {
+        if ((ret = pthread_create(&fifo->thread, NULL, worker, outlink->src))) {
+            pthread_mutex_unlock(&fifo->lock);
+            return AVERROR(ret);
+        }
+        fifo->thread_started = 1;
+    }
+
+    /* When the caller pushes the input, it also wakes the worker up: only
+     * wait for the pushed frames to be taken, not for them to be filtered,
+     * so that the caller can prepare the next ones meanwhile. Otherwise, or once the input is finished, wake a starved worker up
+     * once and wait for the outcome: a frame, an error or EAGAIN again. */
+    while (!fifo->root.next && !fifo->status && !fifo->stop) {
+        if (fifo->push_mode && !fifo->draining) {
+            if (fifo->starved || !fifo->pushed)
+                break;
+        } else if (fifo->starved) {
+            if (woken)
+                break;
+            fifo->starved = 0;
+            woken         = 1;
+            pthread_cond_broadcast(&fifo->cond);
+        }
+        pthread_cond_wait(&fifo->cond, &fifo->lock);
+    }
+
+    if (!fifo->root.next) {
+        ret = fifo->status ? fifo->status :
+              fifo->stop   ? AVERROR_EOF : AVERROR(EAGAIN);
+        pthread_mutex_unlock(&fifo->lock);
+        return ret;
+    }
+
+    buf = fifo->root.next->buf;
+    queue_pop(fifo);
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+
+    if ((ret = ff_start_frame(outlink, buf)) < 0 ||
+        (ret = ff_draw_slice(outlink, 0, outlink->h, 1)) < 0 ||
+        (ret = ff_end_frame(outlink)) < 0)
+        return ret;
+    return 0;
+}
+#endif
+
+static int poll_frame(AVFilterLink *outlink)
+{
+    FifoContext *fifo = outlink->src->priv;
+
+#if HAVE_PTHREADS
+    if (fifo->queue_size) {
+        int ret;
+        pthread_mutex_lock(&fifo->lock);
+        ret = fifo->nb_queued ? fifo->nb_queued : fifo->status;
+        pthread_mutex_unlock(&fifo->lock);
+        return ret;
+    }
+#endif
+    return ff_poll_frame(outlink->src->inputs[0]);
+}
+
 static int request_frame(AVFilterLink *outlink)
 {
     FifoContext *fifo = outlink->src->priv;
     int ret = 0;
 
+#if HAVE_PTHREADS
+    if (fifo->queue_size)
+        return request_frame_threaded(outlink);
+#endif
+
     if (!fifo->root.next) {
         if ((ret = ff_request_frame(outlink->src->inputs[0])) < 0)
             return ret;
@@ -277,7 +580,7 @@ AVFilter avfilter_vf_fifo = {
 
     .inputs    = (const AVFilterPad[]) {{ .name            = "default",
                                           .type            = AVMEDIA_TYPE_VIDEO,
-                                          .get_video_buffer= ff_null_get_video_buffer,
+                                          .get_video_buffer= get_video_buffer,
                                           .start_frame     = add_to_queue,
                                           .draw_slice      = draw_slice,
                                           .end_frame       = end_frame,
@@ -285,7 +588,8 @@ AVFilter avfilter_vf_fifo = {
                                         { .name = NULL}},
     .outputs   = (const AVFilterPad[]) {{ .name            = "default",
                                           .type            = AVMEDIA_TYPE_VIDEO,
-                                          .request_frame   = request_frame, },
+                                          .request_frame   = request_frame,
+                                          .poll_frame      = poll_frame, },
                                         { .name = NULL}},
 };
 
@@ -24,6 +24,12 @@
  * internal API functions
  */
 
+#include "config.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "avfilter.h"
 #include "avfiltergraph.h"
 #include "formats.h"
@@ -35,6 +41,10 @@ typedef struct AVFilterPool {
     int count;
     int refcount;
     int draining;
+    int threaded;           ///< the pool belongs to a pipelined graph and must be locked
+#if HAVE_PTHREADS
+    pthread_mutex_t lock;
+#endif
 } AVFilterPool;
 
 typedef struct AVFilterCommand {
@@ -269,8 +279,74 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts);
 
 void ff_free_pool(AVFilterPool *pool);
 
+/**
+ * Make a buffer pool lock itself, for pools of pipelined graphs.
+ */
+void ff_pool_set_threaded(AVFilterPool *pool);
+
+/**
+ * Lock/unlock a buffer pool, whose buffers can be released by another
+ * thread of a pipelined graph. No-ops for pools of unpipelined graphs.
+ */
+void ff_pool_lock(AVFilterPool *pool);
+void ff_pool_unlock(AVFilterPool *pool);
+
+/**
+ * Stop and join the worker thread of a threaded fifo filter, if any.
+ * After this call the fifo behaves as if its input had reached EOF.
+ */
+void ff_fifo_stop(AVFilterContext *ctx);
+
+/**
+ * Tell a threaded fifo filter that a frame, or EOF, was pushed into a
+ * buffer source of its graph, waking its worker thread up if it waits for
+ * input. Until EOF is pushed, requests to the fifo then return EAGAIN
+ * instead of waiting for the worker to filter the pushed frames.
+ */
+void ff_fifo_input_pushed(AVFilterContext *ctx, int eof);
+
+/**
+ * Tell a threaded fifo filter that a frame pushed into a buffer source of
+ * its graph was taken by a filter.
+ */
+void ff_fifo_input_taken(AVFilterContext *ctx);
+
+/**
+ * Wait for the worker thread of a threaded fifo filter to be out of the
+ * filters before the fifo and keep it out, until ff_fifo_resume().
+ * The fifos of a graph must be paused from the sinks to the sources.
+ */
+void ff_fifo_pause(AVFilterContext *ctx);
+void ff_fifo_resume(AVFilterContext *ctx);
+
 void ff_command_queue_pop(AVFilterContext *filter);
 
+/**
+ * State of a timed call into a filter callback, for the profiling counters.
+ */
+typedef struct FFProfileTimer {
+    int64_t start;          ///< time when the callback was entered
+    int64_t nested_time;    ///< nested time of the filter at that moment
+} FFProfileTimer;
+
+/**
+ * Start timing a callback of link->dst. Does nothing if the filter has no
+ * profiling counters.
+ */
+void ff_profile_start(AVFilterLink *link, FFProfileTimer *timer);
+
+/**
+ * Stop timing a callback of link->dst, started with ff_profile_start().
+ *
+ * The time of the call is accounted as nested time to link->src if it is
+ * running a callback itself.
+ *
+ * @return the time spent in the callback, not counting the time spent in
+ *         the other filters it called; 0 if the filter has no profiling
+ *         counters
+ */
+int64_t ff_profile_stop(AVFilterLink *link, FFProfileTimer *timer);
+
 /* misc trace functions */
 
 /* #define FF_AVFILTER_TRACE */
@@ -0,0 +1,47 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_OVERLAY_H
+#define AVFILTER_OVERLAY_H
+
+#include <stdint.h>
+
+/// DSP functions used by the overlay filter for the YUV blending.
+typedef struct {
+    /**
+     * Blend w pixels of src on dst, using one alpha value per pixel:
+     * dst = (dst * (255 - alpha) + src * alpha) / 255, rounded to nearest.
+     */
+    void (*blend_row)(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+
+    /**
+     * Same as blend_row() for a plane subsampled by 2 in both directions,
+     * the alpha of each pixel is the average of the 2x2 alpha block at
+     * alpha + 2*x and alpha + alpha_linesize + 2*x.
+     */
+    void (*blend_row_420)(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                          int alpha_linesize, int w);
+} OverlayDSPContext;
+
+void ff_overlay_init_x86(OverlayDSPContext *dsp);
+
+void ff_overlay_blend_row_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w);
+void ff_overlay_blend_row_420_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                int alpha_linesize, int w);
+
+#endif /* AVFILTER_OVERLAY_H */
@@ -30,23 +30,22 @@
 #include "libavutil/intreadwrite.h"
 #include "avfilter.h"
 #include "formats.h"
+#include "hqdn3d.h"
 #include "internal.h"
 #include "video.h"
 
-typedef struct {
-    int16_t coefs[4][512*16];
-    uint16_t *line;
-    uint16_t *frame_prev[3];
-    int hsub, vsub;
-    int depth;
-} HQDN3DContext;
-
 #define RIGHTSHIFT(a,b) (((a)+(((1<<(b))-1)>>1))>>(b))
-#define LOAD(x) ((depth==8 ? src[x] : AV_RN16A(src+(x)*2)) << (16-depth))
-#define STORE(x,val) (depth==8 ? dst[x] = RIGHTSHIFT(val, 16-depth)\
-                    : AV_WN16A(dst+(x)*2, RIGHTSHIFT(val, 16-depth)))
-
-static inline uint32_t lowpass(int prev, int cur, int16_t *coef)
+#define LOAD_ROW(p,x) ((depth==8 ? (p)[x] : AV_RN16A((p)+(x)*2)) << (16-depth))
+/* The filtered value can overshoot by a few units, which is only out of
+ * range in the output and in the 16-bit state for depths above 10. */
+#define CLIP_ANT(val) (depth > 10 ? av_clip_uint16(val) : (val))
+#define STORE_ROW(p,x,val) (depth==8 ? (p)[x] = RIGHTSHIFT(val, 16-depth)\
+                           : AV_WN16A((p)+(x)*2, depth <= 10 ? RIGHTSHIFT(val, 16-depth)\
+                                : av_clip_uintp2(RIGHTSHIFT((int)(val), 16-depth), depth)))
+#define LOAD(x)      LOAD_ROW(src, x)
+#define STORE(x,val) STORE_ROW(dst, x, val)
+
+static inline int lowpass(int prev, int cur, int16_t *coef)
 {
     int d = (prev-cur)>>4;
     return cur + coef[d];
@@ -65,7 +64,7 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
 
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
-            frame_ant[x] = tmp = lowpass(frame_ant[x], LOAD(x), temporal);
+            frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], LOAD(x), temporal));
             STORE(x, tmp);
         }
         src += sstride;
@@ -74,8 +73,49 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
     }
 }
 
+/**
+ * Filter the rows src and src + sstride. The horizontal recursion through
+ * pixel_ant is a chain of dependent table lookups. Two rows are filtered at
+ * once, so that the chains of both rows can execute in parallel; the second
+ * row only depends on the first one through line_ant[x], which is already
+ * computed.
+ */
+av_always_inline
+static void denoise_rows_c(uint8_t *src, uint8_t *dst,
+                           uint16_t *line_ant, uint16_t *frame_ant,
+                           ptrdiff_t w, ptrdiff_t sstride, ptrdiff_t dstride,
+                           int16_t *spatial, int16_t *temporal, int depth)
+{
+    uint8_t *src2 = src + sstride;
+    uint8_t *dst2 = dst + dstride;
+    uint16_t *frame_ant2 = frame_ant + w;
+    uint32_t pixel_ant  = LOAD(0);
+    uint32_t pixel_ant2 = LOAD_ROW(src2, 0);
+    uint32_t tmp;
+    long x;
+
+    for (x = 0; x < w-1; x++) {
+        line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant, spatial));
+        pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial);
+        frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], tmp, temporal));
+        STORE(x, tmp);
+
+        line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant2, spatial));
+        pixel_ant2 = lowpass(pixel_ant2, LOAD_ROW(src2, x+1), spatial);
+        frame_ant2[x] = tmp = CLIP_ANT(lowpass(frame_ant2[x], tmp, temporal));
+        STORE_ROW(dst2, x, tmp);
+    }
+    line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant, spatial));
+    frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], tmp, temporal));
+    STORE(x, tmp);
+    line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant2, spatial));
+    frame_ant2[x] = tmp = CLIP_ANT(lowpass(frame_ant2[x], tmp, temporal));
+    STORE_ROW(dst2, x, tmp);
+}
+
 av_always_inline
-static void denoise_spatial(uint8_t *src, uint8_t *dst,
+static void denoise_spatial(HQDN3DContext *hqdn3d,
+                            uint8_t *src, uint8_t *dst,
                             uint16_t *line_ant, uint16_t *frame_ant,
                             int w, int h, int sstride, int dstride,
                             int16_t *spatial, int16_t *temporal, int depth)
@@ -91,33 +131,49 @@ static void denoise_spatial(uint8_t *src, uint8_t *dst,
      * last frame */
     pixel_ant = LOAD(0);
     for (x = 0; x < w; x++) {
-        line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal);
+        line_ant[x] = tmp = pixel_ant = CLIP_ANT(lowpass(pixel_ant, LOAD(x), spatial));
+        frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], tmp, temporal));
         STORE(x, tmp);
     }
 
-    for (y = 1; y < h; y++) {
+    for (y = 1; y < h - 1; y += 2) {
+        src += sstride;
+        dst += dstride;
+        frame_ant += w;
+        if (hqdn3d->denoise_rows[depth])
+            hqdn3d->denoise_rows[depth](src, dst, line_ant, frame_ant, w,
+                                        sstride, dstride, spatial, temporal);
+        else
+            denoise_rows_c(src, dst, line_ant, frame_ant, w,
+                           sstride, dstride, spatial, temporal, depth);
+        src += sstride;
+        dst += dstride;
+        frame_ant += w;
+    }
+
+    for (; y < h; y++) {
         src += sstride;
         dst += dstride;
         frame_ant += w;
         pixel_ant = LOAD(0);
         for (x = 0; x < w-1; x++) {
-            line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial);
+            line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant, spatial));
             pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial);
-            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal);
+            frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], tmp, temporal));
             STORE(x, tmp);
         }
-        line_ant[x] = tmp = lowpass(line_ant[x], pixel_ant, spatial);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal);
+        line_ant[x] = tmp = CLIP_ANT(lowpass(line_ant[x], pixel_ant, spatial));
+        frame_ant[x] = tmp = CLIP_ANT(lowpass(frame_ant[x], tmp, temporal));
         STORE(x, tmp);
     }
 }
 
 av_always_inline
-static void denoise_depth(uint8_t *src, uint8_t *dst,
+static void denoise_depth(HQDN3DContext *hqdn3d, uint8_t *src, uint8_t *dst,
                           uint16_t *line_ant, uint16_t **frame_ant_ptr,
                           int w, int h, int sstride, int dstride,
-                          int16_t *spatial, int16_t *temporal, int depth)
+                          int16_t *spatial, int16_t *temporal,
+                          int spatial_enabled, int depth)
 {
     long x, y;
     uint16_t *frame_ant = *frame_ant_ptr;
@@ -131,8 +187,8 @@ static void denoise_depth(uint8_t *src, uint8_t *dst,
         frame_ant = *frame_ant_ptr;
     }
 
-    if (spatial[0])
-        denoise_spatial(src, dst, line_ant, frame_ant,
+    if (spatial_enabled)
+        denoise_spatial(hqdn3d, src, dst, line_ant, frame_ant,
                         w, h, sstride, dstride, spatial, temporal, depth);
     else
         denoise_temporal(src, dst, frame_ant,
@@ -141,9 +197,12 @@ static void denoise_depth(uint8_t *src, uint8_t *dst,
 
 #define denoise(...) \
     switch (hqdn3d->depth) {\
-        case  8: denoise_depth(__VA_ARGS__,  8); break;\
-        case  9: denoise_depth(__VA_ARGS__,  9); break;\
-        case 10: denoise_depth(__VA_ARGS__, 10); break;\
+        case  8: denoise_depth(hqdn3d, __VA_ARGS__,  8); break;\
+        case  9: denoise_depth(hqdn3d, __VA_ARGS__,  9); break;\
+        case 10: denoise_depth(hqdn3d, __VA_ARGS__, 10); break;\
+        case 12: denoise_depth(hqdn3d, __VA_ARGS__, 12); break;\
+        case 14: denoise_depth(hqdn3d, __VA_ARGS__, 14); break;\
+        case 16: denoise_depth(hqdn3d, __VA_ARGS__, 16); break;\
     }
 
 static void precalc_coefs(int16_t *ct, double dist25)
@@ -153,15 +212,13 @@ static void precalc_coefs(int16_t *ct, double dist25)
 
     gamma = log(0.25) / log(1.0 - FFMIN(dist25,252.0)/255.0 - 0.00001);
 
-    for (i = -255*16; i <= 255*16; i++) {
+    for (i = -256*16; i <= 256*16; i++) {
         // lowpass() truncates (not rounds) the diff, so +15/32 for the midpoint of the bin.
         double f = (i + 15.0/32.0) / 16.0;
-        simil = 1.0 - FFABS(f) / 255.0;
+        simil = FFMAX(0, 1.0 - FFABS(f) / 255.0);
         C = pow(simil, gamma) * 256.0 * f;
         ct[16*256+i] = lrint(C);
     }
-
-    ct[0] = !!dist25;
 }
 
 #define PARAM1_DEFAULT 4.0
@@ -218,11 +275,19 @@ static int init(AVFilterContext *ctx, const char *args)
         return AVERROR(EINVAL);
     }
 
+    hqdn3d->strength[0] = lum_spac;
+    hqdn3d->strength[1] = lum_tmp;
+    hqdn3d->strength[2] = chrom_spac;
+    hqdn3d->strength[3] = chrom_tmp;
+
     precalc_coefs(hqdn3d->coefs[0], lum_spac);
     precalc_coefs(hqdn3d->coefs[1], lum_tmp);
     precalc_coefs(hqdn3d->coefs[2], chrom_spac);
     precalc_coefs(hqdn3d->coefs[3], chrom_tmp);
 
+    if (HAVE_MMX)
+        ff_hqdn3d_init_x86(hqdn3d);
+
     return 0;
 }
 
@@ -255,6 +320,15 @@ static int query_formats(AVFilterContext *ctx)
         AV_NE( PIX_FMT_YUV420P10BE, PIX_FMT_YUV420P10LE ),
         AV_NE( PIX_FMT_YUV422P10BE, PIX_FMT_YUV422P10LE ),
         AV_NE( PIX_FMT_YUV444P10BE, PIX_FMT_YUV444P10LE ),
+        AV_NE( PIX_FMT_YUV420P12BE, PIX_FMT_YUV420P12LE ),
+        AV_NE( PIX_FMT_YUV422P12BE, PIX_FMT_YUV422P12LE ),
+        AV_NE( PIX_FMT_YUV444P12BE, PIX_FMT_YUV444P12LE ),
+        AV_NE( PIX_FMT_YUV420P14BE, PIX_FMT_YUV420P14LE ),
+        AV_NE( PIX_FMT_YUV422P14BE, PIX_FMT_YUV422P14LE ),
+        AV_NE( PIX_FMT_YUV444P14BE, PIX_FMT_YUV444P14LE ),
+        AV_NE( PIX_FMT_YUV420P16BE, PIX_FMT_YUV420P16LE ),
+        AV_NE( PIX_FMT_YUV422P16BE, PIX_FMT_YUV422P16LE ),
+        AV_NE( PIX_FMT_YUV444P16BE, PIX_FMT_YUV444P16LE ),
         PIX_FMT_NONE
     };
 
@@ -297,7 +371,8 @@ static int end_frame(AVFilterLink *inlink)
                 inpic->video->w >> (!!c * hqdn3d->hsub),
                 inpic->video->h >> (!!c * hqdn3d->vsub),
                 inpic->linesize[c], outpic->linesize[c],
-                hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1]);
+                hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1],
+                hqdn3d->strength[c?2:0] > 0);
     }
 
     if ((ret = ff_draw_slice(outlink, 0, inpic->video->h, 1)) < 0 ||
@@ -327,3 +402,193 @@ AVFilter avfilter_vf_hqdn3d = {
                                           .type             = AVMEDIA_TYPE_VIDEO },
                                         { .name = NULL}},
 };
+
+#ifdef TEST
+
+#include "libavutil/lfg.h"
+
+#undef printf
+
+#define DENOISE_ROWS_C(depth)                                                  \
+static void denoise_rows_c_ ## depth(uint8_t *src, uint8_t *dst,              \
+                                     uint16_t *line_ant, uint16_t *frame_ant, \
+                                     ptrdiff_t w, ptrdiff_t sstride,          \
+                                     ptrdiff_t dstride,                       \
+                                     int16_t *spatial, int16_t *temporal)     \
+{                                                                              \
+    denoise_rows_c(src, dst, line_ant, frame_ant, w, sstride, dstride,        \
+                   spatial, temporal, depth);                                 \
+}
+
+DENOISE_ROWS_C(8)
+DENOISE_ROWS_C(9)
+DENOISE_ROWS_C(10)
+DENOISE_ROWS_C(12)
+DENOISE_ROWS_C(14)
+DENOISE_ROWS_C(16)
+
+typedef void (*DenoiseRowsFunc)(uint8_t *src, uint8_t *dst,
+                                uint16_t *line_ant, uint16_t *frame_ant,
+                                ptrdiff_t w, ptrdiff_t sstride, ptrdiff_t dstride,
+                                int16_t *spatial, int16_t *temporal);
+
+/**
+ * Check that flat areas at the ends of the sample range stay there over
+ * several frames, without the filtered values wrapping around in the
+ * 16-bit line and frame state at the top of the range.
+ */
+static int check_range(int depth, DenoiseRowsFunc denoise_rows,
+                       int16_t *spatial, int16_t *temporal)
+{
+    enum { W = 16 };
+    DECLARE_ALIGNED(16, uint16_t, src)[2 * W];
+    DECLARE_ALIGNED(16, uint16_t, dst)[2 * W];
+    uint16_t line_ant[W], frame_ant[2 * W];
+    int max = (1 << depth) - 1, stride = depth == 8 ? W : W * 2;
+    int values[] = { 0, 1, max - 1, max };
+    int i, f, x;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(values); i++) {
+        int v = values[i];
+
+        for (x = 0; x < 2 * W; x++) {
+            if (depth == 8)
+                ((uint8_t *)src)[x] = v;
+            else
+                src[x] = v;
+            frame_ant[x] = v << (16 - depth);
+        }
+        for (x = 0; x < W; x++)
+            line_ant[x] = v << (16 - depth);
+
+        for (f = 0; f < 8; f++) {
+            denoise_rows((uint8_t *)src, (uint8_t *)dst, line_ant, frame_ant,
+                         W, stride, stride, spatial, temporal);
+            for (x = 0; x < 2 * W; x++) {
+                int out = depth == 8 ? ((uint8_t *)dst)[x] : dst[x];
+                int ant = x < W ? line_ant[x] : frame_ant[x];
+                /* the filtered values overshoot the samples, which the
+                 * state must hold at the top of the range */
+                if (FFABS(out - v) > max >> 8 ||
+                    (v >= max - 1 && FFABS(ant - (v << (16 - depth))) > 256)) {
+                    printf("  value %5d: got %5d, state %5d in frame %d\n",
+                           v, out, ant, f);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check that the optimized row functions give the same output, line and
+ * previous frame as the C ones, for random samples of all the supported
+ * bit depths, and that the filter does not overflow at any depth.
+ */
+int main(void)
+{
+    static const struct {
+        int depth;
+        DenoiseRowsFunc denoise_rows;
+    } depths[] = {
+        {  8, denoise_rows_c_8  }, {  9, denoise_rows_c_9  },
+        { 10, denoise_rows_c_10 }, { 12, denoise_rows_c_12 },
+        { 14, denoise_rows_c_14 }, { 16, denoise_rows_c_16 },
+    };
+    static const int widths[] = { 1, 2, 3, 7, 16, 17, 317, 1920 };
+    static const double strengths[] = { 0, 0.5, 4, 10, 255 };
+    static HQDN3DContext hqdn3d;
+    AVLFG lfg;
+    int d, i, s, x, ret = 0;
+
+    av_lfg_init(&lfg, 0xDEADBEEF);
+
+    if (HAVE_MMX)
+        ff_hqdn3d_init_x86(&hqdn3d);
+
+    for (d = 0; d < FF_ARRAY_ELEMS(depths); d++) {
+        int depth = depths[d].depth;
+        int df    = (depth + 7) / 8;
+
+        printf("depth %2d %s\n", depth,
+               hqdn3d.denoise_rows[depth] ? "optimized" : "C only");
+
+        for (s = 0; s < FF_ARRAY_ELEMS(strengths); s++) {
+            int mismatch;
+
+            precalc_coefs(hqdn3d.coefs[0], strengths[s]);
+            mismatch = check_range(depth, depths[d].denoise_rows,
+                                   hqdn3d.coefs[0] + 0x1000,
+                                   hqdn3d.coefs[0] + 0x1000);
+            if (hqdn3d.denoise_rows[depth])
+                mismatch |= check_range(depth, hqdn3d.denoise_rows[depth],
+                                        hqdn3d.coefs[0] + 0x1000,
+                                        hqdn3d.coefs[0] + 0x1000);
+            printf("  range, strength %5.1f: %s\n", strengths[s],
+                   mismatch ? "FAILED" : "ok");
+            ret |= mismatch;
+        }
+        if (!hqdn3d.denoise_rows[depth])
+            continue;
+
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int w = widths[i];
+            /* two rows of each buffer, for the reference and the tested
+             * function */
+            uint8_t  *src = av_malloc(2 * w * df);
+            uint8_t  *dst[2]       = { av_malloc(2 * w * df), av_malloc(2 * w * df) };
+            uint16_t *line_ant[2]  = { av_malloc(w * 2), av_malloc(w * 2) };
+            uint16_t *frame_ant[2] = { av_malloc(2 * w * 2), av_malloc(2 * w * 2) };
+            int mismatch = 0;
+
+            if (!src || !dst[0] || !dst[1] || !line_ant[0] || !line_ant[1] ||
+                !frame_ant[0] || !frame_ant[1])
+                return 1;
+
+            /* a few rounds per strength, so that the narrow rows also
+             * hit the rounding and clipping cases */
+            for (s = 0; s < 16 * FF_ARRAY_ELEMS(strengths); s++) {
+                int n = FF_ARRAY_ELEMS(strengths);
+                precalc_coefs(hqdn3d.coefs[0], strengths[s % n]);
+                precalc_coefs(hqdn3d.coefs[1], strengths[n - 1 - s / 16 % n]);
+
+                for (x = 0; x < 2 * w; x++) {
+                    int v = av_lfg_get(&lfg) & ((1 << depth) - 1);
+                    if (df == 2)
+                        ((uint16_t *)src)[x] = v;
+                    else
+                        src[x] = v;
+                    frame_ant[0][x] = frame_ant[1][x] = av_lfg_get(&lfg);
+                }
+                for (x = 0; x < w; x++)
+                    line_ant[0][x] = line_ant[1][x] = av_lfg_get(&lfg);
+
+                depths[d].denoise_rows(src, dst[0], line_ant[0], frame_ant[0],
+                                       w, w * df, w * df, hqdn3d.coefs[0] + 0x1000,
+                                       hqdn3d.coefs[1] + 0x1000);
+                hqdn3d.denoise_rows[depth](src, dst[1], line_ant[1], frame_ant[1],
+                                           w, w * df, w * df, hqdn3d.coefs[0] + 0x1000,
+                                           hqdn3d.coefs[1] + 0x1000);
+                if (memcmp(dst[0], dst[1], 2 * w * df) ||
+                    memcmp(line_ant[0], line_ant[1], w * 2) ||
+                    memcmp(frame_ant[0], frame_ant[1], 2 * w * 2))
+                    mismatch = 1;
+            }
+            printf("  width %4d: %s\n", w, mismatch ? "MISMATCH" : "ok");
+            ret |= mismatch;
+
+            av_free(src);
+            av_free(dst[0]);
+            av_free(dst[1]);
+            av_free(line_ant[0]);
+            av_free(line_ant[1]);
+            av_free(frame_ant[0]);
+            av_free(frame_ant[1]);
+        }
+    }
+
+    return ret;
+}
+
+#endif
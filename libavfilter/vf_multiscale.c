@@ -0,0 +1,437 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * multi-output scale filter, producing several sizes of the input in one pass
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/jobpool.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct {
+    int w, h;                   ///< requested size, 0 = input size, -1 = keep aspect
+    struct SwsContext *sws;
+    AVFilterBufferRef *out;     ///< picture being scaled for this output
+    int ret;                    ///< return value of the last scaling
+} ScaleOutput;
+
+typedef struct {
+    ScaleOutput *outs;
+    int nb_outs;
+    unsigned int flags;         ///< sws flags
+    int nb_threads;             ///< number of threads scaling the outputs
+
+    /**
+     * Input formats which are not read directly by the scaler are
+     * converted only once per frame, into conv_fmt, and all the outputs
+     * are scaled from that picture.
+     */
+    enum PixelFormat conv_fmt;  ///< PIX_FMT_NONE if the input is read directly
+    struct SwsContext *conv;
+    uint8_t *conv_data[4];
+    int conv_linesize[4];
+
+    const uint8_t *src[4];      ///< picture all the outputs are scaled from
+    int src_linesize[4];
+    int src_h;
+
+    AVJobPool *pool;            ///< threads scaling the outputs, NULL for one thread
+} MultiScaleContext;
+
+static int scale_output(void *opaque, int i, int thread)
+{
+    MultiScaleContext *s = opaque;
+    ScaleOutput *o = &s->outs[i];
+
+    o->ret = sws_scale(o->sws, s->src, s->src_linesize, 0, s->src_h,
+                       o->out->data, o->out->linesize) < 0 ? AVERROR(EINVAL) : 0;
+    return 0;
+}
+
+/**
+ * Scale all the outputs, the calling thread takes its share of the work.
+ */
+static void scale_outputs(MultiScaleContext *s)
+{
+    int i;
+
+    if (s->pool)
+        avpriv_jobpool_execute(s->pool, scale_output, s, s->nb_outs);
+    else
+        for (i = 0; i < s->nb_outs; i++)
+            scale_output(s, i, 0);
+}
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init(AVFilterContext *ctx, const char *args)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *size, *saveptr = NULL;
+    const char *p;
+    int i, ret;
+
+    s->flags    = SWS_BILINEAR;
+    s->conv_fmt = PIX_FMT_NONE;
+
+    if (!args || !*args) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (!(sizes = av_get_token(&args, ":")))
+        return AVERROR(ENOMEM);
+    for (i = 1, p = sizes; *p; p++)
+        i += *p == '|';
+    if (!(s->outs = av_mallocz(i * sizeof(*s->outs)))) {
+        av_freep(&sizes);
+        return AVERROR(ENOMEM);
+    }
+    for (size = av_strtok(sizes, "|", &saveptr); size;
+         size = av_strtok(NULL, "|", &saveptr)) {
+        ScaleOutput *o = &s->outs[s->nb_outs++];
+
+        if (sscanf(size, "%dx%d", &o->w, &o->h) != 2 &&
+            av_parse_video_size(&o->w, &o->h, size) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'.\n", size);
+            av_freep(&sizes);
+            return AVERROR(EINVAL);
+        }
+        if (o->w < -1 || o->h < -1) {
+            av_log(ctx, AV_LOG_ERROR, "Size values less than -1 are not acceptable.\n");
+            av_freep(&sizes);
+            return AVERROR(EINVAL);
+        }
+    }
+    av_freep(&sizes);
+    if (!s->nb_outs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if ((p = strstr(args, "flags="))) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        char flags[256];
+
+        sscanf(p + 6, "%255[^:]", flags);
+        if ((ret = av_opt_eval_flags(&class, o, flags, &s->flags)) < 0)
+            return ret;
+    }
+    s->nb_threads = s->nb_outs;
+    if ((p = strstr(args, "threads=")))
+        s->nb_threads = av_clip(strtol(p + 8, NULL, 10), 1, s->nb_outs);
+
+    for (i = 0; i < s->nb_outs; i++) {
+        char name[32];
+        AVFilterPad pad = { 0 };
+
+        snprintf(name, sizeof(name), "output%d", i);
+        pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.name = av_strdup(name);
+        pad.config_props = config_output;
+
+        ff_insert_outpad(ctx, i, &pad);
+    }
+
+    if (s->nb_threads > 1 &&
+        !(s->pool = avpriv_jobpool_alloc(s->nb_threads, ctx)))
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    avpriv_jobpool_free(&s->pool);
+
+    for (i = 0; i < s->nb_outs; i++) {
+        sws_freeContext(s->outs[i].sws);
+        avfilter_unref_bufferp(&s->outs[i].out);
+    }
+    av_freep(&s->outs);
+    sws_freeContext(s->conv);
+    av_freep(&s->conv_data[0]);
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *in_formats = NULL, *out_formats = NULL;
+    enum PixelFormat pix_fmt;
+    int i, ret;
+
+    for (pix_fmt = 0; pix_fmt < PIX_FMT_NB; pix_fmt++) {
+        if (sws_isSupportedInput(pix_fmt) &&
+            (ret = ff_add_format(&in_formats, pix_fmt)) < 0)
+            goto fail;
+        if (sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&out_formats, pix_fmt)) < 0)
+            goto fail;
+    }
+    ff_formats_ref(in_formats, &ctx->inputs[0]->out_formats);
+    for (i = 0; i < ctx->nb_outputs; i++)
+        ff_formats_ref(out_formats, &ctx->outputs[i]->in_formats);
+    return 0;
+
+fail:
+    ff_formats_unref(&in_formats);
+    ff_formats_unref(&out_formats);
+    return ret;
+}
+
+/**
+ * Tell if the scaler reads the format as it is, without converting each
+ * source line first.
+ */
+static int is_native_planar(const AVPixFmtDescriptor *desc)
+{
+    int i;
+
+    if (desc->flags & (PIX_FMT_RGB | PIX_FMT_PAL | PIX_FMT_BITSTREAM | PIX_FMT_HWACCEL))
+        return 0;
+    for (i = 0; i < desc->nb_components; i++)
+        if (desc->comp[i].plane != i || desc->comp[i].step_minus1 ||
+            desc->comp[i].offset_plus1 != 1 || desc->comp[i].shift ||
+            desc->comp[i].depth_minus1 != 7)
+            return 0;
+    return 1;
+}
+
+/**
+ * Find the format the input should be converted to once before scaling
+ * all the outputs, PIX_FMT_NONE if it is better to read it directly.
+ */
+static enum PixelFormat shared_input_format(AVFilterContext *ctx)
+{
+    const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[ctx->inputs[0]->format];
+    enum PixelFormat pix_fmt;
+    int i;
+
+    if (ctx->nb_outputs < 2 || is_native_planar(desc))
+        return PIX_FMT_NONE;
+    /* only lossless repacking is shared, so that the result is the same as
+     * with separate scalers: RGB and high bit depth input is read directly */
+    if (desc->flags & (PIX_FMT_RGB | PIX_FMT_PAL | PIX_FMT_PSEUDOPAL))
+        return PIX_FMT_NONE;
+    for (i = 0; i < desc->nb_components; i++)
+        if (desc->comp[i].depth_minus1 > 7)
+            return PIX_FMT_NONE;
+
+    /* packed or semi-planar YUV, unpack to the same subsampling */
+    for (pix_fmt = 0; pix_fmt < PIX_FMT_NB; pix_fmt++) {
+        const AVPixFmtDescriptor *d = &av_pix_fmt_descriptors[pix_fmt];
+        if (is_native_planar(d) && sws_isSupportedInput(pix_fmt) &&
+            d->nb_components == desc->nb_components &&
+            d->log2_chroma_w == desc->log2_chroma_w &&
+            d->log2_chroma_h == desc->log2_chroma_h)
+            return pix_fmt;
+    }
+    return PIX_FMT_NONE;
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    int ret;
+
+    sws_freeContext(s->conv);
+    s->conv = NULL;
+    av_freep(&s->conv_data[0]);
+
+    s->conv_fmt = shared_input_format(ctx);
+    if (s->conv_fmt != PIX_FMT_NONE) {
+        s->conv = sws_getContext(inlink->w, inlink->h, inlink->format,
+                                 inlink->w, inlink->h, s->conv_fmt,
+                                 s->flags, NULL, NULL, NULL);
+        if (!s->conv)
+            return AVERROR(EINVAL);
+        if ((ret = av_image_alloc(s->conv_data, s->conv_linesize,
+                                  inlink->w, inlink->h, s->conv_fmt, 16)) < 0)
+            return ret;
+        av_log(ctx, AV_LOG_VERBOSE, "converting %s input to %s once for all outputs\n",
+               av_get_pix_fmt_name(inlink->format), av_get_pix_fmt_name(s->conv_fmt));
+    }
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    ScaleOutput *o = &s->outs[FF_OUTLINK_IDX(outlink)];
+    enum PixelFormat src_fmt = s->conv_fmt != PIX_FMT_NONE ? s->conv_fmt : inlink->format;
+    int64_t w = o->w, h = o->h;
+
+    if (w == -1 && h == -1)
+        w = h = 0;
+    if (!w)
+        w = inlink->w;
+    if (!h)
+        h = inlink->h;
+    if (w == -1)
+        w = av_rescale(h, inlink->w, inlink->h);
+    if (h == -1)
+        h = av_rescale(w, inlink->h, inlink->w);
+    if (w > INT_MAX || h > INT_MAX ||
+        (h * inlink->w) > INT_MAX  ||
+        (w * inlink->h) > INT_MAX) {
+        av_log(ctx, AV_LOG_ERROR, "Rescaled value for width or height is too big.\n");
+        return AVERROR(EINVAL);
+    }
+    outlink->w = w;
+    outlink->h = h;
+
+    sws_freeContext(o->sws);
+    o->sws = sws_getContext(inlink->w, inlink->h, src_fmt,
+                            outlink->w, outlink->h, outlink->format,
+                            s->flags, NULL, NULL, NULL);
+    if (!o->sws)
+        return AVERROR(EINVAL);
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w,
+                                                             outlink->w * inlink->h},
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d fmt:%s -> w:%d h:%d fmt:%s flags:0x%0x\n",
+           FF_OUTLINK_IDX(outlink), inlink->w, inlink->h, av_get_pix_fmt_name(src_fmt),
+           outlink->w, outlink->h, av_get_pix_fmt_name(outlink->format), s->flags);
+    return 0;
+}
+
+static int start_frame(AVFilterLink *inlink, AVFilterBufferRef *picref)
+{
+    return 0;
+}
+
+static int null_draw_slice(AVFilterLink *inlink, int y, int h, int slice_dir)
+{
+    return 0;
+}
+
+static int end_frame(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    AVFilterBufferRef *in = inlink->cur_buf;
+    int i, ret = 0;
+
+    if (in->video->w != inlink->w || in->video->h != inlink->h ||
+        in->format != inlink->format) {
+        av_log(ctx, AV_LOG_ERROR, "Changing the input frame properties is not supported.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < s->nb_outs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFilterBufferRef *out = ff_get_video_buffer(outlink, AV_PERM_WRITE | AV_PERM_ALIGN,
+                                                     outlink->w, outlink->h);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        avfilter_copy_buffer_ref_props(out, in);
+        out->video->w = outlink->w;
+        out->video->h = outlink->h;
+        av_reduce(&out->video->sample_aspect_ratio.num, &out->video->sample_aspect_ratio.den,
+                  (int64_t)in->video->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->video->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+        s->outs[i].out = out;
+    }
+
+    if (s->conv) {
+        sws_scale(s->conv, (const uint8_t * const *)in->data, in->linesize,
+                  0, inlink->h, s->conv_data, s->conv_linesize);
+        memcpy(s->src,          s->conv_data,     sizeof(s->src));
+        memcpy(s->src_linesize, s->conv_linesize, sizeof(s->src_linesize));
+    } else {
+        memcpy(s->src,          in->data,         sizeof(s->src));
+        memcpy(s->src_linesize, in->linesize,     sizeof(s->src_linesize));
+    }
+    s->src_h = inlink->h;
+
+    scale_outputs(s);
+
+    for (i = 0; i < s->nb_outs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFilterBufferRef *out = s->outs[i].out;
+        AVFilterBufferRef *for_next_filter;
+
+        s->outs[i].out = NULL;
+        if ((ret = s->outs[i].ret) < 0 ||
+            !(for_next_filter = avfilter_ref_buffer(out, ~0))) {
+            avfilter_unref_buffer(out);
+            ret = ret < 0 ? ret : AVERROR(ENOMEM);
+            goto end;
+        }
+        outlink->out_buf = out;
+        if ((ret = ff_start_frame(outlink, for_next_filter))          < 0 ||
+            (ret = ff_draw_slice(outlink, 0, outlink->h, 1))          < 0 ||
+            (ret = ff_end_frame(outlink))                             < 0)
+            goto end;
+    }
+
+end:
+    for (i = 0; i < s->nb_outs; i++)
+        avfilter_unref_bufferp(&s->outs[i].out);
+    return ret;
+}
+
+AVFilter avfilter_vf_multiscale = {
+    .name        = "multiscale",
+    .description = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes, one per output."),
+
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+
+    .priv_size = sizeof(MultiScaleContext),
+
+    .inputs    = (const AVFilterPad[]) {{ .name             = "default",
+                                          .type             = AVMEDIA_TYPE_VIDEO,
+                                          .config_props     = config_input,
+                                          .start_frame      = start_frame,
+                                          .draw_slice       = null_draw_slice,
+                                          .end_frame        = end_frame,
+                                          .min_perms        = AV_PERM_READ, },
+                                        { .name = NULL}},
+    .outputs   = (const AVFilterPad[]) {{ .name = NULL}},
+};
@@ -27,6 +27,7 @@
 
 /* #define DEBUG */
 
+#include "config.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "libavutil/eval.h"
@@ -39,6 +40,7 @@
 #include "internal.h"
 #include "bufferqueue.h"
 #include "drawutils.h"
+#include "overlay.h"
 #include "video.h"
 
 static const char *const var_names[] = {
@@ -69,6 +71,11 @@ enum var_name {
 #define U 1
 #define V 2
 
+/* classes of the overlay alpha rows */
+#define ALPHA_ROW_MIXED       0
+#define ALPHA_ROW_TRANSPARENT 1 ///< all alpha values are 0
+#define ALPHA_ROW_OPAQUE      2 ///< all alpha values are 255
+
 typedef struct {
     const AVClass *class;
     int x, y;                   ///< position of overlayed picture
@@ -84,6 +91,8 @@ typedef struct {
     uint8_t overlay_has_alpha;
 
     AVFilterBufferRef *overpicref;
+    uint8_t *alpha_rows;        ///< ALPHA_ROW_* class of each row of overpicref
+    uint8_t alpha_rows_ready;   ///< alpha_rows is up to date with overpicref
     struct FFBufQueue queue_main;
     struct FFBufQueue queue_over;
 
@@ -92,6 +101,8 @@ typedef struct {
     int hsub, vsub;             ///< chroma subsampling values
 
     char *x_expr, *y_expr;
+
+    OverlayDSPContext dsp;
 } OverlayContext;
 
 #define OFFSET(x) offsetof(OverlayContext, x)
@@ -133,6 +144,11 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     if (bufptr && (ret = av_set_options_string(over, bufptr, "=", ":")) < 0)
         goto end;
 
+    over->dsp.blend_row     = ff_overlay_blend_row_c;
+    over->dsp.blend_row_420 = ff_overlay_blend_row_420_c;
+    if (HAVE_MMX)
+        ff_overlay_init_x86(&over->dsp);
+
 end:
     av_free(args1);
     return ret;
@@ -144,6 +160,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&over->x_expr);
     av_freep(&over->y_expr);
+    av_freep(&over->alpha_rows);
 
     avfilter_unref_bufferp(&over->overpicref);
     ff_bufqueue_discard_all(&over->queue_main);
@@ -244,6 +261,11 @@ static int config_input_overlay(AVFilterLink *inlink)
         ff_fill_rgba_map(over->overlay_rgba_map, inlink->format) >= 0;
     over->overlay_has_alpha = ff_fmt_is_in(inlink->format, alpha_pix_fmts);
 
+    av_freep(&over->alpha_rows);
+    if (!(over->alpha_rows = av_malloc(inlink->h)))
+        return AVERROR(ENOMEM);
+    over->alpha_rows_ready = 0;
+
     av_log(ctx, AV_LOG_VERBOSE,
            "main w:%d h:%d fmt:%s overlay x:%d y:%d w:%d h:%d fmt:%s\n",
            ctx->inputs[MAIN]->w, ctx->inputs[MAIN]->h,
@@ -305,6 +327,56 @@ static AVFilterBufferRef *get_video_buffer(AVFilterLink *link, int perms, int w,
 // apply a fast variant: (X+127)/255 = ((X+127)*257+257)>>16 = ((X+128)*257)>>16
 #define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
 
+void ff_overlay_blend_row_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        dst[x] = FAST_DIV255(dst[x] * (255 - alpha[x]) + src[x] * alpha[x]);
+}
+
+void ff_overlay_blend_row_420_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                int alpha_linesize, int w)
+{
+    const uint8_t *alpha1 = alpha + alpha_linesize;
+    int x;
+
+    for (x = 0; x < w; x++) {
+        int a = (alpha[2*x] + alpha1[2*x] + alpha[2*x+1] + alpha1[2*x+1]) >> 2;
+        dst[x] = FAST_DIV255(dst[x] * (255 - a) + src[x] * a);
+    }
+}
+
+/**
+ * Sort the rows of the overlay picture into fully transparent, fully
+ * opaque and mixed ones, so that blending can skip or copy whole rows.
+ */
+static void classify_alpha_rows(OverlayContext *over, AVFilterBufferRef *pic)
+{
+    const uint8_t *ap;
+    int i, j, step;
+
+    if (over->overlay_is_packed_rgb) {
+        ap   = pic->data[0] + over->overlay_rgba_map[A];
+        step = over->overlay_pix_step[0];
+    } else {
+        ap   = pic->data[3];
+        step = 1;
+    }
+    for (i = 0; i < pic->video->h; i++) {
+        int all_and = 255, all_or = 0;
+        for (j = 0; j < pic->video->w * step; j += step) {
+            all_and &= ap[j];
+            all_or  |= ap[j];
+        }
+        over->alpha_rows[i] = !all_or          ? ALPHA_ROW_TRANSPARENT :
+                              all_and == 255   ? ALPHA_ROW_OPAQUE      :
+                                                 ALPHA_ROW_MIXED;
+        ap += pic->linesize[over->overlay_is_packed_rgb ? 0 : 3];
+    }
+    over->alpha_rows_ready = 1;
+}
+
 static void blend_slice(AVFilterContext *ctx,
                         AVFilterBufferRef *dst, AVFilterBufferRef *src,
                         int x, int y, int w, int h,
@@ -322,6 +394,9 @@ static void blend_slice(AVFilterContext *ctx,
     start_y = FFMAX(y, slice_y);
     height = end_y - start_y;
 
+    if (!over->alpha_rows_ready)
+        classify_alpha_rows(over, src);
+
     if (over->main_is_packed_rgb) {
         uint8_t *dp = dst->data[0] + x * over->main_pix_step[0] +
                       start_y * dst->linesize[0];
@@ -338,10 +413,25 @@ static void blend_slice(AVFilterContext *ctx,
         const int sa = over->overlay_rgba_map[A];
         const int sstep = over->overlay_pix_step[0];
         const int main_has_alpha = over->main_has_alpha;
+        const int same_layout = dstep == sstep && main_has_alpha &&
+                                !memcmp(over->main_rgba_map, over->overlay_rgba_map,
+                                        sizeof(over->main_rgba_map));
+        const uint8_t *alpha_rows = over->alpha_rows + start_y - y;
         if (slice_y > y)
             sp += (slice_y - y) * src->linesize[0];
         for (i = 0; i < height; i++) {
             uint8_t *d = dp, *s = sp;
+            if (alpha_rows[i] == ALPHA_ROW_TRANSPARENT) {
+                dp += dst->linesize[0];
+                sp += src->linesize[0];
+                continue;
+            }
+            if (alpha_rows[i] == ALPHA_ROW_OPAQUE && same_layout) {
+                memcpy(d, s, width * dstep);
+                dp += dst->linesize[0];
+                sp += src->linesize[0];
+                continue;
+            }
             for (j = 0; j < width; j++) {
                 alpha = s[sa];
 
@@ -402,13 +492,35 @@ static void blend_slice(AVFilterContext *ctx,
             uint8_t *ap = src->data[3];
             int wp = FFALIGN(width, 1<<hsub) >> hsub;
             int hp = FFALIGN(height, 1<<vsub) >> vsub;
+            const uint8_t *alpha_rows = over->alpha_rows + start_y - y;
             if (slice_y > y) {
                 sp += ((slice_y - y) >> vsub) * src->linesize[i];
                 ap += (slice_y - y) * src->linesize[3];
             }
             for (j = 0; j < hp; j++) {
                 uint8_t *d = dp, *s = sp, *a = ap;
-                for (k = 0; k < wp; k++) {
+                int row_class = alpha_rows[j << vsub];
+                if (vsub && j+1 < hp && alpha_rows[(j << vsub) + 1] != row_class)
+                    row_class = ALPHA_ROW_MIXED;
+
+                k = 0;
+                if (row_class == ALPHA_ROW_OPAQUE) {
+                    memcpy(d, s, wp);
+                    k = wp;
+                } else if (row_class == ALPHA_ROW_TRANSPARENT) {
+                    k = wp;
+                } else if (!hsub && !vsub) {
+                    over->dsp.blend_row(d, s, a, wp);
+                    k = wp;
+                } else if (hsub == 1 && vsub == 1 && j+1 < hp) {
+                    // the last pixel uses the edge averaging below
+                    k = wp - 1;
+                    over->dsp.blend_row_420(d, s, a, src->linesize[3], k);
+                    d += k;
+                    s += k;
+                    a += k << hsub;
+                }
+                for (; k < wp; k++) {
                     // average alpha for color components, improve quality
                     int alpha_v, alpha_h, alpha;
                     if (hsub && vsub && j+1 < hp && k+1 < wp) {
@@ -450,6 +562,7 @@ static int try_start_frame(AVFilterContext *ctx, AVFilterBufferRef *mainpic)
         ff_bufqueue_get(&over->queue_over);
         avfilter_unref_buffer(over->overpicref);
         over->overpicref = next_overpic;
+        over->alpha_rows_ready = 0;
     }
     /* If there is no next frame and no EOF and the overlay frame is before
      * the main frame, we can not know yet if it will be superseded. */
@@ -24,6 +24,7 @@
  */
 
 #include "avfilter.h"
+#include "drawutils.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
@@ -31,6 +32,7 @@
 #include "libavutil/eval.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/avassert.h"
@@ -79,20 +81,65 @@ typedef struct {
     int input_is_pal;           ///< set to 1 if the input format is paletted
     int output_is_pal;          ///< set to 1 if the output format is paletted
     int interlaced;
+    int nb_threads;             ///< threads used by the scaler contexts
 
     char w_expr[256];           ///< width  expression string
     char h_expr[256];           ///< height expression string
+
+    /**
+     * Optional crop applied to the input and padding applied to the
+     * output, so that crop,scale,pad chains can be done with a single
+     * output buffer and no intermediate copy.
+     */
+    int crop, pad;              ///< set if cropping / padding was requested
+    int crop_x, crop_y, crop_w, crop_h; ///< input area which is scaled
+    int out_w, out_h;           ///< scaled size, excluding the padding
+    int pad_x, pad_y;           ///< offset of the scaled picture in the output
+    int max_step[4];            ///< max pixel step for each input plane
+    char crop_w_expr[256], crop_h_expr[256], crop_x_expr[256], crop_y_expr[256];
+    char pad_w_expr[256],  pad_h_expr[256],  pad_x_expr[256],  pad_y_expr[256];
+    uint8_t pad_rgba[4];        ///< color for the padding area
+    FFDrawContext draw;
+    FFDrawColor color;
 } ScaleContext;
 
+#define OFFSET(x) offsetof(ScaleContext, x)
+
+static const struct {
+    const char *key;
+    int offset;
+    int is_pad;
+} fuse_opts[] = {
+    { "crop_w=", OFFSET(crop_w_expr), 0 },
+    { "crop_h=", OFFSET(crop_h_expr), 0 },
+    { "crop_x=", OFFSET(crop_x_expr), 0 },
+    { "crop_y=", OFFSET(crop_y_expr), 0 },
+    { "pad_w=",  OFFSET(pad_w_expr),  1 },
+    { "pad_h=",  OFFSET(pad_h_expr),  1 },
+    { "pad_x=",  OFFSET(pad_x_expr),  1 },
+    { "pad_y=",  OFFSET(pad_y_expr),  1 },
+};
+
 static av_cold int init(AVFilterContext *ctx, const char *args)
 {
     ScaleContext *scale = ctx->priv;
     const char *p;
+    char color_string[128] = "black";
+    int i;
 
     av_strlcpy(scale->w_expr, "iw", sizeof(scale->w_expr));
     av_strlcpy(scale->h_expr, "ih", sizeof(scale->h_expr));
+    av_strlcpy(scale->crop_w_expr, "iw", sizeof(scale->crop_w_expr));
+    av_strlcpy(scale->crop_h_expr, "ih", sizeof(scale->crop_h_expr));
+    av_strlcpy(scale->crop_x_expr, "(in_w-out_w)/2", sizeof(scale->crop_x_expr));
+    av_strlcpy(scale->crop_y_expr, "(in_h-out_h)/2", sizeof(scale->crop_y_expr));
+    av_strlcpy(scale->pad_w_expr, "iw", sizeof(scale->pad_w_expr));
+    av_strlcpy(scale->pad_h_expr, "ih", sizeof(scale->pad_h_expr));
+    av_strlcpy(scale->pad_x_expr, "(ow-iw)/2", sizeof(scale->pad_x_expr));
+    av_strlcpy(scale->pad_y_expr, "(oh-ih)/2", sizeof(scale->pad_y_expr));
 
     scale->flags = SWS_BILINEAR;
+    scale->nb_threads = 1;
     if (args) {
         sscanf(args, "%255[^:]:%255[^:]", scale->w_expr, scale->h_expr);
         p = strstr(args,"flags=");
@@ -109,8 +156,30 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
             scale->interlaced=1;
         }else if(strstr(args,"interl=-1"))
             scale->interlaced=-1;
+        if ((p = strstr(args, "threads=")) &&
+            (sscanf(p + 8, "%d", &scale->nb_threads) != 1 ||
+             scale->nb_threads < 1 || scale->nb_threads > 64)) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid number of threads '%s', must be in [1;64]\n", p + 8);
+            return AVERROR(EINVAL);
+        }
+
+        for (i = 0; i < FF_ARRAY_ELEMS(fuse_opts); i++) {
+            if ((p = strstr(args, fuse_opts[i].key))) {
+                sscanf(p + strlen(fuse_opts[i].key), "%255[^:]",
+                       (char *)scale + fuse_opts[i].offset);
+                if (fuse_opts[i].is_pad) scale->pad  = 1;
+                else                     scale->crop = 1;
+            }
+        }
+        if ((p = strstr(args, "pad_color="))) {
+            sscanf(p + 10, "%127[^:]", color_string);
+            scale->pad = 1;
+        }
     }
 
+    if (scale->pad && av_parse_color(scale->pad_rgba, color_string, -1, ctx) < 0)
+        return AVERROR(EINVAL);
+
     return 0;
 }
 
@@ -125,8 +194,10 @@ static av_cold void uninit(AVFilterContext *ctx)
 
 static int query_formats(AVFilterContext *ctx)
 {
+    ScaleContext *scale = ctx->priv;
     AVFilterFormats *formats;
     enum PixelFormat pix_fmt;
+    FFDrawContext draw;
     int ret;
 
     if (ctx->inputs[0]) {
@@ -143,6 +214,7 @@ static int query_formats(AVFilterContext *ctx)
         formats = NULL;
         for (pix_fmt = 0; pix_fmt < PIX_FMT_NB; pix_fmt++)
             if (   (sws_isSupportedOutput(pix_fmt) || pix_fmt == PIX_FMT_PAL8)
+                && (!scale->pad || ff_draw_init(&draw, pix_fmt, 0) >= 0)
                 && (ret = ff_add_format(&formats, pix_fmt)) < 0) {
                 ff_formats_unref(&formats);
                 return ret;
@@ -153,6 +225,192 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+/**
+ * Allocate a scaler context like sws_getContext(), but also apply the
+ * options which sws_getContext() has no parameter for.
+ */
+static struct SwsContext *alloc_sws(ScaleContext *scale,
+                                    int srcW, int srcH, enum PixelFormat srcFormat,
+                                    int dstW, int dstH, enum PixelFormat dstFormat,
+                                    int nb_threads)
+{
+    struct SwsContext *sws = sws_alloc_context();
+    int src_range = 0, dst_range = 0;
+
+    if (!sws)
+        return NULL;
+
+    /* the YUVJ formats are full range YUV, as in sws_getContext() */
+    switch (srcFormat) {
+    case PIX_FMT_YUVJ420P: srcFormat = PIX_FMT_YUV420P; src_range = 1; break;
+    case PIX_FMT_YUVJ422P: srcFormat = PIX_FMT_YUV422P; src_range = 1; break;
+    case PIX_FMT_YUVJ444P: srcFormat = PIX_FMT_YUV444P; src_range = 1; break;
+    case PIX_FMT_YUVJ440P: srcFormat = PIX_FMT_YUV440P; src_range = 1; break;
+    }
+    switch (dstFormat) {
+    case PIX_FMT_YUVJ420P: dstFormat = PIX_FMT_YUV420P; dst_range = 1; break;
+    case PIX_FMT_YUVJ422P: dstFormat = PIX_FMT_YUV422P; dst_range = 1; break;
+    case PIX_FMT_YUVJ444P: dstFormat = PIX_FMT_YUV444P; dst_range = 1; break;
+    case PIX_FMT_YUVJ440P: dstFormat = PIX_FMT_YUV440P; dst_range = 1; break;
+    }
+
+    av_opt_set_int(sws, "srcw",       srcW,              0);
+    av_opt_set_int(sws, "srch",       srcH,              0);
+    av_opt_set_int(sws, "src_format", srcFormat,         0);
+    av_opt_set_int(sws, "dstw",       dstW,              0);
+    av_opt_set_int(sws, "dsth",       dstH,              0);
+    av_opt_set_int(sws, "dst_format", dstFormat,         0);
+    av_opt_set_int(sws, "sws_flags",  scale->flags,      0);
+    av_opt_set_int(sws, "threads",    nb_threads,        0);
+    sws_setColorspaceDetails(sws, sws_getCoefficients(SWS_CS_DEFAULT), src_range,
+                             sws_getCoefficients(SWS_CS_DEFAULT), dst_range,
+                             0, 1 << 16, 1 << 16);
+
+    if (sws_init_context(sws, NULL, NULL) < 0) {
+        sws_freeContext(sws);
+        return NULL;
+    }
+    return sws;
+}
+
+static int eval_expr(AVFilterContext *ctx, const char *expr,
+                     double *var_values, double *res)
+{
+    int ret = av_expr_parse_and_eval(res, expr, var_names, var_values,
+                                     NULL, NULL, NULL, NULL, NULL, 0, ctx);
+    if (ret < 0)
+        av_log(ctx, AV_LOG_ERROR,
+               "Error when evaluating the expression '%s'.\n", expr);
+    return ret;
+}
+
+static int config_crop(AVFilterContext *ctx, AVFilterLink *inlink,
+                       double *var_values)
+{
+    ScaleContext *scale = ctx->priv;
+    const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[inlink->format];
+    int hsub = desc->log2_chroma_w;
+    int vsub = desc->log2_chroma_h + !!scale->interlaced;
+    double res;
+    int ret;
+
+    if ((ret = eval_expr(ctx, scale->crop_w_expr, var_values, &res)) < 0)
+        return ret;
+    var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if ((ret = eval_expr(ctx, scale->crop_h_expr, var_values, &res)) < 0)
+        return ret;
+    var_values[VAR_OUT_H] = var_values[VAR_OH] = res;
+    /* evaluate again the width, as it may depend on the cropped height */
+    if ((ret = eval_expr(ctx, scale->crop_w_expr, var_values, &res)) < 0)
+        return ret;
+    var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+
+    if (isnan(var_values[VAR_OUT_W]) || isnan(var_values[VAR_OUT_H]) ||
+        (scale->crop_w = lrint(var_values[VAR_OUT_W])) <= 0 ||
+        (scale->crop_h = lrint(var_values[VAR_OUT_H])) <= 0 ||
+        scale->crop_w > inlink->w || scale->crop_h > inlink->h) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Invalid crop size %sx%s, the cropped area must be non-empty and "
+               "fit inside the input %dx%d\n",
+               scale->crop_w_expr, scale->crop_h_expr, inlink->w, inlink->h);
+        return AVERROR(EINVAL);
+    }
+
+    if ((ret = eval_expr(ctx, scale->crop_x_expr, var_values, &res)) < 0)
+        return ret;
+    scale->crop_x = isnan(res) ? 0 : lrint(res);
+    if ((ret = eval_expr(ctx, scale->crop_y_expr, var_values, &res)) < 0)
+        return ret;
+    scale->crop_y = isnan(res) ? 0 : lrint(res);
+
+    /* the crop area is clipped to the input like the crop filter does;
+     * interlaced scaling needs each field to start on a chroma line */
+    scale->crop_x = av_clip(scale->crop_x, 0, inlink->w - scale->crop_w);
+    scale->crop_y = av_clip(scale->crop_y, 0, inlink->h - scale->crop_h);
+    scale->crop_x &= ~((1 << hsub) - 1);
+    scale->crop_y &= ~((1 << vsub) - 1);
+    scale->crop_w &= ~((1 << hsub) - 1);
+    scale->crop_h &= ~((1 << vsub) - 1);
+    if (!scale->crop_w || !scale->crop_h) {
+        av_log(ctx, AV_LOG_ERROR, "Crop size too small for the chroma subsampling\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_image_fill_max_pixsteps(scale->max_step, NULL, desc);
+    return 0;
+}
+
+static int config_pad(AVFilterContext *ctx, AVFilterLink *outlink,
+                      double *var_values)
+{
+    ScaleContext *scale = ctx->priv;
+    FFDrawContext *draw = &scale->draw;
+    int pad_w, pad_h;
+    double res;
+    int ret;
+
+    if ((ret = ff_draw_init(draw, outlink->format, 0)) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Padding is not supported for format %s.\n",
+               av_pix_fmt_descriptors[outlink->format].name);
+        return ret;
+    }
+    ff_draw_color(draw, &scale->color, scale->pad_rgba);
+
+    var_values[VAR_IN_W]  = var_values[VAR_IW] = scale->out_w;
+    var_values[VAR_IN_H]  = var_values[VAR_IH] = scale->out_h;
+    var_values[VAR_OUT_W] = var_values[VAR_OW] = NAN;
+    var_values[VAR_OUT_H] = var_values[VAR_OH] = NAN;
+    var_values[VAR_A]     = (float) scale->out_w / scale->out_h;
+    var_values[VAR_SAR]   = outlink->sample_aspect_ratio.num ?
+        (float) outlink->sample_aspect_ratio.num / outlink->sample_aspect_ratio.den : 1;
+    var_values[VAR_DAR]   = var_values[VAR_A] * var_values[VAR_SAR];
+    var_values[VAR_HSUB]  = 1 << draw->hsub_max;
+    var_values[VAR_VSUB]  = 1 << draw->vsub_max;
+
+    if ((ret = eval_expr(ctx, scale->pad_w_expr, var_values, &res)) < 0)
+        return ret;
+    pad_w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if ((ret = eval_expr(ctx, scale->pad_h_expr, var_values, &res)) < 0)
+        return ret;
+    pad_h = var_values[VAR_OUT_H] = var_values[VAR_OH] = res;
+    /* evaluate again the width, as it may depend on the padded height */
+    if ((ret = eval_expr(ctx, scale->pad_w_expr, var_values, &res)) < 0)
+        return ret;
+    pad_w = var_values[VAR_OUT_W] = var_values[VAR_OW] = res;
+    if ((ret = eval_expr(ctx, scale->pad_x_expr, var_values, &res)) < 0)
+        return ret;
+    scale->pad_x = res;
+    if ((ret = eval_expr(ctx, scale->pad_y_expr, var_values, &res)) < 0)
+        return ret;
+    scale->pad_y = res;
+
+    if (!pad_w)
+        pad_w = scale->out_w;
+    if (!pad_h)
+        pad_h = scale->out_h;
+
+    pad_w        = ff_draw_round_to_sub(draw, 0, -1, pad_w);
+    pad_h        = ff_draw_round_to_sub(draw, 1, -1, pad_h);
+    scale->pad_x = ff_draw_round_to_sub(draw, 0, -1, scale->pad_x);
+    scale->pad_y = ff_draw_round_to_sub(draw, 1, -1, scale->pad_y);
+
+    if (scale->pad_x <  0 || scale->pad_y <  0 ||
+        pad_w        <= 0 || pad_h        <= 0 ||
+        (unsigned)scale->pad_x + (unsigned)scale->out_w > pad_w ||
+        (unsigned)scale->pad_y + (unsigned)scale->out_h > pad_h) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Scaled area %d:%d:%d:%d not within the padded area 0:0:%d:%d or zero-sized\n",
+               scale->pad_x, scale->pad_y,
+               scale->pad_x + scale->out_w, scale->pad_y + scale->out_h,
+               pad_w, pad_h);
+        return AVERROR(EINVAL);
+    }
+
+    outlink->w = pad_w;
+    outlink->h = pad_h;
+    return 0;
+}
+
 static int config_props(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -175,6 +433,20 @@ static int config_props(AVFilterLink *outlink)
     var_values[VAR_HSUB]  = 1<<av_pix_fmt_descriptors[inlink->format].log2_chroma_w;
     var_values[VAR_VSUB]  = 1<<av_pix_fmt_descriptors[inlink->format].log2_chroma_h;
 
+    scale->crop_x = scale->crop_y = 0;
+    scale->crop_w = inlink->w;
+    scale->crop_h = inlink->h;
+    if (scale->crop) {
+        if ((ret = config_crop(ctx, inlink, var_values)) < 0)
+            return ret;
+        var_values[VAR_IN_W]  = var_values[VAR_IW] = scale->crop_w;
+        var_values[VAR_IN_H]  = var_values[VAR_IH] = scale->crop_h;
+        var_values[VAR_OUT_W] = var_values[VAR_OW] = NAN;
+        var_values[VAR_OUT_H] = var_values[VAR_OH] = NAN;
+        var_values[VAR_A]     = (float) scale->crop_w / scale->crop_h;
+        var_values[VAR_DAR]   = var_values[VAR_A] * var_values[VAR_SAR];
+    }
+
     /* evaluate width and height */
     av_expr_parse_and_eval(&res, (expr = scale->w_expr),
                            var_names, var_values,
@@ -204,21 +476,21 @@ static int config_props(AVFilterLink *outlink)
         scale->w = scale->h = 0;
 
     if (!(w = scale->w))
-        w = inlink->w;
+        w = scale->crop_w;
     if (!(h = scale->h))
-        h = inlink->h;
+        h = scale->crop_h;
     if (w == -1)
-        w = av_rescale(h, inlink->w, inlink->h);
+        w = av_rescale(h, scale->crop_w, scale->crop_h);
     if (h == -1)
-        h = av_rescale(w, inlink->h, inlink->w);
+        h = av_rescale(w, scale->crop_h, scale->crop_w);
 
     if (w > INT_MAX || h > INT_MAX ||
-        (h * inlink->w) > INT_MAX  ||
-        (w * inlink->h) > INT_MAX)
+        (h * scale->crop_w) > INT_MAX  ||
+        (w * scale->crop_h) > INT_MAX)
         av_log(ctx, AV_LOG_ERROR, "Rescaled value for width or height is too big.\n");
 
-    outlink->w = w;
-    outlink->h = h;
+    outlink->w = scale->out_w = w;
+    outlink->h = scale->out_h = h;
 
     /* TODO: make algorithm configurable */
 
@@ -231,37 +503,45 @@ static int config_props(AVFilterLink *outlink)
     if (scale->sws)
         sws_freeContext(scale->sws);
     if (inlink->w == outlink->w && inlink->h == outlink->h &&
-        inlink->format == outlink->format)
+        inlink->format == outlink->format && !scale->crop && !scale->pad)
         scale->sws = NULL;
     else {
-        scale->sws = sws_getContext(inlink ->w, inlink ->h, inlink ->format,
-                                    outlink->w, outlink->h, outfmt,
-                                    scale->flags, NULL, NULL, NULL);
+        scale->sws = alloc_sws(scale, scale->crop_w, scale->crop_h, inlink->format,
+                               outlink->w, outlink->h, outfmt, scale->nb_threads);
+        /* the field contexts only need threads for interlaced scaling */
         if (scale->isws[0])
             sws_freeContext(scale->isws[0]);
-        scale->isws[0] = sws_getContext(inlink ->w, inlink ->h/2, inlink ->format,
-                                        outlink->w, outlink->h/2, outfmt,
-                                        scale->flags, NULL, NULL, NULL);
+        scale->isws[0] = alloc_sws(scale, scale->crop_w, scale->crop_h/2, inlink->format,
+                                   outlink->w, outlink->h/2, outfmt,
+                                   scale->interlaced ? scale->nb_threads : 1);
         if (scale->isws[1])
             sws_freeContext(scale->isws[1]);
-        scale->isws[1] = sws_getContext(inlink ->w, inlink ->h/2, inlink ->format,
-                                        outlink->w, outlink->h/2, outfmt,
-                                        scale->flags, NULL, NULL, NULL);
+        scale->isws[1] = alloc_sws(scale, scale->crop_w, scale->crop_h/2, inlink->format,
+                                   outlink->w, outlink->h/2, outfmt,
+                                   scale->interlaced ? scale->nb_threads : 1);
         if (!scale->sws || !scale->isws[0] || !scale->isws[1])
             return AVERROR(EINVAL);
     }
 
     if (inlink->sample_aspect_ratio.num){
-        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w, outlink->w * inlink->h}, inlink->sample_aspect_ratio);
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * scale->crop_w, outlink->w * scale->crop_h}, inlink->sample_aspect_ratio);
     } else
         outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
 
+    scale->pad_x = scale->pad_y = 0;
+    if (scale->pad && (ret = config_pad(ctx, outlink, var_values)) < 0)
+        return ret;
+
     av_log(ctx, AV_LOG_VERBOSE, "w:%d h:%d fmt:%s sar:%d/%d -> w:%d h:%d fmt:%s sar:%d/%d flags:0x%0x\n",
            inlink ->w, inlink ->h, av_pix_fmt_descriptors[ inlink->format].name,
            inlink->sample_aspect_ratio.num, inlink->sample_aspect_ratio.den,
            outlink->w, outlink->h, av_pix_fmt_descriptors[outlink->format].name,
            outlink->sample_aspect_ratio.num, outlink->sample_aspect_ratio.den,
            scale->flags);
+    if (scale->crop || scale->pad)
+        av_log(ctx, AV_LOG_VERBOSE, "crop:%d:%d:%d:%d scaled:%dx%d pad_x:%d pad_y:%d\n",
+               scale->crop_w, scale->crop_h, scale->crop_x, scale->crop_y,
+               scale->out_w, scale->out_h, scale->pad_x, scale->pad_y);
     return 0;
 
 fail:
@@ -272,6 +552,14 @@ fail:
     return ret;
 }
 
+static void fill_bar(ScaleContext *scale, AVFilterBufferRef *picref,
+                     int x, int y, int w, int h)
+{
+    if (w > 0 && h > 0)
+        ff_fill_rectangle(&scale->draw, &scale->color,
+                          picref->data, picref->linesize, x, y, w, h);
+}
+
 static int start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
 {
     ScaleContext *scale = link->dst->priv;
@@ -283,8 +571,8 @@ static int start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
        || picref->video->h != link->h
        || picref->format   != link->format) {
         int ret;
-        snprintf(scale->w_expr, sizeof(scale->w_expr)-1, "%d", outlink->w);
-        snprintf(scale->h_expr, sizeof(scale->h_expr)-1, "%d", outlink->h);
+        snprintf(scale->w_expr, sizeof(scale->w_expr)-1, "%d", scale->out_w);
+        snprintf(scale->h_expr, sizeof(scale->h_expr)-1, "%d", scale->out_h);
 
         link->dst->inputs[0]->format = picref->format;
         link->dst->inputs[0]->w      = picref->video->w;
@@ -316,9 +604,19 @@ static int start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
     if(scale->output_is_pal)
         ff_set_systematic_pal2(outpicref->data[1], outlink->format == PIX_FMT_PAL8 ? PIX_FMT_BGR8 : outlink->format);
 
+    /* the right bar is drawn after each slice, as swscale may write a
+     * few pixels past the end of the scaled lines */
+    if (scale->pad) {
+        int y1 = scale->pad_y + scale->out_h;
+
+        fill_bar(scale, outpicref, 0, 0,            outlink->w,   scale->pad_y);
+        fill_bar(scale, outpicref, 0, y1,           outlink->w,   outlink->h - y1);
+        fill_bar(scale, outpicref, 0, scale->pad_y, scale->pad_x, scale->out_h);
+    }
+
     av_reduce(&outpicref->video->sample_aspect_ratio.num, &outpicref->video->sample_aspect_ratio.den,
-              (int64_t)picref->video->sample_aspect_ratio.num * outlink->h * link->w,
-              (int64_t)picref->video->sample_aspect_ratio.den * outlink->w * link->h,
+              (int64_t)picref->video->sample_aspect_ratio.num * scale->out_h * scale->crop_w,
+              (int64_t)picref->video->sample_aspect_ratio.den * scale->out_w * scale->crop_h,
               INT_MAX);
 
     scale->slice_y = 0;
@@ -349,10 +647,15 @@ static int scale_slice(AVFilterLink *link, struct SwsContext *sws, int y, int h,
 
     for(i=0; i<4; i++){
         int vsub= ((i+1)&2) ? scale->vsub : 0;
+        int hsub= ((i+1)&2) ? scale->hsub : 0;
          in_stride[i] = cur_pic->linesize[i] * mul;
         out_stride[i] = out_buf->linesize[i] * mul;
-         in[i] = cur_pic->data[i] + ((y>>vsub)+field) * cur_pic->linesize[i];
+         in[i] = cur_pic->data[i] + (((y+scale->crop_y)>>vsub)+field) * cur_pic->linesize[i]
+                                  +  (scale->crop_x>>hsub) * scale->max_step[i];
         out[i] = out_buf->data[i] +            field  * out_buf->linesize[i];
+        if (scale->pad && i < scale->draw.nb_planes)
+            out[i] += (scale->pad_y >> scale->draw.vsub[i]) * out_buf->linesize[i] +
+                      (scale->pad_x >> scale->draw.hsub[i]) * scale->draw.pixelstep[i];
     }
     if(scale->input_is_pal)
          in[1] = cur_pic->data[1];
@@ -366,14 +669,23 @@ static int scale_slice(AVFilterLink *link, struct SwsContext *sws, int y, int h,
 static int draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
 {
     ScaleContext *scale = link->dst->priv;
-    int out_h, ret;
+    AVFilterLink *outlink = link->dst->outputs[0];
+    int out_h, out_y0, out_y1, ret;
 
     if (!scale->sws) {
-        return ff_draw_slice(link->dst->outputs[0], y, h, slice_dir);
+        return ff_draw_slice(outlink, y, h, slice_dir);
     }
 
+    /* only the part of the slice inside the crop area is scaled */
+    out_y0 = FFMAX(y,     scale->crop_y);
+    out_y1 = FFMIN(y + h, scale->crop_y + scale->crop_h);
+    if (out_y1 <= out_y0)
+        return 0;
+    y = out_y0 - scale->crop_y;
+    h = out_y1 - out_y0;
+
     if (scale->slice_y == 0 && slice_dir == -1)
-        scale->slice_y = link->dst->outputs[0]->h;
+        scale->slice_y = scale->out_h;
 
     if(scale->interlaced>0 || (scale->interlaced<0 && link->cur_buf->video->interlaced)){
         av_assert0(y%(2<<scale->vsub) == 0);
@@ -385,7 +697,28 @@ static int draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
 
     if (slice_dir == -1)
         scale->slice_y -= out_h;
-    ret = ff_draw_slice(link->dst->outputs[0], scale->slice_y, out_h, slice_dir);
+    if (!scale->pad) {
+        ret = ff_draw_slice(outlink, scale->slice_y, out_h, slice_dir);
+    } else if (out_h) {
+        /* like the pad filter, an odd scaled size is rounded down to the
+         * chroma subsampling */
+        int x1 = scale->pad_x + ff_draw_round_to_sub(&scale->draw, 0, -1, scale->out_w);
+        int h1 = ff_draw_round_to_sub(&scale->draw, 1, -1, scale->out_h);
+
+        fill_bar(scale, outlink->out_buf, x1, scale->pad_y + scale->slice_y,
+                 outlink->w - x1, out_h);
+        if (scale->slice_y + out_h > h1)
+            fill_bar(scale, outlink->out_buf, scale->pad_x, scale->pad_y + h1,
+                     outlink->w - scale->pad_x,
+                     ff_draw_round_to_sub(&scale->draw, 1, 1, scale->out_h - h1));
+
+        /* send the padding bars along with the first and last slices */
+        out_y0 = scale->slice_y ? scale->pad_y + scale->slice_y : 0;
+        out_y1 = scale->slice_y + out_h < scale->out_h ?
+                 scale->pad_y + scale->slice_y + out_h : outlink->h;
+        ret = ff_draw_slice(outlink, out_y0, out_y1 - out_y0, slice_dir);
+    } else
+        ret = 0;
     if (slice_dir == 1)
         scale->slice_y += out_h;
     return ret;
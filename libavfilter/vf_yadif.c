@@ -102,24 +102,102 @@ static void filter_line_c_16bit(uint16_t *dst,
     FILTER
 }
 
+static int plane_height(YADIFContext *yadif, int i)
+{
+    int h = yadif->dst->video->h;
+
+    if (i == 1 || i == 2)
+        h >>= yadif->csp->log2_chroma_h;
+    return h;
+}
+
+static void filter_rows(YADIFContext *yadif, int i, int y_start, int y_end)
+{
+    AVFilterBufferRef *dstpic = yadif->dst;
+    int parity = yadif->dst_parity;
+    int tff    = yadif->dst_tff;
+    int w = dstpic->video->w;
+    int h = dstpic->video->h;
+    int refs = yadif->cur->linesize[i];
+    int absrefs = FFABS(refs);
+    int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
+    int y;
+
+    if (i == 1 || i == 2) {
+    /* Why is this not part of the per-plane description thing? */
+        w >>= yadif->csp->log2_chroma_w;
+        h >>= yadif->csp->log2_chroma_h;
+    }
+
+    for (y = y_start; y < y_end; y++) {
+        if ((y ^ parity) & 1) {
+            uint8_t *prev = &yadif->prev->data[i][y*refs];
+            uint8_t *cur  = &yadif->cur ->data[i][y*refs];
+            uint8_t *next = &yadif->next->data[i][y*refs];
+            uint8_t *dst  = &dstpic->data[i][y*dstpic->linesize[i]];
+            int     mode  = y==1 || y+2==h ? 2 : yadif->mode;
+            int     prefs = y+1<h ? refs : -refs;
+            int     mrefs =     y ?-refs :  refs;
+
+            if(y<=1 || y+2>=h) {
+                uint8_t *tmp = yadif->temp_line + 64 + 2*absrefs;
+                if(mode<2)
+                    memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
+                memcpy(tmp+mrefs, cur+mrefs, w*df);
+                memcpy(tmp      , cur      , w*df);
+                if(prefs != mrefs) {
+                    memcpy(tmp+prefs, cur+prefs, w*df);
+                    if(mode<2)
+                        memcpy(tmp+2*prefs, cur+2*prefs, w*df);
+                }
+                cur = tmp;
+            }
+
+            yadif->filter_line(dst, prev, cur, next, w, prefs, mrefs, parity ^ tff, mode);
+        } else {
+            memcpy(&dstpic->data[i][y*dstpic->linesize[i]],
+                   &yadif->cur->data[i][y*refs], w*df);
+        }
+    }
+}
+
+/**
+ * Filter one slice of the rows of a plane which do not need the edge
+ * line copies.
+ */
+static int filter_slice(void *opaque, int job, int thread)
+{
+    YADIFContext *yadif = opaque;
+    int i     = job / yadif->nb_threads;
+    int slice = job % yadif->nb_threads;
+    int inner = FFMAX(plane_height(yadif, i) - 4, 0);
+
+    filter_rows(yadif, i, 2 + inner *  slice      / yadif->nb_threads,
+                          2 + inner * (slice + 1) / yadif->nb_threads);
+    emms_c();
+    return 0;
+}
+
 static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
                    int parity, int tff)
 {
     YADIFContext *yadif = ctx->priv;
-    int y, i;
+    int nb_jobs = yadif->csp->nb_components * yadif->nb_threads;
+    int i, h, absrefs;
+
+    yadif->dst        = dstpic;
+    yadif->dst_parity = parity;
+    yadif->dst_tff    = tff;
 
+    if (yadif->pool)
+        avpriv_jobpool_start(yadif->pool, filter_slice, yadif, nb_jobs);
+
+    /* The first and last two rows are filtered from copies in temp_line,
+     * which read past the copied width, so they are always done here and in
+     * the same order to keep the output independent of the thread count. */
     for (i = 0; i < yadif->csp->nb_components; i++) {
-        int w = dstpic->video->w;
-        int h = dstpic->video->h;
-        int refs = yadif->cur->linesize[i];
-        int absrefs = FFABS(refs);
-        int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
-
-        if (i == 1 || i == 2) {
-        /* Why is this not part of the per-plane description thing? */
-            w >>= yadif->csp->log2_chroma_w;
-            h >>= yadif->csp->log2_chroma_h;
-        }
+        h       = plane_height(yadif, i);
+        absrefs = FFABS(yadif->cur->linesize[i]);
 
         if(yadif->temp_line_size < absrefs) {
             av_free(yadif->temp_line);
@@ -127,39 +205,18 @@ static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
             yadif->temp_line_size = absrefs;
         }
 
-        for (y = 0; y < h; y++) {
-            if ((y ^ parity) & 1) {
-                uint8_t *prev = &yadif->prev->data[i][y*refs];
-                uint8_t *cur  = &yadif->cur ->data[i][y*refs];
-                uint8_t *next = &yadif->next->data[i][y*refs];
-                uint8_t *dst  = &dstpic->data[i][y*dstpic->linesize[i]];
-                int     mode  = y==1 || y+2==h ? 2 : yadif->mode;
-                int     prefs = y+1<h ? refs : -refs;
-                int     mrefs =     y ?-refs :  refs;
-
-                if(y<=1 || y+2>=h) {
-                    int j;
-                    uint8_t *tmp = yadif->temp_line + 64 + 2*absrefs;
-                    if(mode<2)
-                        memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
-                    memcpy(tmp+mrefs, cur+mrefs, w*df);
-                    memcpy(tmp      , cur      , w*df);
-                    if(prefs != mrefs) {
-                        memcpy(tmp+prefs, cur+prefs, w*df);
-                        if(mode<2)
-                            memcpy(tmp+2*prefs, cur+2*prefs, w*df);
-                    }
-                    cur = tmp;
-                }
-
-                yadif->filter_line(dst, prev, cur, next, w, prefs, mrefs, parity ^ tff, mode);
-            } else {
-                memcpy(&dstpic->data[i][y*dstpic->linesize[i]],
-                       &yadif->cur->data[i][y*refs], w*df);
-            }
-        }
+        filter_rows(yadif, i, 0, FFMIN(2, h));
+        filter_rows(yadif, i, FFMAX(2, h - 2), h);
     }
 
+    if (yadif->pool)
+        avpriv_jobpool_wait(yadif->pool);
+    else
+        for (i = 0; i < nb_jobs; i++)
+            filter_slice(yadif, i, 0);
+
+    yadif->dst = NULL;
+
     emms_c();
 }
 
@@ -186,11 +243,6 @@ static int return_frame(AVFilterContext *ctx, int is_second)
         yadif->out->video->interlaced = 0;
     }
 
-    if (!yadif->csp)
-        yadif->csp = &av_pix_fmt_descriptors[link->format];
-    if (yadif->csp->comp[0].depth_minus1 / 8 == 1)
-        yadif->filter_line = (void*)filter_line_c_16bit;
-
     filter(ctx, yadif->out, tff ^ !is_second, tff);
 
     if (is_second) {
@@ -356,6 +408,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (yadif->cur ) avfilter_unref_bufferp(&yadif->cur );
     if (yadif->next) avfilter_unref_bufferp(&yadif->next);
     av_freep(&yadif->temp_line); yadif->temp_line_size = 0;
+    avpriv_jobpool_free(&yadif->pool);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -397,16 +450,20 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     yadif->mode = 0;
     yadif->parity = -1;
     yadif->auto_enable = 0;
+    yadif->nb_threads = 1;
     yadif->csp = NULL;
 
-    if (args) sscanf(args, "%d:%d:%d", &yadif->mode, &yadif->parity, &yadif->auto_enable);
+    if (args) sscanf(args, "%d:%d:%d:%d", &yadif->mode, &yadif->parity,
+                     &yadif->auto_enable, &yadif->nb_threads);
 
-    yadif->filter_line = filter_line_c;
+    yadif->nb_threads = av_clip(yadif->nb_threads, 1, 64);
 
-    if (HAVE_MMX)
-        ff_yadif_init_x86(yadif);
+    if (yadif->nb_threads > 1 &&
+        !(yadif->pool = avpriv_jobpool_alloc(yadif->nb_threads, ctx)))
+        return AVERROR(ENOMEM);
 
-    av_log(ctx, AV_LOG_VERBOSE, "mode:%d parity:%d auto_enable:%d\n", yadif->mode, yadif->parity, yadif->auto_enable);
+    av_log(ctx, AV_LOG_VERBOSE, "mode:%d parity:%d auto_enable:%d threads:%d\n",
+           yadif->mode, yadif->parity, yadif->auto_enable, yadif->nb_threads);
 
     return 0;
 }
@@ -428,6 +485,15 @@ static int config_props(AVFilterLink *link)
     if(yadif->mode&1)
         link->frame_rate = av_mul_q(link->src->inputs[0]->frame_rate, (AVRational){2,1});
 
+    yadif->csp = &av_pix_fmt_descriptors[link->format];
+    if (yadif->csp->comp[0].depth_minus1 / 8 == 1)
+        yadif->filter_line = (void*)filter_line_c_16bit;
+    else
+        yadif->filter_line = filter_line_c;
+
+    if (HAVE_MMX)
+        ff_yadif_init_x86(yadif);
+
     return 0;
 }
 
@@ -455,3 +521,94 @@ AVFilter avfilter_vf_yadif = {
                                           .config_props     = config_props, },
                                         { .name = NULL}},
 };
+
+#ifdef TEST
+
+#include "libavutil/lfg.h"
+
+#undef printf
+
+/**
+ * Check that the optimized line functions give the same output as the
+ * C ones, for random samples of all the supported bit depths.
+ */
+int main(void)
+{
+    static const enum PixelFormat pix_fmts[] = {
+        PIX_FMT_YUV420P, AV_NE(PIX_FMT_YUV420P10BE, PIX_FMT_YUV420P10LE),
+        AV_NE(PIX_FMT_YUV420P16BE, PIX_FMT_YUV420P16LE),
+    };
+    static const int widths[] = { 1, 3, 7, 8, 9, 17, 64, 317, 720, 1920 };
+    YADIFContext yadif = { 0 };
+    AVLFG lfg;
+    int f, i, x, mode, parity, ret = 0;
+
+    av_lfg_init(&lfg, 0xDEADBEEF);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(pix_fmts); f++) {
+        int depth, df, refs;
+        void (*filter_line_ref)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                uint8_t *next, int w, int prefs, int mrefs,
+                                int parity, int mode);
+
+        yadif.csp = &av_pix_fmt_descriptors[pix_fmts[f]];
+        depth = yadif.csp->comp[0].depth_minus1 + 1;
+        df    = (depth + 7) / 8;
+        refs  = FFALIGN(1920 * df + 64, 32);
+
+        filter_line_ref = depth > 8 ? (void*)filter_line_c_16bit : filter_line_c;
+        yadif.filter_line = filter_line_ref;
+        if (HAVE_MMX)
+            ff_yadif_init_x86(&yadif);
+
+        printf("%-14s %s\n", yadif.csp->name,
+               yadif.filter_line == filter_line_ref ? "C only" : "optimized");
+
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int w = widths[i];
+            /* 5 lines of each picture, the filtered line in the middle */
+            uint8_t *buf = av_malloc(3 * 5 * refs + 2 * 64);
+            uint8_t *dst[2] = { av_malloc(refs), av_malloc(refs) };
+            uint8_t *prev = buf + 64 + 2 * refs;
+            uint8_t *cur  = prev + 5 * refs;
+            uint8_t *next = cur  + 5 * refs;
+            int mismatch = 0;
+
+            if (!buf || !dst[0] || !dst[1])
+                return 1;
+
+            for (x = 0; x < (3 * 5 * refs + 2 * 64) / df; x++) {
+                int v = av_lfg_get(&lfg) & ((1 << depth) - 1);
+                /* mostly smooth content so that all the checks are taken */
+                if (x % 16)
+                    v = (v & 15) + (1 << (depth - 1));
+                if (df == 2)
+                    ((uint16_t *)buf)[x] = v;
+                else
+                    buf[x] = v;
+            }
+
+            for (mode = 0; mode <= 2; mode++) {
+                for (parity = 0; parity <= 1; parity++) {
+                    memset(dst[0], 0, refs);
+                    memset(dst[1], 0, refs);
+                    filter_line_ref  (dst[0], prev, cur, next, w, refs, -refs, parity, mode);
+                    yadif.filter_line(dst[1], prev, cur, next, w, refs, -refs, parity, mode);
+                    emms_c();
+                    if (memcmp(dst[0], dst[1], w * df))
+                        mismatch = 1;
+                }
+            }
+            printf("  width %4d: %s\n", w, mismatch ? "MISMATCH" : "ok");
+            ret |= mismatch;
+
+            av_free(buf);
+            av_free(dst[0]);
+            av_free(dst[1]);
+        }
+    }
+
+    return ret;
+}
+
+#endif
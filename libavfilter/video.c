@@ -38,9 +38,11 @@ AVFilterBufferRef *ff_default_get_video_buffer(AVFilterLink *link, int perms, in
     uint8_t *data[4];
     int i;
     AVFilterBufferRef *picref = NULL;
-    AVFilterPool *pool = link->pool;
+    AVFilterPool *pool;
 
+    pool = link->pool;
     if (pool) {
+        ff_pool_lock(pool);
         for (i = 0; i < POOL_SIZE; i++) {
             picref = pool->pic[i];
             if (picref && picref->buf->format == link->format && picref->buf->w == w && picref->buf->h == h) {
@@ -55,12 +57,18 @@ AVFilterBufferRef *ff_default_get_video_buffer(AVFilterLink *link, int perms, in
                 memcpy(picref->data,     pic->data,     sizeof(picref->data));
                 memcpy(picref->linesize, pic->linesize, sizeof(picref->linesize));
                 pool->refcount++;
+                ff_pool_unlock(pool);
                 return picref;
             }
         }
+        ff_pool_unlock(pool);
     } else {
         pool = link->pool = av_mallocz(sizeof(AVFilterPool));
+        if (!pool)
+            return NULL;
         pool->refcount = 1;
+        if (link->graph && link->graph->nb_pipeline_fifos)
+            ff_pool_set_threaded(pool);
     }
 
     // align: +2 is needed for swscaler, +16 to be SIMD-friendly
@@ -76,9 +84,13 @@ AVFilterBufferRef *ff_default_get_video_buffer(AVFilterLink *link, int perms, in
 
     memset(data[0], 128, i);
 
+    if (link->src->stats)
+        link->src->stats->buffer_allocs++;
     picref->buf->priv = pool;
     picref->buf->free = NULL;
+    ff_pool_lock(pool);
     pool->refcount++;
+    ff_pool_unlock(pool);
 
     return picref;
 }
@@ -237,6 +249,7 @@ int ff_start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
     int ret, perms;
     AVFilterCommand *cmd= link->dst->command_queue;
     int64_t pts;
+    FFProfileTimer timer;
 
     FF_TPRINTF_START(NULL, start_frame); ff_tlog_link(NULL, link, 0); ff_tlog(NULL, " "); ff_tlog_ref(NULL, picref, 1);
 
@@ -264,6 +277,8 @@ int ff_start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
 
         link->src_buf = picref;
         avfilter_copy_buffer_ref_props(link->cur_buf, link->src_buf);
+        if (link->dst->stats)
+            link->dst->stats->buffer_copies++;
 
         /* copy palette if required */
         if (av_pix_fmt_descriptors[link->format].flags & PIX_FMT_PAL)
@@ -283,7 +298,14 @@ int ff_start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
         cmd= link->dst->command_queue;
     }
     pts = link->cur_buf->pts;
+    if (link->src->stats)
+        link->src->stats->frames_out++;
+    if (link->dst->stats)
+        link->dst->stats->frames_in++;
+    ff_profile_start(link, &timer);
     ret = start_frame(link, link->cur_buf);
+    if (link->dst->stats)
+        link->dst->stats->start_frame_time += ff_profile_stop(link, &timer);
     ff_update_link_current_pts(link, pts);
     if (ret < 0)
         clear_link(link);
@@ -317,11 +339,15 @@ int ff_end_frame(AVFilterLink *link)
 {
     int (*end_frame)(AVFilterLink *);
     int ret;
+    FFProfileTimer timer;
 
     if (!(end_frame = link->dstpad->end_frame))
         end_frame = default_end_frame;
 
+    ff_profile_start(link, &timer);
     ret = end_frame(link);
+    if (link->dst->stats)
+        link->dst->stats->end_frame_time += ff_profile_stop(link, &timer);
 
     clear_link(link);
 
@@ -350,6 +376,7 @@ int ff_draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
     uint8_t *src[4], *dst[4];
     int i, j, vsub, ret;
     int (*draw_slice)(AVFilterLink *, int, int, int);
+    FFProfileTimer timer;
 
     FF_TPRINTF_START(NULL, draw_slice); ff_tlog_link(NULL, link, 0); ff_tlog(NULL, " y:%d h:%d dir:%d\n", y, h, slice_dir);
 
@@ -383,7 +410,10 @@ int ff_draw_slice(AVFilterLink *link, int y, int h, int slice_dir)
 
     if (!(draw_slice = link->dstpad->draw_slice))
         draw_slice = default_draw_slice;
+    ff_profile_start(link, &timer);
     ret = draw_slice(link, y, h, slice_dir);
+    if (link->dst->stats)
+        link->dst->stats->draw_slice_time += ff_profile_stop(link, &timer);
     if (ret < 0)
         clear_link(link);
     else
@@ -0,0 +1,41 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_VOLUME_H
+#define AVFILTER_VOLUME_H
+
+#include <stdint.h>
+#include "libavutil/samplefmt.h"
+
+typedef struct VolumeContext {
+    double volume;
+    int    volume_i;                ///< volume in 1/256 units, for the integer formats
+    enum AVSampleFormat sample_fmt; ///< packed sample format of the input
+
+    /**
+     * Optimized function scaling nb_samples samples of sample_fmt in place,
+     * or NULL. nb_samples is a multiple of 8, the C code handles the
+     * remainder. The output must be the same as the one of the C code.
+     */
+    void (*scale_samples)(uint8_t *p, int nb_samples,
+                          const struct VolumeContext *vol);
+} VolumeContext;
+
+void ff_volume_init_x86(VolumeContext *vol);
+
+#endif /* AVFILTER_VOLUME_H */
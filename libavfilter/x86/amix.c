@@ -0,0 +1,102 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavfilter/amix.h"
+
+#if HAVE_INLINE_ASM
+
+DECLARE_ALIGNED(16, static const int32_t, pd_round)[4] = {
+    1 << (AMIX_SCALE_BITS - 1), 1 << (AMIX_SCALE_BITS - 1),
+    1 << (AMIX_SCALE_BITS - 1), 1 << (AMIX_SCALE_BITS - 1),
+};
+
+#if HAVE_SSE
+/* full 32-bit products from the low and high halves of pmullw/pmulhw */
+static void mix_s16_sse2(int32_t *acc, const int16_t *src, int scale, int len)
+{
+    x86_reg i = -2 * len;
+
+    __asm__ volatile(
+        "movd           %3, %%xmm7 \n"
+        "pshuflw $0, %%xmm7, %%xmm7 \n"
+        "punpcklqdq %%xmm7, %%xmm7 \n"
+        "1: \n"
+        "movdqu  (%1,%0), %%xmm0 \n"
+        "movdqa   %%xmm0, %%xmm1 \n"
+        "pmullw   %%xmm7, %%xmm0 \n"
+        "pmulhw   %%xmm7, %%xmm1 \n"
+        "movdqa   %%xmm0, %%xmm2 \n"
+        "punpcklwd %%xmm1, %%xmm0 \n"
+        "punpckhwd %%xmm1, %%xmm2 \n"
+        "paddd     (%2,%0,2), %%xmm0 \n"
+        "paddd   16(%2,%0,2), %%xmm2 \n"
+        "movdqa   %%xmm0,   (%2,%0,2) \n"
+        "movdqa   %%xmm2, 16(%2,%0,2) \n"
+        "add         $16, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(src + len), "r"(acc + len), "r"(scale)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",)
+         "memory"
+    );
+}
+
+static void clip_s16_sse2(int16_t *dst, const int32_t *acc, int len)
+{
+    x86_reg i = -2 * len;
+
+    __asm__ volatile(
+        "movdqa         %3, %%xmm7 \n"
+        "1: \n"
+        "movdqa    (%2,%0,2), %%xmm0 \n"
+        "movdqa  16(%2,%0,2), %%xmm1 \n"
+        "paddd    %%xmm7, %%xmm0 \n"
+        "paddd    %%xmm7, %%xmm1 \n"
+        "psrad  $"AV_STRINGIFY(AMIX_SCALE_BITS)", %%xmm0 \n"
+        "psrad  $"AV_STRINGIFY(AMIX_SCALE_BITS)", %%xmm1 \n"
+        "packssdw %%xmm1, %%xmm0 \n"
+        "movdqu   %%xmm0, (%1,%0) \n"
+        "add         $16, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(dst + len), "r"(acc + len), "m"(*pd_round)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+#endif /* HAVE_INLINE_ASM */
+
+av_cold void ff_amix_init_x86(AMixDSPContext *dsp)
+{
+#if HAVE_INLINE_ASM
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        dsp->mix_s16  = mix_s16_sse2;
+        dsp->clip_s16 = clip_s16_sse2;
+    }
+#endif
+#endif /* HAVE_INLINE_ASM */
+}
@@ -0,0 +1,279 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavfilter/atempo.h"
+
+#if HAVE_INLINE_ASM
+
+DECLARE_ALIGNED(16, static const uint32_t, ps_abs_mask)[4] = { 0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff };
+DECLARE_ALIGNED(16, static const float,    ps_1)[4]        = { 1.0, 1.0, 1.0, 1.0 };
+DECLARE_ALIGNED(16, static const float,    ps_32767)[4]    = { 32767.0, 32767.0, 32767.0, 32767.0 };
+
+#if HAVE_SSE
+/* a, b = the 8 16-bit samples of a converted to float */
+#define S16_TO_FLOAT(a, b)                                                   \
+        "movdqa     %%"a", %%"b" \n"                                        \
+        "punpcklwd  %%"a", %%"a" \n"                                        \
+        "punpckhwd  %%"b", %%"b" \n"                                        \
+        "psrad         $16, %%"a" \n"                                       \
+        "psrad         $16, %%"b" \n"                                       \
+        "cvtdq2ps   %%"a", %%"a" \n"                                        \
+        "cvtdq2ps   %%"b", %%"b" \n"
+
+/* xmm3 = for 4 stereo samples in xmm0 (samples 0, 1) and xmm1 (samples 2, 3),
+ * the channel with the largest magnitude clipped to xmm7, left on ties */
+#define SELECT_STEREO                                                        \
+        "movaps     %%xmm0, %%xmm2 \n"                                      \
+        "shufps  $0x88, %%xmm1, %%xmm0 \n" /* left */                       \
+        "shufps  $0xDD, %%xmm1, %%xmm2 \n" /* right */                      \
+        "movaps     %%xmm0, %%xmm3 \n"                                      \
+        "movaps     %%xmm2, %%xmm4 \n"                                      \
+        "andps      %%xmm6, %%xmm3 \n"                                      \
+        "andps      %%xmm6, %%xmm4 \n"                                      \
+        "minps      %%xmm7, %%xmm3 \n"                                      \
+        "minps      %%xmm7, %%xmm4 \n"                                      \
+        "cmpltps    %%xmm4, %%xmm3 \n"                                      \
+        "andps      %%xmm3, %%xmm2 \n"                                      \
+        "andnps     %%xmm0, %%xmm3 \n"                                      \
+        "orps       %%xmm2, %%xmm3 \n"
+
+static void downmix_flt_stereo_sse(FFTSample *dst, const uint8_t *src, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "movaps         %3, %%xmm6 \n"
+        "movaps         %4, %%xmm7 \n"
+        "1: \n"
+        "movups  (%1,%0,8), %%xmm0 \n"
+        "movups 16(%1,%0,8), %%xmm1 \n"
+        SELECT_STEREO
+        "movups     %%xmm3, (%2,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(src + 8 * nsamples), "r"(dst + nsamples),
+         "m"(*ps_abs_mask), "m"(*ps_1)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                      "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void downmix_s16_stereo_sse2(FFTSample *dst, const uint8_t *src, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "movaps         %3, %%xmm6 \n"
+        "movaps         %4, %%xmm7 \n"
+        "1: \n"
+        "movdqu  (%1,%0,4), %%xmm0 \n"
+        S16_TO_FLOAT("xmm0", "xmm1")
+        SELECT_STEREO
+        "movups     %%xmm3, (%2,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(src + 4 * nsamples), "r"(dst + nsamples),
+         "m"(*ps_abs_mask), "m"(*ps_32767)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",
+                      "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void downmix_s16_mono_sse2(FFTSample *dst, const uint8_t *src, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "1: \n"
+        "movq    (%1,%0,2), %%xmm0 \n"
+        "punpcklwd  %%xmm0, %%xmm0 \n"
+        "psrad         $16, %%xmm0 \n"
+        "cvtdq2ps   %%xmm0, %%xmm0 \n"
+        "movups     %%xmm0, (%2,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(src + 2 * nsamples), "r"(dst + nsamples)
+        :XMM_CLOBBERS("%xmm0",)
+         "memory"
+    );
+}
+
+/* xmm0,xmm2 = wa and xmm1,xmm3 = wb, duplicated for 4 stereo samples */
+#define LOAD_WEIGHTS_STEREO                                                  \
+        "movups  (%1,%0,4), %%xmm0 \n"                                      \
+        "movups  (%2,%0,4), %%xmm1 \n"                                      \
+        "movaps     %%xmm0, %%xmm2 \n"                                      \
+        "movaps     %%xmm1, %%xmm3 \n"                                      \
+        "unpcklps   %%xmm0, %%xmm0 \n"                                      \
+        "unpckhps   %%xmm2, %%xmm2 \n"                                      \
+        "unpcklps   %%xmm1, %%xmm1 \n"                                      \
+        "unpckhps   %%xmm3, %%xmm3 \n"
+
+/* xmm4,xmm5 = xmm4,xmm5 * wa + xmm6,xmm7 * wb */
+#define BLEND_STEREO                                                         \
+        "mulps      %%xmm0, %%xmm4 \n"                                      \
+        "mulps      %%xmm2, %%xmm5 \n"                                      \
+        "mulps      %%xmm1, %%xmm6 \n"                                      \
+        "mulps      %%xmm3, %%xmm7 \n"                                      \
+        "addps      %%xmm6, %%xmm4 \n"                                      \
+        "addps      %%xmm7, %%xmm5 \n"
+
+static void blend_flt_stereo_sse(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                                 const float *wa, const float *wb, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "1: \n"
+        LOAD_WEIGHTS_STEREO
+        "movups   (%3,%0,8), %%xmm4 \n"
+        "movups 16(%3,%0,8), %%xmm5 \n"
+        "movups   (%4,%0,8), %%xmm6 \n"
+        "movups 16(%4,%0,8), %%xmm7 \n"
+        BLEND_STEREO
+        "movups     %%xmm4,   (%5,%0,8) \n"
+        "movups     %%xmm5, 16(%5,%0,8) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(wa + nsamples), "r"(wb + nsamples),
+         "r"(a + 8 * nsamples), "r"(b + 8 * nsamples), "r"(dst + 8 * nsamples)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void blend_flt_mono_sse(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                               const float *wa, const float *wb, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "1: \n"
+        "movups  (%1,%0,4), %%xmm0 \n"
+        "movups  (%2,%0,4), %%xmm1 \n"
+        "movups  (%3,%0,4), %%xmm4 \n"
+        "movups  (%4,%0,4), %%xmm6 \n"
+        "mulps      %%xmm0, %%xmm4 \n"
+        "mulps      %%xmm1, %%xmm6 \n"
+        "addps      %%xmm6, %%xmm4 \n"
+        "movups     %%xmm4, (%5,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(wa + nsamples), "r"(wb + nsamples),
+         "r"(a + 4 * nsamples), "r"(b + 4 * nsamples), "r"(dst + 4 * nsamples)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm4", "%xmm6",)
+         "memory"
+    );
+}
+
+static void blend_s16_stereo_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                                  const float *wa, const float *wb, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "1: \n"
+        LOAD_WEIGHTS_STEREO
+        "movdqu  (%3,%0,4), %%xmm4 \n"
+        "movdqu  (%4,%0,4), %%xmm6 \n"
+        S16_TO_FLOAT("xmm4", "xmm5")
+        S16_TO_FLOAT("xmm6", "xmm7")
+        BLEND_STEREO
+        "cvttps2dq  %%xmm4, %%xmm4 \n"
+        "cvttps2dq  %%xmm5, %%xmm5 \n"
+        "packssdw   %%xmm5, %%xmm4 \n"
+        "movdqu     %%xmm4, (%5,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(wa + nsamples), "r"(wb + nsamples),
+         "r"(a + 4 * nsamples), "r"(b + 4 * nsamples), "r"(dst + 4 * nsamples)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void blend_s16_mono_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                                const float *wa, const float *wb, int nsamples)
+{
+    x86_reg i = -nsamples;
+    __asm__ volatile(
+        "1: \n"
+        "movups  (%1,%0,4), %%xmm0 \n"
+        "movups  (%2,%0,4), %%xmm1 \n"
+        "movq    (%3,%0,2), %%xmm4 \n"
+        "movq    (%4,%0,2), %%xmm6 \n"
+        "punpcklwd  %%xmm4, %%xmm4 \n"
+        "punpcklwd  %%xmm6, %%xmm6 \n"
+        "psrad         $16, %%xmm4 \n"
+        "psrad         $16, %%xmm6 \n"
+        "cvtdq2ps   %%xmm4, %%xmm4 \n"
+        "cvtdq2ps   %%xmm6, %%xmm6 \n"
+        "mulps      %%xmm0, %%xmm4 \n"
+        "mulps      %%xmm1, %%xmm6 \n"
+        "addps      %%xmm6, %%xmm4 \n"
+        "cvttps2dq  %%xmm4, %%xmm4 \n"
+        "packssdw   %%xmm4, %%xmm4 \n"
+        "movq       %%xmm4, (%5,%0,2) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(wa + nsamples), "r"(wb + nsamples),
+         "r"(a + 2 * nsamples), "r"(b + 2 * nsamples), "r"(dst + 2 * nsamples)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm4", "%xmm6",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+#endif /* HAVE_INLINE_ASM */
+
+av_cold void ff_atempo_init_x86(ATempoDSPContext *dsp, enum AVSampleFormat format,
+                                int channels)
+{
+#if HAVE_INLINE_ASM
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE && format == AV_SAMPLE_FMT_FLT) {
+        if (channels == 1) {
+            dsp->blend   = blend_flt_mono_sse;
+        } else if (channels == 2) {
+            dsp->downmix = downmix_flt_stereo_sse;
+            dsp->blend   = blend_flt_stereo_sse;
+        }
+    }
+    if (cpu_flags & AV_CPU_FLAG_SSE2 && format == AV_SAMPLE_FMT_S16) {
+        if (channels == 1) {
+            dsp->downmix = downmix_s16_mono_sse2;
+            dsp->blend   = blend_s16_mono_sse2;
+        } else if (channels == 2) {
+            dsp->downmix = downmix_s16_stereo_sse2;
+            dsp->blend   = blend_s16_stereo_sse2;
+        }
+    }
+#endif
+#endif /* HAVE_INLINE_ASM */
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavfilter/hqdn3d.h"
+
+/* The two rows use 14 registers, which needs x86-64 and a free rbp. */
+#if HAVE_INLINE_ASM && ARCH_X86_64 && HAVE_EBP_AVAILABLE
+
+/* Every sample depends on its left neighbor through a table lookup, which
+ * SIMD cannot gather, so the rows are filtered by scalar code. As in the C
+ * version, the chains of both rows are interleaved. */
+
+/* prev = cur + coefs[(prev - cur) >> 4] */
+#define LOWPASS(prev, cur, coefs)                                   \
+    "sub     %["cur"], %["prev"]                        \n\t"       \
+    "sar     $4, %["prev"]                              \n\t"       \
+    "movswq  (%["coefs"], %["prev"], 2), %["prev"]      \n\t"       \
+    "add     %["cur"], %["prev"]                        \n\t"
+
+/* reg = src[x + offset] << shift */
+#define LOAD_SAMPLE(load, size, shift, src, offset, reg)            \
+    load"  "offset"(%["src"], %[x], "size"), %k["reg"]  \n\t"       \
+    "shl     $"shift", %k["reg"]                        \n\t"
+
+/* filter the spatial result t1 with the previous frame fa[x], and store
+ * the result in fa[x] and, scaled back to the sample depth, in dst[x] */
+#define TEMPORAL(store, size, shift, rnd, fa, dst)                  \
+    "movzwl  (%["fa"], %[x], 2), %k[t0]                 \n\t"       \
+    LOWPASS("t0", "t1", "tp")                                       \
+    "mov     %w[t0], (%["fa"], %[x], 2)                 \n\t"       \
+    "add     $"rnd", %k[t0]                             \n\t"       \
+    "shr     $"shift", %k[t0]                           \n\t"       \
+    "mov     %"store"[t0], (%["dst"], %[x], "size")     \n\t"
+
+/* Filter sample x of both rows. The next samples are loaded if next is
+ * set, the last sample of a row has none. */
+#define FILTER_SAMPLES(load, store, size, shift, rnd, next)         \
+    "movzwl  (%[la], %[x], 2), %k[t1]                   \n\t"       \
+    LOWPASS("t1", "pa", "sp")                                       \
+    next(LOAD_SAMPLE(load, size, shift, "src", size, "t0"))         \
+    next(LOWPASS("pa", "t0", "sp"))                                 \
+    TEMPORAL(store, size, shift, rnd, "fa", "dst")                  \
+    /* the line value of the first row is read back as 16 bits */   \
+    "movzwl  %w[t1], %k[t1]                             \n\t"       \
+    LOWPASS("t1", "pa2", "sp")                                      \
+    "mov     %w[t1], (%[la], %[x], 2)                   \n\t"       \
+    next(LOAD_SAMPLE(load, size, shift, "src2", size, "t0"))        \
+    next(LOWPASS("pa2", "t0", "sp"))                                \
+    TEMPORAL(store, size, shift, rnd, "fa2", "dst2")
+
+#define NEXT(x) x
+#define LAST(x)
+
+#define HQDN3D_ROWS(depth, load, store, size, shift, rnd)                      \
+static void denoise_rows_ ## depth ## _x86(uint8_t *src, uint8_t *dst,          \
+                                           uint16_t *line_ant,                  \
+                                           uint16_t *frame_ant, ptrdiff_t w,    \
+                                           ptrdiff_t sstride, ptrdiff_t dstride,\
+                                           int16_t *spatial, int16_t *temporal)\
+{                                                                               \
+    /* the pointers are moved to the last sample, which x reaches at 0 */      \
+    uint8_t  *src2       = src + sstride + (w - 1) * size;                      \
+    uint8_t  *dst2       = dst + dstride + (w - 1) * size;                      \
+    uint16_t *frame_ant2 = frame_ant + 2 * w - 1;                               \
+    x86_reg x = 1 - w, pa, pa2, t0, t1;                                         \
+                                                                                \
+    src       += (w - 1) * size;                                                \
+    dst       += (w - 1) * size;                                                \
+    line_ant  += w - 1;                                                         \
+    frame_ant += w - 1;                                                         \
+                                                                                \
+    __asm__ volatile(                                                           \
+        LOAD_SAMPLE(load, #size, #shift, "src",  "0", "pa")                     \
+        LOAD_SAMPLE(load, #size, #shift, "src2", "0", "pa2")                    \
+        "test    %[x], %[x]                                 \n\t"               \
+        "jz      2f                                         \n\t"               \
+        "1:                                                 \n\t"               \
+        FILTER_SAMPLES(load, store, #size, #shift, #rnd, NEXT)                  \
+        "add     $1, %[x]                                   \n\t"               \
+        "jnz     1b                                         \n\t"               \
+        "2:                                                 \n\t"               \
+        FILTER_SAMPLES(load, store, #size, #shift, #rnd, LAST)                  \
+        : [x]"+&r"(x), [pa]"=&r"(pa), [pa2]"=&r"(pa2),                          \
+          [t0]"=&r"(t0), [t1]"=&r"(t1)                                          \
+        : [src]"r"(src), [src2]"r"(src2), [dst]"r"(dst), [dst2]"r"(dst2),       \
+          [la]"r"(line_ant), [fa]"r"(frame_ant), [fa2]"r"(frame_ant2),          \
+          [sp]"r"(spatial), [tp]"r"(temporal)                                   \
+        : "memory"                                                              \
+    );                                                                          \
+}
+
+HQDN3D_ROWS( 8, "movzbl", "b", 1, 8, 127)
+HQDN3D_ROWS( 9, "movzwl", "w", 2, 7,  63)
+HQDN3D_ROWS(10, "movzwl", "w", 2, 6,  31)
+
+#endif /* HAVE_INLINE_ASM && ARCH_X86_64 && HAVE_EBP_AVAILABLE */
+
+av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
+{
+#if HAVE_INLINE_ASM && ARCH_X86_64 && HAVE_EBP_AVAILABLE
+    hqdn3d->denoise_rows[ 8] = denoise_rows_8_x86;
+    hqdn3d->denoise_rows[ 9] = denoise_rows_9_x86;
+    hqdn3d->denoise_rows[10] = denoise_rows_10_x86;
+#endif
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavfilter/overlay.h"
+
+#if HAVE_INLINE_ASM
+
+DECLARE_ALIGNED(16, static const uint16_t, pw_80)[8] = {0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80};
+DECLARE_ALIGNED(16, static const uint16_t, pw_ff)[8] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+
+#if HAVE_SSE
+/* xmm0 = FAST_DIV255(xmm0 * (255 - xmm2) + xmm1 * xmm2), on words;
+ * (r + (r >> 8)) >> 8 is the same as (r * 257) >> 16 for r < 65536 */
+#define BLEND_WORDS                                                          \
+        "movdqa     %%xmm6, %%xmm3 \n"                                      \
+        "psubw      %%xmm2, %%xmm3 \n" /* 255 - alpha */                    \
+        "pmullw     %%xmm2, %%xmm1 \n" /* src * alpha */                    \
+        "pmullw     %%xmm3, %%xmm0 \n" /* dst * (255 - alpha) */            \
+        "paddw      %%xmm1, %%xmm0 \n"                                      \
+        "paddw      %%xmm5, %%xmm0 \n" /* + 128 */                          \
+        "movdqa     %%xmm0, %%xmm1 \n"                                      \
+        "psrlw          $8, %%xmm1 \n"                                      \
+        "paddw      %%xmm1, %%xmm0 \n"                                      \
+        "psrlw          $8, %%xmm0 \n"
+
+static void overlay_blend_row_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int w)
+{
+    intptr_t x;
+    if (w & 7) {
+        x = w & ~7;
+        ff_overlay_blend_row_c(dst + x, src + x, alpha + x, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        "pxor       %%xmm7, %%xmm7 \n"
+        "movdqa         %5, %%xmm6 \n"
+        "movdqa         %4, %%xmm5 \n"
+        "1: \n"
+        "movq      (%1,%0), %%xmm0 \n"
+        "movq      (%2,%0), %%xmm1 \n"
+        "movq      (%3,%0), %%xmm2 \n"
+        "punpcklbw  %%xmm7, %%xmm0 \n"
+        "punpcklbw  %%xmm7, %%xmm1 \n"
+        "punpcklbw  %%xmm7, %%xmm2 \n"
+        BLEND_WORDS
+        "packuswb   %%xmm0, %%xmm0 \n"
+        "movq       %%xmm0, (%1,%0) \n"
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(dst+w), "r"(src+w), "r"(alpha+w),
+         "m"(*pw_80), "m"(*pw_ff)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void overlay_blend_row_420_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha,
+                                       int alpha_linesize, int w)
+{
+    intptr_t x;
+    if (w & 7) {
+        x = w & ~7;
+        ff_overlay_blend_row_420_c(dst + x, src + x, alpha + 2 * x, alpha_linesize, w - x);
+        w = x;
+    }
+    if (!w)
+        return;
+    x = -w;
+    __asm__ volatile(
+        "movdqa         %5, %%xmm6 \n"
+        "movdqa         %4, %%xmm5 \n"
+        "pxor       %%xmm7, %%xmm7 \n"
+        "1: \n"
+        "movdqu  (%3,%0,2), %%xmm2 \n"
+        "movdqu  (%6,%0,2), %%xmm3 \n"
+        "movdqa     %%xmm2, %%xmm0 \n"
+        "movdqa     %%xmm3, %%xmm1 \n"
+        "psrlw          $8, %%xmm2 \n"
+        "psrlw          $8, %%xmm3 \n"
+        "pand       %%xmm6, %%xmm0 \n"
+        "pand       %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm0, %%xmm2 \n"
+        "paddw      %%xmm1, %%xmm3 \n"
+        "paddw      %%xmm3, %%xmm2 \n"
+        "psrlw          $2, %%xmm2 \n" // average of the 2x2 alpha block
+        "movq      (%1,%0), %%xmm0 \n"
+        "movq      (%2,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm7, %%xmm0 \n"
+        "punpcklbw  %%xmm7, %%xmm1 \n"
+        BLEND_WORDS
+        "packuswb   %%xmm0, %%xmm0 \n"
+        "movq       %%xmm0, (%1,%0) \n"
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(dst+w), "r"(src+w), "r"(alpha+2*w),
+         "m"(*pw_80), "m"(*pw_ff), "r"(alpha+alpha_linesize+2*w)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+#endif /* HAVE_INLINE_ASM */
+
+av_cold void ff_overlay_init_x86(OverlayDSPContext *dsp)
+{
+#if HAVE_INLINE_ASM
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        dsp->blend_row     = overlay_blend_row_sse2;
+        dsp->blend_row_420 = overlay_blend_row_420_sse2;
+    }
+#endif
+#endif /* HAVE_INLINE_ASM */
+}
@@ -0,0 +1,188 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavfilter/volume.h"
+
+#if HAVE_INLINE_ASM
+
+DECLARE_ALIGNED(16, static const int16_t, pw_1)[8]      = { 1, 1, 1, 1, 1, 1, 1, 1 };
+DECLARE_ALIGNED(16, static const double,  pd_128)[2]    = { 128.0, 128.0 };
+DECLARE_ALIGNED(16, static const double,  pd_1_256)[2]  = { 1.0 / 256, 1.0 / 256 };
+DECLARE_ALIGNED(16, static const double,  pd_int32_min)[2] = { INT32_MIN, INT32_MIN };
+DECLARE_ALIGNED(16, static const double,  pd_int32_max)[2] = { INT32_MAX, INT32_MAX };
+
+#if HAVE_SSE
+/* (s * volume_i + 128) >> 8 with pmaddwd on (s, 1) * (volume_i, 128) pairs,
+ * exact as long as volume_i fits in a signed word */
+static void scale_samples_s16_sse2(uint8_t *p, int nb_samples,
+                                   const VolumeContext *vol)
+{
+    DECLARE_ALIGNED(16, int32_t, mul)[4];
+    x86_reg i = -2 * nb_samples;
+
+    mul[0] = mul[1] = mul[2] = mul[3] = vol->volume_i | 128 << 16;
+
+    __asm__ volatile(
+        "movdqa         %2, %%xmm6 \n"
+        "movdqa         %3, %%xmm7 \n"
+        "1: \n"
+        "movdqu  (%1,%0), %%xmm0 \n"
+        "movdqa   %%xmm0, %%xmm1 \n"
+        "punpcklwd %%xmm7, %%xmm0 \n"
+        "punpckhwd %%xmm7, %%xmm1 \n"
+        "pmaddwd  %%xmm6, %%xmm0 \n"
+        "pmaddwd  %%xmm6, %%xmm1 \n"
+        "psrad        $8, %%xmm0 \n"
+        "psrad        $8, %%xmm1 \n"
+        "packssdw %%xmm1, %%xmm0 \n"
+        "movdqu   %%xmm0, (%1,%0) \n"
+        "add         $16, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(p + 2 * nb_samples), "m"(*mul), "m"(*pw_1)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+/* the same in double precision, exact as long as s * volume_i + 128 fits
+ * in the 53-bit mantissa; the truncation is turned into a floor by
+ * subtracting one where the truncated value is above the exact one */
+#define S32_SCALE(src, tmp)                                                  \
+        "mulpd    %%xmm5, %%"src" \n"                                       \
+        "addpd         %3, %%"src" \n"                                      \
+        "mulpd         %4, %%"src" \n"                                      \
+        "minpd         %5, %%"src" \n"                                      \
+        "maxpd         %6, %%"src" \n"                                      \
+        "cvttpd2dq %%"src", %%"tmp" \n"                                     \
+        "cvtdq2pd  %%"tmp", %%xmm4 \n"                                      \
+        "cmpnlepd %%"src", %%xmm4 \n"   /* -1 where trunc > exact */        \
+        "pshufd $0x08, %%xmm4, %%xmm4 \n"                                   \
+        "paddd     %%xmm4, %%"tmp" \n"
+
+static void scale_samples_s32_sse2(uint8_t *p, int nb_samples,
+                                   const VolumeContext *vol)
+{
+    DECLARE_ALIGNED(16, double, mul)[2];
+    x86_reg i = -4 * nb_samples;
+
+    mul[0] = mul[1] = vol->volume_i;
+
+    __asm__ volatile(
+        "movapd         %2, %%xmm5 \n"
+        "1: \n"
+        "movdqu  (%1,%0), %%xmm0 \n"
+        "cvtdq2pd %%xmm0, %%xmm1 \n"
+        "pshufd $0xEE, %%xmm0, %%xmm0 \n"
+        "cvtdq2pd %%xmm0, %%xmm2 \n"
+        S32_SCALE("xmm1", "xmm0")
+        S32_SCALE("xmm2", "xmm3")
+        "punpcklqdq %%xmm3, %%xmm0 \n"
+        "movdqu   %%xmm0, (%1,%0) \n"
+        "add         $16, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(p + 4 * nb_samples), "m"(*mul),
+         "m"(*pd_128), "m"(*pd_1_256), "m"(*pd_int32_max), "m"(*pd_int32_min)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+         "memory"
+    );
+}
+
+static void scale_samples_flt_sse(uint8_t *p, int nb_samples,
+                                  const VolumeContext *vol)
+{
+    float scale = vol->volume;
+    x86_reg i = -4 * nb_samples;
+
+    __asm__ volatile(
+        "movss          %2, %%xmm7 \n"
+        "shufps $0, %%xmm7, %%xmm7 \n"
+        "1: \n"
+        "movups   (%1,%0), %%xmm0 \n"
+        "movups 16(%1,%0), %%xmm1 \n"
+        "mulps    %%xmm7, %%xmm0 \n"
+        "mulps    %%xmm7, %%xmm1 \n"
+        "movups   %%xmm0,   (%1,%0) \n"
+        "movups   %%xmm1, 16(%1,%0) \n"
+        "add         $32, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(p + 4 * nb_samples), "m"(scale)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",)
+         "memory"
+    );
+}
+
+static void scale_samples_dbl_sse2(uint8_t *p, int nb_samples,
+                                   const VolumeContext *vol)
+{
+    x86_reg i = -8 * nb_samples;
+
+    __asm__ volatile(
+        "movsd          %2, %%xmm7 \n"
+        "unpcklpd %%xmm7, %%xmm7 \n"
+        "1: \n"
+        "movupd   (%1,%0), %%xmm0 \n"
+        "movupd 16(%1,%0), %%xmm1 \n"
+        "mulpd    %%xmm7, %%xmm0 \n"
+        "mulpd    %%xmm7, %%xmm1 \n"
+        "movupd   %%xmm0,   (%1,%0) \n"
+        "movupd   %%xmm1, 16(%1,%0) \n"
+        "add         $32, %0 \n"
+        "jl 1b \n"
+        :"+&r"(i)
+        :"r"(p + 8 * nb_samples), "m"(vol->volume)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",)
+         "memory"
+    );
+}
+#endif /* HAVE_SSE */
+
+#endif /* HAVE_INLINE_ASM */
+
+av_cold void ff_volume_init_x86(VolumeContext *vol)
+{
+#if HAVE_INLINE_ASM
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE && vol->sample_fmt == AV_SAMPLE_FMT_FLT)
+        vol->scale_samples = scale_samples_flt_sse;
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        switch (vol->sample_fmt) {
+        case AV_SAMPLE_FMT_S16:
+            if (vol->volume_i < 32768)
+                vol->scale_samples = scale_samples_s16_sse2;
+            break;
+        case AV_SAMPLE_FMT_S32:
+            if (vol->volume_i < 1 << 22)
+                vol->scale_samples = scale_samples_s32_sse2;
+            break;
+        case AV_SAMPLE_FMT_DBL:
+            vol->scale_samples = scale_samples_dbl_sse2;
+            break;
+        }
+    }
+#endif
+#endif /* HAVE_INLINE_ASM */
+}
@@ -0,0 +1,225 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Same algorithm as yadif_template.c on 16-bit samples. All the
+ * intermediate values are kept in signed words, which is exact for
+ * samples of up to 12 bits; the scores of wider samples can overflow.
+ * prefs and mrefs are in bytes.
+ */
+
+#ifdef COMPILE_TEMPLATE_SSSE3
+#define PABS(tmp,dst) \
+            "pabsw     "dst", "dst" \n\t"
+#else
+#define PABS(tmp,dst) \
+            "pxor     "tmp", "tmp" \n\t"\
+            "psubw    "dst", "tmp" \n\t"\
+            "pmaxsw   "tmp", "dst" \n\t"
+#endif
+
+/* ABS(cur[x-refs+j+k] - cur[x+refs-j+k]) for k = -1, 0, 1 in xmm2,
+ * (cur[x-refs+j] + cur[x+refs-j])>>1 in xmm5 */
+#define CHECK(pj,mj) \
+            "movdqu "#pj"+2(%[cur],%[mrefs]), %%xmm2 \n\t" /* cur[x-refs+j] */\
+            "movdqu "#mj"+2(%[cur],%[prefs]), %%xmm3 \n\t" /* cur[x+refs-j] */\
+            "movdqa    %%xmm2, %%xmm5 \n\t"\
+            "paddw     %%xmm3, %%xmm5 \n\t"\
+            "psrlw     $1,     %%xmm5 \n\t"\
+            "psubw     %%xmm3, %%xmm2 \n\t"\
+            PABS(      "%%xmm7", "%%xmm2")\
+            "movdqu "#pj"(%[cur],%[mrefs]), %%xmm3 \n\t" /* cur[x-refs-1+j] */\
+            "movdqu "#mj"(%[cur],%[prefs]), %%xmm4 \n\t" /* cur[x+refs-1-j] */\
+            "psubw     %%xmm4, %%xmm3 \n\t"\
+            PABS(      "%%xmm7", "%%xmm3")\
+            "paddw     %%xmm3, %%xmm2 \n\t"\
+            "movdqu "#pj"+4(%[cur],%[mrefs]), %%xmm3 \n\t" /* cur[x-refs+1+j] */\
+            "movdqu "#mj"+4(%[cur],%[prefs]), %%xmm4 \n\t" /* cur[x+refs+1-j] */\
+            "psubw     %%xmm4, %%xmm3 \n\t"\
+            PABS(      "%%xmm7", "%%xmm3")\
+            "paddw     %%xmm3, %%xmm2 \n\t" /* score */
+
+#define CHECK1 \
+            "movdqa    %%xmm0, %%xmm3 \n\t"\
+            "pcmpgtw   %%xmm2, %%xmm3 \n\t" /* if(score < spatial_score) */\
+            "pminsw    %%xmm2, %%xmm0 \n\t" /* spatial_score= score; */\
+            "movdqa    %%xmm3, %%xmm6 \n\t"\
+            "pand      %%xmm3, %%xmm5 \n\t"\
+            "pandn     %%xmm1, %%xmm3 \n\t"\
+            "por       %%xmm5, %%xmm3 \n\t"\
+            "movdqa    %%xmm3, %%xmm1 \n\t" /* spatial_pred= (cur[x-refs+j] + cur[x+refs-j])>>1; */
+
+#define CHECK2 /* pretend not to have checked dir=2 if dir=1 was bad.\
+                  hurts both quality and speed, but matches the C version. */\
+            "paddw    "MANGLE(pw_1)", %%xmm6 \n\t"\
+            "psllw     $14,    %%xmm6 \n\t"\
+            "paddsw    %%xmm6, %%xmm2 \n\t"\
+            "movdqa    %%xmm0, %%xmm3 \n\t"\
+            "pcmpgtw   %%xmm2, %%xmm3 \n\t"\
+            "pminsw    %%xmm2, %%xmm0 \n\t"\
+            "pand      %%xmm3, %%xmm5 \n\t"\
+            "pandn     %%xmm1, %%xmm3 \n\t"\
+            "por       %%xmm5, %%xmm3 \n\t"\
+            "movdqa    %%xmm3, %%xmm1 \n\t"
+
+static void RENAME(yadif_filter_line_16bit)(uint16_t *dst, uint16_t *prev,
+                                            uint16_t *cur, uint16_t *next,
+                                            int w, int prefs, int mrefs,
+                                            int parity, int mode)
+{
+    uint8_t tmpU[5*16];
+    uint8_t *tmp= (uint8_t*)(((uint64_t)(tmpU+15)) & ~15);
+    int x;
+
+#define FILTER\
+    for(x=0; x<w; x+=8){\
+        __asm__ volatile(\
+            "movdqu  (%[cur],%[mrefs]), %%xmm0 \n\t" /* c = cur[x-refs] */\
+            "movdqu  (%[cur],%[prefs]), %%xmm1 \n\t" /* e = cur[x+refs] */\
+            "movdqu  (%["prev2"]), %%xmm2 \n\t" /* prev2[x] */\
+            "movdqu  (%["next2"]), %%xmm3 \n\t" /* next2[x] */\
+            "movdqa    %%xmm3, %%xmm4 \n\t"\
+            "paddw     %%xmm2, %%xmm3 \n\t"\
+            "psrlw     $1,     %%xmm3 \n\t" /* d = (prev2[x] + next2[x])>>1 */\
+            "movdqa    %%xmm0,   (%[tmp]) \n\t" /* c */\
+            "movdqa    %%xmm3, 16(%[tmp]) \n\t" /* d */\
+            "movdqa    %%xmm1, 32(%[tmp]) \n\t" /* e */\
+            "psubw     %%xmm4, %%xmm2 \n\t"\
+            PABS(      "%%xmm4", "%%xmm2") /* temporal_diff0 */\
+            "movdqu  (%[prev],%[mrefs]), %%xmm3 \n\t" /* prev[x-refs] */\
+            "movdqu  (%[prev],%[prefs]), %%xmm4 \n\t" /* prev[x+refs] */\
+            "psubw     %%xmm0, %%xmm3 \n\t"\
+            "psubw     %%xmm1, %%xmm4 \n\t"\
+            PABS(      "%%xmm5", "%%xmm3")\
+            PABS(      "%%xmm5", "%%xmm4")\
+            "paddw     %%xmm4, %%xmm3 \n\t" /* temporal_diff1 */\
+            "psrlw     $1,     %%xmm2 \n\t"\
+            "psrlw     $1,     %%xmm3 \n\t"\
+            "pmaxsw    %%xmm3, %%xmm2 \n\t"\
+            "movdqu  (%[next],%[mrefs]), %%xmm3 \n\t" /* next[x-refs] */\
+            "movdqu  (%[next],%[prefs]), %%xmm4 \n\t" /* next[x+refs] */\
+            "psubw     %%xmm0, %%xmm3 \n\t"\
+            "psubw     %%xmm1, %%xmm4 \n\t"\
+            PABS(      "%%xmm5", "%%xmm3")\
+            PABS(      "%%xmm5", "%%xmm4")\
+            "paddw     %%xmm4, %%xmm3 \n\t" /* temporal_diff2 */\
+            "psrlw     $1,     %%xmm3 \n\t"\
+            "pmaxsw    %%xmm3, %%xmm2 \n\t"\
+            "movdqa    %%xmm2, 48(%[tmp]) \n\t" /* diff */\
+\
+            "paddw     %%xmm0, %%xmm1 \n\t"\
+            "paddw     %%xmm0, %%xmm0 \n\t"\
+            "psubw     %%xmm1, %%xmm0 \n\t"\
+            "psrlw     $1,     %%xmm1 \n\t" /* spatial_pred */\
+            PABS(      "%%xmm2", "%%xmm0")      /* ABS(c-e) */\
+\
+            "movdqu -2(%[cur],%[mrefs]), %%xmm2 \n\t" /* cur[x-refs-1] */\
+            "movdqu -2(%[cur],%[prefs]), %%xmm3 \n\t" /* cur[x+refs-1] */\
+            "psubw     %%xmm3, %%xmm2 \n\t"\
+            PABS(      "%%xmm4", "%%xmm2")      /* ABS(cur[x-refs-1] - cur[x+refs-1]) */\
+            "movdqu  2(%[cur],%[mrefs]), %%xmm3 \n\t" /* cur[x-refs+1] */\
+            "movdqu  2(%[cur],%[prefs]), %%xmm4 \n\t" /* cur[x+refs+1] */\
+            "psubw     %%xmm4, %%xmm3 \n\t"\
+            PABS(      "%%xmm5", "%%xmm3")      /* ABS(cur[x-refs+1] - cur[x+refs+1]) */\
+            "paddw     %%xmm2, %%xmm0 \n\t"\
+            "paddw     %%xmm3, %%xmm0 \n\t"\
+            "psubw    "MANGLE(pw_1)", %%xmm0 \n\t" /* spatial_score */\
+\
+            CHECK(-4,0)\
+            CHECK1\
+            CHECK(-6,2)\
+            CHECK2\
+            CHECK(0,-4)\
+            CHECK1\
+            CHECK(2,-6)\
+            CHECK2\
+\
+            /* if(p->mode<2) ... */\
+            "movdqa 48(%[tmp]), %%xmm6 \n\t" /* diff */\
+            "cmpl      $2, %[mode] \n\t"\
+            "jge       1f \n\t"\
+            "movdqu  (%["prev2"],%[mrefs],2), %%xmm2 \n\t" /* prev2[x-2*refs] */\
+            "movdqu  (%["next2"],%[mrefs],2), %%xmm4 \n\t" /* next2[x-2*refs] */\
+            "movdqu  (%["prev2"],%[prefs],2), %%xmm3 \n\t" /* prev2[x+2*refs] */\
+            "movdqu  (%["next2"],%[prefs],2), %%xmm5 \n\t" /* next2[x+2*refs] */\
+            "paddw     %%xmm4, %%xmm2 \n\t"\
+            "paddw     %%xmm5, %%xmm3 \n\t"\
+            "psrlw     $1,     %%xmm2 \n\t" /* b */\
+            "psrlw     $1,     %%xmm3 \n\t" /* f */\
+            "movdqa   (%[tmp]), %%xmm4 \n\t" /* c */\
+            "movdqa 16(%[tmp]), %%xmm5 \n\t" /* d */\
+            "movdqa 32(%[tmp]), %%xmm7 \n\t" /* e */\
+            "psubw     %%xmm4, %%xmm2 \n\t" /* b-c */\
+            "psubw     %%xmm7, %%xmm3 \n\t" /* f-e */\
+            "movdqa    %%xmm5, %%xmm0 \n\t"\
+            "psubw     %%xmm4, %%xmm5 \n\t" /* d-c */\
+            "psubw     %%xmm7, %%xmm0 \n\t" /* d-e */\
+            "movdqa    %%xmm2, %%xmm4 \n\t"\
+            "pminsw    %%xmm3, %%xmm2 \n\t"\
+            "pmaxsw    %%xmm4, %%xmm3 \n\t"\
+            "pmaxsw    %%xmm5, %%xmm2 \n\t"\
+            "pminsw    %%xmm5, %%xmm3 \n\t"\
+            "pmaxsw    %%xmm0, %%xmm2 \n\t" /* max */\
+            "pminsw    %%xmm0, %%xmm3 \n\t" /* min */\
+            "pxor      %%xmm4, %%xmm4 \n\t"\
+            "pmaxsw    %%xmm3, %%xmm6 \n\t"\
+            "psubw     %%xmm2, %%xmm4 \n\t" /* -max */\
+            "pmaxsw    %%xmm4, %%xmm6 \n\t" /* diff= MAX3(diff, min, -max); */\
+            "1: \n\t"\
+\
+            "movdqa 16(%[tmp]), %%xmm2 \n\t" /* d */\
+            "movdqa    %%xmm2, %%xmm3 \n\t"\
+            "psubw     %%xmm6, %%xmm2 \n\t" /* d-diff */\
+            "paddw     %%xmm6, %%xmm3 \n\t" /* d+diff */\
+            "pmaxsw    %%xmm2, %%xmm1 \n\t"\
+            "pminsw    %%xmm3, %%xmm1 \n\t" /* d = clip(spatial_pred, d-diff, d+diff); */\
+\
+            ::[prev] "r"(prev),\
+             [cur]  "r"(cur),\
+             [next] "r"(next),\
+             [prefs]"r"((x86_reg)prefs),\
+             [mrefs]"r"((x86_reg)mrefs),\
+             [mode] "g"(mode),\
+             [tmp]  "r"(tmp)\
+        );\
+        __asm__ volatile("movdqu %%xmm1, %0" :"=m"(*(xmm_reg *)dst));\
+        dst += 8;\
+        prev+= 8;\
+        cur += 8;\
+        next+= 8;\
+    }
+
+    if (parity) {
+#define prev2 "prev"
+#define next2 "cur"
+        FILTER
+#undef prev2
+#undef next2
+    } else {
+#define prev2 "cur"
+#define next2 "next"
+        FILTER
+#undef prev2
+#undef next2
+    }
+}
+#undef PABS
+#undef CHECK
+#undef CHECK1
+#undef CHECK2
+#undef FILTER
@@ -19,6 +19,8 @@
 #ifndef AVFILTER_YADIF_H
 #define AVFILTER_YADIF_H
 
+#include "config.h"
+#include "libavutil/jobpool.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
 
@@ -58,6 +60,18 @@ typedef struct {
     int eof;
     uint8_t *temp_line;
     int temp_line_size;
+
+    /**
+     * number of threads filtering the rows of each field, each plane is
+     * split into that many slices
+     */
+    int nb_threads;
+
+    AVFilterBufferRef *dst; ///< picture being filtered
+    int dst_parity;         ///< parity of the field being filtered
+    int dst_tff;
+
+    AVJobPool *pool;        ///< threads filtering the slices, NULL for one thread
 } YADIFContext;
 
 void ff_yadif_init_x86(YADIFContext *yadif);
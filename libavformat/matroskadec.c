@@ -264,6 +264,10 @@ typedef struct {
 
     /* File has a CUES element, but we defer parsing until it is needed. */
     int cues_parsing_deferred;
+    /* Cue points were added to the stream indexes. */
+    int has_cues;
+    /* Byte position of the first cluster, start of the cluster bisection. */
+    int64_t first_cluster_pos;
 
     int current_cluster_num_blocks;
     int64_t current_cluster_pos;
@@ -524,8 +528,8 @@ static EbmlSyntax matroska_segments[] = {
 };
 
 static EbmlSyntax matroska_blockgroup[] = {
-    { MATROSKA_ID_BLOCK,          EBML_BIN,  0, offsetof(MatroskaBlock,bin) },
     { MATROSKA_ID_SIMPLEBLOCK,    EBML_BIN,  0, offsetof(MatroskaBlock,bin) },
+    { MATROSKA_ID_BLOCK,          EBML_BIN,  0, offsetof(MatroskaBlock,bin) },
     { MATROSKA_ID_BLOCKDURATION,  EBML_UINT, 0, offsetof(MatroskaBlock,duration) },
     { MATROSKA_ID_BLOCKREFERENCE, EBML_UINT, 0, offsetof(MatroskaBlock,reference) },
     { 1,                          EBML_UINT, 0, offsetof(MatroskaBlock,non_simple), {.u=1} },
@@ -551,9 +555,10 @@ static EbmlSyntax matroska_clusters[] = {
 };
 
 static EbmlSyntax matroska_cluster_incremental_parsing[] = {
-    { MATROSKA_ID_CLUSTERTIMECODE,EBML_UINT,0, offsetof(MatroskaCluster,timecode) },
-    { MATROSKA_ID_BLOCKGROUP,     EBML_NEST, sizeof(MatroskaBlock), offsetof(MatroskaCluster,blocks), {.n=matroska_blockgroup} },
+    /* looked up for every block, keep the block elements first */
     { MATROSKA_ID_SIMPLEBLOCK,    EBML_PASS, sizeof(MatroskaBlock), offsetof(MatroskaCluster,blocks), {.n=matroska_blockgroup} },
+    { MATROSKA_ID_BLOCKGROUP,     EBML_NEST, sizeof(MatroskaBlock), offsetof(MatroskaCluster,blocks), {.n=matroska_blockgroup} },
+    { MATROSKA_ID_CLUSTERTIMECODE,EBML_UINT,0, offsetof(MatroskaCluster,timecode) },
     { MATROSKA_ID_CLUSTERPOSITION,EBML_NONE },
     { MATROSKA_ID_CLUSTERPREVSIZE,EBML_NONE },
     { MATROSKA_ID_INFO,           EBML_NONE },
@@ -1357,6 +1362,13 @@ static void matroska_add_index_entries(MatroskaDemuxContext *matroska) {
                                    AVINDEX_KEYFRAME);
         }
     }
+
+    /* The AVIndexEntry arrays are all that is needed from here on,
+     * drop the parsed cue tree instead of keeping it until close. */
+    if (index_list->nb_elem)
+        matroska->has_cues = 1;
+    ebml_free(matroska_index, matroska);
+    memset(index_list, 0, sizeof(*index_list));
 }
 
 static void matroska_parse_cues(MatroskaDemuxContext *matroska) {
@@ -1457,6 +1469,8 @@ static int matroska_read_header(AVFormatContext *s)
         pos = avio_tell(matroska->ctx->pb);
         res = ebml_parse(matroska, matroska_segment, matroska);
     }
+    /* the ID of the first cluster has already been read */
+    matroska->first_cluster_pos = avio_tell(matroska->ctx->pb) - 4;
     matroska_execute_seekhead(matroska);
 
     if (!matroska->time_scale)
@@ -2236,13 +2250,164 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/*
+ * Read the timecode of the cluster whose ID was just read.
+ * Returns AV_NOPTS_VALUE if the data does not look like a cluster.
+ */
+static int64_t matroska_parse_cluster_timecode(MatroskaDemuxContext *matroska,
+                                               AVIOContext *pb)
+{
+    uint64_t id, length, timecode;
+    int i, res;
+
+    if (ebml_read_length(matroska, pb, &length) < 0)
+        return AV_NOPTS_VALUE;
+
+    /* the timecode is the first child, possibly after a CRC or Void */
+    for (i = 0; i < 3; i++) {
+        if ((res = ebml_read_num(matroska, pb, 4, &id)) < 0 ||
+            ebml_read_length(matroska, pb, &length) < 0)
+            return AV_NOPTS_VALUE;
+        id |= 1 << 7 * res;
+        if (id == MATROSKA_ID_CLUSTERTIMECODE) {
+            if (ebml_read_uint(pb, length, &timecode) < 0)
+                return AV_NOPTS_VALUE;
+            return timecode;
+        }
+        if (id != EBML_ID_CRC32 && id != EBML_ID_VOID)
+            break;
+        avio_skip(pb, length);
+    }
+    return AV_NOPTS_VALUE;
+}
+
+/*
+ * Find the first cluster starting in [*pos, end) and read its timecode.
+ * Returns the timecode, or AV_NOPTS_VALUE if there is no such cluster.
+ */
+static int64_t matroska_read_cluster_timecode(MatroskaDemuxContext *matroska,
+                                              int64_t *pos, int64_t end)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+    uint32_t cluster_id = 0;
+    int64_t timecode;
+
+    if (avio_seek(pb, *pos, SEEK_SET) < 0)
+        return AV_NOPTS_VALUE;
+    for (;;) {
+        while (cluster_id != MATROSKA_ID_CLUSTER) {
+            if (url_feof(pb) || avio_tell(pb) >= end + 4)
+                return AV_NOPTS_VALUE;
+            cluster_id = (cluster_id << 8) | avio_r8(pb);
+        }
+        *pos = avio_tell(pb) - 4;
+        timecode = matroska_parse_cluster_timecode(matroska, pb);
+        if (timecode != AV_NOPTS_VALUE)
+            return timecode;
+
+        /* the ID was found inside some payload, scan on after it */
+        cluster_id = 0;
+        if (avio_seek(pb, *pos + 4, SEEK_SET) < 0)
+            return AV_NOPTS_VALUE;
+    }
+}
+
+/*
+ * Bisect the cluster positions for the last cluster starting at or before
+ * timestamp, for files without cues. The keyframes that were already
+ * demuxed bound the search.
+ */
+static int matroska_find_cluster(MatroskaDemuxContext *matroska, AVStream *st,
+                                 int64_t timestamp, int64_t *pos_ret,
+                                 int64_t *ts_ret)
+{
+    int64_t lo, hi = avio_size(matroska->ctx->pb);
+    int64_t best_pos = matroska->first_cluster_pos, best_ts;
+    int index;
+
+    if (hi < 0)
+        return -1;
+    best_ts = matroska_read_cluster_timecode(matroska, &best_pos, hi);
+    if (best_ts == AV_NOPTS_VALUE)
+        return -1;
+
+    index = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_BACKWARD);
+    if (index >= 0 && st->index_entries[index].pos > best_pos) {
+        best_pos = st->index_entries[index].pos;
+        best_ts  = st->index_entries[index].timestamp;
+    }
+    index = av_index_search_timestamp(st, timestamp, 0);
+    if (index >= 0 && st->index_entries[index].timestamp > timestamp)
+        hi = FFMIN(hi, st->index_entries[index].pos);
+
+    lo = best_pos + 1;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2, pos = mid;
+        int64_t ts = matroska_read_cluster_timecode(matroska, &pos, hi);
+        if (ts == AV_NOPTS_VALUE || pos >= hi || ts > timestamp) {
+            /* no cluster at or before timestamp starts in [mid, hi) */
+            hi = mid;
+        } else {
+            best_pos = pos;
+            best_ts  = ts;
+            lo       = pos + 1;
+        }
+    }
+
+    *pos_ret = best_pos;
+    *ts_ret  = best_ts;
+    return 0;
+}
+
+/*
+ * Index the keyframes around timestamp for files without cues: demux
+ * from the cluster found by bisection up to timestamp, or up to the next
+ * keyframe of st for forward seeks, stepping back one cluster at a time
+ * until a keyframe of st at or before timestamp is known.
+ */
+static int matroska_index_clusters(MatroskaDemuxContext *matroska,
+                                   AVStream *st, int64_t timestamp, int flags)
+{
+    int64_t pos, ts = timestamp;
+    int index, forward = !(flags & AVSEEK_FLAG_BACKWARD);
+
+    do {
+        if (matroska_find_cluster(matroska, st, ts, &pos, &ts) < 0)
+            return -1;
+        avio_seek(matroska->ctx->pb, pos, SEEK_SET);
+        matroska->current_id = 0;
+        matroska->num_levels = 0;
+        matroska->done = 0;
+        matroska_clear_queue(matroska);
+        while (!matroska->done && matroska_parse_cluster(matroska) >= 0) {
+            AVPacket *pkt = matroska->num_packets ?
+                            matroska->packets[matroska->num_packets - 1] : NULL;
+            if (pkt && pkt->pts >= timestamp &&
+                (forward ? pkt->stream_index == st->index &&
+                           pkt->flags & AV_PKT_FLAG_KEY
+                         : pkt->pts > timestamp))
+                break;
+            matroska_clear_queue(matroska);
+        }
+        forward = 0;
+        matroska_clear_queue(matroska);
+        ts--;
+        /* a keyframe before the demuxed clusters may have more recent ones
+         * in the clusters in between */
+        index = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_BACKWARD);
+    } while ((index < 0 || st->index_entries[index].pos < pos) &&
+             pos > matroska->first_cluster_pos);
+
+    return 0;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
     MatroskaDemuxContext *matroska = s->priv_data;
     MatroskaTrack *tracks = matroska->tracks.elem;
     AVStream *st = s->streams[stream_index];
-    int i, index, index_sub, index_min;
+    int i, index, index_sub, index_min, indexed = 0;
 
     /* Parse the CUES now since we need the index data to seek. */
     if (matroska->cues_parsing_deferred > 0) {
@@ -2250,6 +2415,14 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         matroska_parse_cues(matroska);
     }
 
+    /* Without cues, locate the keyframes by bisecting the clusters. */
+    if (!matroska->has_cues && s->pb->seekable &&
+        !(s->flags & AVFMT_FLAG_IGNIDX)) {
+        if (matroska_index_clusters(matroska, st, timestamp, flags) < 0)
+            goto err;
+        indexed = 1;
+    }
+
     if (!st->nb_index_entries)
         goto err;
     timestamp = FFMAX(timestamp, st->index_entries[0].timestamp);
@@ -2266,7 +2439,9 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     matroska_clear_queue(matroska);
-    if (index < 0 || (matroska->cues_parsing_deferred < 0 && index == st->nb_index_entries - 1))
+    // the clusters around timestamp were indexed, the last entry is reliable
+    if (index < 0 || (matroska->cues_parsing_deferred < 0 && !indexed &&
+                      index == st->nb_index_entries - 1))
         goto err;
 
     index_min = index;
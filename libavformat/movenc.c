@@ -33,16 +33,22 @@
 #include "libavcodec/vc1.h"
 #include "internal.h"
 #include "libavutil/avstring.h"
+#include "libavutil/file.h"
 #include "libavutil/intfloat.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
 #include "rtpenc.h"
 #include "mov_chan.h"
+#include "os_support.h"
+
+#include <unistd.h>
 
 #undef NDEBUG
 #include <assert.h>
 
+#define MOV_SHIFT_BUFFER_SIZE (1024 * 1024)
+
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.dbl = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -52,6 +58,8 @@ static const AVOption options[] = {
     { "separate_moof", "Write separate moof/mdat atoms for each track", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_SEPARATE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_custom", "Flush fragments on caller requests", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_FRAG_CUSTOM}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "isml", "Create a live smooth streaming feed (for pushing to a publishing point)", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_ISML}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "spill_index", "Keep the sample index in a temporary file instead of memory", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_SPILL_INDEX}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "faststart", "Run a second pass to put the moov at the beginning of the file", 0, AV_OPT_TYPE_CONST, {.dbl = FF_MOV_FLAG_FASTSTART}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     FF_RTP_FLAG_OPTS(MOVMuxContext, rtp_flags),
     { "skip_iods", "Skip writing iods atom.", offsetof(MOVMuxContext, iods_skip), AV_OPT_TYPE_INT, {.dbl = 1}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { "iods_audio_profile", "iods audio profile atom.", offsetof(MOVMuxContext, iods_audio_profile), AV_OPT_TYPE_INT, {.dbl = -1}, -1, 255, AV_OPT_FLAG_ENCODING_PARAM},
@@ -82,14 +90,109 @@ static int64_t update_size(AVIOContext *pb, int64_t pos)
     return curpos - pos;
 }
 
+/*
+ * With -movflags spill_index, only one block of MOV_INDEX_CLUSTER_SIZE
+ * sample table entries per track is held in memory, the other blocks are
+ * stored in a temporary file and read back when the moov atom is written.
+ */
+static int mov_spill_open(AVFormatContext *s, MOVTrack *track)
+{
+    MOVMuxContext *mov = s->priv_data;
+    char *filename;
+
+    track->spill_fd = av_tempfile("ffmovidx", &filename, 0, s);
+    if (track->spill_fd < 0)
+        return track->spill_fd;
+    unlink(filename);
+    av_freep(&filename);
+    av_log(s, AV_LOG_DEBUG, "Spilling the index of track %d to a temporary file\n",
+           (int)(track - mov->tracks));
+    track->spilling = 1;
+    /* the block in memory has never been written out */
+    track->cluster_dirty = 1;
+    return 0;
+}
+
+static int mov_spill_io(MOVTrack *track, int first, int nb_entries, int do_write)
+{
+    int64_t offset = (int64_t)first * sizeof(*track->cluster);
+    uint8_t *buf = (uint8_t *)track->cluster;
+    int ret, size = nb_entries * sizeof(*track->cluster);
+
+    if (lseek(track->spill_fd, offset, SEEK_SET) != offset)
+        return AVERROR(errno);
+    while (size > 0) {
+        ret = do_write ? write(track->spill_fd, buf, size) :
+                         read (track->spill_fd, buf, size);
+        if (ret < 0)
+            return AVERROR(errno);
+        if (!ret)
+            return AVERROR(EIO);
+        buf  += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/**
+ * Make cluster hold the block of entries starting at first, writing the
+ * current block back to the spill file if it was modified.
+ */
+static int mov_load_entries(MOVTrack *track, int first)
+{
+    int i, ret = 0;
+
+    if (first == track->cluster_first)
+        return 0;
+    if (track->cluster_dirty)
+        ret = mov_spill_io(track, track->cluster_first,
+                           FFMIN(track->entry - track->cluster_first,
+                                 MOV_INDEX_CLUSTER_SIZE), 1);
+    track->cluster_dirty = 0;
+    track->cluster_first = first;
+    if (ret >= 0 && first < track->entry)
+        ret = mov_spill_io(track, first,
+                           FFMIN(track->entry - first, MOV_INDEX_CLUSTER_SIZE), 0);
+    if (ret < 0) {
+        /* keep the entries usable, the error is reported by the trailer */
+        memset(track->cluster, 0, MOV_INDEX_CLUSTER_SIZE * sizeof(*track->cluster));
+        for (i = 0; i < MOV_INDEX_CLUSTER_SIZE; i++)
+            track->cluster[i].entries = 1;
+        if (!track->spill_error)
+            track->spill_error = ret;
+    }
+    return ret;
+}
+
+/**
+ * Get entry i of the sample table. The pointer is only valid until the
+ * next call; set cluster_dirty after modifying the entry.
+ */
+static MOVIentry *mov_get_entry(MOVTrack *track, int i)
+{
+    if (!track->spilling)
+        return &track->cluster[i];
+    mov_load_entries(track, i - i % MOV_INDEX_CLUSTER_SIZE);
+    return &track->cluster[i - track->cluster_first];
+}
+
+static void mov_spill_close(MOVTrack *track)
+{
+    if (track->spilling)
+        close(track->spill_fd);
+    track->spilling = 0;
+}
+
 /* Chunk offset atom */
 static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
 {
     int i;
     int mode64 = 0; //   use 32 bit size variant if possible
     int64_t pos = avio_tell(pb);
+    /* the moov may precede the data when it is moved to the start */
+    uint64_t last_pos = track->entry ? mov_get_entry(track, track->entry - 1)->pos : 0;
     avio_wb32(pb, 0); /* size */
-    if (pos > UINT32_MAX) {
+    if (pos > UINT32_MAX || last_pos + track->data_offset > UINT32_MAX) {
         mode64 = 1;
         ffio_wfourcc(pb, "co64");
     } else
@@ -97,12 +200,13 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
     avio_wb32(pb, track->chunkCount); /* entry count */
     for (i=0; i<track->entry; i++) {
-        if(!track->cluster[i].chunkNum)
+        MOVIentry *e = mov_get_entry(track, i);
+        if(!e->chunkNum)
             continue;
         if(mode64 == 1)
-            avio_wb64(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb64(pb, e->pos + track->data_offset);
         else
-            avio_wb32(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb32(pb, e->pos + track->data_offset);
     }
     return update_size(pb, pos);
 }
@@ -119,15 +223,17 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
 
     for (i=0; i<track->entry; i++) {
-        tst = track->cluster[i].size/track->cluster[i].entries;
+        MOVIentry *e = mov_get_entry(track, i);
+        tst = e->size / e->entries;
         if(oldtst != -1 && tst != oldtst) {
             equalChunks = 0;
         }
         oldtst = tst;
-        entries += track->cluster[i].entries;
+        entries += e->entries;
     }
     if (equalChunks && track->entry) {
-        int sSize = track->entry ? track->cluster[0].size/track->cluster[0].entries : 0;
+        MOVIentry *e = mov_get_entry(track, 0);
+        int sSize = e->size / e->entries;
         sSize = FFMAX(1, sSize); // adpcm mono case could make sSize == 0
         avio_wb32(pb, sSize); // sample size
         avio_wb32(pb, entries); // sample count
@@ -136,9 +242,9 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
         avio_wb32(pb, 0); // sample size
         avio_wb32(pb, entries); // sample count
         for (i=0; i<track->entry; i++) {
-            for (j=0; j<track->cluster[i].entries; j++) {
-                avio_wb32(pb, track->cluster[i].size /
-                         track->cluster[i].entries);
+            MOVIentry *e = mov_get_entry(track, i);
+            for (j=0; j<e->entries; j++) {
+                avio_wb32(pb, e->size / e->entries);
             }
         }
     }
@@ -158,12 +264,13 @@ static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->chunkCount); // entry count
     for (i=0; i<track->entry; i++) {
-        if (oldval != track->cluster[i].samples_in_chunk && track->cluster[i].chunkNum)
+        MOVIentry *e = mov_get_entry(track, i);
+        if (oldval != e->samples_in_chunk && e->chunkNum)
         {
-            avio_wb32(pb, track->cluster[i].chunkNum); // first chunk
-            avio_wb32(pb, track->cluster[i].samples_in_chunk); // samples per chunk
+            avio_wb32(pb, e->chunkNum); // first chunk
+            avio_wb32(pb, e->samples_in_chunk); // samples per chunk
             avio_wb32(pb, 0x1); // sample description index
-            oldval = track->cluster[i].samples_in_chunk;
+            oldval = e->samples_in_chunk;
             index++;
         }
     }
@@ -187,7 +294,7 @@ static int mov_write_stss_tag(AVIOContext *pb, MOVTrack *track, uint32_t flag)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->entry); // entry count
     for (i=0; i<track->entry; i++) {
-        if (track->cluster[i].flags & flag) {
+        if (mov_get_entry(track, i)->flags & flag) {
             avio_wb32(pb, i+1);
             index++;
         }
@@ -291,7 +398,7 @@ static unsigned compute_avg_bitrate(MOVTrack *track)
     if (!track->track_duration)
         return 0;
     for (i = 0; i < track->entry; i++)
-        size += track->cluster[i].size;
+        size += mov_get_entry(track, i)->size;
     return size * 8 * track->timescale / track->track_duration;
 }
 
@@ -570,17 +677,20 @@ static int mov_get_lpcm_flags(enum AVCodecID codec_id)
 
 static int get_cluster_duration(MOVTrack *track, int cluster_idx)
 {
-    int64_t next_dts;
+    int64_t dts, next_dts;
 
     if (cluster_idx >= track->entry)
         return 0;
 
+    /* fetch the entries in order, so that a spilled index is read
+     * sequentially */
+    dts = mov_get_entry(track, cluster_idx)->dts;
     if (cluster_idx + 1 == track->entry)
         next_dts = track->track_duration + track->start_dts;
     else
-        next_dts = track->cluster[cluster_idx + 1].dts;
+        next_dts = mov_get_entry(track, cluster_idx + 1)->dts;
 
-    return next_dts - track->cluster[cluster_idx].dts;
+    return next_dts - dts;
 }
 
 static int get_samples_per_packet(MOVTrack *track)
@@ -1148,79 +1258,69 @@ static int mov_write_stsd_tag(AVIOContext *pb, MOVTrack *track)
     return update_size(pb, pos);
 }
 
-static int mov_write_ctts_tag(AVIOContext *pb, MOVTrack *track)
+/* Write the runs of equal values as (count, value) pairs, the number of
+ * pairs is patched in afterwards. */
+static int mov_write_runs_tag(AVIOContext *pb, MOVTrack *track, const char *tag,
+                              int (*get_value)(MOVTrack *track, int idx))
 {
-    MOVStts *ctts_entries;
-    uint32_t entries = 0;
-    uint32_t atom_size;
-    int i;
+    int64_t pos = avio_tell(pb), entryPos, curpos;
+    uint32_t entries = 0, count = 0;
+    int i, value = 0;
 
-    ctts_entries = av_malloc((track->entry + 1) * sizeof(*ctts_entries)); /* worst case */
-    ctts_entries[0].count = 1;
-    ctts_entries[0].duration = track->cluster[0].cts;
-    for (i=1; i<track->entry; i++) {
-        if (track->cluster[i].cts == ctts_entries[entries].duration) {
-            ctts_entries[entries].count++; /* compress */
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, tag);
+    avio_wb32(pb, 0); /* version & flags */
+    entryPos = avio_tell(pb);
+    avio_wb32(pb, 0); /* entry count */
+    for (i=0; i<track->entry; i++) {
+        int v = get_value(track, i);
+        if (i && v == value) {
+            count++; /* compress */
         } else {
-            entries++;
-            ctts_entries[entries].duration = track->cluster[i].cts;
-            ctts_entries[entries].count = 1;
+            if (count) {
+                avio_wb32(pb, count);
+                avio_wb32(pb, value);
+                entries++;
+            }
+            value = v;
+            count = 1;
         }
     }
-    entries++; /* last one */
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
-    ffio_wfourcc(pb, "ctts");
-    avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i=0; i<entries; i++) {
-        avio_wb32(pb, ctts_entries[i].count);
-        avio_wb32(pb, ctts_entries[i].duration);
+    if (count) { /* last one */
+        avio_wb32(pb, count);
+        avio_wb32(pb, value);
+        entries++;
     }
-    av_free(ctts_entries);
-    return atom_size;
+    curpos = avio_tell(pb);
+    avio_seek(pb, entryPos, SEEK_SET);
+    avio_wb32(pb, entries);
+    avio_seek(pb, curpos, SEEK_SET);
+    return update_size(pb, pos);
+}
+
+static int get_cluster_cts(MOVTrack *track, int cluster_idx)
+{
+    return mov_get_entry(track, cluster_idx)->cts;
+}
+
+static int mov_write_ctts_tag(AVIOContext *pb, MOVTrack *track)
+{
+    return mov_write_runs_tag(pb, track, "ctts", get_cluster_cts);
 }
 
 /* Time to sample atom */
 static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *stts_entries;
-    uint32_t entries = -1;
-    uint32_t atom_size;
-    int i;
-
     if (track->enc->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
-        stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
-        stts_entries[0].count = track->sample_count;
-        stts_entries[0].duration = 1;
-        entries = 1;
-    } else {
-        stts_entries = track->entry ?
-                       av_malloc(track->entry * sizeof(*stts_entries)) : /* worst case */
-                       NULL;
-        for (i=0; i<track->entry; i++) {
-            int duration = get_cluster_duration(track, i);
-            if (i && duration == stts_entries[entries].duration) {
-                stts_entries[entries].count++; /* compress */
-            } else {
-                entries++;
-                stts_entries[entries].duration = duration;
-                stts_entries[entries].count = 1;
-            }
-        }
-        entries++; /* last one */
-    }
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
-    ffio_wfourcc(pb, "stts");
-    avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i=0; i<entries; i++) {
-        avio_wb32(pb, stts_entries[i].count);
-        avio_wb32(pb, stts_entries[i].duration);
+        avio_wb32(pb, 24); /* size */
+        ffio_wfourcc(pb, "stts");
+        avio_wb32(pb, 0); /* version & flags */
+        avio_wb32(pb, 1); /* entry count */
+        avio_wb32(pb, track->sample_count);
+        avio_wb32(pb, 1); /* duration */
+        return 24;
     }
-    av_free(stts_entries);
-    return atom_size;
+    return mov_write_runs_tag(pb, track, "stts", get_cluster_duration);
 }
 
 static int mov_write_dref_tag(AVIOContext *pb)
@@ -1622,8 +1722,9 @@ static int mov_write_edts_tag(AVIOContext *pb, MOVTrack *track)
                                       track->timescale, AV_ROUND_UP);
     int version = duration < INT32_MAX ? 0 : 1;
     int entry_size, entry_count, size;
-    int64_t delay, start_ct = track->cluster[0].cts;
-    delay = av_rescale_rnd(track->cluster[0].dts + start_ct, MOV_TIMESCALE,
+    MOVIentry *first = mov_get_entry(track, 0);
+    int64_t delay, start_ct = first->cts;
+    delay = av_rescale_rnd(first->dts + start_ct, MOV_TIMESCALE,
                            track->timescale, AV_ROUND_DOWN);
     version |= delay < INT32_MAX ? 0 : 1;
 
@@ -2160,27 +2261,47 @@ static int mov_write_uuidusmt_tag(AVIOContext *pb, AVFormatContext *s)
     return 0;
 }
 
+/* Store the samples_in_chunk of the chunk starting at entry chunk */
+static void set_chunk_samples(MOVTrack *trk, int chunk, unsigned samples_in_chunk)
+{
+    MOVIentry *e = mov_get_entry(trk, chunk);
+    if (e->samples_in_chunk != samples_in_chunk) {
+        e->samples_in_chunk = samples_in_chunk;
+        trk->cluster_dirty = 1;
+    }
+}
+
 static void build_chunks(MOVTrack *trk)
 {
-    int i;
-    MOVIentry *chunk= &trk->cluster[0];
-    uint64_t chunkSize = chunk->size;
-    chunk->chunkNum= 1;
+    int i, chunk = 0;
+    MOVIentry *e = mov_get_entry(trk, 0);
+    uint64_t chunkPos  = e->pos;
+    uint64_t chunkSize = e->size;
+    unsigned chunkNum  = 1, chunkSamples = e->samples_in_chunk;
+    e->chunkNum= 1;
+    trk->cluster_dirty = 1;
     if (trk->chunkCount)
         return;
     trk->chunkCount= 1;
     for(i=1; i<trk->entry; i++){
-        if(chunk->pos + chunkSize == trk->cluster[i].pos &&
-            chunkSize + trk->cluster[i].size < (1<<20)){
-            chunkSize             += trk->cluster[i].size;
-            chunk->samples_in_chunk += trk->cluster[i].entries;
+        e = mov_get_entry(trk, i);
+        if(chunkPos + chunkSize == e->pos &&
+            chunkSize + e->size < (1<<20)){
+            chunkSize    += e->size;
+            chunkSamples += e->entries;
         }else{
-            trk->cluster[i].chunkNum = chunk->chunkNum+1;
-            chunk=&trk->cluster[i];
-            chunkSize = chunk->size;
+            chunkPos      = e->pos;
+            chunkSize     = e->size;
+            e->chunkNum   = ++chunkNum;
+            trk->cluster_dirty = 1;
+            /* the previous chunk may be in a spilled block, update it last */
+            set_chunk_samples(trk, chunk, chunkSamples);
+            chunkSamples  = mov_get_entry(trk, i)->samples_in_chunk;
+            chunk         = i;
             trk->chunkCount++;
         }
     }
+    set_chunk_samples(trk, chunk, chunkSamples);
 }
 
 static int mov_write_moov_tag(AVIOContext *pb, MOVMuxContext *mov,
@@ -2788,7 +2909,8 @@ static int mov_parse_mpeg2_frame(AVPacket *pkt, uint32_t *flags)
     return 0;
 }
 
-static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment)
+static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment,
+                                uint32_t *flags)
 {
     const uint8_t *start, *next, *end = pkt->data + pkt->size;
     int seq = 0, entry = 0;
@@ -2815,8 +2937,10 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment)
     } else if ((seq && !trk->vc1_info.packet_seq) ||
                (entry && !trk->vc1_info.packet_entry)) {
         int i;
-        for (i = 0; i < trk->entry; i++)
-            trk->cluster[i].flags &= ~MOV_SYNC_SAMPLE;
+        for (i = 0; i < trk->entry; i++) {
+            mov_get_entry(trk, i)->flags &= ~MOV_SYNC_SAMPLE;
+            trk->cluster_dirty = 1;
+        }
         trk->has_keyframes = 0;
         if (seq)
             trk->vc1_info.packet_seq = 1;
@@ -2828,7 +2952,8 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment)
                 (!entry || trk->vc1_info.first_packet_entry)) {
                 /* First packet had the same headers as this one, readd the
                  * sync sample flag. */
-                trk->cluster[0].flags |= MOV_SYNC_SAMPLE;
+                mov_get_entry(trk, 0)->flags |= MOV_SYNC_SAMPLE;
+                trk->cluster_dirty = 1;
                 trk->has_keyframes = 1;
             }
         }
@@ -2840,7 +2965,7 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment)
     else if (trk->vc1_info.packet_entry)
         key = entry;
     if (key) {
-        trk->cluster[trk->entry].flags |= MOV_SYNC_SAMPLE;
+        *flags |= MOV_SYNC_SAMPLE;
         trk->has_keyframes++;
     }
 }
@@ -2978,11 +3103,11 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     MOVTrack *trk = &mov->tracks[pkt->stream_index];
     AVCodecContext *enc = trk->enc;
     unsigned int samples_in_chunk = 0;
-    int size= pkt->size;
+    int size= pkt->size, ret;
     uint8_t *reformatted_data = NULL;
+    MOVIentry sample = { 0 };
 
     if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
-        int ret;
         if (mov->fragments > 0) {
             if (!trk->mdat_buf) {
                 if ((ret = avio_open_dyn_buf(&trk->mdat_buf)) < 0)
@@ -3055,24 +3180,18 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         memcpy(trk->vos_data, pkt->data, size);
     }
 
-    if (!(trk->entry % MOV_INDEX_CLUSTER_SIZE)) {
-        trk->cluster = av_realloc_f(trk->cluster, sizeof(*trk->cluster), (trk->entry + MOV_INDEX_CLUSTER_SIZE));
-        if (!trk->cluster)
-            return -1;
-    }
-
-    trk->cluster[trk->entry].pos = avio_tell(pb) - size;
-    trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
-    trk->cluster[trk->entry].chunkNum = 0;
-    trk->cluster[trk->entry].size = size;
-    trk->cluster[trk->entry].entries = samples_in_chunk;
-    trk->cluster[trk->entry].dts = pkt->dts;
+    sample.pos = avio_tell(pb) - size;
+    sample.samples_in_chunk = samples_in_chunk;
+    sample.chunkNum = 0;
+    sample.size = size;
+    sample.entries = samples_in_chunk;
+    sample.dts = pkt->dts;
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         /* First packet of a new fragment. We already wrote the duration
          * of the last packet of the previous fragment based on track_duration,
          * which might not exactly match our dts. Therefore adjust the dts
          * of this packet to be what the previous packets duration implies. */
-        trk->cluster[trk->entry].dts = trk->start_dts + trk->track_duration;
+        sample.dts = trk->start_dts + trk->track_duration;
     }
     if (trk->start_dts == AV_NOPTS_VALUE)
         trk->start_dts = pkt->dts;
@@ -3085,22 +3204,37 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (pkt->dts != pkt->pts)
         trk->flags |= MOV_TRACK_CTTS;
-    trk->cluster[trk->entry].cts = pkt->pts - pkt->dts;
-    trk->cluster[trk->entry].flags = 0;
+    sample.cts = pkt->pts - pkt->dts;
+    sample.flags = 0;
     if (enc->codec_id == AV_CODEC_ID_VC1) {
-        mov_parse_vc1_frame(pkt, trk, mov->fragments);
+        mov_parse_vc1_frame(pkt, trk, mov->fragments, &sample.flags);
     } else if (pkt->flags & AV_PKT_FLAG_KEY) {
         if (mov->mode == MODE_MOV && enc->codec_id == AV_CODEC_ID_MPEG2VIDEO &&
             trk->entry > 0) { // force sync sample for the first key frame
-            mov_parse_mpeg2_frame(pkt, &trk->cluster[trk->entry].flags);
-            if (trk->cluster[trk->entry].flags & MOV_PARTIAL_SYNC_SAMPLE)
+            mov_parse_mpeg2_frame(pkt, &sample.flags);
+            if (sample.flags & MOV_PARTIAL_SYNC_SAMPLE)
                 trk->flags |= MOV_TRACK_STPS;
         } else {
-            trk->cluster[trk->entry].flags = MOV_SYNC_SAMPLE;
+            sample.flags = MOV_SYNC_SAMPLE;
         }
-        if (trk->cluster[trk->entry].flags & MOV_SYNC_SAMPLE)
+        if (sample.flags & MOV_SYNC_SAMPLE)
             trk->has_keyframes++;
     }
+
+    if (trk->spilling || (mov->flags & FF_MOV_FLAG_SPILL_INDEX &&
+                          trk->entry == MOV_INDEX_CLUSTER_SIZE)) {
+        /* start a new block once the one in memory is full */
+        if (!trk->spilling && (ret = mov_spill_open(s, trk)) < 0)
+            return ret;
+        if ((ret = mov_load_entries(trk, trk->entry - trk->entry % MOV_INDEX_CLUSTER_SIZE)) < 0)
+            return ret;
+        trk->cluster_dirty = 1;
+    } else if (!(trk->entry % MOV_INDEX_CLUSTER_SIZE)) {
+        trk->cluster = av_realloc_f(trk->cluster, sizeof(*trk->cluster), (trk->entry + MOV_INDEX_CLUSTER_SIZE));
+        if (!trk->cluster)
+            return -1;
+    }
+    trk->cluster[trk->entry - trk->cluster_first] = sample;
     trk->entry++;
     trk->sample_count += samples_in_chunk;
     mov->mdat_size += size;
@@ -3124,7 +3258,7 @@ static int mov_write_single_packet(AVFormatContext *s, AVPacket *pkt)
 
         if (!pkt->size) return 0; /* Discard 0 sized packets */
 
-        if (trk->entry && pkt->stream_index < s->nb_streams)
+        if (trk->entry && !trk->spilling && pkt->stream_index < s->nb_streams)
             frag_duration = av_rescale_q(pkt->dts - trk->cluster[0].dts,
                                          s->streams[pkt->stream_index]->time_base,
                                          AV_TIME_BASE_Q);
@@ -3518,6 +3652,29 @@ static int mov_write_header(AVFormatContext *s)
                       FF_MOV_FLAG_FRAGMENT;
     }
 
+    if (mov->flags & FF_MOV_FLAG_SPILL_INDEX &&
+        mov->flags & FF_MOV_FLAG_FRAGMENT) {
+        av_log(s, AV_LOG_WARNING, "The spill_index flag is ignored "
+               "when writing fragments\n");
+        mov->flags &= ~FF_MOV_FLAG_SPILL_INDEX;
+    }
+
+    if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->flags & FF_MOV_FLAG_FRAGMENT || mov->reserved_moov_size) {
+            av_log(s, AV_LOG_ERROR, "The faststart flag is incompatible "
+                   "with fragmentation and moov_size\n");
+            goto error;
+        }
+        /* the second pass reads the data back through s->filename */
+        if (!s->pb->seekable ||
+            !(FFMAX(avio_check(s->filename, AVIO_FLAG_READ), 0) & AVIO_FLAG_READ)) {
+            av_log(s, AV_LOG_ERROR, "The faststart flag requires a seekable "
+                   "output file which can be reopened for reading\n");
+            goto error;
+        }
+        mov->reserved_moov_pos = avio_tell(pb);
+    }
+
     if(mov->reserved_moov_size){
         mov->reserved_moov_pos= avio_tell(pb);
         avio_skip(pb, mov->reserved_moov_size);
@@ -3580,6 +3737,75 @@ static int mov_write_header(AVFormatContext *s)
     return -1;
 }
 
+static int compute_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *moov_buf;
+    uint8_t *buf;
+    int ret, size;
+
+    if ((ret = avio_open_dyn_buf(&moov_buf)) < 0)
+        return ret;
+    mov_write_moov_tag(moov_buf, mov, s);
+    size = avio_close_dyn_buf(moov_buf, &buf);
+    av_free(buf);
+    return size;
+}
+
+/**
+ * Move the data written since reserved_moov_pos forward, to make room
+ * for the moov atom, and adjust the chunk offsets accordingly.
+ */
+static int shift_data(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *read_pb;
+    int64_t pos, end = avio_tell(s->pb);
+    int i, moov_size = 0, ret = 0;
+    uint8_t *buf;
+
+    /* the offsets may grow to 64 bits, changing the moov size again */
+    for (;;) {
+        int size = compute_moov_size(s);
+        if (size < 0)
+            return size;
+        if (size == moov_size)
+            break;
+        for (i = 0; i < mov->nb_streams; i++)
+            mov->tracks[i].data_offset += size - moov_size;
+        moov_size = size;
+    }
+
+    buf = av_malloc(MOV_SHIFT_BUFFER_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    avio_flush(s->pb);
+    ret = avio_open(&read_pb, s->filename, AVIO_FLAG_READ);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to re-open %s output file for "
+               "the second pass (faststart)\n", s->filename);
+        goto end;
+    }
+
+    /* copy backwards so that no data is overwritten before it is read */
+    for (pos = end; pos > mov->reserved_moov_pos; ) {
+        int n = FFMIN(pos - mov->reserved_moov_pos, MOV_SHIFT_BUFFER_SIZE);
+        pos -= n;
+        avio_seek(read_pb, pos, SEEK_SET);
+        if (avio_read(read_pb, buf, n) != n) {
+            ret = AVERROR(EIO);
+            break;
+        }
+        avio_seek(s->pb, pos + moov_size, SEEK_SET);
+        avio_write(s->pb, buf, n);
+    }
+    avio_close(read_pb);
+
+end:
+    av_free(buf);
+    return ret;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -3619,7 +3845,16 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, mov->reserved_moov_size ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
 
-        mov_write_moov_tag(pb, mov, s);
+        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+            av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
+            res = shift_data(s);
+            if (res < 0)
+                goto end;
+            avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+            mov_write_moov_tag(pb, mov, s);
+        } else {
+            mov_write_moov_tag(pb, mov, s);
+        }
         if(mov->reserved_moov_size){
             int64_t size=  mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_moov_pos);
             if(size < 8){
@@ -3637,6 +3872,7 @@ static int mov_write_trailer(AVFormatContext *s)
         mov_write_mfra_tag(pb, mov);
     }
 
+end:
     if (mov->chapter_track)
         av_freep(&mov->tracks[mov->chapter_track].enc);
 
@@ -3655,6 +3891,9 @@ static int mov_write_trailer(AVFormatContext *s)
                 avio_seek(pb, off, SEEK_SET);
             }
         }
+        if (mov->tracks[i].spill_error && res >= 0)
+            res = mov->tracks[i].spill_error;
+        mov_spill_close(&mov->tracks[i]);
         av_freep(&mov->tracks[i].cluster);
         av_freep(&mov->tracks[i].frag_info);
 
@@ -100,6 +100,11 @@ typedef struct MOVIndex {
     int         vos_len;
     uint8_t     *vos_data;
     MOVIentry   *cluster;
+    int         cluster_first;  ///< index of the first entry held in cluster when spilling
+    int         cluster_dirty;  ///< cluster holds entries not yet written to spill_fd
+    int         spilling;       ///< entries are spilled to spill_fd
+    int         spill_fd;       ///< temporary file holding the sample table
+    int         spill_error;
     int         audio_vbr;
     int         height; ///< active picture (w/o VBI) height for D-10/IMX
     uint32_t    tref_tag;
@@ -173,6 +178,8 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_SEPARATE_MOOF 16
 #define FF_MOV_FLAG_FRAG_CUSTOM 32
 #define FF_MOV_FLAG_ISML 64
+#define FF_MOV_FLAG_SPILL_INDEX 128
+#define FF_MOV_FLAG_FASTSTART 256
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
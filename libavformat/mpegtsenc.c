@@ -22,6 +22,7 @@
 #include "libavutil/bswap.h"
 #include "libavutil/crc.h"
 #include "libavutil/dict.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
@@ -32,6 +33,9 @@
 
 #define PCR_TIME_BASE 27000000
 
+/* number of TS packets gathered before they are passed to the AVIOContext */
+#define TS_BATCH_PACKETS 64
+
 /* write DVB SI sections */
 
 /*********************************************/
@@ -84,6 +88,10 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_AAC_LATM        0x02
     int flags;
     int copyts;
+
+    /* TS packets are assembled here and written with a single avio_write() */
+    uint8_t batch[TS_BATCH_PACKETS * (TS_PACKET_SIZE + 4)];
+    int batch_len;
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -227,6 +235,7 @@ static int mpegts_write_section1(MpegTSSection *s, int tid, int id,
 typedef struct MpegTSWriteStream {
     struct MpegTSService *service;
     int pid; /* stream associated pid */
+    uint32_t ts_header; /* sync byte, pid and payload indicator of every TS packet */
     int cc;
     int payload_size;
     int first_pts_check; ///< first pts check needed
@@ -479,27 +488,45 @@ static MpegTSService *mpegts_add_service(MpegTSWrite *ts,
 
 static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
-           ts->first_pcr;
+    return av_rescale(avio_tell(pb) + ts->batch_len + 11,
+                      8 * PCR_TIME_BASE, ts->mux_rate) + ts->first_pcr;
+}
+
+/* Write out the TS packets gathered so far */
+static void mpegts_flush_batch(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->batch_len) {
+        avio_write(s->pb, ts->batch, ts->batch_len);
+        ts->batch_len = 0;
+    }
 }
 
-static void mpegts_prefix_m2ts_header(AVFormatContext *s)
+/* Reserve the next TS packet in the batch buffer, preceded by the m2ts
+ * header if needed. The returned packet must be filled by the caller. */
+static uint8_t *mpegts_get_ts_packet(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
+    uint8_t *pkt;
+
+    if (ts->batch_len + 4 + TS_PACKET_SIZE > sizeof(ts->batch))
+        mpegts_flush_batch(s);
+
     if (ts->m2ts_mode) {
-        int64_t pcr = get_pcr(s->priv_data, s->pb);
-        uint32_t tp_extra_header = pcr % 0x3fffffff;
-        tp_extra_header = AV_RB32(&tp_extra_header);
-        avio_write(s->pb, (unsigned char *) &tp_extra_header,
-                sizeof(tp_extra_header));
+        int64_t pcr = get_pcr(ts, s->pb);
+        AV_WB32(ts->batch + ts->batch_len, pcr % 0x3fffffff);
+        ts->batch_len += 4;
     }
+    pkt = ts->batch + ts->batch_len;
+    ts->batch_len += TS_PACKET_SIZE;
+    return pkt;
 }
 
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
-    mpegts_prefix_m2ts_header(ctx);
-    avio_write(ctx->pb, packet, TS_PACKET_SIZE);
+    memcpy(mpegts_get_ts_packet(ctx), packet, TS_PACKET_SIZE);
 }
 
 static int mpegts_write_header(AVFormatContext *s)
@@ -576,6 +603,7 @@ static int mpegts_write_header(AVFormatContext *s)
             ret = AVERROR(EINVAL);
             goto fail;
         }
+        ts_st->ts_header = 0x47 << 24 | ts_st->pid << 8 | 0x10;
         if (ts_st->pid == service->pmt.pid) {
             av_log(s, AV_LOG_ERROR, "Duplicate stream id %d\n", ts_st->pid);
             ret = AVERROR(EINVAL);
@@ -685,6 +713,7 @@ static int mpegts_write_header(AVFormatContext *s)
         }
     }
 
+    mpegts_flush_batch(s);
     avio_flush(s->pb);
 
     return 0;
@@ -743,28 +772,24 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 /* Write a single null transport stream packet */
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
-    uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *q, *buf;
 
-    q = buf;
+    q = buf = mpegts_get_ts_packet(s);
     *q++ = 0x47;
     *q++ = 0x00 | 0x1f;
     *q++ = 0xff;
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
-static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
+static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st,
+                                   int64_t pcr)
 {
-    MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
-    uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *q, *buf;
 
-    q = buf;
+    q = buf = mpegts_get_ts_packet(s);
     *q++ = 0x47;
     *q++ = ts_st->pid >> 8;
     *q++ = ts_st->pid;
@@ -774,12 +799,10 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     *q++ = 0x10;               /* Adaptation flags: PCR present */
 
     /* PCR coded into 6 bytes */
-    q += write_pcr_bits(q, get_pcr(ts, s->pb));
+    q += write_pcr_bits(q, pcr);
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -840,7 +863,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 {
     MpegTSWriteStream *ts_st = st->priv_data;
     MpegTSWrite *ts = s->priv_data;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf;
     uint8_t *q;
     int val, is_start, len, header_len, write_pcr, private_code, flags;
     int afc_len, stuffing_len;
@@ -864,26 +887,25 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             }
         }
 
-        if (ts->mux_rate > 1 && dts != AV_NOPTS_VALUE &&
-            (dts - get_pcr(ts, s->pb)/300) > delay) {
-            /* pcr insert gets priority over null packet insert */
-            if (write_pcr)
-                mpegts_insert_pcr_only(s, st);
-            else
-                mpegts_insert_null_packet(s);
-            continue; /* recalculate write_pcr and possibly retransmit si_info */
+        if (ts->mux_rate > 1) {
+            /* the PCR of the next packet, computed once since it is
+             * both needed for the null insertion check and the PCR field */
+            pcr = get_pcr(ts, s->pb);
+            if (dts != AV_NOPTS_VALUE && (dts - pcr / 300) > delay) {
+                /* pcr insert gets priority over null packet insert */
+                if (write_pcr)
+                    mpegts_insert_pcr_only(s, st, pcr);
+                else
+                    mpegts_insert_null_packet(s);
+                continue; /* recalculate write_pcr and possibly retransmit si_info */
+            }
         }
 
-        /* prepare packet header */
-        q = buf;
-        *q++ = 0x47;
-        val = (ts_st->pid >> 8);
-        if (is_start)
-            val |= 0x40;
-        *q++ = val;
-        *q++ = ts_st->pid;
+        /* prepare packet header from the stream template */
+        buf = mpegts_get_ts_packet(s);
         ts_st->cc = (ts_st->cc + 1) & 0xf;
-        *q++ = 0x10 | ts_st->cc; // payload indicator + CC
+        AV_WB32(buf, ts_st->ts_header | (is_start << 22) | ts_st->cc);
+        q = buf + 4;
         if (key && is_start && pts != AV_NOPTS_VALUE) {
             // set Random Access for key frames
             if (ts_st->pid == ts_st->service->pcr_pid)
@@ -895,9 +917,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             set_af_flag(buf, 0x10);
             q = get_ts_payload_start(buf);
             // add 11, pcr references the last byte of program clock reference base
-            if (ts->mux_rate > 1)
-                pcr = get_pcr(ts, s->pb);
-            else
+            if (ts->mux_rate <= 1)
                 pcr = (dts - delay)*300;
             if (dts != AV_NOPTS_VALUE && dts < pcr / 300)
                 av_log(s, AV_LOG_WARNING, "dts < pcr, TS is invalid\n");
@@ -1043,9 +1063,8 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         memcpy(buf + TS_PACKET_SIZE - len, payload, len);
         payload += len;
         payload_size -= len;
-        mpegts_prefix_m2ts_header(s);
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
     }
+    mpegts_flush_batch(s);
     avio_flush(s->pb);
     ts_st->prev_payload_key = key;
 }
@@ -1207,6 +1226,7 @@ static void mpegts_write_flush(AVFormatContext *s)
             ts_st->payload_size = 0;
         }
     }
+    mpegts_flush_batch(s);
     avio_flush(s->pb);
 }
 
@@ -0,0 +1,761 @@
+/*
+ * Tee pseudo-muxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Tee pseudo-muxer: write the same packets to several outputs.
+ *
+ * The filename is a list of slave outputs separated by '|'. Each slave may
+ * be prefixed by a list of options between square brackets, for example:
+ * [f=mpegts:onfail=ignore]udp://239.0.0.1:1234|[bsfs/v=h264_mp4toannexb]out.ts
+ *
+ * When threading is available every slave is fed through its own bounded
+ * packet queue by a dedicated thread, so that a slow output only stalls
+ * the others once its queue is full.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/opt.h"
+#include "avformat.h"
+#include "internal.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#define MAX_SLAVES 16
+
+typedef enum {
+    ON_SLAVE_FAILURE_ABORT  = 1,
+    ON_SLAVE_FAILURE_IGNORE = 2,
+} SlaveFailurePolicy;
+
+typedef struct {
+    AVFormatContext *avf;
+    AVBitStreamFilterContext **bsfs; ///< bitstream filter chain of each stream
+    SlaveFailurePolicy on_fail;
+    int error;                       ///< first error returned by the slave
+    int header_written;
+#if HAVE_PTHREADS
+    AVFifoBuffer *queue;             ///< pending packets, at most queue_size
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int thread_started;
+    int eof;                         ///< no more packets will be queued
+#endif
+} TeeSlave;
+
+typedef struct TeeContext {
+    const AVClass *class;
+    unsigned nb_slaves;
+    unsigned nb_alive;
+    TeeSlave slaves[MAX_SLAVES];
+    int queue_size;                  ///< per slave queue length, 0 for synchronous writes
+} TeeContext;
+
+static const char *const slave_delim     = "|";
+static const char *const slave_opt_open  = "[";
+static const char *const slave_opt_close = "]";
+static const char *const slave_opt_delim = ":]"; /* must have the close too */
+static const char *const slave_bsfs_spec_sep = "/";
+
+static int parse_slave_options(void *log, char *slave,
+                               AVDictionary **options, char **filename)
+{
+    const char *p;
+    char *key, *val;
+    int ret;
+
+    if (!strspn(slave, slave_opt_open)) {
+        *filename = slave;
+        return 0;
+    }
+    p = slave + 1;
+    while (1) {
+        key = av_get_token(&p, "=");
+        if (!key || *p != '=') {
+            av_log(log, AV_LOG_ERROR, "No option value in slave '%s'\n", slave);
+            av_free(key);
+            return AVERROR(EINVAL);
+        }
+        p++;
+        val = av_get_token(&p, slave_opt_delim);
+        if (!val) {
+            av_free(key);
+            return AVERROR(ENOMEM);
+        }
+        ret = av_dict_set(options, key, val,
+                          AV_DICT_DONT_STRDUP_KEY | AV_DICT_DONT_STRDUP_VAL);
+        if (ret < 0)
+            return ret;
+        if (strspn(p, slave_opt_close))
+            break;
+        if (!*p) {
+            av_log(log, AV_LOG_ERROR, "Unterminated options in slave '%s'\n", slave);
+            return AVERROR(EINVAL);
+        }
+        p++;
+    }
+    *filename = (char *)p + 1;
+    return 0;
+}
+
+/**
+ * Parse a comma separated list of bitstream filters and chain them.
+ */
+static int parse_bsfs(void *log_ctx, const char *bsfs_spec,
+                      AVBitStreamFilterContext **bsfs)
+{
+    char *bsf_name, *buf, *dup, *saveptr = NULL;
+    int ret = 0;
+
+    if (!(dup = buf = av_strdup(bsfs_spec)))
+        return AVERROR(ENOMEM);
+
+    while ((bsf_name = av_strtok(buf, ",", &saveptr))) {
+        AVBitStreamFilterContext *bsf = av_bitstream_filter_init(bsf_name);
+
+        if (!bsf) {
+            av_log(log_ctx, AV_LOG_ERROR,
+                   "Cannot initialize bitstream filter with name '%s'\n",
+                   bsf_name);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+
+        *bsfs = bsf;
+        bsfs = &bsf->next;
+        buf = NULL;
+    }
+
+end:
+    av_free(dup);
+    return ret;
+}
+
+static void close_slave_bsfs(TeeSlave *tee_slave)
+{
+    unsigned i;
+
+    if (!tee_slave->bsfs)
+        return;
+    for (i = 0; i < tee_slave->avf->nb_streams; i++) {
+        AVBitStreamFilterContext *bsf = tee_slave->bsfs[i], *next;
+        while (bsf) {
+            next = bsf->next;
+            av_bitstream_filter_close(bsf);
+            bsf = next;
+        }
+    }
+    av_freep(&tee_slave->bsfs);
+}
+
+static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
+{
+    int i, ret;
+    AVDictionary *options = NULL;
+    AVDictionaryEntry *entry;
+    char *filename;
+    char *format = NULL, *on_fail = NULL;
+    AVFormatContext *avf2 = NULL;
+    AVStream *st, *st2;
+
+    if ((ret = parse_slave_options(avf, slave, &options, &filename)) < 0)
+        goto end;
+
+#define STEAL_OPTION(option, field) do {                                \
+        if ((entry = av_dict_get(options, option, NULL, 0))) {          \
+            field = entry->value;                                       \
+            entry->value = NULL; /* prevent it from being freed */      \
+            av_dict_set(&options, option, NULL, 0);                     \
+        }                                                               \
+    } while (0)
+
+    STEAL_OPTION("f", format);
+    STEAL_OPTION("onfail", on_fail);
+
+    tee_slave->on_fail = ON_SLAVE_FAILURE_ABORT;
+    if (on_fail) {
+        if (!strcmp(on_fail, "ignore")) {
+            tee_slave->on_fail = ON_SLAVE_FAILURE_IGNORE;
+        } else if (strcmp(on_fail, "abort")) {
+            av_log(avf, AV_LOG_ERROR,
+                   "Invalid onfail value '%s' for slave '%s', "
+                   "expected 'abort' or 'ignore'\n", on_fail, filename);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+    }
+
+    ret = avformat_alloc_output_context2(&avf2, NULL, format, filename);
+    if (ret < 0)
+        goto end;
+    tee_slave->avf = avf2;
+    av_dict_copy(&avf2->metadata, avf->metadata, 0);
+    avf2->max_delay = avf->max_delay;
+
+    for (i = 0; i < avf->nb_streams; i++) {
+        st = avf->streams[i];
+        if (!(st2 = avformat_new_stream(avf2, NULL))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st2->id = st->id;
+        st2->r_frame_rate        = st->r_frame_rate;
+        st2->time_base           = st->time_base;
+        st2->sample_aspect_ratio = st->sample_aspect_ratio;
+        av_dict_copy(&st2->metadata, st->metadata, 0);
+        if ((ret = avcodec_copy_context(st2->codec, st->codec)) < 0)
+            goto end;
+        /* keep the codec tag only if it is valid for the slave format */
+        if (avf2->oformat->codec_tag &&
+            av_codec_get_id(avf2->oformat->codec_tag,
+                            st2->codec->codec_tag) != st2->codec->codec_id &&
+            av_codec_get_tag(avf2->oformat->codec_tag,
+                             st2->codec->codec_id) > 0)
+            st2->codec->codec_tag = 0;
+    }
+
+    if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_open2(&avf2->pb, filename, AVIO_FLAG_WRITE,
+                              &avf->interrupt_callback, NULL)) < 0) {
+            av_log(avf, AV_LOG_ERROR, "Slave '%s': error opening: %s\n",
+                   slave, av_err2str(ret));
+            goto end;
+        }
+    }
+
+    tee_slave->bsfs = av_mallocz(avf2->nb_streams * sizeof(*tee_slave->bsfs));
+    if (!tee_slave->bsfs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* bsfs=... applies to every stream, bsfs/<stream specifier>=... only
+     * to the matching streams */
+    entry = NULL;
+    while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
+        const char *spec = entry->key + strlen("bsfs");
+        if (*spec) {
+            if (strspn(spec, slave_bsfs_spec_sep) != 1) {
+                av_log(avf, AV_LOG_ERROR,
+                       "Specifier separator in '%s' is '%c', but only "
+                       "characters '%s' are allowed\n",
+                       entry->key, *spec, slave_bsfs_spec_sep);
+                ret = AVERROR(EINVAL);
+                goto end;
+            }
+            spec++; /* consume separator */
+        }
+
+        for (i = 0; i < avf2->nb_streams; i++) {
+            ret = avformat_match_stream_specifier(avf2, avf2->streams[i], spec);
+            if (ret < 0) {
+                av_log(avf, AV_LOG_ERROR,
+                       "Invalid stream specifier '%s' in bsfs option '%s' "
+                       "for slave output '%s'\n", spec, entry->key, filename);
+                goto end;
+            }
+            if (ret > 0) {
+                av_log(avf, AV_LOG_DEBUG, "spec:%s bsfs:%s matches stream %d "
+                       "of slave output '%s'\n", spec, entry->value, i, filename);
+                if (tee_slave->bsfs[i]) {
+                    av_log(avf, AV_LOG_WARNING,
+                           "Duplicate bsfs specification associated to stream "
+                           "%d of slave output '%s', filters will be ignored\n",
+                           i, filename);
+                    continue;
+                }
+                ret = parse_bsfs(avf, entry->value, &tee_slave->bsfs[i]);
+                if (ret < 0) {
+                    av_log(avf, AV_LOG_ERROR,
+                           "Error parsing bitstream filter sequence '%s' "
+                           "associated to stream %d of slave output '%s'\n",
+                           entry->value, i, filename);
+                    goto end;
+                }
+            }
+        }
+        av_dict_set(&options, entry->key, NULL, 0);
+        entry = NULL;
+    }
+
+    if ((ret = avformat_write_header(avf2, &options)) < 0) {
+        av_log(avf, AV_LOG_ERROR, "Slave '%s': error writing header: %s\n",
+               slave, av_err2str(ret));
+        goto end;
+    }
+    tee_slave->header_written = 1;
+
+    if (options) {
+        entry = NULL;
+        while ((entry = av_dict_get(options, "", entry, AV_DICT_IGNORE_SUFFIX)))
+            av_log(avf2, AV_LOG_ERROR, "Unknown option '%s'\n", entry->key);
+        ret = AVERROR_OPTION_NOT_FOUND;
+        goto end;
+    }
+
+end:
+    av_free(format);
+    av_free(on_fail);
+    av_dict_free(&options);
+    return ret;
+}
+
+static void close_slave(TeeSlave *tee_slave)
+{
+    AVFormatContext *avf = tee_slave->avf;
+
+    if (!avf)
+        return;
+    if (tee_slave->header_written)
+        av_write_trailer(avf);
+    close_slave_bsfs(tee_slave);
+    if (!(avf->oformat->flags & AVFMT_NOFILE))
+        avio_close(avf->pb);
+    avf->pb = NULL;
+    avformat_free_context(avf);
+    tee_slave->avf = NULL;
+}
+
+static void log_slave(TeeSlave *slave, void *log_ctx, int log_level)
+{
+    int i;
+
+    av_log(log_ctx, log_level, "filename:'%s' format:%s\n",
+           slave->avf->filename, slave->avf->oformat->name);
+    for (i = 0; i < slave->avf->nb_streams; i++) {
+        AVStream *st = slave->avf->streams[i];
+        AVBitStreamFilterContext *bsf = slave->bsfs[i];
+
+        av_log(log_ctx, log_level, "    stream:%d codec:%s type:%s",
+               i, avcodec_get_name(st->codec->codec_id),
+               av_get_media_type_string(st->codec->codec_type));
+        if (bsf) {
+            av_log(log_ctx, log_level, " bsfs:");
+            while (bsf) {
+                av_log(log_ctx, log_level, "%s%s",
+                       bsf->filter->name, bsf->next ? "," : "");
+                bsf = bsf->next;
+            }
+        }
+        av_log(log_ctx, log_level, "\n");
+    }
+}
+
+/**
+ * Run the packet through the bitstream filters of its stream.
+ * On return the packet always owns its data.
+ */
+static int filter_packet(void *log_ctx, AVPacket *pkt,
+                         AVFormatContext *fmt_ctx, AVBitStreamFilterContext *bsf_ctx)
+{
+    AVCodecContext *enc_ctx = fmt_ctx->streams[pkt->stream_index]->codec;
+    int ret = 0;
+
+    while (bsf_ctx) {
+        AVPacket new_pkt = *pkt;
+        ret = av_bitstream_filter_filter(bsf_ctx, enc_ctx, NULL,
+                                         &new_pkt.data, &new_pkt.size,
+                                         pkt->data, pkt->size,
+                                         pkt->flags & AV_PKT_FLAG_KEY);
+        if (ret == 0 && new_pkt.data != pkt->data && new_pkt.destruct) {
+            /* the new data is a subset of the old one, so cannot overflow */
+            uint8_t *t = av_malloc(new_pkt.size + FF_INPUT_BUFFER_PADDING_SIZE);
+            if (t) {
+                memcpy(t, new_pkt.data, new_pkt.size);
+                memset(t + new_pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+                new_pkt.data = t;
+                ret = 1;
+            } else
+                ret = AVERROR(ENOMEM);
+        }
+
+        if (ret > 0) {
+            av_free_packet(pkt);
+            new_pkt.destruct = av_destruct_packet;
+        }
+        *pkt = new_pkt;
+        if (ret < 0) {
+            av_log(log_ctx, AV_LOG_ERROR,
+                   "Failed to filter bitstream with filter %s for stream %d "
+                   "in file '%s' with codec %s\n", bsf_ctx->filter->name,
+                   pkt->stream_index, fmt_ctx->filename,
+                   avcodec_get_name(enc_ctx->codec_id));
+            break;
+        }
+        bsf_ctx = bsf_ctx->next;
+    }
+
+    return ret < 0 ? ret : 0;
+}
+
+/**
+ * Write a packet owned by the caller to a slave; the packet is consumed.
+ */
+static int slave_write_packet(TeeSlave *tee_slave, AVPacket *pkt)
+{
+    int ret;
+
+    if ((ret = filter_packet(tee_slave->avf, pkt, tee_slave->avf,
+                             tee_slave->bsfs[pkt->stream_index])) >= 0)
+        ret = av_interleaved_write_frame(tee_slave->avf, pkt);
+    av_free_packet(pkt);
+    return ret;
+}
+
+#if HAVE_PTHREADS
+static void *slave_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    AVPacket pkt;
+    int ret;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    while (1) {
+        while (!av_fifo_size(tee_slave->queue) && !tee_slave->eof)
+            pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+        if (!av_fifo_size(tee_slave->queue))
+            break;
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        pthread_cond_signal(&tee_slave->cond);
+        pthread_mutex_unlock(&tee_slave->mutex);
+
+        ret = slave_write_packet(tee_slave, &pkt);
+
+        pthread_mutex_lock(&tee_slave->mutex);
+        if (ret < 0) {
+            tee_slave->error = ret;
+            /* nobody will consume the queued packets anymore */
+            while (av_fifo_size(tee_slave->queue)) {
+                av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+                av_free_packet(&pkt);
+            }
+            pthread_cond_signal(&tee_slave->cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&tee_slave->mutex);
+    return NULL;
+}
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave,
+                              int queue_size)
+{
+    int ret;
+
+    tee_slave->queue = av_fifo_alloc(queue_size * sizeof(AVPacket));
+    if (!tee_slave->queue)
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&tee_slave->mutex, NULL))) {
+        av_fifo_free(tee_slave->queue);
+        tee_slave->queue = NULL;
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&tee_slave->cond, NULL))) {
+        pthread_mutex_destroy(&tee_slave->mutex);
+        av_fifo_free(tee_slave->queue);
+        tee_slave->queue = NULL;
+        return AVERROR(ret);
+    }
+    ret = pthread_create(&tee_slave->thread, NULL, slave_thread, tee_slave);
+    tee_slave->thread_started = !ret;
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        pthread_cond_destroy(&tee_slave->cond);
+        pthread_mutex_destroy(&tee_slave->mutex);
+        av_fifo_free(tee_slave->queue);
+        tee_slave->queue = NULL;
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+static void stop_slave_thread(TeeSlave *tee_slave)
+{
+    AVPacket pkt;
+
+    if (!tee_slave->thread_started)
+        return;
+    pthread_mutex_lock(&tee_slave->mutex);
+    tee_slave->eof = 1;
+    pthread_cond_signal(&tee_slave->cond);
+    pthread_mutex_unlock(&tee_slave->mutex);
+    pthread_join(tee_slave->thread, NULL);
+    tee_slave->thread_started = 0;
+
+    while (av_fifo_size(tee_slave->queue)) {
+        av_fifo_generic_read(tee_slave->queue, &pkt, sizeof(pkt), NULL);
+        av_free_packet(&pkt);
+    }
+    av_fifo_free(tee_slave->queue);
+    tee_slave->queue = NULL;
+    pthread_cond_destroy(&tee_slave->cond);
+    pthread_mutex_destroy(&tee_slave->mutex);
+}
+
+/**
+ * Queue a packet owned by the caller; wait while the queue is full.
+ */
+static int slave_queue_packet(TeeSlave *tee_slave, AVPacket *pkt)
+{
+    int ret;
+
+    pthread_mutex_lock(&tee_slave->mutex);
+    while (!av_fifo_space(tee_slave->queue) && !tee_slave->error)
+        pthread_cond_wait(&tee_slave->cond, &tee_slave->mutex);
+    ret = tee_slave->error;
+    if (!ret) {
+        av_fifo_generic_write(tee_slave->queue, pkt, sizeof(*pkt), NULL);
+        pthread_cond_signal(&tee_slave->cond);
+    }
+    pthread_mutex_unlock(&tee_slave->mutex);
+    if (ret < 0)
+        av_free_packet(pkt);
+    return ret;
+}
+#endif
+
+/**
+ * Check whether a slave failed, and decide what to do about it.
+ * @return 0 if the muxing can go on, a negative error code otherwise
+ */
+static int check_slave_failure(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+    TeeContext *tee = avf->priv_data;
+    int ret = tee_slave->error;
+
+#if HAVE_PTHREADS
+    if (tee_slave->thread_started) {
+        pthread_mutex_lock(&tee_slave->mutex);
+        ret = tee_slave->error;
+        pthread_mutex_unlock(&tee_slave->mutex);
+    }
+#endif
+    if (ret >= 0 || !tee_slave->avf)
+        return 0;
+
+    if (tee_slave->on_fail == ON_SLAVE_FAILURE_ABORT)
+        return ret;
+
+    av_log(avf, AV_LOG_WARNING,
+           "Slave '%s' failed: %s, continuing with %u/%u slaves.\n",
+           tee_slave->avf->filename, av_err2str(ret),
+           tee->nb_alive - 1, tee->nb_slaves);
+#if HAVE_PTHREADS
+    stop_slave_thread(tee_slave);
+#endif
+    close_slave(tee_slave);
+    if (!--tee->nb_alive)
+        return ret;
+    return 0;
+}
+
+static void tee_free(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned i;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+#if HAVE_PTHREADS
+        stop_slave_thread(&tee->slaves[i]);
+#endif
+        close_slave(&tee->slaves[i]);
+    }
+}
+
+static int tee_write_header(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned nb_slaves = 0, i;
+    const char *filename = avf->filename;
+    char *slaves[MAX_SLAVES];
+    int ret;
+
+    while (*filename) {
+        if (nb_slaves == MAX_SLAVES) {
+            av_log(avf, AV_LOG_ERROR, "Maximum %d slave muxers reached.\n",
+                   MAX_SLAVES);
+            ret = AVERROR_PATCHWELCOME;
+            goto fail;
+        }
+        if (!(slaves[nb_slaves++] = av_get_token(&filename, slave_delim))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (strspn(filename, slave_delim))
+            filename++;
+    }
+
+    for (i = 0; i < nb_slaves; i++) {
+        tee->nb_slaves = i + 1;
+        if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0) {
+            if (tee->slaves[i].on_fail != ON_SLAVE_FAILURE_IGNORE)
+                goto fail;
+            av_log(avf, AV_LOG_WARNING, "Slave '%s' failed to open: %s, "
+                   "ignoring it.\n", slaves[i], av_err2str(ret));
+            close_slave(&tee->slaves[i]);
+            av_freep(&slaves[i]);
+            continue;
+        }
+        tee->nb_alive++;
+        log_slave(&tee->slaves[i], avf, AV_LOG_VERBOSE);
+        av_freep(&slaves[i]);
+    }
+
+    if (!tee->nb_alive) {
+        av_log(avf, AV_LOG_ERROR, "No slave could be opened.\n");
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+
+#if HAVE_PTHREADS
+    if (tee->queue_size > 0) {
+        for (i = 0; i < tee->nb_slaves; i++) {
+            if (!tee->slaves[i].avf)
+                continue;
+            if ((ret = start_slave_thread(avf, &tee->slaves[i],
+                                          tee->queue_size)) < 0)
+                goto fail;
+        }
+    }
+#endif
+
+    return 0;
+
+fail:
+    for (i = 0; i < nb_slaves; i++)
+        av_freep(&slaves[i]);
+    tee_free(avf);
+    return ret;
+}
+
+static int tee_write_trailer(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    AVFormatContext *avf2;
+    int ret_all = 0, ret;
+    unsigned i;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *tee_slave = &tee->slaves[i];
+        if (!(avf2 = tee_slave->avf))
+            continue;
+#if HAVE_PTHREADS
+        stop_slave_thread(tee_slave);
+#endif
+        if (tee_slave->error >= 0 && (ret = av_write_trailer(avf2)) < 0)
+            tee_slave->error = ret;
+        tee_slave->header_written = 0;
+        if (tee_slave->error < 0 && tee_slave->on_fail != ON_SLAVE_FAILURE_IGNORE &&
+            !ret_all)
+            ret_all = tee_slave->error;
+        close_slave(tee_slave);
+    }
+    return ret_all;
+}
+
+static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    AVFormatContext *avf2;
+    AVPacket pkt2;
+    int ret_all = 0, ret;
+    unsigned i, s;
+    AVRational tb, tb2;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        if ((ret = check_slave_failure(avf, tee_slave)) < 0) {
+            if (!ret_all)
+                ret_all = ret;
+            continue;
+        }
+        if (!(avf2 = tee_slave->avf))
+            continue;
+
+        /* each slave gets its own reference, since it may be queued */
+        s = pkt->stream_index;
+        if (s >= avf2->nb_streams) {
+            av_log(avf, AV_LOG_ERROR, "Invalid stream index %u\n", s);
+            return AVERROR(EINVAL);
+        }
+        pkt2 = *pkt;
+        pkt2.destruct = NULL;
+        if ((ret = av_dup_packet(&pkt2)) < 0) {
+            if (!ret_all)
+                ret_all = ret;
+            continue;
+        }
+        tb  = avf ->streams[s]->time_base;
+        tb2 = avf2->streams[s]->time_base;
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt2.pts      = av_rescale_q(pkt->pts,      tb, tb2);
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt2.dts      = av_rescale_q(pkt->dts,      tb, tb2);
+        if (pkt->duration > 0)
+            pkt2.duration = av_rescale_q(pkt->duration, tb, tb2);
+
+#if HAVE_PTHREADS
+        if (tee_slave->thread_started)
+            ret = slave_queue_packet(tee_slave, &pkt2);
+        else
+#endif
+        {
+            ret = slave_write_packet(tee_slave, &pkt2);
+            if (ret < 0)
+                tee_slave->error = ret;
+        }
+        if (ret < 0 && (ret = check_slave_failure(avf, tee_slave)) < 0 &&
+            !ret_all)
+            ret_all = ret;
+    }
+    return ret_all;
+}
+
+#define OFFSET(x) offsetof(TeeContext, x)
+#define E AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption options[] = {
+    { "tee_queue_size", "set the number of packets queued for each slave output, 0 to write synchronously",
+      OFFSET(queue_size), AV_OPT_TYPE_INT, {.dbl = 32}, 0, INT_MAX / sizeof(AVPacket), E },
+    { NULL },
+};
+
+static const AVClass tee_muxer_class = {
+    .class_name = "tee muxer",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+AVOutputFormat ff_tee_muxer = {
+    .name              = "tee",
+    .long_name         = NULL_IF_CONFIG_SMALL("Multiple muxer tee"),
+    .priv_data_size    = sizeof(TeeContext),
+    .write_header      = tee_write_header,
+    .write_trailer     = tee_write_trailer,
+    .write_packet      = tee_write_packet,
+    .priv_class        = &tee_muxer_class,
+    .flags             = AVFMT_NOFILE,
+};
@@ -21,6 +21,7 @@
 
 #include "libavutil/libm.h"
 #include "libavutil/log.h"
+#include "libavutil/refcache.h"
 #include "internal.h"
 #include "audio_data.h"
 
@@ -141,6 +142,44 @@ static int build_filter(ResampleContext *c)
     return 0;
 }
 
+/**
+ * Parameters identifying a filter bank in the process-wide cache.
+ */
+typedef struct FilterBankKey {
+    char id[4];                 ///< "avr", to not mix with other users of the cache
+    double factor;
+    int filter_length;
+    int phase_shift;
+    enum AVSampleFormat format;
+    enum AVResampleFilterType filter_type;
+    int kaiser_beta;
+} FilterBankKey;
+
+static int create_filter_bank(void **data, void *opaque)
+{
+    ResampleContext *c = opaque;
+    int phase_count    = 1 << c->phase_shift;
+    int felem_size     = av_get_bytes_per_sample(c->avr->internal_sample_fmt);
+    int ret;
+
+    c->filter_bank = av_mallocz(c->filter_length * (phase_count + 1) * felem_size);
+    if (!c->filter_bank)
+        return AVERROR(ENOMEM);
+
+    if ((ret = build_filter(c)) < 0) {
+        av_freep(&c->filter_bank);
+        return ret;
+    }
+
+    memcpy(&c->filter_bank[(c->filter_length * phase_count + 1) * felem_size],
+           c->filter_bank, (c->filter_length - 1) * felem_size);
+    memcpy(&c->filter_bank[c->filter_length * phase_count * felem_size],
+           &c->filter_bank[(c->filter_length - 1) * felem_size], felem_size);
+
+    *data = c->filter_bank;
+    return 0;
+}
+
 ResampleContext *ff_audio_resample_init(AVAudioResampleContext *avr)
 {
     ResampleContext *c;
@@ -148,7 +187,7 @@ ResampleContext *ff_audio_resample_init(AVAudioResampleContext *avr)
     int in_rate     = avr->in_sample_rate;
     double factor   = FFMIN(out_rate * avr->cutoff / in_rate, 1.0);
     int phase_count = 1 << avr->phase_shift;
-    int felem_size;
+    FilterBankKey key;
 
     if (avr->internal_sample_fmt != AV_SAMPLE_FMT_S16P &&
         avr->internal_sample_fmt != AV_SAMPLE_FMT_S32P &&
@@ -191,19 +230,20 @@ ResampleContext *ff_audio_resample_init(AVAudioResampleContext *avr)
         break;
     }
 
-    felem_size = av_get_bytes_per_sample(avr->internal_sample_fmt);
-    c->filter_bank = av_mallocz(c->filter_length * (phase_count + 1) * felem_size);
-    if (!c->filter_bank)
-        goto error;
-
-    if (build_filter(c) < 0)
+    /* the filter bank is read-only once built, share it between all the
+     * contexts using the same parameters */
+    memset(&key, 0, sizeof(key));
+    memcpy(key.id, "avr", 4);
+    key.factor        = c->factor;
+    key.filter_length = c->filter_length;
+    key.phase_shift   = c->phase_shift;
+    key.format        = avr->internal_sample_fmt;
+    key.filter_type   = c->filter_type;
+    key.kaiser_beta   = c->kaiser_beta;
+    if (avpriv_refcache_get(&key, sizeof(key), create_filter_bank, av_free, c,
+                            (void **)&c->filter_bank) < 0)
         goto error;
 
-    memcpy(&c->filter_bank[(c->filter_length * phase_count + 1) * felem_size],
-           c->filter_bank, (c->filter_length - 1) * felem_size);
-    memcpy(&c->filter_bank[c->filter_length * phase_count * felem_size],
-           &c->filter_bank[(c->filter_length - 1) * felem_size], felem_size);
-
     c->compensation_distance = 0;
     if (!av_reduce(&c->src_incr, &c->dst_incr, out_rate,
                    in_rate * (int64_t)phase_count, INT32_MAX / 2))
@@ -228,7 +268,7 @@ ResampleContext *ff_audio_resample_init(AVAudioResampleContext *avr)
 
 error:
     ff_audio_data_free(&c->buffer);
-    av_free(c->filter_bank);
+    avpriv_refcache_unref((void **)&c->filter_bank);
     av_free(c);
     return NULL;
 }
@@ -238,7 +278,7 @@ void ff_audio_resample_free(ResampleContext **c)
     if (!*c)
         return;
     ff_audio_data_free(&(*c)->buffer);
-    av_free((*c)->filter_bank);
+    avpriv_refcache_unref((void **)&(*c)->filter_bank);
     av_freep(c);
 }
 
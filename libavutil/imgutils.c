@@ -54,6 +54,12 @@ int image_get_linesize(int width, int plane,
 
     if (width < 0)
         return AVERROR(EINVAL);
+    if (desc == &av_pix_fmt_descriptors[PIX_FMT_V210]) {
+        /* 128 bytes for each 48 pixels */
+        if (width > INT_MAX / 3)
+            return AVERROR(EINVAL);
+        return plane ? 0 : (width + 47) / 48 * 128;
+    }
     s = (max_step_comp == 1 || max_step_comp == 2) ? desc->log2_chroma_w : 0;
     shifted_w = ((width + (1 << s) - 1)) >> s;
     if (shifted_w && max_step > INT_MAX / shifted_w)
@@ -0,0 +1,196 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "jobpool.h"
+#include "log.h"
+#include "mem.h"
+
+struct AVJobPool {
+#if HAVE_PTHREADS
+    pthread_t *threads;
+    int nb_started;             ///< number of worker threads running
+    int next_index;             ///< index given to the next worker started
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   ///< signaled when jobs are started
+    pthread_cond_t done_cond;   ///< signaled when all the jobs are done
+    int stop;
+#endif
+    AVJobFunc func;
+    void *opaque;
+    int next_job;               ///< index of the next job to run
+    int nb_jobs;                ///< number of jobs of the current call
+    int nb_done;                ///< number of jobs done for the current call
+    int ret;                    ///< sum of the values returned by the jobs
+};
+
+#if HAVE_PTHREADS
+static void *worker(void *arg)
+{
+    AVJobPool *pool = arg;
+    int job, ret, thread;
+
+    pthread_mutex_lock(&pool->lock);
+    thread = ++pool->next_index;
+    for (;;) {
+        while (!pool->stop && pool->next_job >= pool->nb_jobs)
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        if (pool->stop)
+            break;
+        job = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+
+        ret = pool->func(pool->opaque, job, thread);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->ret += ret;
+        if (++pool->nb_done == pool->nb_jobs)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+#endif
+
+AVJobPool *avpriv_jobpool_alloc(int nb_threads, void *log_ctx)
+{
+    AVJobPool *pool = av_mallocz(sizeof(*pool));
+
+    if (!pool)
+        return NULL;
+#if HAVE_PTHREADS
+    if (nb_threads > 1) {
+        int i;
+
+        if (!(pool->threads = av_malloc((nb_threads - 1) * sizeof(*pool->threads)))) {
+            av_free(pool);
+            return NULL;
+        }
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->work_cond, NULL);
+        pthread_cond_init(&pool->done_cond, NULL);
+        for (i = 0; i < nb_threads - 1; i++) {
+            if (pthread_create(&pool->threads[i], NULL, worker, pool)) {
+                av_log(log_ctx, AV_LOG_WARNING, "Could only start %d threads.\n", i + 1);
+                break;
+            }
+            pool->nb_started++;
+        }
+    }
+#else
+    if (nb_threads > 1)
+        av_log(log_ctx, AV_LOG_WARNING, "Threads are not supported, "
+               "running in a single thread.\n");
+#endif
+    return pool;
+}
+
+void avpriv_jobpool_free(AVJobPool **ppool)
+{
+    AVJobPool *pool = *ppool;
+
+    if (!pool)
+        return;
+#if HAVE_PTHREADS
+    if (pool->threads) {
+        int i;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->work_cond);
+        pthread_mutex_unlock(&pool->lock);
+        for (i = 0; i < pool->nb_started; i++)
+            pthread_join(pool->threads[i], NULL);
+        pthread_cond_destroy(&pool->done_cond);
+        pthread_cond_destroy(&pool->work_cond);
+        pthread_mutex_destroy(&pool->lock);
+        av_freep(&pool->threads);
+    }
+#endif
+    av_freep(ppool);
+}
+
+int avpriv_jobpool_nb_threads(const AVJobPool *pool)
+{
+#if HAVE_PTHREADS
+    return pool->nb_started + 1;
+#else
+    return 1;
+#endif
+}
+
+void avpriv_jobpool_start(AVJobPool *pool, AVJobFunc func, void *opaque,
+                          int nb_jobs)
+{
+#if HAVE_PTHREADS
+    if (pool->nb_started)
+        pthread_mutex_lock(&pool->lock);
+#endif
+    pool->func     = func;
+    pool->opaque   = opaque;
+    pool->ret      = 0;
+    pool->nb_jobs  = nb_jobs;
+    pool->next_job = 0;
+    pool->nb_done  = 0;
+#if HAVE_PTHREADS
+    if (pool->nb_started) {
+        pthread_cond_broadcast(&pool->work_cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+#endif
+}
+
+int avpriv_jobpool_wait(AVJobPool *pool)
+{
+    int job, ret;
+
+#if HAVE_PTHREADS
+    if (pool->nb_started) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next_job < pool->nb_jobs) {
+            job = pool->next_job++;
+            pthread_mutex_unlock(&pool->lock);
+            ret = pool->func(pool->opaque, job, 0);
+            pthread_mutex_lock(&pool->lock);
+            pool->ret += ret;
+            pool->nb_done++;
+        }
+        while (pool->nb_done < pool->nb_jobs)
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        pool->nb_jobs = 0;
+        ret = pool->ret;
+        pthread_mutex_unlock(&pool->lock);
+        return ret;
+    }
+#endif
+    for (ret = 0, job = 0; job < pool->nb_jobs; job++)
+        ret += pool->func(pool->opaque, job, 0);
+    pool->nb_jobs = 0;
+    return ret;
+}
+
+int avpriv_jobpool_execute(AVJobPool *pool, AVJobFunc func, void *opaque,
+                           int nb_jobs)
+{
+    avpriv_jobpool_start(pool, func, opaque, nb_jobs);
+    return avpriv_jobpool_wait(pool);
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_JOBPOOL_H
+#define AVUTIL_JOBPOOL_H
+
+/**
+ * @file
+ * Pool of worker threads running the numbered jobs of one call at a time,
+ * e.g. the slices of a picture. The calling thread takes jobs too, so a
+ * pool for n threads starts n - 1 workers.
+ *
+ * Without pthreads no worker is started and the calling thread runs all
+ * the jobs.
+ */
+
+typedef struct AVJobPool AVJobPool;
+
+/**
+ * Function running one job.
+ *
+ * @param opaque opaque pointer given to avpriv_jobpool_start()
+ * @param job    index of the job, in [0, nb_jobs)
+ * @param thread index of the thread running the job, 0 for the calling
+ *               thread and 1 to avpriv_jobpool_nb_threads() - 1 for the
+ *               workers, so it can select per thread state
+ * @return a value added to the ones of the other jobs of the call
+ */
+typedef int (*AVJobFunc)(void *opaque, int job, int thread);
+
+/**
+ * Allocate a pool and start nb_threads - 1 worker threads. A warning is
+ * logged to log_ctx if fewer can be started.
+ *
+ * @return the pool, or NULL if it cannot be allocated
+ */
+AVJobPool *avpriv_jobpool_alloc(int nb_threads, void *log_ctx);
+
+/**
+ * Stop the worker threads, free the pool and set *pool to NULL.
+ * Does nothing if *pool is NULL.
+ */
+void avpriv_jobpool_free(AVJobPool **pool);
+
+/**
+ * @return the number of threads running the jobs, the calling thread
+ *         included
+ */
+int avpriv_jobpool_nb_threads(const AVJobPool *pool);
+
+/**
+ * Let the worker threads start running jobs 0 to nb_jobs - 1 of a call.
+ * The calling thread may do other work before avpriv_jobpool_wait().
+ */
+void avpriv_jobpool_start(AVJobPool *pool, AVJobFunc func, void *opaque,
+                          int nb_jobs);
+
+/**
+ * Run the jobs left in the calling thread and wait for the ones run by
+ * the workers.
+ *
+ * @return the sum of the values returned by the jobs
+ */
+int avpriv_jobpool_wait(AVJobPool *pool);
+
+/**
+ * Run nb_jobs jobs, like avpriv_jobpool_start() and avpriv_jobpool_wait().
+ */
+int avpriv_jobpool_execute(AVJobPool *pool, AVJobFunc func, void *opaque,
+                           int nb_jobs);
+
+#endif /* AVUTIL_JOBPOOL_H */
@@ -26,6 +26,21 @@
 
 #include "intreadwrite.h"
 
+/**
+ * Position of the samples of each component in a v210 group of 6 pixels,
+ * as 32-bit word index * 32 + bit shift. v210 can not be described by
+ * the component descriptors, it is special-cased using this table.
+ */
+static const uint8_t v210_pos[3][6] = {
+    { 10, 32, 52, 74, 96, 116 },   /* Y */
+    {  0, 42, 84 },                /* U */
+    { 20, 64, 106 },               /* V */
+};
+
+#define V210_SAMPLE(line, c, k)                                               \
+    ((line) + ((k) / (c ? 3 : 6)) * 16 + (v210_pos[c][(k) % (c ? 3 : 6)] >> 5) * 4)
+#define V210_SHIFT(c, k) (v210_pos[c][(k) % (c ? 3 : 6)] & 31)
+
 void av_read_image_line(uint16_t *dst, const uint8_t *data[4], const int linesize[4],
                         const AVPixFmtDescriptor *desc, int x, int y, int c, int w,
                         int read_pal_component)
@@ -38,7 +53,12 @@ void av_read_image_line(uint16_t *dst, const uint8_t *data[4], const int linesiz
     int step  = comp.step_minus1 + 1;
     int flags = desc->flags;
 
-    if (flags & PIX_FMT_BITSTREAM) {
+    if (desc == &av_pix_fmt_descriptors[PIX_FMT_V210]) {
+        const uint8_t *line = data[0] + y * linesize[0];
+
+        for (; w--; x++)
+            *dst++ = AV_RL32(V210_SAMPLE(line, c, x)) >> V210_SHIFT(c, x) & 0x3FF;
+    } else if (flags & PIX_FMT_BITSTREAM) {
         int skip = x * step + comp.offset_plus1 - 1;
         const uint8_t *p = data[plane] + y * linesize[plane] + (skip >> 3);
         int shift = 8 - depth - (skip & 7);
@@ -80,7 +100,14 @@ void av_write_image_line(const uint16_t *src, uint8_t *data[4], const int linesi
     int step  = comp.step_minus1 + 1;
     int flags = desc->flags;
 
-    if (flags & PIX_FMT_BITSTREAM) {
+    if (desc == &av_pix_fmt_descriptors[PIX_FMT_V210]) {
+        uint8_t *line = data[0] + y * linesize[0];
+
+        for (; w--; x++) {
+            uint8_t *p = V210_SAMPLE(line, c, x);
+            AV_WL32(p, AV_RL32(p) | *src++ << V210_SHIFT(c, x));
+        }
+    } else if (flags & PIX_FMT_BITSTREAM) {
         int skip = x * step + comp.offset_plus1 - 1;
         uint8_t *p = data[plane] + y * linesize[plane] + (skip >> 3);
         int shift = 8 - depth - (skip & 7);
@@ -1408,6 +1435,42 @@ const AVPixFmtDescriptor av_pix_fmt_descriptors[PIX_FMT_NB] = {
         },
         .flags = PIX_FMT_BE | PIX_FMT_PLANAR | PIX_FMT_RGB,
     },
+    [PIX_FMT_V210] = {
+        .name = "v210",
+        .nb_components = 3,
+        .log2_chroma_w = 1,
+        .log2_chroma_h = 0,
+        /* only the depth is meaningful, the samples are packed 3 per
+         * 32-bit word and handled separately by av_read_image_line(),
+         * av_write_image_line() and av_image_fill_linesizes() */
+        .comp = {
+            { 0, 1, 1, 0, 9 },        /* Y */
+            { 0, 3, 1, 0, 9 },        /* U */
+            { 0, 3, 3, 0, 9 },        /* V */
+        },
+    },
+    [PIX_FMT_V410] = {
+        .name = "v410",
+        .nb_components = 3,
+        .log2_chroma_w = 0,
+        .log2_chroma_h = 0,
+        .comp = {
+            { 0, 3, 2, 4, 9 },        /* Y */
+            { 0, 3, 1, 2, 9 },        /* U */
+            { 0, 3, 3, 6, 9 },        /* V */
+        },
+    },
+    [PIX_FMT_Y216] = {
+        .name = "y216",
+        .nb_components = 3,
+        .log2_chroma_w = 1,
+        .log2_chroma_h = 0,
+        .comp = {
+            { 0, 3, 1, 0, 15 },       /* Y */
+            { 0, 7, 3, 0, 15 },       /* U */
+            { 0, 7, 7, 0, 15 },       /* V */
+        },
+    },
 };
 
 static enum PixelFormat get_pix_fmt_internal(const char *name)
@@ -201,6 +201,9 @@ enum PixelFormat {
     PIX_FMT_GBRP12LE,    ///< planar GBR 4:4:4 36bpp, little endian
     PIX_FMT_GBRP14BE,    ///< planar GBR 4:4:4 42bpp, big endian
     PIX_FMT_GBRP14LE,    ///< planar GBR 4:4:4 42bpp, little endian
+    PIX_FMT_V210,        ///< packed YUV 4:2:2, 10bpp per sample, 6 pixels in 4 little-endian 32-bit words (Cb Y Cr, Y Cb Y, Cr Y Cb, Y Cr Y), lines padded to 48 pixels
+    PIX_FMT_V410,        ///< packed YUV 4:4:4, 32bpp, one little-endian 32-bit word per pixel, Cb Y Cr in bits 2-11, 12-21 and 22-31
+    PIX_FMT_Y216,        ///< packed YUV 4:2:2, 32bpp, Y0 Cb Y1 Cr, 16 bits per sample, little-endian
 
     PIX_FMT_NB,        ///< number of pixel formats, DO NOT USE THIS if you want to link with shared libav* because the number of formats might differ between versions
 };
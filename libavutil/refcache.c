@@ -0,0 +1,153 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "avassert.h"
+#include "error.h"
+#include "mem.h"
+#include "refcache.h"
+
+typedef struct RefCacheEntry {
+    struct RefCacheEntry *next;
+    void *data;
+    void (*free_data)(void *data);
+    int refcount;
+    unsigned last_release;      ///< release counter value when unreferenced
+    int key_size;
+    uint8_t *key;
+} RefCacheEntry;
+
+#if HAVE_PTHREADS
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()   pthread_mutex_lock(&cache_lock)
+#define UNLOCK() pthread_mutex_unlock(&cache_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+static RefCacheEntry *cache;
+static unsigned release_count;
+
+static void free_entry(RefCacheEntry *e)
+{
+    e->free_data(e->data);
+    av_free(e->key);
+    av_free(e);
+}
+
+/**
+ * Free the least recently released entries above the unused limit.
+ */
+static void trim_cache(void)
+{
+    for (;;) {
+        RefCacheEntry **e, **oldest = NULL;
+        int unused = 0;
+
+        for (e = &cache; *e; e = &(*e)->next) {
+            if ((*e)->refcount)
+                continue;
+            unused++;
+            if (!oldest || (*e)->last_release - (*oldest)->last_release > UINT_MAX / 2)
+                oldest = e;
+        }
+        if (unused <= AVPRIV_REFCACHE_MAX_UNUSED)
+            break;
+        {
+            RefCacheEntry *victim = *oldest;
+            *oldest = victim->next;
+            free_entry(victim);
+        }
+    }
+}
+
+int avpriv_refcache_get(const void *key, int key_size,
+                        int (*create)(void **data, void *opaque),
+                        void (*free_data)(void *data), void *opaque, void **data)
+{
+    RefCacheEntry *e;
+    int ret;
+
+    LOCK();
+    if (HAVE_PTHREADS) {
+        for (e = cache; e; e = e->next) {
+            if (e->key_size == key_size && !memcmp(e->key, key, key_size)) {
+                e->refcount++;
+                *data = e->data;
+                UNLOCK();
+                return 0;
+            }
+        }
+    }
+
+    ret = AVERROR(ENOMEM);
+    if (!(e = av_mallocz(sizeof(*e))) || !(e->key = av_malloc(key_size)))
+        goto fail;
+    if ((ret = create(&e->data, opaque)) < 0)
+        goto fail;
+    memcpy(e->key, key, key_size);
+    e->key_size  = key_size;
+    e->free_data = free_data;
+    e->refcount  = 1;
+    e->next      = cache;
+    cache        = e;
+    *data        = e->data;
+    UNLOCK();
+    return 0;
+
+fail:
+    if (e)
+        av_free(e->key);
+    av_free(e);
+    UNLOCK();
+    return ret;
+}
+
+void avpriv_refcache_unref(void **data)
+{
+    RefCacheEntry **e;
+
+    if (!*data)
+        return;
+
+    LOCK();
+    for (e = &cache; *e && (*e)->data != *data; e = &(*e)->next)
+        ;
+    av_assert0(*e && (*e)->refcount > 0);
+    if (!--(*e)->refcount) {
+        if (HAVE_PTHREADS) {
+            (*e)->last_release = release_count++;
+            trim_cache();
+        } else {
+            RefCacheEntry *victim = *e;
+            *e = victim->next;
+            free_entry(victim);
+        }
+    }
+    UNLOCK();
+    *data = NULL;
+}
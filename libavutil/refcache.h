@@ -0,0 +1,59 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_REFCACHE_H
+#define AVUTIL_REFCACHE_H
+
+/**
+ * @file
+ * Process-wide cache of immutable, reference counted data identified by
+ * a binary key, e.g. resampling filter banks shared by all the contexts
+ * using the same parameters.
+ *
+ * Unreferenced data is kept for reuse until AVPRIV_REFCACHE_MAX_UNUSED
+ * other unreferenced entries are more recent. The cache is thread-safe
+ * if pthreads are available; otherwise nothing is shared and every call
+ * creates new data.
+ */
+
+#define AVPRIV_REFCACHE_MAX_UNUSED 16
+
+/**
+ * Get a reference to the data identified by key, creating it if needed.
+ *
+ * @param key       key bytes, compared with memcmp(), so any padding in
+ *                  a key structure must be zeroed
+ * @param create    called to create the data if it is not in the cache,
+ *                  with the cache lock held; must set *data and return 0,
+ *                  or return a negative AVERROR code
+ * @param free_data called to free the data when it leaves the cache
+ * @param opaque    passed to create
+ * @param data      set to the data on success
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int avpriv_refcache_get(const void *key, int key_size,
+                        int (*create)(void **data, void *opaque),
+                        void (*free_data)(void *data), void *opaque, void **data);
+
+/**
+ * Release a reference returned by avpriv_refcache_get() and set *data
+ * to NULL. Does nothing if *data is NULL.
+ */
+void avpriv_refcache_unref(void **data);
+
+#endif /* AVUTIL_REFCACHE_H */
@@ -21,15 +21,61 @@
 #include "libavutil/avassert.h"
 #include "swresample_internal.h"
 
-void swri_get_dither(SwrContext *s, void *dst, int len, unsigned seed, enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt) {
+/* Lipshitz, "Minimally Audible Noise Shaping", JAES 39(11), 1991 */
+static const double ns_lipshitz[NS_TAPS] = { 2.033, -2.165, 1.959, -1.590, 0.6149 };
+
+/**
+ * Next value of the random generator, uniform in [-0.5, 0.5).
+ * The optimized code computes exactly the same values.
+ */
+static inline float lcg_rand(unsigned *seed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return (int32_t)(*seed ^ 0x80000000) * (1.0f / 4294967296.0f);
+}
+
+static inline float noise(DitherContext *c, int ch)
+{
+    float r = lcg_rand(&c->seed[ch]), t, v;
+
+    switch (c->method) {
+    case SWR_DITHER_RECTANGULAR:
+        return r * c->scale;
+    case SWR_DITHER_TRIANGULAR:
+        return (r - lcg_rand(&c->seed[ch])) * c->scale;
+    case SWR_DITHER_TRIANGULAR_HIGHPASS:
+        t = r - lcg_rand(&c->seed[ch]);
+        v = (c->hist[ch][1] + c->hist[ch][1] - c->hist[ch][0]) - t;
+        c->hist[ch][0] = c->hist[ch][1];
+        c->hist[ch][1] = t;
+        return v * c->scale;
+    default:
+        av_assert0(0);
+    }
+    return 0;
+}
+
+void swri_dither_init(SwrContext *s, enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt)
+{
+    DitherContext *c = &s->dither;
     double scale = 0;
-#define TMP_EXTRA 2
-    double *tmp = av_malloc((len + TMP_EXTRA) * sizeof(double));
-    int i;
+    int ch;
 
     out_fmt = av_get_packed_sample_fmt(out_fmt);
     in_fmt  = av_get_packed_sample_fmt( in_fmt);
 
+    memset(c, 0, sizeof(*c));
+    c->method = s->dither_method;
+
+    if (c->method == SWR_DITHER_NS_LIPSHITZ &&
+        (   (in_fmt != AV_SAMPLE_FMT_FLT && in_fmt != AV_SAMPLE_FMT_DBL)
+         || (out_fmt != AV_SAMPLE_FMT_S16 && out_fmt != AV_SAMPLE_FMT_U8)
+         || (s->out_sample_rate != 44100 && s->out_sample_rate != 48000))) {
+        av_log(s, AV_LOG_WARNING, "Noise shaping is only supported from float to "
+               "16 or 8 bit samples at 44.1 or 48 kHz, using triangular_hp dither\n");
+        c->method = SWR_DITHER_TRIANGULAR_HIGHPASS;
+    }
+
     if(in_fmt == AV_SAMPLE_FMT_FLT || in_fmt == AV_SAMPLE_FMT_DBL){
         if(out_fmt == AV_SAMPLE_FMT_S32) scale = 1.0/(1L<<31);
         if(out_fmt == AV_SAMPLE_FMT_S16) scale = 1.0/(1L<<15);
@@ -39,49 +85,100 @@ void swri_get_dither(SwrContext *s, void *dst, int len, unsigned seed, enum AVSa
     if(in_fmt == AV_SAMPLE_FMT_S32 && out_fmt == AV_SAMPLE_FMT_U8 ) scale = 1L<<24;
     if(in_fmt == AV_SAMPLE_FMT_S16 && out_fmt == AV_SAMPLE_FMT_U8 ) scale = 1L<<8;
 
-    scale *= s->dither_scale;
-
-    for(i=0; i<len + TMP_EXTRA; i++){
-        double v;
-        seed = seed* 1664525 + 1013904223;
+    if (c->method == SWR_DITHER_NS_LIPSHITZ) {
+        /* the noise is added in units of output LSBs */
+        c->ns_scale = 1 / scale;
+        scale = 1;
+    } else if (c->method == SWR_DITHER_TRIANGULAR_HIGHPASS) {
+        scale /= sqrt(6);
+    }
+    c->scale = scale * s->dither_scale;
 
-        switch(s->dither_method){
-            case SWR_DITHER_RECTANGULAR: v= ((double)seed) / UINT_MAX - 0.5; break;
-            case SWR_DITHER_TRIANGULAR :
-            case SWR_DITHER_TRIANGULAR_HIGHPASS :
-                v = ((double)seed) / UINT_MAX;
-                seed = seed*1664525 + 1013904223;
-                v-= ((double)seed) / UINT_MAX;
-                break;
-            default: av_assert0(0);
+    for (ch = 0; ch < SWR_CH_MAX; ch++) {
+        c->seed[ch] = 12345678913579ULL << ch;
+        /* prime the high pass filter lookahead */
+        if (c->method == SWR_DITHER_TRIANGULAR_HIGHPASS) {
+            int i;
+            for (i = 0; i < 2; i++) {
+                float r = lcg_rand(&c->seed[ch]);
+                c->hist[ch][i] = r - lcg_rand(&c->seed[ch]);
+            }
         }
-        tmp[i] = v;
     }
 
-    for(i=0; i<len; i++){
-        double v;
+    if (HAVE_MMX)
+        swri_dither_init_mmx(s);
+}
+
+/**
+ * Quantize to the output precision with error feedback, so that the
+ * quantization noise is moved to where the ear is the least sensitive.
+ * The result is exactly representable in the output format.
+ */
+#define NOISE_SHAPING(type)                                                   \
+static void noise_shaping_ ## type(DitherContext *c, int ch, type *dst, int len) \
+{                                                                             \
+    double *err = c->ns_errors[ch];                                           \
+    double scale_1 = 1 / c->ns_scale;                                         \
+    int pos = c->ns_pos[ch], i, j;                                            \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        double v = dst[i] * c->ns_scale, q;                                   \
+        float r  = lcg_rand(&c->seed[ch]);                                    \
+                                                                              \
+        for (j = 0; j < NS_TAPS; j++)                                         \
+            v -= ns_lipshitz[j] * err[pos + j];                               \
+        q = rint(v + (r - lcg_rand(&c->seed[ch])) * c->scale);                \
+        pos = pos ? pos - 1 : NS_TAPS - 1;                                    \
+        err[pos] = err[pos + NS_TAPS] = q - v;                                \
+        dst[i] = q * scale_1;                                                 \
+    }                                                                         \
+    c->ns_pos[ch] = pos;                                                      \
+}
+
+NOISE_SHAPING(float)
+NOISE_SHAPING(double)
 
-        switch(s->dither_method){
-            case SWR_DITHER_RECTANGULAR:
-            case SWR_DITHER_TRIANGULAR :
-                v = tmp[i];
+void swri_dither(SwrContext *s, AudioData *a, int len)
+{
+    DitherContext *c = &s->dither;
+    int ch, i;
+
+    for (ch = 0; ch < a->ch_count; ch++) {
+        switch (a->fmt) {
+        case AV_SAMPLE_FMT_FLTP: {
+            float *dst = (float *)a->ch[ch];
+            i = 0;
+            if (c->method == SWR_DITHER_NS_LIPSHITZ) {
+                noise_shaping_float(c, ch, dst, len);
                 break;
-            case SWR_DITHER_TRIANGULAR_HIGHPASS :
-                v = (- tmp[i] + 2*tmp[i+1] - tmp[i+2]) / sqrt(6);
+            }
+            if (c->noise_flt && len >= 4) {
+                i = len & ~3;
+                c->noise_flt(c, ch, dst, i);
+            }
+            for (; i < len; i++)
+                dst[i] += noise(c, ch);
+            break;
+        }
+        case AV_SAMPLE_FMT_DBLP: {
+            double *dst = (double *)a->ch[ch];
+            if (c->method == SWR_DITHER_NS_LIPSHITZ) {
+                noise_shaping_double(c, ch, dst, len);
                 break;
-            default: av_assert0(0);
+            }
+            for (i = 0; i < len; i++)
+                dst[i] += noise(c, ch);
+            break;
         }
-
-        v*= scale;
-
-        switch(in_fmt){
-            case AV_SAMPLE_FMT_S16: ((int16_t*)dst)[i] = v; break;
-            case AV_SAMPLE_FMT_S32: ((int32_t*)dst)[i] = v; break;
-            case AV_SAMPLE_FMT_FLT: ((float  *)dst)[i] = v; break;
-            case AV_SAMPLE_FMT_DBL: ((double *)dst)[i] = v; break;
-            default: av_assert0(0);
+        case AV_SAMPLE_FMT_S16P: {
+            int16_t *dst = (int16_t *)a->ch[ch];
+            for (i = 0; i < len; i++)
+                dst[i] = av_clip_int16(dst[i] + (int)noise(c, ch));
+            break;
+        }
+        default:
+            av_assert0(0);
         }
     }
-
-    av_free(tmp);
 }
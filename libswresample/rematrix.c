@@ -294,13 +294,26 @@ int swri_rematrix_init(SwrContext *s){
     int nb_in  = av_get_channel_layout_nb_channels(s->in_ch_layout);
     int nb_out = av_get_channel_layout_nb_channels(s->out_ch_layout);
 
-    s->mix_any_f = NULL;
+    s->mix_any_f    = NULL;
+    s->mix_any_simd = NULL;
+    s->mix_n_1_simd = NULL;
 
     if (!s->rematrix_custom) {
         int r = auto_matrix(s);
         if (r)
             return r;
     }
+    //FIXME quantize for integeres
+    for (i = 0; i < SWR_CH_MAX; i++) {
+        int ch_in=0;
+        for (j = 0; j < SWR_CH_MAX; j++) {
+            s->matrix32[i][j]= lrintf(s->matrix[i][j] * 32768);
+            if(s->matrix[i][j])
+                s->matrix_ch[i][++ch_in]= j;
+        }
+        s->matrix_ch[i][0]= ch_in;
+    }
+
     if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P){
         s->native_matrix = av_mallocz(nb_in * nb_out * sizeof(int));
         s->native_one    = av_mallocz(sizeof(int));
@@ -333,18 +346,9 @@ int swri_rematrix_init(SwrContext *s){
         s->mix_any_f = (mix_any_func_type*)get_mix_any_func_double(s);
     }else
         av_assert0(0);
-    //FIXME quantize for integeres
-    for (i = 0; i < SWR_CH_MAX; i++) {
-        int ch_in=0;
-        for (j = 0; j < SWR_CH_MAX; j++) {
-            s->matrix32[i][j]= lrintf(s->matrix[i][j] * 32768);
-            if(s->matrix[i][j])
-                s->matrix_ch[i][++ch_in]= j;
-        }
-        s->matrix_ch[i][0]= ch_in;
-    }
 
     if(HAVE_YASM && HAVE_MMX) swri_rematrix_init_x86(s);
+    if(HAVE_MMX) swri_rematrix_init_mmx(s);
 
     return 0;
 }
@@ -361,19 +365,37 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
     int off = 0;
 
     if(s->mix_any_f) {
-        s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
+        if(s->mix_any_simd)
+            len1= len&~7;
+        if(len1)
+            s->mix_any_simd(out->ch, (const uint8_t **)in->ch, s->native_matrix, len1);
+        if(len != len1){
+            uint8_t *outp[SWR_CH_MAX];
+            const uint8_t *inp[SWR_CH_MAX];
+            for(i=0; i<out->ch_count; i++)
+                outp[i]= out->ch[i] + len1*out->bps;
+            for(i=0; i<in->ch_count; i++)
+                inp[i]= in->ch[i] + len1*in->bps;
+            s->mix_any_f(outp, inp, s->native_matrix, len-len1);
+        }
         return 0;
     }
 
     if(s->mix_2_1_simd || s->mix_1_1_simd){
         len1= len&~15;
         off = len1 * out->bps;
+    }else if(s->mix_n_1_simd){
+        len1= len&~7;
+        off = len1 * out->bps;
     }
 
     av_assert0(out->ch_count == av_get_channel_layout_nb_channels(s->out_ch_layout));
     av_assert0(in ->ch_count == av_get_channel_layout_nb_channels(s-> in_ch_layout));
 
     for(out_i=0; out_i<out->ch_count; out_i++){
+        const void *row = s->int_sample_fmt == AV_SAMPLE_FMT_S16P ? (void*)s->matrix32[out_i] : (void*)s->matrix[out_i];
+        int start = 0;
+
         switch(s->matrix_ch[out_i][0]){
         case 0:
             if(mustcopy)
@@ -384,6 +406,8 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
             if(s->matrix[out_i][in_i]!=1.0){
                 if(s->mix_1_1_simd && len1)
                     s->mix_1_1_simd(out->ch[out_i]    , in->ch[in_i]    , s->native_simd_matrix, in->ch_count*out_i + in_i, len1);
+                else if(s->mix_n_1_simd && len1)
+                    s->mix_n_1_simd(out->ch[out_i], in->ch, row, s->matrix_ch[out_i], len1);
                 if(len != len1)
                     s->mix_1_1_f   (out->ch[out_i]+off, in->ch[in_i]+off, s->native_matrix, in->ch_count*out_i + in_i, len-len1);
             }else if(mustcopy){
@@ -397,14 +421,20 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
             int in_i2 = s->matrix_ch[out_i][2];
             if(s->mix_2_1_simd && len1)
                 s->mix_2_1_simd(out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_simd_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
+            else if(s->mix_n_1_simd && len1)
+                s->mix_n_1_simd(out->ch[out_i], in->ch, row, s->matrix_ch[out_i], len1);
             else
                 s->mix_2_1_f   (out->ch[out_i]    , in->ch[in_i1]    , in->ch[in_i2]    , s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len1);
             if(len != len1)
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
         default:
+            if(s->mix_n_1_simd && len1){
+                s->mix_n_1_simd(out->ch[out_i], in->ch, row, s->matrix_ch[out_i], len1);
+                start = len1;
+            }
             if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
+                for(i=start; i<len; i++){
                     float v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
@@ -413,7 +443,7 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                     ((float*)out->ch[out_i])[i]= v;
                 }
             }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
+                for(i=start; i<len; i++){
                     double v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
@@ -422,7 +452,7 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                     ((double*)out->ch[out_i])[i]= v;
                 }
             }else{
-                for(i=0; i<len; i++){
+                for(i=start; i<len; i++){
                     int v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
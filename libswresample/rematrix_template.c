@@ -56,6 +56,26 @@ static void RENAME(mix8to2)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, int
     }
 }
 
+static void RENAME(mix8to6)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, int len){
+    int i;
+
+    for(i=0; i<len; i++) {
+        out[0][i] = R(in[0][i]*coeffp[0*8+0]);
+        out[1][i] = R(in[1][i]*coeffp[1*8+1]);
+        out[2][i] = R(in[2][i]*coeffp[2*8+2]);
+        out[3][i] = R(in[3][i]*coeffp[3*8+3]);
+        out[4][i] = R(in[4][i]*coeffp[4*8+4] + in[6][i]*coeffp[4*8+6]);
+        out[5][i] = R(in[5][i]*coeffp[5*8+5] + in[7][i]*coeffp[5*8+7]);
+    }
+}
+
+static void RENAME(mix2to1)(SAMPLE **out, const SAMPLE **in, COEFF *coeffp, int len){
+    int i;
+
+    for(i=0; i<len; i++)
+        out[0][i] = R(in[0][i]*coeffp[0] + in[1][i]*coeffp[1]);
+}
+
 static RENAME(mix_any_func_type) *RENAME(get_mix_any_func)(SwrContext *s){
     if(   s->out_ch_layout == AV_CH_LAYOUT_STEREO && (s->in_ch_layout == AV_CH_LAYOUT_5POINT1 || s->in_ch_layout == AV_CH_LAYOUT_5POINT1_BACK)
        && s->matrix[0][2] == s->matrix[1][2] && s->matrix[0][3] == s->matrix[1][3]
@@ -70,5 +90,21 @@ static RENAME(mix_any_func_type) *RENAME(get_mix_any_func)(SwrContext *s){
     )
         return RENAME(mix8to2);
 
+    /* when the front channels are passed through unchanged, the per channel
+     * code is faster as it can skip them */
+    if(   s->out_ch_layout == AV_CH_LAYOUT_5POINT1 && s->in_ch_layout == AV_CH_LAYOUT_7POINT1
+       && (s->matrix[0][0] != 1.0 || s->matrix[1][1] != 1.0 || s->matrix[2][2] != 1.0 || s->matrix[3][3] != 1.0)
+       && s->matrix_ch[0][0] == 1 && s->matrix_ch[0][1] == 0
+       && s->matrix_ch[1][0] == 1 && s->matrix_ch[1][1] == 1
+       && s->matrix_ch[2][0] == 1 && s->matrix_ch[2][1] == 2
+       && s->matrix_ch[3][0] == 1 && s->matrix_ch[3][1] == 3
+       && s->matrix_ch[4][0] == 2 && s->matrix_ch[4][1] == 4 && s->matrix_ch[4][2] == 6
+       && s->matrix_ch[5][0] == 2 && s->matrix_ch[5][1] == 5 && s->matrix_ch[5][2] == 7
+    )
+        return RENAME(mix8to6);
+
+    if(s->out_ch_layout == AV_CH_LAYOUT_MONO && s->in_ch_layout == AV_CH_LAYOUT_STEREO)
+        return RENAME(mix2to1);
+
     return NULL;
 }
@@ -25,10 +25,29 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include "config.h"
 #include "libavutil/log.h"
 #include "libavutil/avassert.h"
+#include "libavutil/jobpool.h"
+#include "libavutil/refcache.h"
 #include "swresample_internal.h"
 
+/**
+ * Worker threads resampling the channels of one swri_multiple_resample()
+ * call concurrently, one channel per job.
+ */
+typedef struct ResampleThreads {
+    AVJobPool *pool;
+    int nb_threads;
+
+    /* arguments of the current call */
+    struct ResampleContext *c;
+    struct ResampleContext *last;   ///< private copy updated by the last channel
+    AudioData *dst, *src;
+    int dst_size, src_size;
+    int ret, consumed;
+} ResampleThreads;
+
 
 typedef struct ResampleContext {
     const AVClass *av_class;
@@ -50,6 +69,7 @@ typedef struct ResampleContext {
     enum AVSampleFormat format;
     int felem_size;
     int filter_shift;
+    ResampleThreads *threads;
 } ResampleContext;
 
 /**
@@ -195,14 +215,49 @@ static int build_filter(ResampleContext *c, void *filter, double factor, int tap
     return 0;
 }
 
+/**
+ * Parameters identifying a filter bank in the process-wide cache.
+ */
+typedef struct FilterBankKey {
+    char   id[4];               ///< "swr", to not mix with other users of the cache
+    double factor;
+    int    filter_length;
+    int    filter_alloc;
+    int    phase_shift;
+    int    filter_shift;
+    enum AVSampleFormat format;
+    enum SwrFilterType filter_type;
+    int    kaiser_beta;
+} FilterBankKey;
+
+static int create_filter_bank(void **data, void *opaque){
+    ResampleContext *c = opaque;
+    int phase_count= 1<<c->phase_shift;
+    uint8_t *bank= av_mallocz(c->filter_alloc*(phase_count+1)*c->felem_size);
+    int ret;
+
+    if (!bank)
+        return AVERROR(ENOMEM);
+    if ((ret = build_filter(c, (void*)bank, c->factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, c->filter_type, c->kaiser_beta)) < 0) {
+        av_free(bank);
+        return ret;
+    }
+    memcpy(bank + (c->filter_alloc*phase_count+1)*c->felem_size, bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(bank + (c->filter_alloc*phase_count  )*c->felem_size, bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+    *data= bank;
+    return 0;
+}
+
 ResampleContext *swri_resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta){
     double factor= FFMIN(out_rate * cutoff / in_rate, 1.0);
     int phase_count= 1<<phase_shift;
+    FilterBankKey key;
 
     if (!c || c->phase_shift != phase_shift || c->linear!=linear || c->factor != factor
            || c->filter_length != FFMAX((int)ceil(filter_size/factor), 1) || c->format != format
            || c->filter_type != filter_type || c->kaiser_beta != kaiser_beta) {
+        swri_resample_free(&c);
         c = av_mallocz(sizeof(*c));
         if (!c)
             return NULL;
@@ -233,15 +288,24 @@ ResampleContext *swri_resample_init(ResampleContext *c, int out_rate, int in_rat
         c->factor        = factor;
         c->filter_length = FFMAX((int)ceil(filter_size/factor), 1);
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_mallocz(c->filter_alloc*(phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
+
+        /* filter banks are shared between the contexts using the same
+         * parameters, they are read-only once built */
+        memset(&key, 0, sizeof(key));
+        memcpy(key.id, "swr", 4);
+        key.factor        = c->factor;
+        key.filter_length = c->filter_length;
+        key.filter_alloc  = c->filter_alloc;
+        key.phase_shift   = c->phase_shift;
+        key.filter_shift  = c->filter_shift;
+        key.format        = c->format;
+        key.filter_type   = c->filter_type;
+        key.kaiser_beta   = c->kaiser_beta;
+        if (avpriv_refcache_get(&key, sizeof(key), create_filter_bank, av_free,
+                                c, (void **)&c->filter_bank) < 0)
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
     c->compensation_distance= 0;
@@ -254,7 +318,7 @@ ResampleContext *swri_resample_init(ResampleContext *c, int out_rate, int in_rat
 
     return c;
 error:
-    av_free(c->filter_bank);
+    avpriv_refcache_unref((void **)&c->filter_bank);
     av_free(c);
     return NULL;
 }
@@ -262,7 +326,8 @@ error:
 void swri_resample_free(ResampleContext **c){
     if(!*c)
         return;
-    av_freep(&(*c)->filter_bank);
+    swri_resample_set_threads(*c, 1);
+    avpriv_refcache_unref((void **)&(*c)->filter_bank);
     av_freep(c);
 }
 
@@ -403,6 +468,7 @@ int swr_set_compensation(struct SwrContext *s, int sample_delta, int compensatio
 
 #if HAVE_SSSE3
 #define COMMON_CORE COMMON_CORE_INT16_SSSE3
+#define LINEAR_CORE LINEAR_CORE_INT16_SSE2
 #define RENAME(N) N ## _int16_ssse3
 #define FILTER_SHIFT 15
 #define DELEM  int16_t
@@ -415,34 +481,253 @@ int swr_set_compensation(struct SwrContext *s, int sample_delta, int compensatio
                   d = (unsigned)(v + 32768) > 65535 ? (v>>31) ^ 32767 : v
 #include "resample_template.c"
 #endif
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
+
+#if HAVE_SSE4_INLINE
+#define COMMON_CORE COMMON_CORE_INT32_SSE4
+#define LINEAR_CORE LINEAR_CORE_INT32_SSE4
+#define RENAME(N) N ## _int32_sse4
+#define FILTER_SHIFT 30
+#define DELEM  int32_t
+#define FELEM  int32_t
+#define FELEM2 int64_t
+#define FELEML int64_t
+#define FELEM_MAX INT32_MAX
+#define FELEM_MIN INT32_MIN
+#define OUT(d, v) v = (v + (1<<(FILTER_SHIFT-1)))>>FILTER_SHIFT;\
+                  d = (uint64_t)(v + 0x80000000) > 0xFFFFFFFF ? (v>>63) ^ 0x7FFFFFFF : v
+#include "resample_template.c"
+#endif
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
+
+#if HAVE_SSE
+#define COMMON_CORE COMMON_CORE_FLT_SSE
+#define LINEAR_CORE LINEAR_CORE_FLT_SSE
+#define RENAME(N) N ## _float_sse
+#define FILTER_SHIFT 0
+#define DELEM  float
+#define FELEM  float
+#define FELEM2 float
+#define FELEML float
+#define OUT(d, v) d = v
+#include "resample_template.c"
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
+
+#define COMMON_CORE COMMON_CORE_DBL_SSE2
+#define LINEAR_CORE LINEAR_CORE_DBL_SSE2
+#define RENAME(N) N ## _double_sse2
+#define FILTER_SHIFT 0
+#define DELEM  double
+#define FELEM  double
+#define FELEM2 double
+#define FELEML double
+#define OUT(d, v) d = v
+#include "resample_template.c"
+#endif
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
+
+#if HAVE_AVX_INLINE
+#define COMMON_CORE COMMON_CORE_FLT_AVX
+#define LINEAR_CORE LINEAR_CORE_FLT_AVX
+#define RENAME(N) N ## _float_avx
+#define FILTER_SHIFT 0
+#define DELEM  float
+#define FELEM  float
+#define FELEM2 float
+#define FELEML float
+#define OUT(d, v) d = v
+#include "resample_template.c"
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
+
+#define COMMON_CORE COMMON_CORE_DBL_AVX
+#define LINEAR_CORE LINEAR_CORE_DBL_AVX
+#define RENAME(N) N ## _double_avx
+#define FILTER_SHIFT 0
+#define DELEM  double
+#define FELEM  double
+#define FELEM2 double
+#define FELEML double
+#define OUT(d, v) d = v
+#include "resample_template.c"
+#endif
+
+#undef COMMON_CORE
+#undef LINEAR_CORE
+#undef RENAME
+#undef FELEM
+#undef FELEM2
+#undef DELEM
+#undef FELEML
+#undef OUT
+#undef FELEM_MIN
+#undef FELEM_MAX
+#undef FILTER_SHIFT
 #endif // ARCH_X86
 
-int swri_multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
-    int i, ret= -1;
+/**
+ * Resample channel i of src into dst.
+ */
+static int resample_channel(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed, int i, int update_ctx){
+    int ret= -1;
     int mm_flags = av_get_cpu_flags();
     int need_emms= 0;
 
-    for(i=0; i<dst->ch_count; i++){
 #if ARCH_X86
+#if HAVE_SSE4_INLINE
+             if(c->format == AV_SAMPLE_FMT_S32P && (mm_flags&AV_CPU_FLAG_SSE4 )) ret= swri_resample_int32_sse4 (c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else
+#endif
+#if HAVE_AVX_INLINE
+             if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_AVX  )) ret= swri_resample_float_avx  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_AVX  )) ret= swri_resample_double_avx (c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else
+#endif
+#if HAVE_SSE
+             if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_SSE  )) ret= swri_resample_float_sse  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_SSE2 )) ret= swri_resample_double_sse2(c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else
+#endif
 #if HAVE_SSSE3
-             if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_SSSE3)) ret= swri_resample_int16_ssse3(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+             if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_SSSE3)) ret= swri_resample_int16_ssse3(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
         else
 #endif
              if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_MMX2 )){
-                 ret= swri_resample_int16_mmx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+                 ret= swri_resample_int16_mmx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
                  need_emms= 1;
              } else
 #endif
-             if(c->format == AV_SAMPLE_FMT_S16P) ret= swri_resample_int16(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_S32P) ret= swri_resample_int32(c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_FLTP) ret= swri_resample_float(c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-        else if(c->format == AV_SAMPLE_FMT_DBLP) ret= swri_resample_double(c,(double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
-    }
+             if(c->format == AV_SAMPLE_FMT_S16P) ret= swri_resample_int16(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else if(c->format == AV_SAMPLE_FMT_S32P) ret= swri_resample_int32(c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else if(c->format == AV_SAMPLE_FMT_FLTP) ret= swri_resample_float(c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+        else if(c->format == AV_SAMPLE_FMT_DBLP) ret= swri_resample_double(c,(double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, update_ctx);
+
     if(need_emms)
         emms_c();
     return ret;
 }
 
+/**
+ * Run job i of the current call. Only the last channel updates the
+ * context, and it does so on a private copy since the other channels are
+ * read from the shared one concurrently.
+ */
+static int resample_job(void *opaque, int i, int thread){
+    ResampleThreads *t = opaque;
+
+    if(i == t->dst->ch_count - 1){
+        t->ret= resample_channel(t->last, t->dst, t->dst_size, t->src, t->src_size, &t->consumed, i, 1);
+    }else{
+        int consumed;
+        resample_channel(t->c, t->dst, t->dst_size, t->src, t->src_size, &consumed, i, 0);
+    }
+    return 0;
+}
+
+int swri_resample_set_threads(ResampleContext *c, int nb_threads){
+    ResampleThreads *t = c->threads;
+
+    if(t && t->nb_threads == nb_threads)
+        return 0;
+
+    if(t){
+        avpriv_jobpool_free(&t->pool);
+        av_freep(&c->threads);
+    }
+
+    if(nb_threads <= 1)
+        return 0;
+
+    t = c->threads = av_mallocz(sizeof(*t));
+    if(!t)
+        return AVERROR(ENOMEM);
+    t->nb_threads= nb_threads;
+    if(!(t->pool = avpriv_jobpool_alloc(nb_threads, NULL))){
+        av_freep(&c->threads);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+int swri_multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+    ResampleThreads *t = c->threads;
+    int i, ret= -1;
+
+    if(t && avpriv_jobpool_nb_threads(t->pool) > 1 && dst->ch_count > 1){
+        ResampleContext last= *c;
+
+        t->c        = c;
+        t->last     = &last;
+        t->dst      = dst;
+        t->src      = src;
+        t->dst_size = dst_size;
+        t->src_size = src_size;
+        avpriv_jobpool_execute(t->pool, resample_job, t, dst->ch_count);
+
+        *c= last;
+        *consumed= t->consumed;
+        return t->ret;
+    }
+
+    for(i=0; i<dst->ch_count; i++)
+        ret= resample_channel(c, dst, dst_size, src, src_size, consumed, i, i+1==dst->ch_count);
+    return ret;
+}
+
 int64_t swr_get_delay(struct SwrContext *s, int64_t base){
     ResampleContext *c = s->resample;
     if(c){
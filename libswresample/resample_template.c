@@ -86,11 +86,15 @@ int RENAME(swri_resample)(ResampleContext *c, DELEM *dst, const DELEM *src, int
                 for(i=0; i<c->filter_length; i++)
                     val += src[FFABS(sample_index + i)] * filter[i];
             }else if(c->linear){
+#ifdef LINEAR_CORE
+                LINEAR_CORE
+#else
                 FELEM2 v2=0;
                 for(i=0; i<c->filter_length; i++){
                     val += src[sample_index + i] * (FELEM2)filter[i];
                     v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_alloc];
                 }
+#endif
                 val+=(v2-val)*(FELEML)frac / c->src_incr;
             }else{
                 for(i=0; i<c->filter_length; i++){
@@ -22,7 +22,10 @@
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/audioconvert.h"
+#include "libavutil/cpu.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 #include "swresample.h"
 
 #undef time
@@ -219,6 +222,451 @@ static void audiogen(void *data, enum AVSampleFormat sample_fmt,
     }
 }
 
+#define BENCH_SECONDS 20
+#define BENCH_CHUNK   1024
+
+static const struct {
+    enum AVSampleFormat fmt;
+    int in_rate, out_rate;
+} bench_tests[] = {
+    { AV_SAMPLE_FMT_S16P, 48000, 44100 },
+    { AV_SAMPLE_FMT_S32P, 96000, 48000 },
+    { AV_SAMPLE_FMT_FLTP, 48000, 44100 },
+    { AV_SAMPLE_FMT_FLTP, 96000, 48000 },
+    { AV_SAMPLE_FMT_DBLP, 48000, 44100 },
+};
+
+/**
+ * Resample BENCH_SECONDS of stereo audio in chunks, the internal sample
+ * format being the one of the input and output so that only the resampler
+ * runs.
+ * @return the number of output samples
+ */
+static int bench_run(uint8_t *out[], int out_max, uint8_t *in[], int in_count,
+                     enum AVSampleFormat fmt, int in_rate, int out_rate,
+                     int linear, int64_t *time)
+{
+    struct SwrContext *ctx;
+    uint8_t *ain[SWR_CH_MAX], *aout[SWR_CH_MAX];
+    int done = 0, ret;
+
+    ctx = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, fmt, out_rate,
+                                   AV_CH_LAYOUT_STEREO, fmt,  in_rate, 0, NULL);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    if (fmt != AV_SAMPLE_FMT_DBLP) // chosen by default for double input
+        av_opt_set_int(ctx, "tsf", fmt, 0);
+    av_opt_set_int(ctx, "linear_interp", linear, 0);
+    if ((ret = swr_init(ctx)) < 0)
+        goto end;
+
+    memcpy(ain,  in,  2 * sizeof(*in));
+    memcpy(aout, out, 2 * sizeof(*out));
+
+    *time = av_gettime();
+    while (in_count > 0 || !done) {
+        int count = FFMIN(in_count, BENCH_CHUNK);
+        ret = swr_convert(ctx, aout, out_max - done,
+                          count ? (const uint8_t **)ain : NULL, count);
+        if (ret < 0)
+            goto end;
+        if (!count && !ret)
+            break;
+        shift(ain,  count, 2, fmt);
+        shift(aout, ret,   2, fmt);
+        in_count -= count;
+        done     += ret;
+    }
+    *time = av_gettime() - *time;
+    ret = done;
+end:
+    swr_free(&ctx);
+    return ret;
+}
+
+static int bench(void)
+{
+    int t, linear, ch, i;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(bench_tests); t++) {
+        enum AVSampleFormat fmt = bench_tests[t].fmt;
+        int in_count = bench_tests[t].in_rate  * BENCH_SECONDS;
+        int out_max  = bench_tests[t].out_rate * BENCH_SECONDS + BENCH_CHUNK;
+        uint8_t *in[SWR_CH_MAX], *out[2][SWR_CH_MAX];
+
+        if (av_samples_alloc(in,     NULL, 2, in_count, fmt, 0) < 0 ||
+            av_samples_alloc(out[0], NULL, 2, out_max,  fmt, 0) < 0 ||
+            av_samples_alloc(out[1], NULL, 2, out_max,  fmt, 0) < 0)
+            return 1;
+        audiogen(in, fmt, 2, bench_tests[t].in_rate, in_count);
+
+        for (linear = 0; linear <= 1; linear++) {
+            int64_t time[2];
+            int count[2];
+            double maxdiff = 0;
+
+            for (i = 0; i < 2; i++) {
+                // C code first, then the optimized one
+                av_force_cpu_flags(i ? -1 : 0);
+                count[i] = bench_run(out[i], out_max, in, in_count, fmt,
+                                     bench_tests[t].in_rate, bench_tests[t].out_rate,
+                                     linear, &time[i]);
+                if (count[i] < 0)
+                    return 1;
+            }
+            av_force_cpu_flags(-1);
+
+            for (ch = 0; ch < 2; ch++)
+                for (i = 0; i < FFMIN(count[0], count[1]); i++)
+                    maxdiff = FFMAX(maxdiff, FFABS(get(out[0], ch, i, 2, fmt) -
+                                                   get(out[1], ch, i, 2, fmt)));
+
+            fprintf(stderr, "%s %5d->%5d%s: C %7.1f ms, optimized %7.1f ms, max difference %g%s\n",
+                    av_get_sample_fmt_name(fmt),
+                    bench_tests[t].in_rate, bench_tests[t].out_rate,
+                    linear ? " linear" : "       ",
+                    time[0] / 1000.0, time[1] / 1000.0, maxdiff,
+                    count[0] != count[1] ? " LENGTH MISMATCH" : "");
+        }
+
+        av_freep(&in[0]);
+        av_freep(&out[0][0]);
+        av_freep(&out[1][0]);
+    }
+    return 0;
+}
+
+#define THREADS_SECONDS 2
+
+static const struct {
+    enum AVSampleFormat fmt;
+    uint64_t layout;
+    int in_rate, out_rate;
+    int linear;
+} threads_tests[] = {
+    { AV_SAMPLE_FMT_S16P, AV_CH_LAYOUT_STEREO,  48000, 44100    },
+    { AV_SAMPLE_FMT_S16P, AV_CH_LAYOUT_5POINT1, 44100, 48000, 1 },
+    { AV_SAMPLE_FMT_S32P, AV_CH_LAYOUT_7POINT1, 96000, 48000    },
+    { AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_5POINT1, 48000, 44100    },
+    { AV_SAMPLE_FMT_FLTP, AV_CH_LAYOUT_7POINT1,  8000, 44100, 1 },
+    { AV_SAMPLE_FMT_DBLP, AV_CH_LAYOUT_QUAD,    22050, 32000    },
+};
+
+/**
+ * Resample in chunks of varying sizes with nb_threads threads.
+ * @return the number of output samples
+ */
+static int threads_run(uint8_t *out[], int out_max, uint8_t *in[], int in_count,
+                       enum AVSampleFormat fmt, uint64_t layout, int in_rate,
+                       int out_rate, int linear, int nb_threads)
+{
+    struct SwrContext *ctx;
+    uint8_t *ain[SWR_CH_MAX], *aout[SWR_CH_MAX];
+    int channels = av_get_channel_layout_nb_channels(layout);
+    int done = 0, chunk = 0, ret;
+
+    ctx = swr_alloc_set_opts(NULL, layout, fmt, out_rate,
+                                   layout, fmt,  in_rate, 0, NULL);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    if (fmt != AV_SAMPLE_FMT_DBLP) // chosen by default for double input
+        av_opt_set_int(ctx, "tsf", fmt, 0);
+    av_opt_set_int(ctx, "linear_interp", linear, 0);
+    av_opt_set_int(ctx, "threads", nb_threads, 0);
+    if ((ret = swr_init(ctx)) < 0)
+        goto end;
+
+    memcpy(ain,  in,  channels * sizeof(*in));
+    memcpy(aout, out, channels * sizeof(*out));
+
+    while (in_count > 0 || !done) {
+        int count = FFMIN(in_count, 1 + chunk++ * 397 % 2000);
+        ret = swr_convert(ctx, aout, out_max - done,
+                          count ? (const uint8_t **)ain : NULL, count);
+        if (ret < 0)
+            goto end;
+        if (!count && !ret)
+            break;
+        shift(ain,  count, channels, fmt);
+        shift(aout, ret,   channels, fmt);
+        in_count -= count;
+        done     += ret;
+    }
+    ret = done;
+end:
+    swr_free(&ctx);
+    return ret;
+}
+
+/**
+ * Check that resampling the channels in several threads gives the same
+ * output as a single thread.
+ */
+static int test_threads(void)
+{
+    int t, ch, ret = 0;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(threads_tests); t++) {
+        enum AVSampleFormat fmt = threads_tests[t].fmt;
+        uint64_t layout = threads_tests[t].layout;
+        int channels = av_get_channel_layout_nb_channels(layout);
+        int in_count = threads_tests[t].in_rate  * THREADS_SECONDS;
+        int out_max  = threads_tests[t].out_rate * THREADS_SECONDS + 4096;
+        uint8_t *in[SWR_CH_MAX], *out[2][SWR_CH_MAX];
+        int count[2], i, mismatch = 0;
+
+        if (av_samples_alloc(in,     NULL, channels, in_count, fmt, 0) < 0 ||
+            av_samples_alloc(out[0], NULL, channels, out_max,  fmt, 0) < 0 ||
+            av_samples_alloc(out[1], NULL, channels, out_max,  fmt, 0) < 0)
+            return 1;
+        audiogen(in, fmt, channels, threads_tests[t].in_rate, in_count);
+
+        for (i = 0; i < 2; i++) {
+            count[i] = threads_run(out[i], out_max, in, in_count, fmt, layout,
+                                   threads_tests[t].in_rate, threads_tests[t].out_rate,
+                                   threads_tests[t].linear, i ? 4 : 1);
+            if (count[i] < 0)
+                return 1;
+        }
+        if (count[0] != count[1])
+            mismatch = 1;
+        for (ch = 0; ch < channels && !mismatch; ch++)
+            if (memcmp(out[0][ch], out[1][ch], count[0] * av_get_bytes_per_sample(fmt)))
+                mismatch = 1;
+
+        fprintf(stderr, "%s %d channels %5d->%5d%s: %s\n",
+                av_get_sample_fmt_name(fmt), channels,
+                threads_tests[t].in_rate, threads_tests[t].out_rate,
+                threads_tests[t].linear ? " linear" : "       ",
+                mismatch ? "MISMATCH" : "ok");
+        ret |= mismatch;
+
+        av_freep(&in[0]);
+        av_freep(&out[0][0]);
+        av_freep(&out[1][0]);
+    }
+    return ret;
+}
+
+static const struct {
+    const char *name;
+    uint64_t in_layout, out_layout;
+    int custom;                                 ///< use a dense matrix instead of the automatic one
+} rematrix_tests[] = {
+    { "5.1 -> stereo",  AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_STEREO },
+    { "7.1 -> stereo",  AV_CH_LAYOUT_7POINT1, AV_CH_LAYOUT_STEREO },
+    { "7.1 -> 5.1",     AV_CH_LAYOUT_7POINT1, AV_CH_LAYOUT_5POINT1 },
+    { "stereo -> mono", AV_CH_LAYOUT_STEREO,  AV_CH_LAYOUT_MONO    },
+    { "5.1 -> mono",    AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_MONO    },
+    { "6 -> 4 dense",   AV_CH_LAYOUT_5POINT1, AV_CH_LAYOUT_QUAD, 1 },
+};
+
+/**
+ * Rematrix BENCH_SECONDS of audio in chunks, without resampling nor sample
+ * format conversion.
+ * @return the time spent in microseconds, a negative value on error
+ */
+static int64_t bench_rematrix_run(uint8_t *out[], uint8_t *in[], int in_count,
+                                  enum AVSampleFormat fmt, uint64_t in_layout,
+                                  uint64_t out_layout, const double *matrix)
+{
+    struct SwrContext *ctx;
+    uint8_t *ain[SWR_CH_MAX], *aout[SWR_CH_MAX];
+    int in_ch  = av_get_channel_layout_nb_channels(in_layout);
+    int out_ch = av_get_channel_layout_nb_channels(out_layout);
+    int64_t time;
+    int ret;
+
+    ctx = swr_alloc_set_opts(NULL, out_layout, fmt, 48000, in_layout, fmt, 48000, 0, NULL);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(ctx, "tsf", fmt, 0);
+    if (matrix && (ret = swr_set_matrix(ctx, matrix, in_ch)) < 0)
+        goto end;
+    if ((ret = swr_init(ctx)) < 0)
+        goto end;
+
+    memcpy(ain,  in,  in_ch  * sizeof(*in));
+    memcpy(aout, out, out_ch * sizeof(*out));
+
+    time = av_gettime();
+    while (in_count > 0) {
+        int count = FFMIN(in_count, BENCH_CHUNK);
+        ret = swr_convert(ctx, aout, count, (const uint8_t **)ain, count);
+        if (ret < 0)
+            goto end;
+        shift(ain,  count, in_ch,  fmt);
+        shift(aout, ret,   out_ch, fmt);
+        in_count -= count;
+    }
+    time = av_gettime() - time;
+    ret  = 0;
+end:
+    swr_free(&ctx);
+    return ret < 0 ? ret : time;
+}
+
+static int bench_rematrix(void)
+{
+    static const enum AVSampleFormat fmts[] = { AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_FLTP };
+    int in_count = 48000 * BENCH_SECONDS;
+    int t, f, ch, i, j;
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        for (t = 0; t < FF_ARRAY_ELEMS(rematrix_tests); t++) {
+            enum AVSampleFormat fmt = fmts[f];
+            uint64_t in_layout  = rematrix_tests[t].in_layout;
+            uint64_t out_layout = rematrix_tests[t].out_layout;
+            int in_ch  = av_get_channel_layout_nb_channels(in_layout);
+            int out_ch = av_get_channel_layout_nb_channels(out_layout);
+            uint8_t *in[SWR_CH_MAX], *out[2][SWR_CH_MAX];
+            double matrix[SWR_CH_MAX * SWR_CH_MAX];
+            int64_t time[2];
+            double maxdiff = 0;
+
+            for (i = 0; i < out_ch; i++)
+                for (j = 0; j < in_ch; j++)
+                    matrix[i * in_ch + j] = 0.05 * (1 + (i + 2 * j) % 4);
+
+            if (av_samples_alloc(in,     NULL, in_ch,  in_count, fmt, 0) < 0 ||
+                av_samples_alloc(out[0], NULL, out_ch, in_count, fmt, 0) < 0 ||
+                av_samples_alloc(out[1], NULL, out_ch, in_count, fmt, 0) < 0)
+                return 1;
+            audiogen(in, fmt, in_ch, 48000, in_count);
+
+            for (i = 0; i < 2; i++) {
+                // C code first, then the optimized one
+                av_force_cpu_flags(i ? -1 : 0);
+                time[i] = bench_rematrix_run(out[i], in, in_count, fmt, in_layout, out_layout,
+                                             rematrix_tests[t].custom ? matrix : NULL);
+                if (time[i] < 0)
+                    return 1;
+            }
+            av_force_cpu_flags(-1);
+
+            for (ch = 0; ch < out_ch; ch++)
+                for (i = 0; i < in_count; i++)
+                    maxdiff = FFMAX(maxdiff, FFABS(get(out[0], ch, i, out_ch, fmt) -
+                                                   get(out[1], ch, i, out_ch, fmt)));
+
+            fprintf(stderr, "%s %-14s: C %7.1f ms, optimized %7.1f ms, max difference %g\n",
+                    av_get_sample_fmt_name(fmt), rematrix_tests[t].name,
+                    time[0] / 1000.0, time[1] / 1000.0, maxdiff);
+
+            av_freep(&in[0]);
+            av_freep(&out[0][0]);
+            av_freep(&out[1][0]);
+        }
+    }
+    return 0;
+}
+
+#define DITHER_SECONDS 2
+
+/**
+ * Convert in_count samples of stereo float to s16 with the given dither.
+ * @return the time spent in microseconds, a negative value on error
+ */
+static int64_t bench_dither_run(uint8_t *out[], uint8_t *in[], int in_count,
+                                enum SwrDitherType method)
+{
+    struct SwrContext *ctx;
+    uint8_t *ain[SWR_CH_MAX], *aout[SWR_CH_MAX];
+    int64_t time;
+    int ret;
+
+    ctx = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16P, 44100,
+                                   AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLTP, 44100, 0, NULL);
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(ctx, "dither_method", method, 0);
+    if ((ret = swr_init(ctx)) < 0)
+        goto end;
+
+    memcpy(ain,  in,  2 * sizeof(*in));
+    memcpy(aout, out, 2 * sizeof(*out));
+
+    time = av_gettime();
+    while (in_count > 0) {
+        // odd chunks to also run the C code for the remainders
+        int count = FFMIN(in_count, BENCH_CHUNK - 3);
+        ret = swr_convert(ctx, aout, count, (const uint8_t **)ain, count);
+        if (ret < 0)
+            goto end;
+        shift(ain,  count, 2, AV_SAMPLE_FMT_FLTP);
+        shift(aout, ret,   2, AV_SAMPLE_FMT_S16P);
+        in_count -= count;
+    }
+    time = av_gettime() - time;
+    ret  = 0;
+end:
+    swr_free(&ctx);
+    return ret < 0 ? ret : time;
+}
+
+/**
+ * Check that the optimized dither gives the same output as the C code for
+ * every dither method, and time both if bench is set.
+ */
+static int test_dither(int seconds, int bench)
+{
+    static const struct {
+        const char *name;
+        enum SwrDitherType method;
+    } methods[] = {
+        { "none",          SWR_DITHER_NONE                },
+        { "rectangular",   SWR_DITHER_RECTANGULAR         },
+        { "triangular",    SWR_DITHER_TRIANGULAR          },
+        { "triangular_hp", SWR_DITHER_TRIANGULAR_HIGHPASS },
+        { "lipshitz",      SWR_DITHER_NS_LIPSHITZ         },
+    };
+    int in_count = 44100 * seconds;
+    uint8_t *in[SWR_CH_MAX], *out[2][SWR_CH_MAX];
+    int m, ch, i, ret = 0;
+
+    if (av_samples_alloc(in,     NULL, 2, in_count, AV_SAMPLE_FMT_FLTP, 0) < 0 ||
+        av_samples_alloc(out[0], NULL, 2, in_count, AV_SAMPLE_FMT_S16P, 0) < 0 ||
+        av_samples_alloc(out[1], NULL, 2, in_count, AV_SAMPLE_FMT_S16P, 0) < 0)
+        return 1;
+    audiogen(in, AV_SAMPLE_FMT_FLTP, 2, 44100, in_count);
+
+    for (m = 0; m < FF_ARRAY_ELEMS(methods); m++) {
+        int64_t time[2];
+        double maxdiff = 0;
+        int mismatch;
+
+        for (i = 0; i < 2; i++) {
+            // C code first, then the optimized one
+            av_force_cpu_flags(i ? -1 : 0);
+            time[i] = bench_dither_run(out[i], in, in_count, methods[m].method);
+            if (time[i] < 0)
+                return 1;
+        }
+        av_force_cpu_flags(-1);
+
+        for (ch = 0; ch < 2; ch++)
+            for (i = 0; i < in_count; i++)
+                maxdiff = FFMAX(maxdiff, FFABS(get(out[0], ch, i, 2, AV_SAMPLE_FMT_S16P) -
+                                               get(out[1], ch, i, 2, AV_SAMPLE_FMT_S16P)));
+
+        // the optimized code generates the same noise as the C code
+        mismatch = maxdiff > 0;
+        if (bench)
+            fprintf(stderr, "fltp->s16p dither %-13s: C %7.1f ms, optimized %7.1f ms, max difference %g%s\n",
+                    methods[m].name, time[0] / 1000.0, time[1] / 1000.0, maxdiff,
+                    mismatch ? " MISMATCH" : "");
+        else
+            fprintf(stderr, "fltp->s16p dither %-13s: %s\n",
+                    methods[m].name, mismatch ? "MISMATCH" : "ok");
+        ret |= mismatch;
+    }
+
+    av_freep(&in[0]);
+    av_freep(&out[0][0]);
+    av_freep(&out[1][0]);
+    return ret;
+}
+
 int main(int argc, char **argv){
     int in_sample_rate, out_sample_rate, ch ,i, flush_count;
     uint64_t in_ch_layout, out_ch_layout;
@@ -245,9 +693,21 @@ int main(int argc, char **argv){
     if (argc > 1) {
         if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
             av_log(NULL, AV_LOG_INFO, "Usage: swresample-test [<num_tests>[ <test>]]  \n"
-                   "num_tests           Default is %d\n", num_tests);
+                   "       swresample-test -bench\n"
+                   "       swresample-test -threads\n"
+                   "       swresample-test -dither\n"
+                   "num_tests           Default is %d\n"
+                   "-bench              Time the resampler, the rematrixing and the dithering, C against the optimized code\n"
+                   "-threads            Check that resampling with several threads is bit-exact\n"
+                   "-dither             Check that the optimized dither is bit-exact, for every method\n", num_tests);
             return 0;
         }
+        if (!strcmp(argv[1], "-bench"))
+            return bench() || bench_rematrix() || test_dither(BENCH_SECONDS, 1);
+        if (!strcmp(argv[1], "-threads"))
+            return test_threads();
+        if (!strcmp(argv[1], "-dither"))
+            return test_dither(DITHER_SECONDS, 0);
         num_tests = strtol(argv[1], NULL, 0);
         if(num_tests < 0) {
             num_tests = -num_tests;
@@ -30,7 +30,7 @@
 #include "libavutil/samplefmt.h"
 
 #define LIBSWRESAMPLE_VERSION_MAJOR 0
-#define LIBSWRESAMPLE_VERSION_MINOR 15
+#define LIBSWRESAMPLE_VERSION_MINOR 17
 #define LIBSWRESAMPLE_VERSION_MICRO 100
 
 #define LIBSWRESAMPLE_VERSION_INT  AV_VERSION_INT(LIBSWRESAMPLE_VERSION_MAJOR, \
@@ -50,6 +50,7 @@ enum SwrDitherType {
     SWR_DITHER_RECTANGULAR,
     SWR_DITHER_TRIANGULAR,
     SWR_DITHER_TRIANGULAR_HIGHPASS,
+    SWR_DITHER_NS_LIPSHITZ,     ///< triangular dither with Lipshitz noise shaping, 44.1/48 kHz s16 or u8 output only
     SWR_DITHER_NB,              ///< not part of API/ABI
 };
 
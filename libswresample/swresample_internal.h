@@ -28,6 +28,31 @@ typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, vo
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, int len);
 
+/**
+ * Mix the input channels listed in in_ch (count first, then the channel
+ * indices) into out, using the coefficients of coeffs indexed by input
+ * channel: float for planar float, 17.15 fixed point int32_t for planar s16.
+ */
+typedef void (mix_n_1_func_type)(void *out, uint8_t * const *in, const void *coeffs, const uint8_t *in_ch, int len);
+
+#define NS_TAPS 5                                   ///< number of taps of the noise shaping filter
+
+typedef struct DitherContext {
+    enum SwrDitherType method;                      ///< dither method in use, can differ from the requested one
+    float scale;                                    ///< noise amplitude in internal sample units
+    float ns_scale;                                 ///< noise shaping: output LSBs per internal sample unit
+    unsigned seed[SWR_CH_MAX];                      ///< random generator state per channel
+    float hist[SWR_CH_MAX][2];                      ///< last 2 triangular noise values per channel, for the high pass
+    double ns_errors[SWR_CH_MAX][2*NS_TAPS];        ///< last quantization errors per channel, stored twice to not wrap
+    int ns_pos[SWR_CH_MAX];                         ///< position of the last error in ns_errors
+
+    /**
+     * Optimized addition of the noise to planar float samples, len must be
+     * a multiple of 4. NULL if not available for the method in use.
+     */
+    void (*noise_flt)(struct DitherContext *c, int ch, float *dst, int len);
+} DitherContext;
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -57,7 +82,6 @@ struct SwrContext {
     const int *channel_map;                         ///< channel index (or -1 if muted channel) map
     int used_ch_count;                              ///< number of used input channels (mapped channel count if channel_map, otherwise in.ch_count)
     enum SwrDitherType dither_method;
-    int dither_pos;
     float dither_scale;
     int filter_size;                                /**< length of each FIR filter in the resampling filterbank relative to the cutoff frequency */
     int phase_shift;                                /**< log2 of the number of entries in the resampling polyphase filterbank */
@@ -65,6 +89,7 @@ struct SwrContext {
     double cutoff;                                  /**< resampling cutoff frequency. 1.0 corresponds to half the output sample rate */
     enum SwrFilterType filter_type;                 /**< resampling filter type */
     int kaiser_beta;                                /**< beta value for Kaiser window (only applicable if filter_type == AV_FILTER_TYPE_KAISER) */
+    int nb_threads;                                 /**< number of threads resampling the channels concurrently */
 
     float min_compensation;                         ///< minimum below which no compensation will happen
     float min_hard_compensation;                    ///< minimum below which no silence inject / sample drop will happen
@@ -81,7 +106,7 @@ struct SwrContext {
     AudioData preout;                               ///< pre-output audio data: used for rematrix/resample
     AudioData out;                                  ///< converted output audio data
     AudioData in_buffer;                            ///< cached audio data (convert and resample purpose)
-    AudioData dither;                               ///< noise used for dithering
+    DitherContext dither;                           ///< dithering state
     int in_buffer_index;                            ///< cached buffer position
     int in_buffer_count;                            ///< cached buffer length
     int resample_in_constraint;                     ///< 1 if the input end was reach before the output end, 0 otherwise
@@ -107,12 +132,15 @@ struct SwrContext {
     mix_2_1_func_type *mix_2_1_simd;
 
     mix_any_func_type *mix_any_f;
+    mix_any_func_type *mix_any_simd;                ///< optimized mix_any_f, for a multiple of 8 samples
+    mix_n_1_func_type *mix_n_1_simd;                ///< optimized generic mixing of one output channel, for a multiple of 8 samples
 
     /* TODO: callbacks for ASM optimizations */
 };
 
 struct ResampleContext *swri_resample_init(struct ResampleContext *, int out_rate, int in_rate, int filter_size, int phase_shift, int linear, double cutoff, enum AVSampleFormat, enum SwrFilterType, int kaiser_beta);
 void swri_resample_free(struct ResampleContext **c);
+int swri_resample_set_threads(struct ResampleContext *c, int nb_threads);
 int swri_multiple_resample(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 void swri_resample_compensate(struct ResampleContext *c, int sample_delta, int compensation_distance);
 int swri_resample_int16(struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
@@ -124,8 +152,11 @@ int swri_rematrix_init(SwrContext *s);
 void swri_rematrix_free(SwrContext *s);
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy);
 void swri_rematrix_init_x86(struct SwrContext *s);
+void swri_rematrix_init_mmx(struct SwrContext *s);
 
-void swri_get_dither(SwrContext *s, void *dst, int len, unsigned seed, enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt);
+void swri_dither_init(SwrContext *s, enum AVSampleFormat out_fmt, enum AVSampleFormat in_fmt);
+void swri_dither(SwrContext *s, AudioData *a, int len);
+void swri_dither_init_mmx(SwrContext *s);
 
 void swri_audio_convert_init_x86(struct AudioConvert *ac,
                                  enum AVSampleFormat out_fmt,
@@ -0,0 +1,211 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Inline asm dither generation, giving the same noise as the C code.
+ * The random generator of each channel is run as 4 or 8 interleaved
+ * streams which are advanced by 4 or 8 steps at once.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libswresample/swresample_internal.h"
+
+#if HAVE_INLINE_ASM && HAVE_SSE
+
+DECLARE_ALIGNED(16, static const uint32_t, pd_sign)[4] = { 0x80000000, 0x80000000, 0x80000000, 0x80000000 };
+DECLARE_ALIGNED(16, static const float,    ps_norm)[4] = { 1.0f / 4294967296.0f, 1.0f / 4294967296.0f,
+                                                           1.0f / 4294967296.0f, 1.0f / 4294967296.0f };
+
+/**
+ * Multiplier and increment advancing the generator by n steps.
+ */
+static void lcg_skip(uint64_t n, uint32_t *mul, uint32_t *add)
+{
+    uint32_t a = 1664525, c = 1013904223;
+
+    *mul = 1;
+    *add = 0;
+    while (n) {
+        if (n & 1) {
+            *mul *= a;
+            *add  = *add * a + c;
+        }
+        c *= a + 1;
+        a *= a;
+        n >>= 1;
+    }
+}
+
+/* s = s * mul + add on 32 bit lanes, t is clobbered */
+#define LCG_NEXT(s, t)                                                       \
+        "movdqa         %%"s", %%"t" \n"                                     \
+        "pmuludq        %[mul], %%"s" \n"                                    \
+        "psrlq             $32, %%"t" \n"                                    \
+        "pmuludq        %[mul], %%"t" \n"                                    \
+        "pshufd     $0x08, %%"s", %%"s" \n"                                  \
+        "pshufd     $0x08, %%"t", %%"t" \n"                                  \
+        "punpckldq      %%"t", %%"s" \n"                                     \
+        "paddd          %[add], %%"s" \n"
+
+/* d = random values of the states in s, as lcg_rand() in dither.c */
+#define LCG_FLOAT(s, d)                                                      \
+        "movdqa         %%"s", %%"d" \n"                                     \
+        "pxor          %[sign], %%"d" \n"                                    \
+        "cvtdq2ps       %%"d", %%"d" \n"                                     \
+        "mulps         %[norm], %%"d" \n"
+
+/* xmm1 = triangular noise from the states in xmm0 and xmm4 */
+#define TRIANGULAR                                                           \
+        LCG_FLOAT("xmm0", "xmm1")                                            \
+        LCG_FLOAT("xmm4", "xmm5")                                            \
+        "movaps         %%xmm1, %%xmm2 \n"                                   \
+        "shufps $0x88,  %%xmm5, %%xmm1 \n"                                   \
+        "shufps $0xDD,  %%xmm5, %%xmm2 \n"                                   \
+        "subps          %%xmm2, %%xmm1 \n"
+
+/* dst += xmm1 * scale */
+#define ADD_NOISE                                                            \
+        "mulps        %[scale], %%xmm1 \n"                                   \
+        "movups (%[dst],%[i]), %%xmm2 \n"                                    \
+        "addps          %%xmm1, %%xmm2 \n"                                   \
+        "movups %%xmm2, (%[dst],%[i]) \n"
+
+static void noise_flt_sse2(DitherContext *c, int ch, float *dst, int len)
+{
+    DECLARE_ALIGNED(16, uint32_t, state)[2][4];
+    DECLARE_ALIGNED(16, uint32_t, mul)[4];
+    DECLARE_ALIGNED(16, uint32_t, add)[4];
+    DECLARE_ALIGNED(16, float, scale)[4];
+    DECLARE_ALIGNED(16, float, hist)[4];
+    int rand_per_sample = c->method == SWR_DITHER_RECTANGULAR ? 1 : 2;
+    int lanes = 4 * rand_per_sample;
+    unsigned seed = c->seed[ch];
+    x86_reg i = -4 * (x86_reg)len;
+    int j;
+
+    for (j = 0; j < lanes; j++) {
+        seed = seed * 1664525 + 1013904223;
+        state[j >> 2][j & 3] = seed;
+    }
+    lcg_skip(lanes, mul, add);
+    mul[1] = mul[2] = mul[3] = mul[0];
+    add[1] = add[2] = add[3] = add[0];
+    scale[0] = scale[1] = scale[2] = scale[3] = c->scale;
+
+    switch (c->method) {
+    case SWR_DITHER_RECTANGULAR:
+        __asm__ volatile(
+            "movdqa      %[s0], %%xmm0 \n"
+            "1: \n"
+            LCG_FLOAT("xmm0", "xmm1")
+            ADD_NOISE
+            LCG_NEXT("xmm0", "xmm3")
+            "add           $16, %[i] \n"
+            "jl 1b \n"
+            : [i]"+&r"(i)
+            : [dst]"r"(dst + len), [s0]"m"(*state[0]), [mul]"m"(*mul), [add]"m"(*add),
+              [scale]"m"(*scale), [sign]"m"(*pd_sign), [norm]"m"(*ps_norm)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+              "memory"
+        );
+        break;
+    case SWR_DITHER_TRIANGULAR:
+        __asm__ volatile(
+            "movdqa      %[s0], %%xmm0 \n"
+            "movdqa      %[s1], %%xmm4 \n"
+            "1: \n"
+            TRIANGULAR
+            ADD_NOISE
+            LCG_NEXT("xmm0", "xmm3")
+            LCG_NEXT("xmm4", "xmm3")
+            "add           $16, %[i] \n"
+            "jl 1b \n"
+            : [i]"+&r"(i)
+            : [dst]"r"(dst + len), [s0]"m"(*state[0]), [s1]"m"(*state[1]),
+              [mul]"m"(*mul), [add]"m"(*add),
+              [scale]"m"(*scale), [sign]"m"(*pd_sign), [norm]"m"(*ps_norm)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+              "memory"
+        );
+        break;
+    case SWR_DITHER_TRIANGULAR_HIGHPASS:
+        /* xmm6 keeps the previous triangular values, the filter being
+         * (2 * t[n+1] - t[n]) - t[n+2] as in the C code */
+        hist[0] = hist[1] = 0;
+        hist[2] = c->hist[ch][0];
+        hist[3] = c->hist[ch][1];
+        __asm__ volatile(
+            "movdqa      %[s0], %%xmm0 \n"
+            "movdqa      %[s1], %%xmm4 \n"
+            "movaps    %[hist], %%xmm6 \n"
+            "1: \n"
+            TRIANGULAR
+            "movaps         %%xmm6, %%xmm2 \n"
+            "shufps $0x4E,  %%xmm1, %%xmm2 \n" // t[n..n+3]
+            "movaps         %%xmm6, %%xmm5 \n"
+            "shufps $0x0F,  %%xmm1, %%xmm5 \n"
+            "shufps $0x98,  %%xmm1, %%xmm5 \n" // t[n+1..n+4]
+            "movaps         %%xmm1, %%xmm6 \n" // t[n+2..n+5]
+            "addps          %%xmm5, %%xmm5 \n"
+            "subps          %%xmm2, %%xmm5 \n"
+            "subps          %%xmm1, %%xmm5 \n"
+            "movaps         %%xmm5, %%xmm1 \n"
+            ADD_NOISE
+            LCG_NEXT("xmm0", "xmm3")
+            LCG_NEXT("xmm4", "xmm3")
+            "add           $16, %[i] \n"
+            "jl 1b \n"
+            "movaps  %%xmm6, %[hist] \n"
+            : [i]"+&r"(i), [hist]"+m"(*hist)
+            : [dst]"r"(dst + len), [s0]"m"(*state[0]), [s1]"m"(*state[1]),
+              [mul]"m"(*mul), [add]"m"(*add),
+              [scale]"m"(*scale), [sign]"m"(*pd_sign), [norm]"m"(*ps_norm)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6",)
+              "memory"
+        );
+        c->hist[ch][0] = hist[2];
+        c->hist[ch][1] = hist[3];
+        break;
+    default:
+        av_assert0(0);
+    }
+
+    lcg_skip((uint64_t)len * rand_per_sample, mul, add);
+    c->seed[ch] = c->seed[ch] * mul[0] + add[0];
+}
+
+#endif /* HAVE_INLINE_ASM && HAVE_SSE */
+
+av_cold void swri_dither_init_mmx(SwrContext *s)
+{
+#if HAVE_INLINE_ASM && HAVE_SSE
+    DitherContext *c = &s->dither;
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2 &&
+        (c->method == SWR_DITHER_RECTANGULAR ||
+         c->method == SWR_DITHER_TRIANGULAR  ||
+         c->method == SWR_DITHER_TRIANGULAR_HIGHPASS))
+        c->noise_flt = noise_flt_sse2;
+#endif
+}
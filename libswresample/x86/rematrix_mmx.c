@@ -0,0 +1,538 @@
+/*
+ * This file is part of libswresample
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Inline asm rematrixing, giving the same output as the C code.
+ * The s16 kernels use pmaddwd on pairs of input channels and thus need all
+ * the coefficients to fit in a signed word, the integer sums and the
+ * truncation to 16 bits are then exactly those of the C code.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/audioconvert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libswresample/swresample_internal.h"
+
+#if HAVE_INLINE_ASM && HAVE_SSE
+
+/**
+ * One (float) or two (s16) input channels of the generic mixing loop.
+ * The pointers are stored in 64 bits so that the layout, which the asm
+ * depends on, is the same on x86_32 and x86_64.
+ */
+typedef struct MixEntry {
+    union {
+        float   f[4];                   ///< coefficient, splatted
+        int32_t w[4];                   ///< pair of coefficients as words, splatted
+    } c;
+    union {
+        const uint8_t *p;
+        uint64_t align;
+    } in[2];
+} MixEntry;
+
+DECLARE_ALIGNED(16, static const int32_t, pd_16384)[4] = { 16384, 16384, 16384, 16384 };
+
+static void splat(float *dst, float c)
+{
+    dst[0] = dst[1] = dst[2] = dst[3] = c;
+}
+
+static void splat_pair(int32_t *dst, int c0, int c1)
+{
+    dst[0] = dst[1] = dst[2] = dst[3] = (c0 & 0xFFFF) | (int32_t)((unsigned)c1 << 16);
+}
+
+/* (a, b) word pairs of the 8 samples at i, multiplied by the coefficient
+ * pair c, in lo and hi; clobbers xmm7 */
+#define PAIR_S16(a, b, c, lo, hi)                                            \
+        "movdqu   (%["a"],%[i]), %%"lo" \n"                                  \
+        "movdqu   (%["b"],%[i]), %%xmm7 \n"                                  \
+        "movdqa         %%"lo", %%"hi" \n"                                   \
+        "punpcklwd     %%xmm7, %%"lo" \n"                                    \
+        "punpckhwd     %%xmm7, %%"hi" \n"                                    \
+        "pmaddwd       %["c"], %%"lo" \n"                                    \
+        "pmaddwd       %["c"], %%"hi" \n"
+
+/* >> 15 and truncation to 16 bits, as the C code does, into lo */
+#define PACK_S16(lo, hi)                                                     \
+        "psrad            $15, %%"lo" \n"                                    \
+        "psrad            $15, %%"hi" \n"                                    \
+        "pslld            $16, %%"lo" \n"                                    \
+        "pslld            $16, %%"hi" \n"                                    \
+        "psrad            $16, %%"lo" \n"                                    \
+        "psrad            $16, %%"hi" \n"                                    \
+        "packssdw      %%"hi", %%"lo" \n"
+
+static void scale_float_sse(float *out, const float *in, float coeff, int len)
+{
+    DECLARE_ALIGNED(16, float, c)[4];
+    x86_reg i = -4 * (x86_reg)len;
+
+    splat(c, coeff);
+    __asm__ volatile(
+        "movaps            %[c], %%xmm2 \n"
+        "1: \n"
+        "movups   (%[in],%[i]), %%xmm0 \n"
+        "movups 16(%[in],%[i]), %%xmm1 \n"
+        "mulps           %%xmm2, %%xmm0 \n"
+        "mulps           %%xmm2, %%xmm1 \n"
+        "movups  %%xmm0,   (%[out],%[i]) \n"
+        "movups  %%xmm1, 16(%[out],%[i]) \n"
+        "add                $32, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in]"r"(in + len), [out]"r"(out + len), [c]"m"(*c)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+          "memory"
+    );
+}
+
+static void sum2_float_sse(float *out, const float *in0, const float *in1,
+                           float coeff0, float coeff1, int len)
+{
+    DECLARE_ALIGNED(16, float, c)[2][4];
+    x86_reg i = -4 * (x86_reg)len;
+
+    splat(c[0], coeff0);
+    splat(c[1], coeff1);
+    __asm__ volatile(
+        "movaps           %[c0], %%xmm4 \n"
+        "movaps           %[c1], %%xmm5 \n"
+        "1: \n"
+        "movups   (%[in0],%[i]), %%xmm0 \n"
+        "movups 16(%[in0],%[i]), %%xmm1 \n"
+        "movups   (%[in1],%[i]), %%xmm2 \n"
+        "movups 16(%[in1],%[i]), %%xmm3 \n"
+        "mulps           %%xmm4, %%xmm0 \n"
+        "mulps           %%xmm4, %%xmm1 \n"
+        "mulps           %%xmm5, %%xmm2 \n"
+        "mulps           %%xmm5, %%xmm3 \n"
+        "addps           %%xmm2, %%xmm0 \n"
+        "addps           %%xmm3, %%xmm1 \n"
+        "movups  %%xmm0,   (%[out],%[i]) \n"
+        "movups  %%xmm1, 16(%[out],%[i]) \n"
+        "add                $32, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in0 + len), [in1]"r"(in1 + len), [out]"r"(out + len),
+          [c0]"m"(*c[0]), [c1]"m"(*c[1])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5",)
+          "memory"
+    );
+}
+
+static void sum2_s16_sse2(int16_t *out, const int16_t *in0, const int16_t *in1,
+                          int coeff0, int coeff1, int len)
+{
+    DECLARE_ALIGNED(16, int32_t, c)[4];
+    x86_reg i = -2 * (x86_reg)len;
+
+    splat_pair(c, coeff0, coeff1);
+    __asm__ volatile(
+        "1: \n"
+        PAIR_S16("in0", "in1", "c", "xmm0", "xmm1")
+        "paddd           %[rnd], %%xmm0 \n"
+        "paddd           %[rnd], %%xmm1 \n"
+        PACK_S16("xmm0", "xmm1")
+        "movdqu  %%xmm0, (%[out],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in0 + len), [in1]"r"(in1 + len), [out]"r"(out + len),
+          [c]"m"(*c), [rnd]"m"(*pd_16384)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm7",)
+          "memory"
+    );
+}
+
+static void mix_n_1_float_sse(void *out, uint8_t * const *in, const void *coeffs,
+                              const uint8_t *in_ch, int len)
+{
+    DECLARE_ALIGNED(16, MixEntry, e)[SWR_CH_MAX];
+    const float *coeff = coeffs;
+    int n = in_ch[0], j;
+    x86_reg i = -4 * (x86_reg)len, k, start = -(x86_reg)sizeof(*e) * n, p;
+
+    for (j = 0; j < n; j++) {
+        splat(e[j].c.f, coeff[in_ch[1 + j]]);
+        e[j].in[0].p = in[in_ch[1 + j]] + 4 * len;
+    }
+
+    __asm__ volatile(
+        "1: \n"
+        "mov         %[start], %[k] \n"
+        "xorps           %%xmm0, %%xmm0 \n"
+        "xorps           %%xmm1, %%xmm1 \n"
+        "2: \n"
+        "mov  16(%[e],%[k]), %[p] \n"
+        "movups   (%[p],%[i]), %%xmm2 \n"
+        "movups 16(%[p],%[i]), %%xmm3 \n"
+        "mulps     (%[e],%[k]), %%xmm2 \n"
+        "mulps     (%[e],%[k]), %%xmm3 \n"
+        "addps           %%xmm2, %%xmm0 \n"
+        "addps           %%xmm3, %%xmm1 \n"
+        "add                $32, %[k] \n"
+        "jl 2b \n"
+        "movups  %%xmm0,   (%[out],%[i]) \n"
+        "movups  %%xmm1, 16(%[out],%[i]) \n"
+        "add                $32, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i), [k]"=&r"(k), [p]"=&r"(p)
+        : [out]"r"((uint8_t *)out + 4 * len), [e]"r"(e + n), [start]"m"(start)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+          "memory"
+    );
+}
+
+static void mix_n_1_s16_sse2(void *out, uint8_t * const *in, const void *coeffs,
+                             const uint8_t *in_ch, int len)
+{
+    DECLARE_ALIGNED(16, MixEntry, e)[(SWR_CH_MAX + 1) / 2];
+    const int32_t *coeff = coeffs;
+    int n = in_ch[0], j;
+    x86_reg i = -2 * (x86_reg)len, k, start = -(x86_reg)sizeof(*e) * ((n + 1) >> 1), p;
+
+    for (j = 0; j < n; j += 2) {
+        int ch0 = in_ch[1 + j];
+        /* an odd channel is paired with itself and a zero coefficient */
+        int ch1 = j + 1 < n ? in_ch[2 + j] : ch0;
+        splat_pair(e[j >> 1].c.w, coeff[ch0], j + 1 < n ? coeff[ch1] : 0);
+        e[j >> 1].in[0].p = in[ch0] + 2 * len;
+        e[j >> 1].in[1].p = in[ch1] + 2 * len;
+    }
+
+    __asm__ volatile(
+        "1: \n"
+        "mov         %[start], %[k] \n"
+        "movdqa          %[rnd], %%xmm0 \n"
+        "movdqa          %%xmm0, %%xmm1 \n"
+        "2: \n"
+        "mov  16(%[e],%[k]), %[p] \n"
+        "movdqu   (%[p],%[i]), %%xmm2 \n"
+        "mov  24(%[e],%[k]), %[p] \n"
+        "movdqu   (%[p],%[i]), %%xmm4 \n"
+        "movdqa          %%xmm2, %%xmm3 \n"
+        "punpcklwd       %%xmm4, %%xmm2 \n"
+        "punpckhwd       %%xmm4, %%xmm3 \n"
+        "pmaddwd   (%[e],%[k]), %%xmm2 \n"
+        "pmaddwd   (%[e],%[k]), %%xmm3 \n"
+        "paddd           %%xmm2, %%xmm0 \n"
+        "paddd           %%xmm3, %%xmm1 \n"
+        "add                $32, %[k] \n"
+        "jl 2b \n"
+        PACK_S16("xmm0", "xmm1")
+        "movdqu  %%xmm0, (%[out],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i), [k]"=&r"(k), [p]"=&r"(p)
+        : [out]"r"((uint8_t *)out + 2 * len), [e]"r"(e + ((n + 1) >> 1)),
+          [start]"m"(start), [rnd]"m"(*pd_16384)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",)
+          "memory"
+    );
+}
+
+static void mix2to1_float_sse(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    const float *c = coeffp;
+
+    sum2_float_sse((float *)out[0], (const float *)in[0], (const float *)in[1],
+                   c[0], c[1], len);
+}
+
+static void mix2to1_s16_sse2(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    const int *c = coeffp;
+
+    sum2_s16_sse2((int16_t *)out[0], (const int16_t *)in[0], (const int16_t *)in[1],
+                  c[0], c[1], len);
+}
+
+static void mix8to6_float_sse(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    const float *c = coeffp;
+    int ch;
+
+    for (ch = 0; ch < 4; ch++)
+        scale_float_sse((float *)out[ch], (const float *)in[ch], c[ch * 8 + ch], len);
+    sum2_float_sse((float *)out[4], (const float *)in[4], (const float *)in[6],
+                   c[4 * 8 + 4], c[4 * 8 + 6], len);
+    sum2_float_sse((float *)out[5], (const float *)in[5], (const float *)in[7],
+                   c[5 * 8 + 5], c[5 * 8 + 7], len);
+}
+
+static void mix8to6_s16_sse2(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    const int *c = coeffp;
+    int ch;
+
+    for (ch = 0; ch < 4; ch++)
+        sum2_s16_sse2((int16_t *)out[ch], (const int16_t *)in[ch], (const int16_t *)in[ch],
+                      c[ch * 8 + ch], 0, len);
+    sum2_s16_sse2((int16_t *)out[4], (const int16_t *)in[4], (const int16_t *)in[6],
+                  c[4 * 8 + 4], c[4 * 8 + 6], len);
+    sum2_s16_sse2((int16_t *)out[5], (const int16_t *)in[5], (const int16_t *)in[7],
+                  c[5 * 8 + 5], c[5 * 8 + 7], len);
+}
+
+#if ARCH_X86_64
+/* the 5.1 and 7.1 to stereo downmixes read all the input channels in a
+ * single pass and share the center and LFE part between both outputs */
+
+static void mix6to2_float_sse(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    DECLARE_ALIGNED(16, float, c)[6][4];
+    const float *m = coeffp;
+    x86_reg i = -4 * (x86_reg)len;
+
+    splat(c[0], m[0*6+0]);
+    splat(c[1], m[0*6+2]);
+    splat(c[2], m[0*6+3]);
+    splat(c[3], m[0*6+4]);
+    splat(c[4], m[1*6+1]);
+    splat(c[5], m[1*6+5]);
+    __asm__ volatile(
+        "1: \n"
+        "movups   (%[in2],%[i]), %%xmm0 \n"
+        "movups   (%[in3],%[i]), %%xmm1 \n"
+        "mulps           %[c02], %%xmm0 \n"
+        "mulps           %[c03], %%xmm1 \n"
+        "addps           %%xmm1, %%xmm0 \n"
+        "movups   (%[in0],%[i]), %%xmm1 \n"
+        "movups   (%[in4],%[i]), %%xmm2 \n"
+        "mulps           %[c00], %%xmm1 \n"
+        "mulps           %[c04], %%xmm2 \n"
+        "addps           %%xmm0, %%xmm1 \n"
+        "addps           %%xmm2, %%xmm1 \n"
+        "movups  %%xmm1, (%[out0],%[i]) \n"
+        "movups   (%[in1],%[i]), %%xmm1 \n"
+        "movups   (%[in5],%[i]), %%xmm2 \n"
+        "mulps           %[c11], %%xmm1 \n"
+        "mulps           %[c15], %%xmm2 \n"
+        "addps           %%xmm0, %%xmm1 \n"
+        "addps           %%xmm2, %%xmm1 \n"
+        "movups  %%xmm1, (%[out1],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in[0] + 4 * len), [in1]"r"(in[1] + 4 * len),
+          [in2]"r"(in[2] + 4 * len), [in3]"r"(in[3] + 4 * len),
+          [in4]"r"(in[4] + 4 * len), [in5]"r"(in[5] + 4 * len),
+          [out0]"r"(out[0] + 4 * len), [out1]"r"(out[1] + 4 * len),
+          [c00]"m"(*c[0]), [c02]"m"(*c[1]), [c03]"m"(*c[2]),
+          [c04]"m"(*c[3]), [c11]"m"(*c[4]), [c15]"m"(*c[5])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+          "memory"
+    );
+}
+
+static void mix8to2_float_sse(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    DECLARE_ALIGNED(16, float, c)[8][4];
+    const float *m = coeffp;
+    x86_reg i = -4 * (x86_reg)len;
+
+    splat(c[0], m[0*8+0]);
+    splat(c[1], m[0*8+2]);
+    splat(c[2], m[0*8+3]);
+    splat(c[3], m[0*8+4]);
+    splat(c[4], m[0*8+6]);
+    splat(c[5], m[1*8+1]);
+    splat(c[6], m[1*8+5]);
+    splat(c[7], m[1*8+7]);
+    __asm__ volatile(
+        "1: \n"
+        "movups   (%[in2],%[i]), %%xmm0 \n"
+        "movups   (%[in3],%[i]), %%xmm1 \n"
+        "mulps           %[c02], %%xmm0 \n"
+        "mulps           %[c03], %%xmm1 \n"
+        "addps           %%xmm1, %%xmm0 \n"
+        "movups   (%[in0],%[i]), %%xmm1 \n"
+        "movups   (%[in4],%[i]), %%xmm2 \n"
+        "movups   (%[in6],%[i]), %%xmm3 \n"
+        "mulps           %[c00], %%xmm1 \n"
+        "mulps           %[c04], %%xmm2 \n"
+        "mulps           %[c06], %%xmm3 \n"
+        "addps           %%xmm0, %%xmm1 \n"
+        "addps           %%xmm2, %%xmm1 \n"
+        "addps           %%xmm3, %%xmm1 \n"
+        "movups  %%xmm1, (%[out0],%[i]) \n"
+        "movups   (%[in1],%[i]), %%xmm1 \n"
+        "movups   (%[in5],%[i]), %%xmm2 \n"
+        "movups   (%[in7],%[i]), %%xmm3 \n"
+        "mulps           %[c11], %%xmm1 \n"
+        "mulps           %[c15], %%xmm2 \n"
+        "mulps           %[c17], %%xmm3 \n"
+        "addps           %%xmm0, %%xmm1 \n"
+        "addps           %%xmm2, %%xmm1 \n"
+        "addps           %%xmm3, %%xmm1 \n"
+        "movups  %%xmm1, (%[out1],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in[0] + 4 * len), [in1]"r"(in[1] + 4 * len),
+          [in2]"r"(in[2] + 4 * len), [in3]"r"(in[3] + 4 * len),
+          [in4]"r"(in[4] + 4 * len), [in5]"r"(in[5] + 4 * len),
+          [in6]"r"(in[6] + 4 * len), [in7]"r"(in[7] + 4 * len),
+          [out0]"r"(out[0] + 4 * len), [out1]"r"(out[1] + 4 * len),
+          [c00]"m"(*c[0]), [c02]"m"(*c[1]), [c03]"m"(*c[2]), [c04]"m"(*c[3]),
+          [c06]"m"(*c[4]), [c11]"m"(*c[5]), [c15]"m"(*c[6]), [c17]"m"(*c[7])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+          "memory"
+    );
+}
+
+static void mix6to2_s16_sse2(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    DECLARE_ALIGNED(16, int32_t, c)[3][4];
+    const int *m = coeffp;
+    x86_reg i = -2 * (x86_reg)len;
+
+    splat_pair(c[0], m[0*6+2], m[0*6+3]);
+    splat_pair(c[1], m[0*6+0], m[0*6+4]);
+    splat_pair(c[2], m[1*6+1], m[1*6+5]);
+    __asm__ volatile(
+        "1: \n"
+        PAIR_S16("in2", "in3", "c23", "xmm0", "xmm1")
+        "paddd           %[rnd], %%xmm0 \n"
+        "paddd           %[rnd], %%xmm1 \n"
+        PAIR_S16("in0", "in4", "c04", "xmm2", "xmm3")
+        "paddd           %%xmm0, %%xmm2 \n"
+        "paddd           %%xmm1, %%xmm3 \n"
+        PACK_S16("xmm2", "xmm3")
+        "movdqu  %%xmm2, (%[out0],%[i]) \n"
+        PAIR_S16("in1", "in5", "c15", "xmm2", "xmm3")
+        "paddd           %%xmm0, %%xmm2 \n"
+        "paddd           %%xmm1, %%xmm3 \n"
+        PACK_S16("xmm2", "xmm3")
+        "movdqu  %%xmm2, (%[out1],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in[0] + 2 * len), [in1]"r"(in[1] + 2 * len),
+          [in2]"r"(in[2] + 2 * len), [in3]"r"(in[3] + 2 * len),
+          [in4]"r"(in[4] + 2 * len), [in5]"r"(in[5] + 2 * len),
+          [out0]"r"(out[0] + 2 * len), [out1]"r"(out[1] + 2 * len),
+          [c23]"m"(*c[0]), [c04]"m"(*c[1]), [c15]"m"(*c[2]), [rnd]"m"(*pd_16384)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7",)
+          "memory"
+    );
+}
+
+static void mix8to2_s16_sse2(uint8_t **out, const uint8_t **in, void *coeffp, int len)
+{
+    DECLARE_ALIGNED(16, int32_t, c)[5][4];
+    const int *m = coeffp;
+    x86_reg i = -2 * (x86_reg)len;
+
+    splat_pair(c[0], m[0*8+2], m[0*8+3]);
+    splat_pair(c[1], m[0*8+0], m[0*8+4]);
+    splat_pair(c[2], m[1*8+1], m[1*8+5]);
+    splat_pair(c[3], m[0*8+6], 0);
+    splat_pair(c[4], 0, m[1*8+7]);
+    __asm__ volatile(
+        "1: \n"
+        PAIR_S16("in2", "in3", "c23", "xmm0", "xmm1")
+        "paddd           %[rnd], %%xmm0 \n"
+        "paddd           %[rnd], %%xmm1 \n"
+        PAIR_S16("in6", "in7", "c6", "xmm4", "xmm5")
+        PAIR_S16("in0", "in4", "c04", "xmm2", "xmm3")
+        "paddd           %%xmm0, %%xmm2 \n"
+        "paddd           %%xmm1, %%xmm3 \n"
+        "paddd           %%xmm4, %%xmm2 \n"
+        "paddd           %%xmm5, %%xmm3 \n"
+        PACK_S16("xmm2", "xmm3")
+        "movdqu  %%xmm2, (%[out0],%[i]) \n"
+        PAIR_S16("in6", "in7", "c7", "xmm4", "xmm5")
+        PAIR_S16("in1", "in5", "c15", "xmm2", "xmm3")
+        "paddd           %%xmm0, %%xmm2 \n"
+        "paddd           %%xmm1, %%xmm3 \n"
+        "paddd           %%xmm4, %%xmm2 \n"
+        "paddd           %%xmm5, %%xmm3 \n"
+        PACK_S16("xmm2", "xmm3")
+        "movdqu  %%xmm2, (%[out1],%[i]) \n"
+        "add                $16, %[i] \n"
+        "jl 1b \n"
+        : [i]"+&r"(i)
+        : [in0]"r"(in[0] + 2 * len), [in1]"r"(in[1] + 2 * len),
+          [in2]"r"(in[2] + 2 * len), [in3]"r"(in[3] + 2 * len),
+          [in4]"r"(in[4] + 2 * len), [in5]"r"(in[5] + 2 * len),
+          [in6]"r"(in[6] + 2 * len), [in7]"r"(in[7] + 2 * len),
+          [out0]"r"(out[0] + 2 * len), [out1]"r"(out[1] + 2 * len),
+          [c23]"m"(*c[0]), [c04]"m"(*c[1]), [c15]"m"(*c[2]),
+          [c6]"m"(*c[3]), [c7]"m"(*c[4]), [rnd]"m"(*pd_16384)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7",)
+          "memory"
+    );
+}
+#endif /* ARCH_X86_64 */
+
+#endif /* HAVE_INLINE_ASM && HAVE_SSE */
+
+/**
+ * Pick the optimized version of the mix_any_f shape chosen by
+ * swri_rematrix_init(), which is identified by the layouts.
+ */
+av_cold void swri_rematrix_init_mmx(SwrContext *s)
+{
+#if HAVE_INLINE_ASM && HAVE_SSE
+    int mm_flags = av_get_cpu_flags();
+    int nb_in    = av_get_channel_layout_nb_channels(s->in_ch_layout);
+    int nb_out   = av_get_channel_layout_nb_channels(s->out_ch_layout);
+    int i, j;
+
+    if (s->midbuf.fmt == AV_SAMPLE_FMT_FLTP && mm_flags & AV_CPU_FLAG_SSE) {
+        s->mix_n_1_simd = mix_n_1_float_sse;
+        if (s->mix_any_f) {
+            if (s->in_ch_layout == AV_CH_LAYOUT_STEREO)
+                s->mix_any_simd = mix2to1_float_sse;
+            else if (s->out_ch_layout == AV_CH_LAYOUT_5POINT1)
+                s->mix_any_simd = mix8to6_float_sse;
+#if ARCH_X86_64
+            else if (s->in_ch_layout == AV_CH_LAYOUT_7POINT1)
+                s->mix_any_simd = mix8to2_float_sse;
+            else
+                s->mix_any_simd = mix6to2_float_sse;
+#endif
+        }
+    } else if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P && mm_flags & AV_CPU_FLAG_SSE2) {
+        for (i = 0; i < nb_out; i++)
+            for (j = 0; j < nb_in; j++)
+                if (s->matrix32[i][j] < INT16_MIN || s->matrix32[i][j] > INT16_MAX)
+                    return;
+
+        s->mix_n_1_simd = mix_n_1_s16_sse2;
+        if (s->mix_any_f) {
+            if (s->in_ch_layout == AV_CH_LAYOUT_STEREO)
+                s->mix_any_simd = mix2to1_s16_sse2;
+            else if (s->out_ch_layout == AV_CH_LAYOUT_5POINT1)
+                s->mix_any_simd = mix8to6_s16_sse2;
+#if ARCH_X86_64
+            else if (s->in_ch_layout == AV_CH_LAYOUT_7POINT1)
+                s->mix_any_simd = mix8to2_s16_sse2;
+            else
+                s->mix_any_simd = mix6to2_s16_sse2;
+#endif
+        }
+    }
+#endif /* HAVE_INLINE_ASM && HAVE_SSE */
+}
@@ -24,6 +24,11 @@
 
 int swri_resample_int16_mmx2 (struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
 int swri_resample_int16_ssse3(struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_int32_sse4(struct ResampleContext *c, int32_t *dst, const int32_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_sse  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_avx  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_sse2(struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_avx (struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
 
 DECLARE_ALIGNED(16, const uint64_t, ff_resample_int16_rounder)[2]    = { 0x0000000000004000ULL, 0x0000000000000000ULL};
 
@@ -68,3 +73,374 @@ __asm__ volatile(\
       "r" (((uint8_t*)filter)-len),\
       "r" (dst+dst_index)\
 );
+
+/* The cores below run the SIMD loop over the filter length rounded down
+ * to the vector size and do the remaining taps in C, so neither the source
+ * nor the filter is read past filter_length. LINEAR_CORE computes the two
+ * neighbouring phases, val and v2, for linear interpolation. */
+
+#define HSUM_PS(x, t) \
+    "movhlps   %%"x", %%"t"       \n\t"\
+    "addps     %%"t", %%"x"       \n\t"\
+    "movss     %%"x", %%"t"       \n\t"\
+    "shufps $1, %%"x", %%"x"      \n\t"\
+    "addss     %%"t", %%"x"       \n\t"
+
+#define HSUM_PD(x, t) \
+    "movapd    %%"x", %%"t"       \n\t"\
+    "unpckhpd  %%"t", %%"t"       \n\t"\
+    "addsd     %%"t", %%"x"       \n\t"
+
+#define HSUM_Q(x, t) \
+    "pshufd $0x4E, %%"x", %%"t"   \n\t"\
+    "paddq     %%"t", %%"x"       \n\t"
+
+#define VHSUM_PS(x, y, t) \
+    "vextractf128 $1, %%"y", %%"t"      \n\t"\
+    "vaddps    %%"t", %%"x", %%"x"      \n\t"\
+    "vmovhlps  %%"x", %%"x", %%"t"      \n\t"\
+    "vaddps    %%"t", %%"x", %%"x"      \n\t"\
+    "vshufps $1, %%"x", %%"x", %%"t"    \n\t"\
+    "vaddss    %%"t", %%"x", %%"x"      \n\t"
+
+#define VHSUM_PD(x, y, t) \
+    "vextractf128 $1, %%"y", %%"t"      \n\t"\
+    "vaddpd    %%"t", %%"x", %%"x"      \n\t"\
+    "vunpckhpd %%"x", %%"x", %%"t"      \n\t"\
+    "vaddsd    %%"t", %%"x", %%"x"      \n\t"
+
+#define CORE_TAIL(n) \
+    for(i=c->filter_length & ~(n-1); i<c->filter_length; i++)\
+        val += src[sample_index + i] * (FELEM2)filter[i];
+
+#define LINEAR_TAIL(n) \
+    for(i=c->filter_length & ~(n-1); i<c->filter_length; i++){\
+        val += src[sample_index + i] * (FELEM2)filter[i];\
+        v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_alloc];\
+    }
+
+#define COMMON_CORE_FLT_SSE \
+    x86_reg len= -4*(c->filter_length & ~3);\
+    float val;\
+__asm__ volatile(\
+    "xorps     %%xmm0, %%xmm0     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movups  (%2, %0), %%xmm1     \n\t"\
+    "mulps   (%3, %0), %%xmm1     \n\t"\
+    "addps     %%xmm1, %%xmm0     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_PS("xmm0", "xmm1")\
+    "2:                           \n\t"\
+    "movss     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    CORE_TAIL(4)\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_FLT_SSE \
+    x86_reg len= -4*(c->filter_length & ~3);\
+    float v2;\
+__asm__ volatile(\
+    "xorps     %%xmm0, %%xmm0     \n\t"\
+    "xorps     %%xmm2, %%xmm2     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movups  (%3, %0), %%xmm1     \n\t"\
+    "movaps    %%xmm1, %%xmm3     \n\t"\
+    "mulps   (%4, %0), %%xmm1     \n\t"\
+    "mulps   (%5, %0), %%xmm3     \n\t"\
+    "addps     %%xmm1, %%xmm0     \n\t"\
+    "addps     %%xmm3, %%xmm2     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_PS("xmm0", "xmm1")\
+    HSUM_PS("xmm2", "xmm3")\
+    "2:                           \n\t"\
+    "movss     %%xmm0, %1         \n\t"\
+    "movss     %%xmm2, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    LINEAR_TAIL(4)
+
+#define COMMON_CORE_FLT_AVX \
+    x86_reg len= -4*(c->filter_length & ~7);\
+    float val;\
+__asm__ volatile(\
+    "vxorps    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "test      %0, %0                     \n\t"\
+    " jz 2f                               \n\t"\
+    "1:                                   \n\t"\
+    "vmovups (%2, %0), %%ymm1             \n\t"\
+    "vmulps  (%3, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddps    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "add       $32, %0                    \n\t"\
+    " js 1b                               \n\t"\
+    VHSUM_PS("xmm0", "ymm0", "xmm1")\
+    "2:                                   \n\t"\
+    "vmovss    %%xmm0, %1                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    CORE_TAIL(8)\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_FLT_AVX \
+    x86_reg len= -4*(c->filter_length & ~7);\
+    float v2;\
+__asm__ volatile(\
+    "vxorps    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "vxorps    %%ymm2, %%ymm2, %%ymm2     \n\t"\
+    "test      %0, %0                     \n\t"\
+    " jz 2f                               \n\t"\
+    "1:                                   \n\t"\
+    "vmovups (%3, %0), %%ymm1             \n\t"\
+    "vmulps  (%5, %0), %%ymm1, %%ymm3     \n\t"\
+    "vmulps  (%4, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddps    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "vaddps    %%ymm3, %%ymm2, %%ymm2     \n\t"\
+    "add       $32, %0                    \n\t"\
+    " js 1b                               \n\t"\
+    VHSUM_PS("xmm0", "ymm0", "xmm1")\
+    VHSUM_PS("xmm2", "ymm2", "xmm3")\
+    "2:                                   \n\t"\
+    "vmovss    %%xmm0, %1                 \n\t"\
+    "vmovss    %%xmm2, %2                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    LINEAR_TAIL(8)
+
+#define COMMON_CORE_DBL_SSE2 \
+    x86_reg len= -8*(c->filter_length & ~1);\
+    double val;\
+__asm__ volatile(\
+    "xorpd     %%xmm0, %%xmm0     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movupd  (%2, %0), %%xmm1     \n\t"\
+    "mulpd   (%3, %0), %%xmm1     \n\t"\
+    "addpd     %%xmm1, %%xmm0     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_PD("xmm0", "xmm1")\
+    "2:                           \n\t"\
+    "movsd     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    CORE_TAIL(2)\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_DBL_SSE2 \
+    x86_reg len= -8*(c->filter_length & ~1);\
+    double v2;\
+__asm__ volatile(\
+    "xorpd     %%xmm0, %%xmm0     \n\t"\
+    "xorpd     %%xmm2, %%xmm2     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movupd  (%3, %0), %%xmm1     \n\t"\
+    "movapd    %%xmm1, %%xmm3     \n\t"\
+    "mulpd   (%4, %0), %%xmm1     \n\t"\
+    "mulpd   (%5, %0), %%xmm3     \n\t"\
+    "addpd     %%xmm1, %%xmm0     \n\t"\
+    "addpd     %%xmm3, %%xmm2     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_PD("xmm0", "xmm1")\
+    HSUM_PD("xmm2", "xmm3")\
+    "2:                           \n\t"\
+    "movsd     %%xmm0, %1         \n\t"\
+    "movsd     %%xmm2, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    LINEAR_TAIL(2)
+
+#define COMMON_CORE_DBL_AVX \
+    x86_reg len= -8*(c->filter_length & ~3);\
+    double val;\
+__asm__ volatile(\
+    "vxorpd    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "test      %0, %0                     \n\t"\
+    " jz 2f                               \n\t"\
+    "1:                                   \n\t"\
+    "vmovupd (%2, %0), %%ymm1             \n\t"\
+    "vmulpd  (%3, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddpd    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "add       $32, %0                    \n\t"\
+    " js 1b                               \n\t"\
+    VHSUM_PD("xmm0", "ymm0", "xmm1")\
+    "2:                                   \n\t"\
+    "vmovsd    %%xmm0, %1                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    CORE_TAIL(4)\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_DBL_AVX \
+    x86_reg len= -8*(c->filter_length & ~3);\
+    double v2;\
+__asm__ volatile(\
+    "vxorpd    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "vxorpd    %%ymm2, %%ymm2, %%ymm2     \n\t"\
+    "test      %0, %0                     \n\t"\
+    " jz 2f                               \n\t"\
+    "1:                                   \n\t"\
+    "vmovupd (%3, %0), %%ymm1             \n\t"\
+    "vmulpd  (%5, %0), %%ymm1, %%ymm3     \n\t"\
+    "vmulpd  (%4, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddpd    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "vaddpd    %%ymm3, %%ymm2, %%ymm2     \n\t"\
+    "add       $32, %0                    \n\t"\
+    " js 1b                               \n\t"\
+    VHSUM_PD("xmm0", "ymm0", "xmm1")\
+    VHSUM_PD("xmm2", "ymm2", "xmm3")\
+    "2:                                   \n\t"\
+    "vmovsd    %%xmm0, %1                 \n\t"\
+    "vmovsd    %%xmm2, %2                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    LINEAR_TAIL(4)
+
+#define LINEAR_CORE_INT16_SSE2 \
+    x86_reg len= -2*(c->filter_length & ~7);\
+    int32_t v2;\
+__asm__ volatile(\
+    "pxor      %%xmm0, %%xmm0     \n\t"\
+    "pxor      %%xmm2, %%xmm2     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movdqu  (%3, %0), %%xmm1     \n\t"\
+    "movdqa    %%xmm1, %%xmm3     \n\t"\
+    "pmaddwd (%4, %0), %%xmm1     \n\t"\
+    "pmaddwd (%5, %0), %%xmm3     \n\t"\
+    "paddd     %%xmm1, %%xmm0     \n\t"\
+    "paddd     %%xmm3, %%xmm2     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    "pshufd $0x4E, %%xmm0, %%xmm1 \n\t"\
+    "pshufd $0x4E, %%xmm2, %%xmm3 \n\t"\
+    "paddd     %%xmm1, %%xmm0     \n\t"\
+    "paddd     %%xmm3, %%xmm2     \n\t"\
+    "pshufd $0x01, %%xmm0, %%xmm1 \n\t"\
+    "pshufd $0x01, %%xmm2, %%xmm3 \n\t"\
+    "paddd     %%xmm1, %%xmm0     \n\t"\
+    "paddd     %%xmm3, %%xmm2     \n\t"\
+    "2:                           \n\t"\
+    "movd      %%xmm0, %1         \n\t"\
+    "movd      %%xmm2, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    LINEAR_TAIL(8)
+
+/* pmuldq gives the exact 64-bit products of the even dwords, the odd ones
+ * are moved down first, so the result is identical to the C code */
+#define COMMON_CORE_INT32_SSE4 \
+    x86_reg len= -4*(c->filter_length & ~3);\
+    int64_t val;\
+__asm__ volatile(\
+    "pxor      %%xmm0, %%xmm0     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movdqu  (%2, %0), %%xmm1     \n\t"\
+    "movdqu  (%3, %0), %%xmm2     \n\t"\
+    "pshufd $0x31, %%xmm1, %%xmm3 \n\t"\
+    "pshufd $0x31, %%xmm2, %%xmm4 \n\t"\
+    "pmuldq    %%xmm2, %%xmm1     \n\t"\
+    "pmuldq    %%xmm4, %%xmm3     \n\t"\
+    "paddq     %%xmm1, %%xmm0     \n\t"\
+    "paddq     %%xmm3, %%xmm0     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_Q("xmm0", "xmm1")\
+    "2:                           \n\t"\
+    "movq      %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4")\
+);\
+    CORE_TAIL(4)\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_INT32_SSE4 \
+    x86_reg len= -4*(c->filter_length & ~3);\
+    int64_t v2;\
+__asm__ volatile(\
+    "pxor      %%xmm0, %%xmm0     \n\t"\
+    "pxor      %%xmm5, %%xmm5     \n\t"\
+    "test      %0, %0             \n\t"\
+    " jz 2f                       \n\t"\
+    "1:                           \n\t"\
+    "movdqu  (%3, %0), %%xmm1     \n\t"\
+    "pshufd $0x31, %%xmm1, %%xmm3 \n\t"\
+    "movdqa    %%xmm1, %%xmm6     \n\t"\
+    "movdqa    %%xmm3, %%xmm7     \n\t"\
+    "movdqu  (%4, %0), %%xmm2     \n\t"\
+    "pshufd $0x31, %%xmm2, %%xmm4 \n\t"\
+    "pmuldq    %%xmm2, %%xmm1     \n\t"\
+    "pmuldq    %%xmm4, %%xmm3     \n\t"\
+    "paddq     %%xmm1, %%xmm0     \n\t"\
+    "paddq     %%xmm3, %%xmm0     \n\t"\
+    "movdqu  (%5, %0), %%xmm2     \n\t"\
+    "pshufd $0x31, %%xmm2, %%xmm4 \n\t"\
+    "pmuldq    %%xmm2, %%xmm6     \n\t"\
+    "pmuldq    %%xmm4, %%xmm7     \n\t"\
+    "paddq     %%xmm6, %%xmm5     \n\t"\
+    "paddq     %%xmm7, %%xmm5     \n\t"\
+    "add       $16, %0            \n\t"\
+    " js 1b                       \n\t"\
+    HSUM_Q("xmm0", "xmm1")\
+    HSUM_Q("xmm5", "xmm1")\
+    "2:                           \n\t"\
+    "movq      %%xmm0, %1         \n\t"\
+    "movq      %%xmm5, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",\
+                      "%xmm5", "%xmm6", "%xmm7")\
+);\
+    LINEAR_TAIL(4)
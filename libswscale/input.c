@@ -566,6 +566,88 @@ static void uyvyToUV_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *unused0, con
     av_assert1(src1 == src2);
 }
 
+/* v210 is read a whole group of 6 pixels at a time, the conversion buffers
+ * are large enough for the extra samples of the last group. */
+static void v210ToY_c(uint8_t *_dst, const uint8_t *src, const uint8_t *unused1,
+                      const uint8_t *unused2, int width, uint32_t *unused)
+{
+    int i;
+    uint16_t *dst = (uint16_t *)_dst;
+    for (i = 0; i < width; i += 6, src += 16) {
+        unsigned w1 = AV_RL32(src + 4), w3 = AV_RL32(src + 12);
+        dst[i    ] = AV_RL32(src    ) >> 10 & 0x3FF;
+        dst[i + 1] = w1               & 0x3FF;
+        dst[i + 2] = w1         >> 20 & 0x3FF;
+        dst[i + 3] = AV_RL32(src + 8) >> 10 & 0x3FF;
+        dst[i + 4] = w3               & 0x3FF;
+        dst[i + 5] = w3         >> 20 & 0x3FF;
+    }
+}
+
+static void v210ToUV_c(uint8_t *_dstU, uint8_t *_dstV, const uint8_t *unused0,
+                       const uint8_t *src1, const uint8_t *src2, int width,
+                       uint32_t *unused)
+{
+    int i;
+    uint16_t *dstU = (uint16_t *)_dstU, *dstV = (uint16_t *)_dstV;
+    for (i = 0; i < width; i += 3, src1 += 16) {
+        unsigned w0 = AV_RL32(src1),     w1 = AV_RL32(src1 + 4),
+                 w2 = AV_RL32(src1 + 8), w3 = AV_RL32(src1 + 12);
+        dstU[i    ] = w0       & 0x3FF;
+        dstV[i    ] = w0 >> 20 & 0x3FF;
+        dstU[i + 1] = w1 >> 10 & 0x3FF;
+        dstV[i + 1] = w2       & 0x3FF;
+        dstU[i + 2] = w2 >> 20 & 0x3FF;
+        dstV[i + 2] = w3 >> 10 & 0x3FF;
+    }
+    av_assert1(src1 == src2);
+}
+
+static void v410ToY_c(uint8_t *_dst, const uint8_t *src, const uint8_t *unused1,
+                      const uint8_t *unused2, int width, uint32_t *unused)
+{
+    int i;
+    uint16_t *dst = (uint16_t *)_dst;
+    for (i = 0; i < width; i++)
+        dst[i] = AV_RL32(src + 4 * i) >> 12 & 0x3FF;
+}
+
+static void v410ToUV_c(uint8_t *_dstU, uint8_t *_dstV, const uint8_t *unused0,
+                       const uint8_t *src1, const uint8_t *src2, int width,
+                       uint32_t *unused)
+{
+    int i;
+    uint16_t *dstU = (uint16_t *)_dstU, *dstV = (uint16_t *)_dstV;
+    for (i = 0; i < width; i++) {
+        unsigned w = AV_RL32(src1 + 4 * i);
+        dstU[i] = w >>  2 & 0x3FF;
+        dstV[i] = w >> 22;
+    }
+    av_assert1(src1 == src2);
+}
+
+static void y216ToY_c(uint8_t *_dst, const uint8_t *src, const uint8_t *unused1,
+                      const uint8_t *unused2, int width, uint32_t *unused)
+{
+    int i;
+    uint16_t *dst = (uint16_t *)_dst;
+    for (i = 0; i < width; i++)
+        dst[i] = AV_RL16(src + 4 * i);
+}
+
+static void y216ToUV_c(uint8_t *_dstU, uint8_t *_dstV, const uint8_t *unused0,
+                       const uint8_t *src1, const uint8_t *src2, int width,
+                       uint32_t *unused)
+{
+    int i;
+    uint16_t *dstU = (uint16_t *)_dstU, *dstV = (uint16_t *)_dstV;
+    for (i = 0; i < width; i++) {
+        dstU[i] = AV_RL16(src1 + 8 * i + 2);
+        dstV[i] = AV_RL16(src1 + 8 * i + 6);
+    }
+    av_assert1(src1 == src2);
+}
+
 static av_always_inline void nvXXtoUV_c(uint8_t *dst1, uint8_t *dst2,
                                         const uint8_t *src, int width)
 {
@@ -874,6 +956,15 @@ av_cold void ff_sws_init_input_funcs(SwsContext *c)
     case PIX_FMT_UYVY422:
         c->chrToYV12 = uyvyToUV_c;
         break;
+    case PIX_FMT_V210:
+        c->chrToYV12 = v210ToUV_c;
+        break;
+    case PIX_FMT_V410:
+        c->chrToYV12 = v410ToUV_c;
+        break;
+    case PIX_FMT_Y216:
+        c->chrToYV12 = y216ToUV_c;
+        break;
     case PIX_FMT_NV12:
         c->chrToYV12 = nv12ToUV_c;
         break;
@@ -1195,6 +1286,15 @@ av_cold void ff_sws_init_input_funcs(SwsContext *c)
     case PIX_FMT_UYVY422:
         c->lumToYV12 = uyvyToY_c;
         break;
+    case PIX_FMT_V210:
+        c->lumToYV12 = v210ToY_c;
+        break;
+    case PIX_FMT_V410:
+        c->lumToYV12 = v410ToY_c;
+        break;
+    case PIX_FMT_Y216:
+        c->lumToYV12 = y216ToY_c;
+        break;
     case PIX_FMT_BGR24:
         c->lumToYV12 = bgr24ToY_c;
         break;
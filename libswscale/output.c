@@ -599,6 +599,65 @@ yuv2422_1_c_template(SwsContext *c, const int16_t *buf0,
 YUV2PACKEDWRAPPER(yuv2, 422, yuyv422, PIX_FMT_YUYV422)
 YUV2PACKEDWRAPPER(yuv2, 422, uyvy422, PIX_FMT_UYVY422)
 
+/* 15 bit intermediate, 12 bit filter, 10 bit output */
+#define filter_10(val, src, filter, filterSize, pos) \
+    val = 1 << 16; \
+    for (j = 0; j < filterSize; j++) \
+        val += src[j][pos] * filter[j]; \
+    val = av_clip_uintp2(val >> 17, 10)
+
+/* The last group of 6 pixels is completed with zeros, as is the padding of
+ * the line to a multiple of 48 pixels. */
+static void
+yuv2v210_X_c(SwsContext *c, const int16_t *lumFilter,
+             const int16_t **lumSrc, int lumFilterSize,
+             const int16_t *chrFilter, const int16_t **chrUSrc,
+             const int16_t **chrVSrc, int chrFilterSize,
+             const int16_t **alpSrc, uint8_t *dest, int dstW, int y)
+{
+    int i, j, k;
+
+    for (i = 0; i < dstW; i += 6, dest += 16) {
+        int Y[6] = { 0 }, U[3] = { 0 }, V[3] = { 0 };
+
+        for (k = 0; k < 6 && i + k < dstW; k++) {
+            filter_10(Y[k], lumSrc, lumFilter, lumFilterSize, i + k);
+        }
+        for (k = 0; k < 3 && i + 2 * k < dstW; k++) {
+            filter_10(U[k], chrUSrc, chrFilter, chrFilterSize, i / 2 + k);
+            filter_10(V[k], chrVSrc, chrFilter, chrFilterSize, i / 2 + k);
+        }
+
+        AV_WL32(dest,      U[0] | Y[0] << 10 | V[0] << 20);
+        AV_WL32(dest +  4, Y[1] | U[1] << 10 | Y[2] << 20);
+        AV_WL32(dest +  8, V[1] | Y[3] << 10 | U[2] << 20);
+        AV_WL32(dest + 12, Y[4] | V[2] << 10 | Y[5] << 20);
+    }
+    memset(dest, 0, (dstW + 47) / 48 * 128 - (dstW + 5) / 6 * 16);
+}
+
+static void
+yuv2v410_X_c(SwsContext *c, const int16_t *lumFilter,
+             const int16_t **lumSrc, int lumFilterSize,
+             const int16_t *chrFilter, const int16_t **chrUSrc,
+             const int16_t **chrVSrc, int chrFilterSize,
+             const int16_t **alpSrc, uint8_t *dest, int dstW, int y)
+{
+    int i, j;
+
+    for (i = 0; i < dstW; i++) {
+        int Y, U, V;
+
+        filter_10(Y, lumSrc,  lumFilter, lumFilterSize, i);
+        filter_10(U, chrUSrc, chrFilter, chrFilterSize, i);
+        filter_10(V, chrVSrc, chrFilter, chrFilterSize, i);
+
+        AV_WL32(dest + 4 * i, U << 2 | Y << 12 | (unsigned)V << 22);
+    }
+}
+
+#undef filter_10
+
 #define R_B ((target == PIX_FMT_RGB48LE || target == PIX_FMT_RGB48BE) ? R : B)
 #define B_R ((target == PIX_FMT_RGB48LE || target == PIX_FMT_RGB48BE) ? B : R)
 #define output_pixel(pos, val) \
@@ -831,6 +890,43 @@ YUV2PACKED16WRAPPER(yuv2, rgb48, rgb48le, PIX_FMT_RGB48LE)
 YUV2PACKED16WRAPPER(yuv2, rgb48, bgr48be, PIX_FMT_BGR48BE)
 YUV2PACKED16WRAPPER(yuv2, rgb48, bgr48le, PIX_FMT_BGR48LE)
 
+static void
+yuv2y216_X_c(SwsContext *c, const int16_t *lumFilter,
+             const int16_t **_lumSrc, int lumFilterSize,
+             const int16_t *chrFilter, const int16_t **_chrUSrc,
+             const int16_t **_chrVSrc, int chrFilterSize,
+             const int16_t **_alpSrc, uint8_t *dest, int dstW, int y)
+{
+    const int32_t **lumSrc  = (const int32_t **) _lumSrc,
+                  **chrUSrc = (const int32_t **) _chrUSrc,
+                  **chrVSrc = (const int32_t **) _chrVSrc;
+    int i;
+
+    for (i = 0; i < ((dstW + 1) >> 1); i++) {
+        int j;
+        /* 19 bit intermediate, 12 bit filter, see yuv2planeX_16_c_template()
+         * for the offset keeping the sums in the signed range */
+        int Y1 = (1 << 14) - 0x40000000;
+        int Y2 = (1 << 14) - 0x40000000;
+        int U  = (1 << 14) - 0x40000000;
+        int V  = (1 << 14) - 0x40000000;
+
+        for (j = 0; j < lumFilterSize; j++) {
+            Y1 += lumSrc[j][i * 2]     * lumFilter[j];
+            Y2 += lumSrc[j][i * 2 + 1] * lumFilter[j];
+        }
+        for (j = 0; j < chrFilterSize; j++) {
+            U += chrUSrc[j][i] * chrFilter[j];
+            V += chrVSrc[j][i] * chrFilter[j];
+        }
+
+        AV_WL16(dest + 8 * i,     0x8000 + av_clip_int16(Y1 >> 15));
+        AV_WL16(dest + 8 * i + 2, 0x8000 + av_clip_int16(U  >> 15));
+        AV_WL16(dest + 8 * i + 4, 0x8000 + av_clip_int16(Y2 >> 15));
+        AV_WL16(dest + 8 * i + 6, 0x8000 + av_clip_int16(V  >> 15));
+    }
+}
+
 /*
  * Write out 2 RGB pixels in the target pixel format. This function takes a
  * R/G/B LUT as generated by ff_yuv2rgb_c_init_tables(), which takes care of
@@ -1496,5 +1592,14 @@ av_cold void ff_sws_init_output_funcs(SwsContext *c,
         *yuv2packed2 = yuv2uyvy422_2_c;
         *yuv2packedX = yuv2uyvy422_X_c;
         break;
+    case PIX_FMT_V210:
+        *yuv2packedX = yuv2v210_X_c;
+        break;
+    case PIX_FMT_V410:
+        *yuv2packedX = yuv2v410_X_c;
+        break;
+    case PIX_FMT_Y216:
+        *yuv2packedX = yuv2y216_X_c;
+        break;
     }
 }
@@ -27,6 +27,7 @@
 
 #include "libavutil/attributes.h"
 #include "libavutil/bswap.h"
+#include "libavutil/intreadwrite.h"
 #include "config.h"
 #include "rgb2rgb.h"
 #include "swscale.h"
@@ -82,6 +83,13 @@ void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
 void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                         int width, int height, int src1Stride,
                         int src2Stride, int dstStride);
+void (*bswap16plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                     int srcStride, int dstStride);
+void (*shift16plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                     int srcStride, int dstStride, int lshift, int rshift);
+void (*dither16to8plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                         int srcStride, int dstStride,
+                         const uint8_t (*dither)[8], int scale, int shift);
 void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                     uint8_t *dst1, uint8_t *dst2,
                     int width, int height,
@@ -134,6 +134,27 @@ extern void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t
                                int width, int height, int src1Stride,
                                int src2Stride, int dstStride);
 
+/**
+ * Byte swap width 16-bit samples per line.
+ */
+extern void (*bswap16plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                            int srcStride, int dstStride);
+
+/**
+ * dst = src << lshift | src >> rshift on width native endian 16-bit samples
+ * per line, rshift can be 16 to only shift up.
+ */
+extern void (*shift16plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                            int srcStride, int dstStride, int lshift, int rshift);
+
+/**
+ * dst = (src + dither) * scale >> shift from width native endian 16-bit
+ * samples per line to 8 bits, dither[line & 7][x & 7] being added.
+ */
+extern void (*dither16to8plane)(const uint8_t *src, uint8_t *dst, int width, int height,
+                                int srcStride, int dstStride,
+                                const uint8_t (*dither)[8], int scale, int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
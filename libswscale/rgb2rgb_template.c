@@ -688,6 +688,70 @@ static void interleaveBytes_c(const uint8_t *src1, const uint8_t *src2,
     }
 }
 
+static void bswap16plane_c(const uint8_t *src, uint8_t *dst, int width,
+                           int height, int srcStride, int dstStride)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d       = (uint16_t *)dst;
+        int w;
+        for (w = 0; w < width; w++)
+            d[w] = av_bswap16(s[w]);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+static void shift16plane_c(const uint8_t *src, uint8_t *dst, int width,
+                           int height, int srcStride, int dstStride,
+                           int lshift, int rshift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d       = (uint16_t *)dst;
+        int w = 0;
+        if (rshift >= 16) {
+            /* the samples use at most 16 - lshift bits, they can be
+             * shifted together */
+#if HAVE_FAST_64BIT
+            for (; w < width - 3; w += 4)
+                AV_WN64A(d + w, AV_RN64A(s + w) << lshift);
+#else
+            for (; w < width - 1; w += 2)
+                AV_WN32A(d + w, AV_RN32A(s + w) << lshift);
+#endif
+        }
+        for (; w < width; w++) {
+            unsigned v = s[w];
+            d[w] = v << lshift | v >> rshift;
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+static void dither16to8plane_c(const uint8_t *src, uint8_t *dst, int width,
+                               int height, int srcStride, int dstStride,
+                               const uint8_t (*dither)[8], int scale,
+                               int shift)
+{
+    int h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        const uint8_t *d  = dither[h & 7];
+        int w;
+        for (w = 0; w < width; w++)
+            dst[w] = (unsigned)(s[w] + d[w & 7]) * scale >> shift;
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
 static inline void vu9_to_vu12_c(const uint8_t *src1, const uint8_t *src2,
                                  uint8_t *dst1, uint8_t *dst2,
                                  int width, int height,
@@ -917,6 +981,9 @@ static inline void rgb2rgb_init_c(void)
     planar2x           = planar2x_c;
     rgb24toyv12        = rgb24toyv12_c;
     interleaveBytes    = interleaveBytes_c;
+    bswap16plane       = bswap16plane_c;
+    shift16plane       = shift16plane_c;
+    dither16to8plane   = dither16to8plane_c;
     vu9_to_vu12        = vu9_to_vu12_c;
     yvu9_to_yuy2       = yvu9_to_yuy2_c;
 
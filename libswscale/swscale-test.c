@@ -31,6 +31,9 @@
 #include "libavutil/crc.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/lfg.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/time.h"
 #include "swscale.h"
 
 /* HACK Duplicated from swscale_internal.h.
@@ -332,6 +335,329 @@ static int fileTest(uint8_t *ref[4], int refStride[4], int w, int h, FILE *fp,
     return 0;
 }
 
+// time the scaling of a srcW x srcH image to 2/3 and 3/2 of its size
+static int benchTest(uint8_t *ref[4], int refStride[4], int w, int h,
+                     enum PixelFormat srcFormat, enum PixelFormat dstFormat,
+                     int srcW, int srcH)
+{
+    const int flags[] = { SWS_BILINEAR, SWS_BICUBIC, SWS_LANCZOS, 0 };
+    const int dstW[]  = { srcW * 2 / 3, srcW * 3 / 2, 0 };
+    const int dstH[]  = { srcH * 2 / 3, srcH * 3 / 2, 0 };
+    const int runs    = 10;
+    uint8_t *src[4], *dst[4];
+    int srcStride[4], dstStride[4];
+    struct SwsContext *sws;
+    int i, j, k;
+
+    if (srcFormat == PIX_FMT_NONE)
+        srcFormat = PIX_FMT_YUV420P10;
+    if (dstFormat == PIX_FMT_NONE)
+        dstFormat = srcFormat;
+
+    if (av_image_alloc(src, srcStride, srcW, srcH, srcFormat, 16) < 0)
+        return -1;
+    sws = sws_getContext(w, h, PIX_FMT_YUVA420P, srcW, srcH, srcFormat,
+                         SWS_BILINEAR, NULL, NULL, NULL);
+    if (!sws) {
+        fprintf(stderr, "Failed to get %s ---> %s\n",
+                av_pix_fmt_descriptors[PIX_FMT_YUVA420P].name,
+                av_pix_fmt_descriptors[srcFormat].name);
+        av_freep(&src[0]);
+        return -1;
+    }
+    sws_scale(sws, (const uint8_t * const *)ref, refStride, 0, h,
+              src, srcStride);
+    sws_freeContext(sws);
+
+    for (k = 0; flags[k]; k++) {
+        for (i = 0; dstW[i]; i++) {
+            int64_t t;
+
+            sws = sws_getContext(srcW, srcH, srcFormat, dstW[i], dstH[i],
+                                 dstFormat, flags[k], NULL, NULL, NULL);
+            if (!sws ||
+                av_image_alloc(dst, dstStride, dstW[i], dstH[i],
+                               dstFormat, 16) < 0) {
+                fprintf(stderr, "Failed to get %s ---> %s\n",
+                        av_pix_fmt_descriptors[srcFormat].name,
+                        av_pix_fmt_descriptors[dstFormat].name);
+                sws_freeContext(sws);
+                av_freep(&src[0]);
+                return -1;
+            }
+
+            // the first run initializes the caches and the buffers
+            sws_scale(sws, (const uint8_t * const *)src, srcStride, 0, srcH,
+                      dst, dstStride);
+            t = av_gettime();
+            for (j = 0; j < runs; j++)
+                sws_scale(sws, (const uint8_t * const *)src, srcStride, 0,
+                          srcH, dst, dstStride);
+            t = av_gettime() - t;
+
+            printf(" %s %dx%d -> %s %4dx%4d flags=%3d %8"PRId64" us/frame\n",
+                   av_pix_fmt_descriptors[srcFormat].name, srcW, srcH,
+                   av_pix_fmt_descriptors[dstFormat].name, dstW[i], dstH[i],
+                   flags[k], t / runs);
+            fflush(stdout);
+
+            sws_freeContext(sws);
+            av_freep(&dst[0]);
+        }
+    }
+
+    av_freep(&src[0]);
+    return 0;
+}
+
+static struct SwsContext *getThreadedContext(int srcW, int srcH,
+                                             enum PixelFormat srcFormat,
+                                             int dstW, int dstH,
+                                             enum PixelFormat dstFormat,
+                                             int flags, int threads)
+{
+    struct SwsContext *sws = sws_alloc_context();
+
+    if (!sws)
+        return NULL;
+    av_opt_set_int(sws, "srcw",       srcW,      0);
+    av_opt_set_int(sws, "srch",       srcH,      0);
+    av_opt_set_int(sws, "src_format", srcFormat, 0);
+    av_opt_set_int(sws, "dstw",       dstW,      0);
+    av_opt_set_int(sws, "dsth",       dstH,      0);
+    av_opt_set_int(sws, "dst_format", dstFormat, 0);
+    av_opt_set_int(sws, "sws_flags",  flags,     0);
+    av_opt_set_int(sws, "threads",    threads,   0);
+    sws_setColorspaceDetails(sws, sws_getCoefficients(SWS_CS_DEFAULT), 0,
+                             sws_getCoefficients(SWS_CS_DEFAULT), 0,
+                             0, 1 << 16, 1 << 16);
+    if (sws_init_context(sws, NULL, NULL) < 0) {
+        sws_freeContext(sws);
+        return NULL;
+    }
+    return sws;
+}
+
+struct Images {
+    int nb;
+    uint8_t *(*data)[4];
+    int (*linesize)[4];
+    uint8_t ***planes;       ///< the arguments of sws_scale_batch()
+    int **strides;
+};
+
+static int allocImages(struct Images *img, int nb, int w, int h,
+                       enum PixelFormat format, AVLFG *rand)
+{
+    int i, j, size;
+
+    img->nb       = 0;
+    img->data     = av_mallocz(nb * sizeof(*img->data));
+    img->linesize = av_mallocz(nb * sizeof(*img->linesize));
+    img->planes   = av_mallocz(nb * sizeof(*img->planes));
+    img->strides  = av_mallocz(nb * sizeof(*img->strides));
+    if (!img->data || !img->linesize || !img->planes || !img->strides)
+        return -1;
+    for (i = 0; i < nb; i++) {
+        if ((size = av_image_alloc(img->data[i], img->linesize[i], w, h,
+                                   format, 16)) < 0)
+            return -1;
+        img->planes[i]  = img->data[i];
+        img->strides[i] = img->linesize[i];
+        img->nb++;
+        if (rand)
+            for (j = 0; j < size; j++)
+                img->data[i][0][j] = av_lfg_get(rand);
+        else
+            memset(img->data[i][0], 0, size);
+    }
+    return 0;
+}
+
+static void freeImages(struct Images *img)
+{
+    int i;
+
+    for (i = 0; i < img->nb; i++)
+        av_freep(&img->data[i][0]);
+    av_freep(&img->data);
+    av_freep(&img->linesize);
+    av_freep(&img->planes);
+    av_freep(&img->strides);
+}
+
+static int scaleBatch(struct SwsContext *sws, int perImage, int srcH,
+                      struct Images *src, struct Images *dst)
+{
+    int i;
+
+    if (!perImage)
+        return sws_scale_batch(sws, src->nb,
+                               (const uint8_t * const * const *)src->planes,
+                               (const int * const *)src->strides,
+                               (uint8_t * const * const *)dst->planes,
+                               (const int * const *)dst->strides) == src->nb ? 0 : -1;
+    for (i = 0; i < src->nb; i++)
+        if (sws_scale(sws, (const uint8_t * const *)src->data[i],
+                      src->linesize[i], 0, srcH,
+                      dst->data[i], dst->linesize[i]) <= 0)
+            return -1;
+    return 0;
+}
+
+static int compareImages(struct Images *a, struct Images *b, int w, int h,
+                         enum PixelFormat format)
+{
+    const AVPixFmtDescriptor *desc = &av_pix_fmt_descriptors[format];
+    int i, p, y;
+
+    for (i = 0; i < a->nb; i++)
+        for (p = 0; p < 4 && a->data[i][p]; p++) {
+            int bytes = av_image_get_linesize(format, w, p);
+            int lines = p == 1 || p == 2 ? -((-h) >> desc->log2_chroma_h) : h;
+
+            if (desc->flags & (PIX_FMT_PAL | PIX_FMT_PSEUDOPAL) && p == 1)
+                bytes = 4 * 256, lines = 1;
+            for (y = 0; y < lines; y++)
+                if (memcmp(a->data[i][p] + y * a->linesize[i][p],
+                           b->data[i][p] + y * b->linesize[i][p], bytes))
+                    return -1;
+        }
+    return 0;
+}
+
+// check that sws_scale_batch() gives the output of one sws_scale() per image
+static int batchTest(int threads)
+{
+    static const struct {
+        enum PixelFormat srcFormat, dstFormat;
+        int srcW, srcH, dstW, dstH, flags;
+    } tests[] = {
+        { PIX_FMT_YUV420P,      PIX_FMT_YUV420P, 320, 180, 160,  90, SWS_BILINEAR },
+        { PIX_FMT_YUV420P,      PIX_FMT_RGB24,   176, 144, 160,  90, SWS_BICUBIC  },
+        { PIX_FMT_RGB0,         PIX_FMT_YUV420P,  64,  48, 160,  90, SWS_BILINEAR },
+        { PIX_FMT_YUV420P10LE,  PIX_FMT_YUV444P,  96,  54, 160,  90, SWS_LANCZOS  },
+        { PIX_FMT_RGB24,        PIX_FMT_BGR24,   160,  90, 160,  90, SWS_BICUBIC  },
+        { PIX_FMT_YUV422P,      PIX_FMT_YUYV422, 160,  90, 160,  90, SWS_BICUBIC  },
+        { PIX_FMT_YUV420P,      PIX_FMT_RGB8,    160,  90, 160,  90, SWS_BICUBIC  },
+    };
+    const int nb_images = 37;
+    int t, i, res = 0;
+    AVLFG rand;
+
+    av_lfg_init(&rand, 1);
+
+    for (t = 0; t < FF_ARRAY_ELEMS(tests) && !res; t++) {
+        struct Images src = { 0 }, dst[3] = { { 0 } };
+        struct SwsContext *sws[3] = { NULL };
+
+        for (i = 0; i < 3; i++)
+            sws[i] = getThreadedContext(tests[t].srcW, tests[t].srcH,
+                                        tests[t].srcFormat,
+                                        tests[t].dstW, tests[t].dstH,
+                                        tests[t].dstFormat, tests[t].flags,
+                                        i == 2 ? threads : 1);
+        if (!sws[0] || !sws[1] || !sws[2] ||
+            allocImages(&src, nb_images, tests[t].srcW, tests[t].srcH,
+                        tests[t].srcFormat, &rand) < 0)
+            res = -1;
+        for (i = 0; i < 3 && !res; i++)
+            if (allocImages(&dst[i], nb_images, tests[t].dstW, tests[t].dstH,
+                            tests[t].dstFormat, NULL) < 0 ||
+                scaleBatch(sws[i], !i, tests[t].srcH, &src, &dst[i]) < 0)
+                res = -1;
+        if (!res)
+            res = compareImages(&dst[0], &dst[1], tests[t].dstW, tests[t].dstH,
+                                tests[t].dstFormat) |
+                  compareImages(&dst[0], &dst[2], tests[t].dstW, tests[t].dstH,
+                                tests[t].dstFormat);
+
+        printf("%s %dx%d -> %s %dx%d flags=%d: %s\n",
+               av_pix_fmt_descriptors[tests[t].srcFormat].name,
+               tests[t].srcW, tests[t].srcH,
+               av_pix_fmt_descriptors[tests[t].dstFormat].name,
+               tests[t].dstW, tests[t].dstH, tests[t].flags,
+               res ? "FAILED" : "ok");
+
+        for (i = 0; i < 3; i++) {
+            sws_freeContext(sws[i]);
+            freeImages(&dst[i]);
+        }
+        freeImages(&src);
+    }
+
+    return res;
+}
+
+// time the scaling of many srcW x srcH images to 160x90 or to the same
+// size, one by one and in batches
+static int batchBench(int srcW, int srcH, int threads)
+{
+    static const struct {
+        enum PixelFormat srcFormat, dstFormat;
+        int scaled, flags;
+    } tests[] = {
+        { PIX_FMT_YUV420P, PIX_FMT_YUV420P, 1, SWS_BILINEAR },
+        { PIX_FMT_YUV420P, PIX_FMT_RGB32,   1, SWS_BICUBIC  },
+        { PIX_FMT_YUV422P, PIX_FMT_YUYV422, 0, SWS_BICUBIC  },
+    };
+    const int nb_images = 256;
+    const int runs      = 4;
+    int t, i, j;
+    AVLFG rand;
+
+    av_lfg_init(&rand, 1);
+
+    for (t = 0; t < FF_ARRAY_ELEMS(tests); t++) {
+        struct Images src = { 0 }, dst = { 0 };
+        int dstW = tests[t].scaled ? 160 : srcW;
+        int dstH = tests[t].scaled ?  90 : srcH;
+        int64_t time[3];
+
+        if (allocImages(&src, nb_images, srcW, srcH,
+                        tests[t].srcFormat, &rand) < 0 ||
+            allocImages(&dst, nb_images, dstW, dstH,
+                        tests[t].dstFormat, NULL) < 0) {
+            freeImages(&src);
+            freeImages(&dst);
+            return -1;
+        }
+
+        for (i = 0; i < 3; i++) {
+            struct SwsContext *sws =
+                getThreadedContext(srcW, srcH, tests[t].srcFormat,
+                                   dstW, dstH, tests[t].dstFormat,
+                                   tests[t].flags, i == 2 ? threads : 1);
+
+            // the first run initializes the caches, buffers and threads
+            if (!sws || scaleBatch(sws, !i, srcH, &src, &dst) < 0) {
+                sws_freeContext(sws);
+                freeImages(&src);
+                freeImages(&dst);
+                return -1;
+            }
+            time[i] = av_gettime();
+            for (j = 0; j < runs; j++)
+                scaleBatch(sws, !i, srcH, &src, &dst);
+            time[i] = av_gettime() - time[i];
+            sws_freeContext(sws);
+        }
+
+        printf(" %s %dx%d -> %s %dx%d flags=%d: sws_scale %6.2f, "
+               "batch %6.2f, batch with %d threads %6.2f us/image\n",
+               av_pix_fmt_descriptors[tests[t].srcFormat].name, srcW, srcH,
+               av_pix_fmt_descriptors[tests[t].dstFormat].name, dstW, dstH,
+               tests[t].flags, time[0] / (double)(runs * nb_images),
+               time[1] / (double)(runs * nb_images), threads,
+               time[2] / (double)(runs * nb_images));
+        fflush(stdout);
+
+        freeImages(&src);
+        freeImages(&dst);
+    }
+    return 0;
+}
+
 #define W 96
 #define H 96
 
@@ -345,6 +671,8 @@ int main(int argc, char **argv)
     uint8_t *data       = av_malloc(4 * W * H);
     uint8_t *src[4]     = { data, data + W * H, data + W * H * 2, data + W * H * 3 };
     int stride[4]       = { W, W, W, W };
+    int benchW = 0, benchH = 0;
+    int batchThreads = 0;
     int x, y;
     struct SwsContext *sws;
     AVLFG rand;
@@ -378,6 +706,17 @@ int main(int argc, char **argv)
             res = fileTest(src, stride, W, H, fp, srcFormat, dstFormat);
             fclose(fp);
             goto end;
+        } else if (!strcmp(argv[i], "-bench")) {
+            if (av_parse_video_size(&benchW, &benchH, argv[i + 1]) < 0) {
+                fprintf(stderr, "invalid size %s\n", argv[i + 1]);
+                goto error;
+            }
+        } else if (!strcmp(argv[i], "-batch")) {
+            batchThreads = atoi(argv[i + 1]);
+            if (batchThreads < 1 || batchThreads > 64) {
+                fprintf(stderr, "invalid number of threads %s\n", argv[i + 1]);
+                goto error;
+            }
         } else if (!strcmp(argv[i], "-src")) {
             srcFormat = av_get_pix_fmt(argv[i + 1]);
             if (srcFormat == PIX_FMT_NONE) {
@@ -397,6 +736,21 @@ bad_option:
         }
     }
 
+    if (batchThreads) {
+        if (batchTest(batchThreads) < 0)
+            goto error;
+        if (benchW && batchBench(benchW, benchH, batchThreads) < 0)
+            goto error;
+        goto end;
+    }
+
+    if (benchW) {
+        if (benchTest(src, stride, W, H, srcFormat, dstFormat,
+                      benchW, benchH) < 0)
+            goto error;
+        goto end;
+    }
+
     selfTest(src, stride, W, H, srcFormat, dstFormat);
 end:
     res = 0;
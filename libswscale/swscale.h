@@ -214,6 +214,28 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Scale a batch of whole images with the same geometry and formats as c,
+ * as nb_images calls of sws_scale() would. The images are spread over
+ * the threads set with the "threads" option, each thread scaling its
+ * images with its own copy of the context.
+ *
+ * This only adds threading over the images: every image still goes
+ * through sws_scale(), with its per call slice handling, so with a single
+ * thread a batch is no faster than a loop of sws_scale().
+ *
+ * @param c         the scaling context
+ * @param nb_images the number of images
+ * @param src       the plane pointers of each source image
+ * @param srcStride the strides of each source image
+ * @param dst       the plane pointers of each destination image
+ * @param dstStride the strides of each destination image
+ * @return          nb_images on success, a negative AVERROR code on error
+ */
+int sws_scale_batch(struct SwsContext *c, int nb_images,
+                    const uint8_t *const *const src[], const int *const srcStride[],
+                    uint8_t *const *const dst[], const int *const dstStride[]);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -253,6 +253,9 @@ typedef struct SwsContext {
     int vChrDrop;                 ///< Binary logarithm of extra vertical subsampling factor in source image chroma planes specified by user.
     int sliceDir;                 ///< Direction that slices are fed to the scaler (1 = top-to-bottom, -1 = bottom-to-top).
     double param[2];              ///< Input parameters for scaling algorithms that need them.
+    int nb_threads;               ///< Number of threads running the unscaled special converters and the batches.
+    struct SwsThreads *threads;   ///< Worker threads of the context, NULL if it runs in the calling thread.
+    int user_filters;             ///< Some filters were built from user vectors instead of coming from the filter cache.
 
     uint32_t pal_yuv[256];
     uint32_t pal_rgb[256];
@@ -307,6 +310,10 @@ typedef struct SwsContext {
     int hChrFilterSize;           ///< Horizontal filter size for chroma     pixels.
     int vLumFilterSize;           ///< Vertical   filter size for luma/alpha pixels.
     int vChrFilterSize;           ///< Vertical   filter size for chroma     pixels.
+    void *hLumFilterRef;          ///< Cache entry owning hLumFilter, hLumFilterPos and lumMmx2FilterCode, NULL if owned by the context.
+    void *hChrFilterRef;          ///< Cache entry owning hChrFilter, hChrFilterPos and chrMmx2FilterCode, NULL if owned by the context.
+    void *vLumFilterRef;          ///< Cache entry owning vLumFilter and vLumFilterPos, NULL if owned by the context.
+    void *vChrFilterRef;          ///< Cache entry owning vChrFilter and vChrFilterPos, NULL if owned by the context.
     //@}
 
     int lumMmx2FilterCodeSize;    ///< Runtime-generated MMX2 horizontal fast bilinear scaler code size for luma/alpha planes.
@@ -666,6 +673,9 @@ const char *sws_format_name(enum PixelFormat format);
            (x)==PIX_FMT_PAL8        \
         || (x)==PIX_FMT_YUYV422     \
         || (x)==PIX_FMT_UYVY422     \
+        || (x)==PIX_FMT_V210        \
+        || (x)==PIX_FMT_V410        \
+        || (x)==PIX_FMT_Y216        \
         || (x)==PIX_FMT_Y400A       \
         ||  isRGBinInt(x)           \
         ||  isBGRinInt(x)           \
@@ -707,6 +717,17 @@ extern const AVClass sws_context_class;
  */
 void ff_get_unscaled_swscale(SwsContext *c);
 
+/**
+ * Start the worker threads running the unscaled special converter in
+ * horizontal bands, if c->nb_threads asks for them and the converter
+ * supports it. Otherwise they are started by the first sws_scale_batch().
+ */
+int ff_sws_init_threads(SwsContext *c);
+
+void ff_sws_free_threads(SwsContext *c);
+
+void ff_sws_init_palette(SwsContext *c, const uint32_t *pal);
+
 void ff_swscale_get_unscaled_altivec(SwsContext *c);
 
 /**
@@ -31,6 +31,8 @@
 #include "libavutil/avutil.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/bswap.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/jobpool.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/avassert.h"
 
@@ -348,20 +350,10 @@ static int packed_16bpc_bswap(SwsContext *c, const uint8_t *src[],
                               int srcStride[], int srcSliceY, int srcSliceH,
                               uint8_t *dst[], int dstStride[])
 {
-    int i, j;
-    int srcstr = srcStride[0] >> 1;
-    int dststr = dstStride[0] >> 1;
-    uint16_t       *dstPtr =       (uint16_t *) dst[0];
-    const uint16_t *srcPtr = (const uint16_t *) src[0];
-    int min_stride         = FFMIN(srcstr, dststr);
-
-    for (i = 0; i < srcSliceH; i++) {
-        for (j = 0; j < min_stride; j++) {
-            dstPtr[j] = av_bswap16(srcPtr[j]);
-        }
-        srcPtr += srcstr;
-        dstPtr += dststr;
-    }
+    int min_stride = FFMIN(FFABS(srcStride[0]), FFABS(dstStride[0])) >> 1;
+
+    bswap16plane(src[0], dst[0] + dstStride[0] * srcSliceY, min_stride,
+                 srcSliceH, srcStride[0], dstStride[0]);
 
     return srcSliceH;
 }
@@ -734,10 +726,15 @@ static int packedCopyWrapper(SwsContext *c, const uint8_t *src[],
         uint8_t *dstPtr = dst[0] + dstStride[0] * srcSliceY;
         int length = 0;
 
-        /* universal length finder */
-        while (length + c->srcW <= FFABS(dstStride[0]) &&
-               length + c->srcW <= FFABS(srcStride[0]))
-            length += c->srcW;
+        if (c->srcFormat == PIX_FMT_V210) {
+            /* not a whole number of bytes per pixel */
+            length = av_image_get_linesize(PIX_FMT_V210, c->srcW, 0);
+        } else {
+            /* universal length finder */
+            while (length + c->srcW <= FFABS(dstStride[0]) &&
+                   length + c->srcW <= FFABS(srcStride[0]))
+                length += c->srcW;
+        }
         av_assert1(length != 0);
 
         for (i = 0; i < srcSliceH; i++) {
@@ -806,7 +803,11 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
 
                 if (dst_depth == 8) {
                     if(isBE(c->srcFormat) == HAVE_BIGENDIAN){
-                        DITHER_COPY(dstPtr, dstStride[plane], srcPtr2, srcStride[plane]/2, , )
+                        dither16to8plane(srcPtr, dstPtr, length, height,
+                                         srcStride[plane], dstStride[plane],
+                                         dithers[src_depth-9],
+                                         dither_scale[dst_depth-1][src_depth-1],
+                                         src_depth-dst_depth + dither_scale[src_depth-2][dst_depth-1]);
                     } else {
                         DITHER_COPY(dstPtr, dstStride[plane], srcPtr2, srcStride[plane]/2, av_bswap16, )
                     }
@@ -829,35 +830,15 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                         dstPtr2 += dstStride[plane]/2;
                         srcPtr  += srcStride[plane];
                     }
+                } else if (src_depth <= dst_depth &&
+                           isBE(c->srcFormat) == HAVE_BIGENDIAN &&
+                           isBE(c->dstFormat) == HAVE_BIGENDIAN) {
+                    shift16plane(srcPtr, dstPtr, length, height,
+                                 srcStride[plane], dstStride[plane],
+                                 dst_depth - src_depth,
+                                 shiftonly ? 16 : 2 * src_depth - dst_depth);
                 } else if (src_depth <= dst_depth) {
-                    int orig_length = length;
                     for (i = 0; i < height; i++) {
-                        if(isBE(c->srcFormat) == HAVE_BIGENDIAN &&
-                           isBE(c->dstFormat) == HAVE_BIGENDIAN &&
-                           shiftonly) {
-                             unsigned shift = dst_depth - src_depth;
-                             length = orig_length;
-#if HAVE_FAST_64BIT
-#define FAST_COPY_UP(shift) \
-    for (j = 0; j < length - 3; j += 4) { \
-        uint64_t v = AV_RN64A(srcPtr2 + j); \
-        AV_WN64A(dstPtr2 + j, v << shift); \
-    } \
-    length &= 3;
-#else
-#define FAST_COPY_UP(shift) \
-    for (j = 0; j < length - 1; j += 2) { \
-        uint32_t v = AV_RN32A(srcPtr2 + j); \
-        AV_WN32A(dstPtr2 + j, v << shift); \
-    } \
-    length &= 1;
-#endif
-                             switch (shift)
-                             {
-                             case 6: FAST_COPY_UP(6); break;
-                             case 7: FAST_COPY_UP(7); break;
-                             }
-                        }
 #define COPY_UP(r,w) \
     if(shiftonly){\
         for (j = 0; j < length; j++){ \
@@ -904,13 +885,8 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                 }
             } else if (is16BPS(c->srcFormat) && is16BPS(c->dstFormat) &&
                       isBE(c->srcFormat) != isBE(c->dstFormat)) {
-
-                for (i = 0; i < height; i++) {
-                    for (j = 0; j < length; j++)
-                        ((uint16_t *) dstPtr)[j] = av_bswap16(((const uint16_t *) srcPtr)[j]);
-                    srcPtr += srcStride[plane];
-                    dstPtr += dstStride[plane];
-                }
+                bswap16plane(srcPtr, dstPtr, length, height,
+                             srcStride[plane], dstStride[plane]);
             } else if (dstStride[plane] == srcStride[plane] &&
                        srcStride[plane] > 0 && srcStride[plane] == length) {
                 memcpy(dst[plane] + dstStride[plane] * y, src[plane],
@@ -1060,6 +1036,245 @@ void ff_get_unscaled_swscale(SwsContext *c)
         ff_swscale_get_unscaled_altivec(c);
 }
 
+/**
+ * Worker threads of a context. They run either one call of the unscaled
+ * converter as horizontal bands, one band per job, or the images of
+ * sws_scale_batch(), a chunk of images per job.
+ */
+typedef struct SwsThreads {
+    AVJobPool *pool;
+    int nb_started;     ///< number of worker threads, besides the calling one
+    int busy;           ///< the threads are running jobs
+    int bands;          ///< the unscaled converter can be run in bands
+
+    /* arguments of the current call */
+    SwsContext *c;
+    const uint8_t **src;
+    int *srcStride;
+    int srcSliceY, srcSliceH;
+    int band_h;
+    uint8_t **dst;
+    int *dstStride;
+
+    /* arguments of the current batch */
+    const uint8_t *const *const *batch_src;
+    const int *const *batch_srcStride;
+    uint8_t *const *const *batch_dst;
+    const int *const *batch_dstStride;
+    int nb_images;
+    int images_per_job;
+    SwsContext **ctx;   ///< contexts of the worker threads for the batches
+} SwsThreads;
+
+/**
+ * Converters which can run on parts of a slice concurrently: they only
+ * write the destination lines of their source lines, keep no state and
+ * give the same output whatever the slice boundaries.
+ * Not yvu9ToYv12Wrapper and bgr24ToYv12Wrapper, whose first and last
+ * lines are handled differently, nor the yuv2rgb converters, which keep
+ * per line state in the context.
+ */
+static int is_band_safe(SwsContext *c)
+{
+    SwsFunc f = c->swScale;
+
+    if (f == rgbToRgbWrapper)
+        return !IS_NOT_NE(c->srcFormatBpp, c->srcFormat); // uses formatConvBuffer
+
+    return f == planarToNv12Wrapper   || f == planarToYuy2Wrapper   ||
+           f == planarToUyvyWrapper   || f == yuv422pToYuy2Wrapper  ||
+           f == yuv422pToUyvyWrapper  || f == yuyvToYuv420Wrapper   ||
+           f == yuyvToYuv422Wrapper   || f == uyvyToYuv420Wrapper   ||
+           f == uyvyToYuv422Wrapper   || f == planarRgbToRgbWrapper ||
+           f == palToRgbWrapper       || f == packed_16bpc_bswap    ||
+           f == packedCopyWrapper     || f == planarCopyWrapper;
+}
+
+static int run_band(void *opaque, int job, int thread)
+{
+    SwsThreads *t = opaque;
+    SwsContext *c = t->c;
+    int y = job * t->band_h;
+    int h = FFMIN(t->band_h, t->srcSliceH - y);
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        int vsub = (i == 1 || i == 2) ? c->chrSrcVSubSample : 0;
+        src[i]       = t->src[i];
+        dst[i]       = t->dst[i];
+        srcStride[i] = t->srcStride[i];
+        dstStride[i] = t->dstStride[i];
+        // the palette is shared by all the lines
+        if (src[i] && !(i == 1 && usePal(c->srcFormat)))
+            src[i] += (y >> vsub) * srcStride[i];
+    }
+
+    return c->swScale(c, src, srcStride, t->srcSliceY + y, h, dst, dstStride);
+}
+
+/**
+ * Run nb_jobs jobs on the worker threads and the calling thread, which is
+ * thread 0. The arguments of the jobs must have been set in t.
+ *
+ * @return the sum of the values returned by the jobs
+ */
+static int execute(SwsThreads *t, AVJobFunc run_job, int nb_jobs)
+{
+    int ret;
+
+    t->busy = 1;
+    ret = avpriv_jobpool_execute(t->pool, run_job, t, nb_jobs);
+    t->busy = 0;
+    return ret;
+}
+
+static int start_threads(SwsContext *c)
+{
+    SwsThreads *t;
+
+    t = c->threads = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+    if (!(t->pool = avpriv_jobpool_alloc(c->nb_threads, c))) {
+        av_freep(&c->threads);
+        return AVERROR(ENOMEM);
+    }
+    t->nb_started = avpriv_jobpool_nb_threads(t->pool) - 1;
+    t->bands      = c->swScale && is_band_safe(c);
+    return 0;
+}
+
+av_cold int ff_sws_init_threads(SwsContext *c)
+{
+    ff_sws_free_threads(c);
+
+    // the threads for the batches are started by the first batch
+    if (c->nb_threads <= 1 || !is_band_safe(c))
+        return 0;
+
+    return start_threads(c);
+}
+
+av_cold void ff_sws_free_threads(SwsContext *c)
+{
+    SwsThreads *t = c->threads;
+
+    if (!t)
+        return;
+    avpriv_jobpool_free(&t->pool);
+    if (t->ctx) {
+        int i;
+        for (i = 0; i < t->nb_started; i++)
+            sws_freeContext(t->ctx[i]);
+        av_freep(&t->ctx);
+    }
+    av_freep(&c->threads);
+}
+
+/**
+ * Run c->swScale, split in bands among the threads of the context if
+ * there are some. The bands start at multiples of 8 chroma lines so that
+ * the ordered dither of the converters is the same as in a single call.
+ */
+static int unscaled_convert(SwsContext *c, const uint8_t *src[],
+                            int srcStride[], int srcSliceY, int srcSliceH,
+                            uint8_t *dst[], int dstStride[])
+{
+    SwsThreads *t = c->threads;
+    int align = 8 << FFMAX(c->chrSrcVSubSample, c->chrDstVSubSample);
+
+    // not from within a batch, whose images already keep the threads busy
+    if (t && t->nb_started && t->bands && !t->busy &&
+        srcSliceH >= 2 * align) {
+        int nb_jobs = FFMIN(t->nb_started + 1, srcSliceH / align);
+        int band_h  = FFALIGN((srcSliceH + nb_jobs - 1) / nb_jobs, align);
+
+        t->c         = c;
+        t->src       = src;
+        t->srcStride = srcStride;
+        t->srcSliceY = srcSliceY;
+        t->srcSliceH = srcSliceH;
+        t->band_h    = band_h;
+        t->dst       = dst;
+        t->dstStride = dstStride;
+        return execute(t, run_band, (srcSliceH + band_h - 1) / band_h);
+    }
+    return c->swScale(c, src, srcStride, srcSliceY, srcSliceH, dst, dstStride);
+}
+
+/**
+ * Compute the palettes used by the input and unscaled converters, from pal
+ * for PAL8 or from the fixed palette of the other formats using one.
+ */
+void ff_sws_init_palette(SwsContext *c, const uint32_t *pal)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int p, r, g, b, y, u, v, a = 0xff;
+        if (c->srcFormat == PIX_FMT_PAL8) {
+            p = pal[i];
+            a = (p >> 24) & 0xFF;
+            r = (p >> 16) & 0xFF;
+            g = (p >>  8) & 0xFF;
+            b =  p        & 0xFF;
+        } else if (c->srcFormat == PIX_FMT_RGB8) {
+            r = ( i >> 5     ) * 36;
+            g = ((i >> 2) & 7) * 36;
+            b = ( i       & 3) * 85;
+        } else if (c->srcFormat == PIX_FMT_BGR8) {
+            b = ( i >> 6     ) * 85;
+            g = ((i >> 3) & 7) * 36;
+            r = ( i       & 7) * 36;
+        } else if (c->srcFormat == PIX_FMT_RGB4_BYTE) {
+            r = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            b = ( i       & 1) * 255;
+        } else if (c->srcFormat == PIX_FMT_GRAY8 || c->srcFormat == PIX_FMT_GRAY8A) {
+            r = g = b = i;
+        } else {
+            av_assert1(c->srcFormat == PIX_FMT_BGR4_BYTE);
+            b = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            r = ( i       & 1) * 255;
+        }
+        y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        c->pal_yuv[i]= y + (u<<8) + (v<<16) + (a<<24);
+
+        switch (c->dstFormat) {
+        case PIX_FMT_BGR32:
+#if !HAVE_BIGENDIAN
+        case PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]=  r + (g<<8) + (b<<16) + (a<<24);
+            break;
+        case PIX_FMT_BGR32_1:
+#if HAVE_BIGENDIAN
+        case PIX_FMT_BGR24:
+#endif
+            c->pal_rgb[i]= a + (r<<8) + (g<<16) + (b<<24);
+            break;
+        case PIX_FMT_RGB32_1:
+#if HAVE_BIGENDIAN
+        case PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]= a + (b<<8) + (g<<16) + (r<<24);
+            break;
+        case PIX_FMT_RGB32:
+#if !HAVE_BIGENDIAN
+        case PIX_FMT_BGR24:
+#endif
+        default:
+            c->pal_rgb[i]=  b + (g<<8) + (r<<16) + (a<<24);
+        }
+    }
+}
+
 static void reset_ptr(const uint8_t *src[], int format)
 {
     if (!isALPHA(format))
@@ -1097,7 +1312,7 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
                                   int srcSliceH, uint8_t *const dst[],
                                   const int dstStride[])
 {
-    int i, ret;
+    int ret;
     const uint8_t *src2[4] = { srcSlice[0], srcSlice[1], srcSlice[2], srcSlice[3] };
     uint8_t *dst2[4] = { dst[0], dst[1], dst[2], dst[3] };
     uint8_t *rgb0_tmp = NULL;
@@ -1123,68 +1338,9 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY == 0) c->sliceDir = 1; else c->sliceDir = -1;
     }
 
-    if (usePal(c->srcFormat)) {
-        for (i = 0; i < 256; i++) {
-            int p, r, g, b, y, u, v, a = 0xff;
-            if (c->srcFormat == PIX_FMT_PAL8) {
-                p = ((const uint32_t *)(srcSlice[1]))[i];
-                a = (p >> 24) & 0xFF;
-                r = (p >> 16) & 0xFF;
-                g = (p >>  8) & 0xFF;
-                b =  p        & 0xFF;
-            } else if (c->srcFormat == PIX_FMT_RGB8) {
-                r = ( i >> 5     ) * 36;
-                g = ((i >> 2) & 7) * 36;
-                b = ( i       & 3) * 85;
-            } else if (c->srcFormat == PIX_FMT_BGR8) {
-                b = ( i >> 6     ) * 85;
-                g = ((i >> 3) & 7) * 36;
-                r = ( i       & 7) * 36;
-            } else if (c->srcFormat == PIX_FMT_RGB4_BYTE) {
-                r = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                b = ( i       & 1) * 255;
-            } else if (c->srcFormat == PIX_FMT_GRAY8 || c->srcFormat == PIX_FMT_GRAY8A) {
-                r = g = b = i;
-            } else {
-                av_assert1(c->srcFormat == PIX_FMT_BGR4_BYTE);
-                b = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                r = ( i       & 1) * 255;
-            }
-            y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            c->pal_yuv[i]= y + (u<<8) + (v<<16) + (a<<24);
-
-            switch (c->dstFormat) {
-            case PIX_FMT_BGR32:
-#if !HAVE_BIGENDIAN
-            case PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]=  r + (g<<8) + (b<<16) + (a<<24);
-                break;
-            case PIX_FMT_BGR32_1:
-#if HAVE_BIGENDIAN
-            case PIX_FMT_BGR24:
-#endif
-                c->pal_rgb[i]= a + (r<<8) + (g<<16) + (b<<24);
-                break;
-            case PIX_FMT_RGB32_1:
-#if HAVE_BIGENDIAN
-            case PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]= a + (b<<8) + (g<<16) + (r<<24);
-                break;
-            case PIX_FMT_RGB32:
-#if !HAVE_BIGENDIAN
-            case PIX_FMT_BGR24:
-#endif
-            default:
-                c->pal_rgb[i]=  b + (g<<8) + (r<<16) + (a<<24);
-            }
-        }
-    }
+    // the fixed palettes of the other formats are set by sws_init_context()
+    if (c->srcFormat == PIX_FMT_PAL8)
+        ff_sws_init_palette(c, (const uint32_t *)srcSlice[1]);
 
     if (c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)) {
         uint8_t *base;
@@ -1215,8 +1371,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
-        ret = c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
-                          dstStride2);
+        ret = unscaled_convert(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
+                               dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
         int srcStride2[4] = { -srcStride[0], -srcStride[1], -srcStride[2],
@@ -1241,14 +1397,131 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (!srcSliceY)
             c->sliceDir = 0;
 
-        ret = c->swScale(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH,
-                          srcSliceH, dst2, dstStride2);
+        ret = unscaled_convert(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH,
+                               srcSliceH, dst2, dstStride2);
     }
 
     av_free(rgb0_tmp);
     return ret;
 }
 
+/**
+ * Create a context scaling like c, for a worker thread of the batches.
+ * Its filters come from the filter cache, so it costs little more than
+ * its line buffers.
+ */
+static SwsContext *clone_context(SwsContext *c)
+{
+    SwsContext *n = sws_alloc_context();
+
+    if (!n)
+        return NULL;
+    n->flags     = c->flags & ~SWS_PRINT_INFO;
+    n->srcW      = c->srcW;
+    n->srcH      = c->srcH;
+    n->dstW      = c->dstW;
+    n->dstH      = c->dstH;
+    n->srcFormat = c->srcFormat;
+    n->dstFormat = c->dstFormat;
+    n->src0Alpha = c->src0Alpha;
+    n->dst0Alpha = c->dst0Alpha;
+    n->param[0]  = c->param[0];
+    n->param[1]  = c->param[1];
+    sws_setColorspaceDetails(n, c->srcColorspaceTable, c->srcRange,
+                             c->dstColorspaceTable, c->dstRange,
+                             c->brightness, c->contrast, c->saturation);
+    if (sws_init_context(n, NULL, NULL) < 0) {
+        sws_freeContext(n);
+        return NULL;
+    }
+    return n;
+}
+
+/**
+ * Give n the colorspace details set on c after the creation of n.
+ */
+static void sync_colorspace(SwsContext *n, SwsContext *c)
+{
+    if (memcmp(n->srcColorspaceTable, c->srcColorspaceTable, sizeof(c->srcColorspaceTable)) ||
+        memcmp(n->dstColorspaceTable, c->dstColorspaceTable, sizeof(c->dstColorspaceTable)) ||
+        n->srcRange   != c->srcRange   || n->dstRange != c->dstRange ||
+        n->brightness != c->brightness || n->contrast != c->contrast ||
+        n->saturation != c->saturation)
+        sws_setColorspaceDetails(n, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
+}
+
+static int run_images(void *opaque, int job, int thread)
+{
+    SwsThreads *t = opaque;
+    SwsContext *c = thread ? t->ctx[thread - 1] : t->c;
+    int i   = job * t->images_per_job;
+    int end = FFMIN(i + t->images_per_job, t->nb_images);
+    int ret = 0;
+
+    for (; i < end; i++)
+        ret += sws_scale(c, t->batch_src[i], t->batch_srcStride[i], 0, c->srcH,
+                         t->batch_dst[i], t->batch_dstStride[i]) > 0;
+    return ret;
+}
+
+int sws_scale_batch(struct SwsContext *c, int nb_images,
+                    const uint8_t *const *const src[], const int *const srcStride[],
+                    uint8_t *const *const dst[], const int *const dstStride[])
+{
+    int i, ret = 0;
+
+    if (nb_images <= 0)
+        return 0;
+
+    /* Filters built from user vectors cannot be rebuilt for the worker
+     * contexts, such a context scales its batches alone. */
+    if (c->nb_threads > 1 && nb_images > 1 && !c->user_filters) {
+        SwsThreads *t = c->threads;
+
+        if (!t) {
+            if ((ret = start_threads(c)) < 0)
+                return ret;
+            t = c->threads;
+        }
+        if (t && t->nb_started) {
+            if (!t->ctx) {
+                if (!(t->ctx = av_mallocz(t->nb_started * sizeof(*t->ctx))))
+                    return AVERROR(ENOMEM);
+                for (i = 0; i < t->nb_started; i++) {
+                    if (!(t->ctx[i] = clone_context(c))) {
+                        while (i--)
+                            sws_freeContext(t->ctx[i]);
+                        av_freep(&t->ctx);
+                        return AVERROR(ENOMEM);
+                    }
+                }
+            }
+            for (i = 0; i < t->nb_started; i++)
+                sync_colorspace(t->ctx[i], c);
+
+            /* A few jobs per thread balance the load, while each thread
+             * keeps scaling consecutive images with the same context. */
+            t->c               = c;
+            t->batch_src       = src;
+            t->batch_srcStride = srcStride;
+            t->batch_dst       = dst;
+            t->batch_dstStride = dstStride;
+            t->nb_images       = nb_images;
+            t->images_per_job  = FFMAX(1, nb_images / (4 * (t->nb_started + 1)));
+            ret = execute(t, run_images,
+                          (nb_images + t->images_per_job - 1) / t->images_per_job);
+            return ret == nb_images ? nb_images : AVERROR(EINVAL);
+        }
+    }
+
+    for (i = 0; i < nb_images; i++)
+        if (sws_scale(c, src[i], srcStride[i], 0, c->srcH, dst[i], dstStride[i]) <= 0)
+            return AVERROR(EINVAL);
+    return nb_images;
+}
+
 /* Convert the palette to the same packed 32-bit format as the palette */
 void sws_convertPalette8ToPacked32(const uint8_t *src, uint8_t *dst,
                                    int num_pixels, const uint8_t *palette)
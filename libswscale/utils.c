@@ -46,6 +46,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/refcache.h"
 #include "libavutil/x86/asm.h"
 #include "rgb2rgb.h"
 #include "swscale.h"
@@ -177,6 +178,9 @@ static const FormatEntry format_entries[PIX_FMT_NB] = {
     [PIX_FMT_GBRP14BE]    = { 1, 0 },
     [PIX_FMT_GBRP16LE]    = { 1, 0 },
     [PIX_FMT_GBRP16BE]    = { 1, 0 },
+    [PIX_FMT_V210]        = { 1, 1 },
+    [PIX_FMT_V410]        = { 1, 1 },
+    [PIX_FMT_Y216]        = { 1, 1 },
 };
 
 int sws_isSupportedInput(enum PixelFormat pix_fmt)
@@ -764,6 +768,197 @@ static int initMMX2HScaler(int dstW, int xInc, uint8_t *filterCode,
 }
 #endif /* HAVE_MMXEXT && HAVE_INLINE_ASM */
 
+/**
+ * Filter shared through the process-wide cache by all the contexts using
+ * the same parameters, it is read-only once built.
+ */
+typedef struct SharedFilter {
+    int16_t *filter;
+    int32_t *filterPos;
+    int      filterSize;
+    uint8_t *mmx2FilterCode;      ///< runtime-generated MMX2 scaler, NULL for initFilter() filters
+    int      mmx2FilterCodeSize;
+} SharedFilter;
+
+/**
+ * Parameters identifying a SharedFilter, the fields not used by a kind of
+ * filter are 0.
+ */
+typedef struct SharedFilterKey {
+    char   id[4];                 ///< "swf" for initFilter(), "swm" for initMMX2HScaler()
+    int    xInc;
+    int    srcW, dstW;
+    int    filterAlign;           ///< numSplits for initMMX2HScaler()
+    int    one;
+    int    flags;
+    int    cpu_flags;
+    double param[2];
+} SharedFilterKey;
+
+static void free_shared_filter(void *data)
+{
+    SharedFilter *f = data;
+
+    av_free(f->filter);
+    av_free(f->filterPos);
+    if (f->mmx2FilterCode) {
+#ifdef MAP_ANONYMOUS
+        munmap(f->mmx2FilterCode, f->mmx2FilterCodeSize);
+#elif HAVE_VIRTUALALLOC
+        VirtualFree(f->mmx2FilterCode, 0, MEM_RELEASE);
+#else
+        av_free(f->mmx2FilterCode);
+#endif
+    }
+    av_free(f);
+}
+
+static int create_filter(void **data, void *opaque)
+{
+    SharedFilterKey *k = opaque;
+    SharedFilter *f    = av_mallocz(sizeof(*f));
+
+    if (!f)
+        return AVERROR(ENOMEM);
+    if (initFilter(&f->filter, &f->filterPos, &f->filterSize, k->xInc,
+                   k->srcW, k->dstW, k->filterAlign, k->one, k->flags,
+                   k->cpu_flags, NULL, NULL, k->param) < 0) {
+        free_shared_filter(f);
+        return AVERROR(EINVAL);
+    }
+    *data = f;
+    return 0;
+}
+
+#if HAVE_MMXEXT && HAVE_INLINE_ASM
+static int create_mmx2_filter(void **data, void *opaque)
+{
+    SharedFilterKey *k = opaque;
+    SharedFilter *f    = av_mallocz(sizeof(*f));
+    int numSplits      = k->filterAlign;
+
+    if (!f)
+        return AVERROR(ENOMEM);
+
+    f->mmx2FilterCodeSize = initMMX2HScaler(k->dstW, k->xInc, NULL, NULL,
+                                            NULL, numSplits);
+#ifdef MAP_ANONYMOUS
+    f->mmx2FilterCode = mmap(NULL, f->mmx2FilterCodeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (f->mmx2FilterCode == MAP_FAILED)
+        f->mmx2FilterCode = NULL;
+#elif HAVE_VIRTUALALLOC
+    f->mmx2FilterCode = VirtualAlloc(NULL, f->mmx2FilterCodeSize, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+#else
+    f->mmx2FilterCode = av_malloc(f->mmx2FilterCodeSize);
+#endif
+    f->filter    = av_mallocz((k->dstW     / numSplits + 8) * sizeof(int16_t));
+    f->filterPos = av_mallocz((k->dstW / 2 / numSplits + 8) * sizeof(int32_t));
+    if (!f->mmx2FilterCode || !f->filter || !f->filterPos) {
+        av_log(NULL, AV_LOG_ERROR, "Failed to allocate MMX2FilterCode\n");
+        free_shared_filter(f);
+        return AVERROR(ENOMEM);
+    }
+
+    initMMX2HScaler(k->dstW, k->xInc, f->mmx2FilterCode, f->filter,
+                    f->filterPos, numSplits);
+#ifdef MAP_ANONYMOUS
+    mprotect(f->mmx2FilterCode, f->mmx2FilterCodeSize, PROT_EXEC | PROT_READ);
+#endif
+    *data = f;
+    return 0;
+}
+#endif /* HAVE_MMXEXT && HAVE_INLINE_ASM */
+
+/**
+ * Get the filter initFilter() would build from the cache, or build it
+ * with initFilter() if the user gave vectors for it.
+ *
+ * @param ref set to the cache entry, or NULL if the filter is not shared
+ */
+static int getFilter(SwsContext *c, void **ref, int16_t **outFilter,
+                     int32_t **filterPos, int *outFilterSize, int xInc,
+                     int srcW, int dstW, int filterAlign, int one, int flags,
+                     int cpu_flags, SwsVector *srcFilter, SwsVector *dstFilter)
+{
+    SharedFilterKey key;
+    SharedFilter *f;
+    int ret;
+
+    *ref = NULL;
+    if (srcFilter || dstFilter) {
+        c->user_filters = 1;
+        return initFilter(outFilter, filterPos, outFilterSize, xInc, srcW,
+                          dstW, filterAlign, one, flags, cpu_flags,
+                          srcFilter, dstFilter, c->param);
+    }
+
+    memset(&key, 0, sizeof(key));
+    memcpy(key.id, "swf", 4);
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.param[0]    = c->param[0];
+    key.param[1]    = c->param[1];
+    if ((ret = avpriv_refcache_get(&key, sizeof(key), create_filter,
+                                   free_shared_filter, &key, ref)) < 0)
+        return ret;
+
+    f              = *ref;
+    *outFilter     = f->filter;
+    *filterPos     = f->filterPos;
+    *outFilterSize = f->filterSize;
+    return 0;
+}
+
+#if HAVE_MMXEXT && HAVE_INLINE_ASM
+/**
+ * Get the filter and code of initMMX2HScaler() from the cache.
+ */
+static int getMMX2Filter(void **ref, uint8_t **filterCode, int *filterCodeSize,
+                         int16_t **filter, int32_t **filterPos,
+                         int dstW, int xInc, int numSplits)
+{
+    SharedFilterKey key;
+    SharedFilter *f;
+    int ret;
+
+    memset(&key, 0, sizeof(key));
+    memcpy(key.id, "swm", 4);
+    key.xInc        = xInc;
+    key.dstW        = dstW;
+    key.filterAlign = numSplits;
+    if ((ret = avpriv_refcache_get(&key, sizeof(key), create_mmx2_filter,
+                                   free_shared_filter, &key, ref)) < 0)
+        return ret;
+
+    f               = *ref;
+    *filterCode     = f->mmx2FilterCode;
+    *filterCodeSize = f->mmx2FilterCodeSize;
+    *filter         = f->filter;
+    *filterPos      = f->filterPos;
+    return 0;
+}
+#endif /* HAVE_MMXEXT && HAVE_INLINE_ASM */
+
+/**
+ * Free a filter of the context, or release it if it comes from the cache.
+ */
+static void freeFilter(void **ref, int16_t **filter, int32_t **filterPos)
+{
+    if (*ref) {
+        avpriv_refcache_unref(ref);
+        *filter    = NULL;
+        *filterPos = NULL;
+    } else {
+        av_freep(filter);
+        av_freep(filterPos);
+    }
+}
+
 static void getSubSampleFactors(int *h, int *v, enum PixelFormat format)
 {
     *h = av_pix_fmt_descriptors[format].log2_chroma_w;
@@ -881,15 +1076,18 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
 
     unscaled = (srcW == dstW && srcH == dstH);
 
-    handle_jpeg(&srcFormat);
-    handle_jpeg(&dstFormat);
-    handle_0alpha(&srcFormat);
-    handle_0alpha(&dstFormat);
+    if (handle_jpeg(&srcFormat) | handle_jpeg(&dstFormat))
+        av_log(c, AV_LOG_WARNING, "deprecated pixel format used, make sure you did set range correctly\n");
+    c->src0Alpha |= handle_0alpha(&srcFormat);
+    c->dst0Alpha |= handle_0alpha(&dstFormat);
 
     if(srcFormat!=c->srcFormat || dstFormat!=c->dstFormat){
-        av_log(c, AV_LOG_WARNING, "deprecated pixel format used, make sure you did set range correctly\n");
         c->srcFormat= srcFormat;
         c->dstFormat= dstFormat;
+        // the tables were built for the deprecated formats
+        sws_setColorspaceDetails(c, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
     }
 
     if (!sws_isSupportedInput(srcFormat)) {
@@ -1000,12 +1198,19 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
 
     FF_ALLOC_OR_GOTO(c, c->formatConvBuffer, FFALIGN(srcW*2+78, 16) * 2, fail);
 
+    // the palette of PAL8 comes with each slice
+    if (usePal(srcFormat) && srcFormat != PIX_FMT_PAL8)
+        ff_sws_init_palette(c, NULL);
+
     /* unscaled special cases */
     if (unscaled && !usesHFilter && !usesVFilter &&
         (c->srcRange == c->dstRange || isAnyRGB(dstFormat))) {
         ff_get_unscaled_swscale(c);
 
         if (c->swScale) {
+            int ret = ff_sws_init_threads(c);
+            if (ret < 0)
+                return ret;
             if (flags & SWS_PRINT_INFO)
                 av_log(c, AV_LOG_INFO,
                        "using unscaled %s -> %s special converter\n",
@@ -1066,46 +1271,15 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
 #if HAVE_MMXEXT && HAVE_INLINE_ASM
 // can't downscale !!!
         if (c->canMMX2BeUsed && (flags & SWS_FAST_BILINEAR)) {
-            c->lumMmx2FilterCodeSize = initMMX2HScaler(dstW, c->lumXInc, NULL,
-                                                       NULL, NULL, 8);
-            c->chrMmx2FilterCodeSize = initMMX2HScaler(c->chrDstW, c->chrXInc,
-                                                       NULL, NULL, NULL, 4);
-
-#ifdef MAP_ANONYMOUS
-            c->lumMmx2FilterCode = mmap(NULL, c->lumMmx2FilterCodeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-            c->chrMmx2FilterCode = mmap(NULL, c->chrMmx2FilterCodeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-#elif HAVE_VIRTUALALLOC
-            c->lumMmx2FilterCode = VirtualAlloc(NULL, c->lumMmx2FilterCodeSize, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-            c->chrMmx2FilterCode = VirtualAlloc(NULL, c->chrMmx2FilterCodeSize, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-#else
-            c->lumMmx2FilterCode = av_malloc(c->lumMmx2FilterCodeSize);
-            c->chrMmx2FilterCode = av_malloc(c->chrMmx2FilterCodeSize);
-#endif
-
-#ifdef MAP_ANONYMOUS
-            if (c->lumMmx2FilterCode == MAP_FAILED || c->chrMmx2FilterCode == MAP_FAILED)
-#else
-            if (!c->lumMmx2FilterCode || !c->chrMmx2FilterCode)
-#endif
-            {
-                av_log(c, AV_LOG_ERROR, "Failed to allocate MMX2FilterCode\n");
-                return AVERROR(ENOMEM);
-            }
-
-            FF_ALLOCZ_OR_GOTO(c, c->hLumFilter,    (dstW           / 8 + 8) * sizeof(int16_t), fail);
-            FF_ALLOCZ_OR_GOTO(c, c->hChrFilter,    (c->chrDstW     / 4 + 8) * sizeof(int16_t), fail);
-            FF_ALLOCZ_OR_GOTO(c, c->hLumFilterPos, (dstW       / 2 / 8 + 8) * sizeof(int32_t), fail);
-            FF_ALLOCZ_OR_GOTO(c, c->hChrFilterPos, (c->chrDstW / 2 / 4 + 8) * sizeof(int32_t), fail);
-
-            initMMX2HScaler(      dstW, c->lumXInc, c->lumMmx2FilterCode,
-                            c->hLumFilter, (uint32_t*)c->hLumFilterPos, 8);
-            initMMX2HScaler(c->chrDstW, c->chrXInc, c->chrMmx2FilterCode,
-                            c->hChrFilter, (uint32_t*)c->hChrFilterPos, 4);
-
-#ifdef MAP_ANONYMOUS
-            mprotect(c->lumMmx2FilterCode, c->lumMmx2FilterCodeSize, PROT_EXEC | PROT_READ);
-            mprotect(c->chrMmx2FilterCode, c->chrMmx2FilterCodeSize, PROT_EXEC | PROT_READ);
-#endif
+            int ret;
+
+            if ((ret = getMMX2Filter(&c->hLumFilterRef, &c->lumMmx2FilterCode,
+                                     &c->lumMmx2FilterCodeSize, &c->hLumFilter,
+                                     &c->hLumFilterPos, dstW, c->lumXInc, 8)) < 0 ||
+                (ret = getMMX2Filter(&c->hChrFilterRef, &c->chrMmx2FilterCode,
+                                     &c->chrMmx2FilterCodeSize, &c->hChrFilter,
+                                     &c->hChrFilterPos, c->chrDstW, c->chrXInc, 4)) < 0)
+                return ret;
         } else
 #endif /* HAVE_MMXEXT && HAVE_INLINE_ASM */
         {
@@ -1114,19 +1288,17 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                 (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC) ? 8 :
                 1;
 
-            if (initFilter(&c->hLumFilter, &c->hLumFilterPos,
-                           &c->hLumFilterSize, c->lumXInc,
-                           srcW, dstW, filterAlign, 1 << 14,
-                           (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
-                           cpu_flags, srcFilter->lumH, dstFilter->lumH,
-                           c->param) < 0)
+            if (getFilter(c, &c->hLumFilterRef, &c->hLumFilter,
+                          &c->hLumFilterPos, &c->hLumFilterSize, c->lumXInc,
+                          srcW, dstW, filterAlign, 1 << 14,
+                          (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
+                          cpu_flags, srcFilter->lumH, dstFilter->lumH) < 0)
                 goto fail;
-            if (initFilter(&c->hChrFilter, &c->hChrFilterPos,
-                           &c->hChrFilterSize, c->chrXInc,
-                           c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
-                           (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
-                           cpu_flags, srcFilter->chrH, dstFilter->chrH,
-                           c->param) < 0)
+            if (getFilter(c, &c->hChrFilterRef, &c->hChrFilter,
+                          &c->hChrFilterPos, &c->hChrFilterSize, c->chrXInc,
+                          c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
+                          (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
+                          cpu_flags, srcFilter->chrH, dstFilter->chrH) < 0)
                 goto fail;
         }
     } // initialize horizontal stuff
@@ -1138,18 +1310,17 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
             (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC) ? 8 :
             1;
 
-        if (initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
-                       c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
-                       (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
-                       cpu_flags, srcFilter->lumV, dstFilter->lumV,
-                       c->param) < 0)
+        if (getFilter(c, &c->vLumFilterRef, &c->vLumFilter, &c->vLumFilterPos,
+                      &c->vLumFilterSize, c->lumYInc, srcH, dstH, filterAlign,
+                      (1 << 12),
+                      (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
+                      cpu_flags, srcFilter->lumV, dstFilter->lumV) < 0)
             goto fail;
-        if (initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
-                       c->chrYInc, c->chrSrcH, c->chrDstH,
-                       filterAlign, (1 << 12),
-                       (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
-                       cpu_flags, srcFilter->chrV, dstFilter->chrV,
-                       c->param) < 0)
+        if (getFilter(c, &c->vChrFilterRef, &c->vChrFilter, &c->vChrFilterPos,
+                      &c->vChrFilterSize, c->chrYInc, c->chrSrcH, c->chrDstH,
+                      filterAlign, (1 << 12),
+                      (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
+                      cpu_flags, srcFilter->chrV, dstFilter->chrV) < 0)
             goto fail;
 
 #if HAVE_ALTIVEC
@@ -1655,6 +1826,8 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    ff_sws_free_threads(c);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
@@ -1674,38 +1847,18 @@ void sws_freeContext(SwsContext *c)
         av_freep(&c->alpPixBuf);
     }
 
-    av_freep(&c->vLumFilter);
-    av_freep(&c->vChrFilter);
-    av_freep(&c->hLumFilter);
-    av_freep(&c->hChrFilter);
+    freeFilter(&c->vLumFilterRef, &c->vLumFilter, &c->vLumFilterPos);
+    freeFilter(&c->vChrFilterRef, &c->vChrFilter, &c->vChrFilterPos);
+    freeFilter(&c->hLumFilterRef, &c->hLumFilter, &c->hLumFilterPos);
+    freeFilter(&c->hChrFilterRef, &c->hChrFilter, &c->hChrFilterPos);
 #if HAVE_ALTIVEC
     av_freep(&c->vYCoeffsBank);
     av_freep(&c->vCCoeffsBank);
 #endif
 
-    av_freep(&c->vLumFilterPos);
-    av_freep(&c->vChrFilterPos);
-    av_freep(&c->hLumFilterPos);
-    av_freep(&c->hChrFilterPos);
-
-#if HAVE_MMX
-#ifdef MAP_ANONYMOUS
-    if (c->lumMmx2FilterCode)
-        munmap(c->lumMmx2FilterCode, c->lumMmx2FilterCodeSize);
-    if (c->chrMmx2FilterCode)
-        munmap(c->chrMmx2FilterCode, c->chrMmx2FilterCodeSize);
-#elif HAVE_VIRTUALALLOC
-    if (c->lumMmx2FilterCode)
-        VirtualFree(c->lumMmx2FilterCode, 0, MEM_RELEASE);
-    if (c->chrMmx2FilterCode)
-        VirtualFree(c->chrMmx2FilterCode, 0, MEM_RELEASE);
-#else
-    av_free(c->lumMmx2FilterCode);
-    av_free(c->chrMmx2FilterCode);
-#endif
+    // the MMX2 filter code is owned by the cache entry of the filter
     c->lumMmx2FilterCode = NULL;
     c->chrMmx2FilterCode = NULL;
-#endif /* HAVE_MMX */
 
     av_freep(&c->yuvTable);
     av_freep(&c->formatConvBuffer);
@@ -2453,6 +2453,137 @@ static void RENAME(uyvytoyuv422)(uint8_t *ydst, uint8_t *udst, uint8_t *vdst, co
 #endif /* !COMPILE_TEMPLATE_AMD3DNOW */
 #endif /* !COMPILE_TEMPLATE_SSE2 */
 
+#if COMPILE_TEMPLATE_SSE2
+static void RENAME(bswap16plane)(const uint8_t *src, uint8_t *dst, int width,
+                                 int height, int srcStride, int dstStride)
+{
+    int w8 = width & ~7;
+    int h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d       = (uint16_t *)dst;
+        x86_reg i         = -2 * (x86_reg)w8;
+        int w;
+
+        if (w8)
+        __asm__ volatile(
+            "1:                                 \n\t"
+            "movdqu        (%1, %0), %%xmm0     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "psllw               $8, %%xmm0     \n\t"
+            "psrlw               $8, %%xmm1     \n\t"
+            "por             %%xmm1, %%xmm0     \n\t"
+            "movdqu          %%xmm0, (%2, %0)   \n\t"
+            "add                $16, %0         \n\t"
+            " js                 1b             \n\t"
+            : "+r"(i)
+            : "r"(s + w8), "r"(d + w8)
+            : XMM_CLOBBERS("%xmm0", "%xmm1",) "memory"
+        );
+        for (w = w8; w < width; w++)
+            d[w] = av_bswap16(s[w]);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+static void RENAME(shift16plane)(const uint8_t *src, uint8_t *dst, int width,
+                                 int height, int srcStride, int dstStride,
+                                 int lshift, int rshift)
+{
+    int w8 = width & ~7;
+    int h;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        uint16_t *d       = (uint16_t *)dst;
+        x86_reg i         = -2 * (x86_reg)w8;
+        int w;
+
+        /* a shift count of 16 or more gives 0 */
+        if (w8)
+        __asm__ volatile(
+            "movd                %3, %%xmm6     \n\t"
+            "movd                %4, %%xmm7     \n\t"
+            "1:                                 \n\t"
+            "movdqu        (%1, %0), %%xmm0     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "psllw           %%xmm6, %%xmm0     \n\t"
+            "psrlw           %%xmm7, %%xmm1     \n\t"
+            "por             %%xmm1, %%xmm0     \n\t"
+            "movdqu          %%xmm0, (%2, %0)   \n\t"
+            "add                $16, %0         \n\t"
+            " js                 1b             \n\t"
+            : "+r"(i)
+            : "r"(s + w8), "r"(d + w8), "m"(lshift), "m"(rshift)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm6", "%xmm7",) "memory"
+        );
+        for (w = w8; w < width; w++) {
+            unsigned v = s[w];
+            d[w] = v << lshift | v >> rshift;
+        }
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+static void RENAME(dither16to8plane)(const uint8_t *src, uint8_t *dst, int width,
+                                     int height, int srcStride, int dstStride,
+                                     const uint8_t (*dither)[8], int scale,
+                                     int shift)
+{
+    DECLARE_ALIGNED(16, uint16_t, scale8)[8];
+    DECLARE_ALIGNED(16, uint32_t, dscaled)[8];
+    int w8 = width & ~7;
+    int h, w;
+
+    for (w = 0; w < 8; w++)
+        scale8[w] = scale;
+
+    for (h = 0; h < height; h++) {
+        const uint16_t *s = (const uint16_t *)src;
+        const uint8_t *d  = dither[h & 7];
+        x86_reg i         = -(x86_reg)w8;
+
+        /* (s + d) * scale is computed as s * scale + d * scale, s + d
+         * does not fit in 16 bits for 16-bit input */
+        for (w = 0; w < 8; w++)
+            dscaled[w] = d[w] * scale;
+
+        if (w8)
+        __asm__ volatile(
+            "movd                %3, %%xmm7     \n\t"
+            "1:                                 \n\t"
+            "movdqu     (%1, %0, 2), %%xmm0     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "pmullw              %4, %%xmm0     \n\t"
+            "pmulhuw             %4, %%xmm1     \n\t"
+            "movdqa          %%xmm0, %%xmm2     \n\t"
+            "punpcklwd       %%xmm1, %%xmm0     \n\t"
+            "punpckhwd       %%xmm1, %%xmm2     \n\t"
+            "paddd               %5, %%xmm0     \n\t"
+            "paddd               %6, %%xmm2     \n\t"
+            "psrld           %%xmm7, %%xmm0     \n\t"
+            "psrld           %%xmm7, %%xmm2     \n\t"
+            "packssdw        %%xmm2, %%xmm0     \n\t"
+            "packuswb        %%xmm0, %%xmm0     \n\t"
+            "movq            %%xmm0, (%2, %0)   \n\t"
+            "add                 $8, %0         \n\t"
+            " js                 1b             \n\t"
+            : "+r"(i)
+            : "r"(s + w8), "r"(dst + w8), "m"(shift), "m"(*scale8),
+              "m"(dscaled[0]), "m"(dscaled[4])
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",) "memory"
+        );
+        for (w = w8; w < width; w++)
+            dst[w] = (unsigned)(s[w] + d[w & 7]) * scale >> shift;
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+#endif /* COMPILE_TEMPLATE_SSE2 */
+
 static inline void RENAME(rgb2rgb_init)(void)
 {
 #if !COMPILE_TEMPLATE_SSE2
@@ -2498,4 +2629,10 @@ static inline void RENAME(rgb2rgb_init)(void)
 #if !COMPILE_TEMPLATE_AMD3DNOW
     interleaveBytes    = RENAME(interleaveBytes);
 #endif /* !COMPILE_TEMPLATE_AMD3DNOW */
+
+#if COMPILE_TEMPLATE_SSE2
+    bswap16plane       = RENAME(bswap16plane);
+    shift16plane       = RENAME(shift16plane);
+    dither16to8plane   = RENAME(dither16to8plane);
+#endif /* COMPILE_TEMPLATE_SSE2 */
 }
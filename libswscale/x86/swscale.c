@@ -265,6 +265,324 @@ static void yuv2yuvX_sse3(const int16_t *filter, int filterSize,
 }
 #endif
 
+#if HAVE_SSE
+DECLARE_ASM_CONST(16, uint64_t, v210_qmask)[3][2] = {
+    { 0x00000000000003FFULL, 0x00000000000003FFULL },
+    { 0x0000000003FF0000ULL, 0x0000000003FF0000ULL },
+    { 0x000003FF00000000ULL, 0x000003FF00000000ULL },
+};
+DECLARE_ASM_CONST(16, uint32_t, v210_dmask)[6][4] = {
+    { 0xFFFFFFFF, 0, 0, 0 },
+    { 0, 0xFFFFFFFF, 0, 0 },
+    { 0, 0, 0xFFFFFFFF, 0 },
+    { 0, 0, 0, 0xFFFFFFFF },
+    { 0xFFFFFFFF, 0, 0xFFFFFFFF, 0 },
+    { 0, 0xFFFFFFFF, 0, 0xFFFFFFFF },
+};
+DECLARE_ASM_CONST(16, uint32_t, pd_3ff)[4] = { 0x3FF, 0x3FF, 0x3FF, 0x3FF };
+DECLARE_ASM_CONST(16, int16_t,  pw_16)[8]   = { 16, 16, 16, 16, 16, 16, 16, 16 };
+DECLARE_ASM_CONST(16, int16_t,  pw_1023)[8] = { 1023, 1023, 1023, 1023,
+                                                1023, 1023, 1023, 1023 };
+DECLARE_ASM_CONST(16, int16_t,  pw_1_1024)[8] = { 1, 1024, 1, 1024,
+                                                  1, 1024, 1, 1024 };
+
+/* One group of 6 pixels per iteration, the samples of both 64 bit halves
+ * of a group sit at the same bit positions. Whole groups are written. */
+static void v210ToY_sse2(uint8_t *dst, const uint8_t *src,
+                         const uint8_t *unused1, const uint8_t *unused2,
+                         int width, uint32_t *unused)
+{
+    x86_reg n = (width + 5) / 6;
+
+    __asm__ volatile(
+        "movdqa    %[m0], %%xmm5        \n\t"
+        "movdqa    %[m1], %%xmm6        \n\t"
+        "movdqa    %[m2], %%xmm7        \n\t"
+        "1:                             \n\t"
+        "movdqu   (%[src]), %%xmm0      \n\t"
+        "movdqa    %%xmm0, %%xmm1       \n\t"
+        "movdqa    %%xmm0, %%xmm2       \n\t"
+        "psrlq       $10, %%xmm0        \n\t" // Y0,     Y3
+        "psrlq       $16, %%xmm1        \n\t" // Y1,     Y4
+        "psrlq       $20, %%xmm2        \n\t" // Y2,     Y5
+        "pand      %%xmm5, %%xmm0       \n\t"
+        "pand      %%xmm6, %%xmm1       \n\t"
+        "pand      %%xmm7, %%xmm2       \n\t"
+        "por       %%xmm1, %%xmm0       \n\t"
+        "por       %%xmm2, %%xmm0       \n\t"
+        "movq      %%xmm0,  (%[dst])    \n\t"
+        "movhps    %%xmm0, 6(%[dst])    \n\t"
+        "add         $16, %[src]        \n\t"
+        "add         $12, %[dst]        \n\t"
+        "dec       %[n]                 \n\t"
+        "jnz 1b                         \n\t"
+        : [src]"+r"(src), [dst]"+r"(dst), [n]"+r"(n)
+        : [m0]"m"(*v210_qmask[0]), [m1]"m"(*v210_qmask[1]),
+          [m2]"m"(*v210_qmask[2])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+static void v210ToUV_sse2(uint8_t *dstU, uint8_t *dstV, const uint8_t *unused0,
+                          const uint8_t *src1, const uint8_t *src2,
+                          int width, uint32_t *unused)
+{
+    x86_reg n = (width + 2) / 3;
+
+    __asm__ volatile(
+        "movdqa  %[m3ff], %%xmm7        \n\t"
+        "1:                             \n\t"
+        "movdqu   (%[src]), %%xmm0      \n\t"
+        "movdqa    %%xmm0, %%xmm1       \n\t"
+        "movdqa    %%xmm0, %%xmm2       \n\t"
+        "psrld       $10, %%xmm1        \n\t"
+        "psrld       $20, %%xmm2        \n\t"
+        "pand      %%xmm7, %%xmm0       \n\t" // U0 Y1 V1 Y4
+        "pand      %%xmm7, %%xmm1       \n\t" // Y0 U1 Y3 V2
+        "pand      %%xmm7, %%xmm2       \n\t" // V0 Y2 U2 Y5
+        "movdqa    %%xmm0, %%xmm3       \n\t"
+        "movdqa    %%xmm1, %%xmm4       \n\t"
+        "movdqa    %%xmm2, %%xmm5       \n\t"
+        "pand      %[d0], %%xmm3        \n\t"
+        "pand      %[d1], %%xmm4        \n\t"
+        "pand      %[d2], %%xmm5        \n\t"
+        "por       %%xmm4, %%xmm3       \n\t"
+        "por       %%xmm5, %%xmm3       \n\t" // U0 U1 U2 0
+        "pand      %[d0], %%xmm2        \n\t"
+        "pand      %[d2], %%xmm0        \n\t"
+        "pand      %[d3], %%xmm1        \n\t"
+        "por       %%xmm0, %%xmm2       \n\t"
+        "por       %%xmm1, %%xmm2       \n\t" // V0 0  V1 V2
+        "pshufd $0xF8, %%xmm2, %%xmm2   \n\t" // V0 V1 V2 V2
+        "packssdw  %%xmm2, %%xmm3       \n\t"
+        "movq      %%xmm3, (%[dstU])    \n\t"
+        "movhps    %%xmm3, (%[dstV])    \n\t"
+        "add         $16, %[src]        \n\t"
+        "add          $6, %[dstU]       \n\t"
+        "add          $6, %[dstV]       \n\t"
+        "dec       %[n]                 \n\t"
+        "jnz 1b                         \n\t"
+        : [src]"+r"(src1), [dstU]"+r"(dstU), [dstV]"+r"(dstV), [n]"+r"(n)
+        : [m3ff]"m"(*pd_3ff),
+          [d0]"m"(*v210_dmask[0]), [d1]"m"(*v210_dmask[1]),
+          [d2]"m"(*v210_dmask[2]), [d3]"m"(*v210_dmask[3])
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm7",)
+          "memory"
+    );
+}
+
+/* Vertically unscaled output: a 1 tap filter is 4096, so the rounding of
+ * yuv2v210_X_c() reduces to (x + 16) >> 5. The sample sequence of a group
+ * is the chroma interleaved with the luma, pmaddwd puts the samples pairs
+ * together and the dwords are assembled from pairs of pairs. */
+static void yuv2v210_1_sse2(SwsContext *c, const int16_t *buf0,
+                            const int16_t *ubuf[2], const int16_t *vbuf[2],
+                            const int16_t *abuf0, uint8_t *dest,
+                            int dstW, int uvalpha, int y)
+{
+    const int16_t *ubuf0 = ubuf[0], *vbuf0 = vbuf[0];
+    x86_reg n = dstW / 6;
+    int i = n * 6, k;
+
+    if (n) {
+        const int16_t *ysrc = buf0, *usrc = ubuf0, *vsrc = vbuf0;
+
+        __asm__ volatile(
+            "movdqa  %[pw16], %%xmm4        \n\t"
+            "movdqa  %[pwmax], %%xmm5       \n\t"
+            "pxor      %%xmm6, %%xmm6       \n\t"
+            "movdqa  %[pwmul], %%xmm7       \n\t"
+            "1:                             \n\t"
+            "movdqu   (%[y]), %%xmm0        \n\t"
+            "movq     (%[u]), %%xmm1        \n\t"
+            "movq     (%[v]), %%xmm2        \n\t"
+            "punpcklwd %%xmm2, %%xmm1       \n\t" // U0 V0 U1 V1 U2 V2
+            "paddsw    %%xmm4, %%xmm0       \n\t"
+            "paddsw    %%xmm4, %%xmm1       \n\t"
+            "psraw        $5, %%xmm0        \n\t"
+            "psraw        $5, %%xmm1        \n\t"
+            "pmaxsw    %%xmm6, %%xmm0       \n\t"
+            "pmaxsw    %%xmm6, %%xmm1       \n\t"
+            "pminsw    %%xmm5, %%xmm0       \n\t"
+            "pminsw    %%xmm5, %%xmm1       \n\t"
+            "movdqa    %%xmm1, %%xmm2       \n\t"
+            "punpcklwd %%xmm0, %%xmm1       \n\t" // S0..S7
+            "punpckhwd %%xmm0, %%xmm2       \n\t" // S8..S15
+            "movaps    %%xmm1, %%xmm3       \n\t"
+            "shufps $0x4F, %%xmm2, %%xmm3   \n\t" // S6 S7 x x S8 S9 S10 S11
+            "pmaddwd   %%xmm7, %%xmm1       \n\t" // E0 E1 E2 E3
+            "pmaddwd   %%xmm7, %%xmm3       \n\t" // E3 x  E4 E5
+            "movaps    %%xmm1, %%xmm2       \n\t"
+            "shufps $0x84, %%xmm3, %%xmm1   \n\t" // E0 E1 E3 E4
+            "shufps $0xE9, %%xmm3, %%xmm2   \n\t" // E1 E2 E4 E5
+            "movdqa    %%xmm2, %%xmm3       \n\t"
+            "pand    %[m3ff], %%xmm3        \n\t"
+            "pslld       $20, %%xmm3        \n\t"
+            "por       %%xmm1, %%xmm3       \n\t" // dwords 0 and 2
+            "psrld       $10, %%xmm1        \n\t"
+            "pslld       $10, %%xmm2        \n\t"
+            "por       %%xmm2, %%xmm1       \n\t" // dwords 1 and 3
+            "pand     %[m02], %%xmm3        \n\t"
+            "pand     %[m13], %%xmm1        \n\t"
+            "por       %%xmm3, %%xmm1       \n\t"
+            "movdqu    %%xmm1, (%[dst])     \n\t"
+            "add         $12, %[y]          \n\t"
+            "add          $6, %[u]          \n\t"
+            "add          $6, %[v]          \n\t"
+            "add         $16, %[dst]        \n\t"
+            "dec       %[n]                 \n\t"
+            "jnz 1b                         \n\t"
+            : [y]"+r"(ysrc), [u]"+r"(usrc), [v]"+r"(vsrc),
+              [dst]"+r"(dest), [n]"+r"(n)
+            : [pw16]"m"(*pw_16), [pwmax]"m"(*pw_1023), [pwmul]"m"(*pw_1_1024),
+              [m3ff]"m"(*pd_3ff), [m02]"m"(*v210_dmask[4]),
+              [m13]"m"(*v210_dmask[5])
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+              "memory"
+        );
+    }
+
+    if (i < dstW) {
+        int Y[6] = { 0 }, U[3] = { 0 }, V[3] = { 0 };
+
+        for (k = 0; i + k < dstW; k++)
+            Y[k] = av_clip_uintp2((buf0[i + k] + 16) >> 5, 10);
+        for (k = 0; i + 2 * k < dstW; k++) {
+            U[k] = av_clip_uintp2((ubuf0[i / 2 + k] + 16) >> 5, 10);
+            V[k] = av_clip_uintp2((vbuf0[i / 2 + k] + 16) >> 5, 10);
+        }
+
+        AV_WL32(dest,      U[0] | Y[0] << 10 | V[0] << 20);
+        AV_WL32(dest +  4, Y[1] | U[1] << 10 | Y[2] << 20);
+        AV_WL32(dest +  8, V[1] | Y[3] << 10 | U[2] << 20);
+        AV_WL32(dest + 12, Y[4] | V[2] << 10 | Y[5] << 20);
+        dest += 16;
+    }
+    memset(dest, 0, (dstW + 47) / 48 * 128 - (dstW + 5) / 6 * 16);
+}
+
+#if HAVE_7REGS
+DECLARE_ASM_CONST(16, uint16_t, pw_8000)[8] = { 0x8000, 0x8000, 0x8000, 0x8000,
+                                                0x8000, 0x8000, 0x8000, 0x8000 };
+DECLARE_ASM_CONST(16, int32_t,  pd_19bit_max)[4] = { (1 << 19) - 1, (1 << 19) - 1,
+                                                     (1 << 19) - 1, (1 << 19) - 1 };
+
+/* xmm0/xmm1 += src * filter of 2 output pixels, 8 (movdqu) or 4 (movq) taps */
+#define HSCALE_STEP(load, fix)                                               \
+        load "  (%[s0],%[j]), %%xmm2   \n\t"                                 \
+        load "  (%[f0],%[j]), %%xmm3   \n\t"                                 \
+        load "  (%[s1],%[j]), %%xmm4   \n\t"                                 \
+        load "  (%[f1],%[j]), %%xmm5   \n\t"                                 \
+        fix                                                                  \
+        "pmaddwd       %%xmm3, %%xmm2   \n\t"                                 \
+        "pmaddwd       %%xmm5, %%xmm4   \n\t"                                 \
+        "paddd         %%xmm2, %%xmm0   \n\t"                                 \
+        "paddd         %%xmm4, %%xmm1   \n\t"
+
+/* pmaddwd is signed, so 16 bit samples are biased by -0x8000 and
+ * 0x8000 * sum(filter) is added back, which wraps like the C code */
+#define HSCALE_FIX16                                                         \
+        "pxor          %%xmm7, %%xmm2   \n\t"                                 \
+        "pxor          %%xmm7, %%xmm4   \n\t"                                 \
+        "movdqa        %%xmm3, %%xmm6   \n\t"                                 \
+        "pmaddwd       %%xmm7, %%xmm6   \n\t"                                 \
+        "psubd         %%xmm6, %%xmm0   \n\t"                                 \
+        "movdqa        %%xmm5, %%xmm6   \n\t"                                 \
+        "pmaddwd       %%xmm7, %%xmm6   \n\t"                                 \
+        "psubd         %%xmm6, %%xmm1   \n\t"
+
+/* store 2 words, packssdw clips like FFMIN(val >> sh, (1 << 15) - 1)
+ * as val >> sh cannot go below -0x8000 */
+#define HSCALE_STORE15                                                       \
+        "packssdw      %%xmm0, %%xmm0   \n\t"                                 \
+        "movd          %%xmm0, (%[dst]) \n\t"
+
+/* store 2 dwords clipped to (1 << 19) - 1 */
+#define HSCALE_STORE19                                                       \
+        "movdqa        %%xmm0, %%xmm2   \n\t"                                 \
+        "pcmpgtd      %[max], %%xmm2    \n\t"                                 \
+        "movdqa       %[max], %%xmm3    \n\t"                                 \
+        "pxor          %%xmm0, %%xmm3   \n\t"                                 \
+        "pand          %%xmm2, %%xmm3   \n\t"                                 \
+        "pxor          %%xmm3, %%xmm0   \n\t"                                 \
+        "movq          %%xmm0, (%[dst]) \n\t"
+
+/* same shifts as hScale16To15_c() and hScale16To19_c() */
+static int hscale16_shift(SwsContext *c, int to19)
+{
+    int bits = av_pix_fmt_descriptors[c->srcFormat].comp[0].depth_minus1;
+
+    if ((isAnyRGB(c->srcFormat) || c->srcFormat == PIX_FMT_PAL8) && bits < 15)
+        return to19 ? 9 : 13;
+    return to19 ? bits - 4 : bits;
+}
+
+/**
+ * Horizontal scaling of 9 to 16 bit input for filter sizes which are a
+ * multiple of 4, bitexact with the C code. Two output pixels are computed
+ * at once, like the yasm scalers this reads over the end of the filter
+ * and filterPos and may write one pixel more than dstW.
+ */
+#define HSCALE_FUNC(name, to19, fix, store)                                  \
+static void name(SwsContext *c, int16_t *_dst, int dstW,                      \
+                 const uint8_t *_src, const int16_t *filter,                 \
+                 const int32_t *filterPos, int filterSize)                   \
+{                                                                            \
+    DECLARE_ALIGNED(16, uint64_t, shift)[2];                                 \
+    const uint16_t *src = (const uint16_t *) _src;                           \
+    uint8_t *dst        = (uint8_t *) _dst;                                  \
+    int i;                                                                   \
+                                                                             \
+    shift[0] = shift[1] = hscale16_shift(c, to19);                           \
+                                                                             \
+    for (i = 0; i < dstW; i += 2) {                                          \
+        x86_reg j = -2 * filterSize;                                         \
+                                                                             \
+        __asm__ volatile(                                                    \
+            "movdqa   %[bias], %%xmm7       \n\t"                             \
+            "pxor          %%xmm0, %%xmm0   \n\t"                             \
+            "pxor          %%xmm1, %%xmm1   \n\t"                             \
+            "test             $8, %[j]      \n\t"                             \
+            "jz 1f                          \n\t"                             \
+            HSCALE_STEP("movq  ", fix)                                       \
+            "add              $8, %[j]      \n\t"                             \
+            "jz 2f                          \n\t"                             \
+            "1:                             \n\t"                             \
+            HSCALE_STEP("movdqu", fix)                                       \
+            "add             $16, %[j]      \n\t"                             \
+            "jl 1b                          \n\t"                             \
+            "2:                             \n\t"                             \
+            "movdqa        %%xmm0, %%xmm2   \n\t"                             \
+            "punpckldq     %%xmm1, %%xmm0   \n\t"                             \
+            "punpckhdq     %%xmm1, %%xmm2   \n\t"                             \
+            "paddd         %%xmm2, %%xmm0   \n\t"                             \
+            "pshufd $0xEE, %%xmm0, %%xmm2   \n\t"                             \
+            "paddd         %%xmm2, %%xmm0   \n\t"                             \
+            "psrad        %[sh], %%xmm0     \n\t"                             \
+            store                                                            \
+            : [j]"+&r"(j)                                                    \
+            : [s0]"r"(src + filterPos[i]     + filterSize),                  \
+              [s1]"r"(src + filterPos[i + 1] + filterSize),                  \
+              [f0]"r"(filter + (i + 1) * filterSize),                        \
+              [f1]"r"(filter + (i + 2) * filterSize),                        \
+              [dst]"r"(dst + (to19 ? 4 : 2) * i),                            \
+              [sh]"m"(*shift), [max]"m"(*pd_19bit_max), [bias]"m"(*pw_8000)  \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                \
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)               \
+              "memory"                                                       \
+        );                                                                   \
+    }                                                                        \
+}
+
+HSCALE_FUNC(hscale16to15_sse2,    0, "",           HSCALE_STORE15)
+HSCALE_FUNC(hscale16to19_sse2,    1, "",           HSCALE_STORE19)
+HSCALE_FUNC(hscale16to15_16_sse2, 0, HSCALE_FIX16, HSCALE_STORE15)
+HSCALE_FUNC(hscale16to19_16_sse2, 1, HSCALE_FIX16, HSCALE_STORE19)
+#endif /* HAVE_7REGS */
+#endif /* HAVE_SSE */
+
 #endif /* HAVE_INLINE_ASM */
 
 #define SCALE_FUNC(filter_n, from_bpc, to_bpc, opt) \
@@ -383,6 +701,28 @@ av_cold void ff_sws_init_swScale_mmx(SwsContext *c)
             c->yuv2planeX = yuv2yuvX_sse3;
     }
 #endif
+#if HAVE_SSE
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        if (c->srcFormat == PIX_FMT_V210) {
+            c->lumToYV12 = v210ToY_sse2;
+            c->chrToYV12 = v210ToUV_sse2;
+        }
+        if (c->dstFormat == PIX_FMT_V210 &&
+            c->vLumFilterSize == 1 && c->vChrFilterSize == 1)
+            c->yuv2packed1 = yuv2v210_1_sse2;
+#if HAVE_7REGS
+        if (c->srcBpc > 8 && !(c->hLumFilterSize & 3) &&
+            !(c->hChrFilterSize & 3)) {
+            if (c->srcBpc == 16)
+                c->hyScale = c->hcScale = c->dstBpc > 14 ? hscale16to19_16_sse2
+                                                         : hscale16to15_16_sse2;
+            else
+                c->hyScale = c->hcScale = c->dstBpc > 14 ? hscale16to19_sse2
+                                                         : hscale16to15_sse2;
+        }
+#endif
+    }
+#endif
 #endif /* HAVE_INLINE_ASM */
 
 #if HAVE_YASM
@@ -20,6 +20,21 @@ $(FATE_AMIX): CMP_UNIT = f32
 
 FATE_FILTER-$(CONFIG_AMIX_FILTER) += $(FATE_AMIX)
 
+FATE_AMIX_FIXED += fate-filter-amix-fixed-s16
+fate-filter-amix-fixed-s16: CMD = md5 -filter_complex amix=fixed=1 -i $(SRC) -ss 3 -i $(SRC1) -f s16le
+fate-filter-amix-fixed-s16: REF = 034fc58ae30092f5a9f5dcbe3e4f42e2
+
+FATE_AMIX_FIXED += fate-filter-amix-fixed-s32p
+fate-filter-amix-fixed-s32p: CMD = md5 -filter_complex amix=fixed=1,aformat=sample_fmts=s32p -i $(SRC) -ss 3 -i $(SRC1) -f s32le
+fate-filter-amix-fixed-s32p: REF = 9c07efce638ff41fc7f4b46d5a5a5e37
+
+$(FATE_AMIX_FIXED): tests/data/asynth-44100-2.wav tests/data/asynth-44100-2-2.wav
+$(FATE_AMIX_FIXED): SRC  = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+$(FATE_AMIX_FIXED): SRC1 = $(TARGET_PATH)/tests/data/asynth-44100-2-2.wav
+$(FATE_AMIX_FIXED): CMP  = oneline
+
+FATE_FFMPEG-$(CONFIG_AMIX_FILTER) += $(FATE_AMIX_FIXED)
+
 FATE_FILTER-$(CONFIG_ASYNCTS_FILTER) += fate-filter-asyncts
 fate-filter-asyncts: SRC = $(SAMPLES)/nellymoser/nellymoser-discont.flv
 fate-filter-asyncts: CMD = pcm -analyzeduration 10000000 -i $(SRC) -af asyncts
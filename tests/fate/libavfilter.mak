@@ -0,0 +1,31 @@
+FATE_LIBAVFILTER-$(CONFIG_AMIX_FILTER) += fate-amix-simd
+fate-amix-simd: libavfilter/af_amix-test$(EXESUF)
+fate-amix-simd: CMD = run libavfilter/af_amix-test
+fate-amix-simd: REF = /dev/null
+
+FATE_LIBAVFILTER-$(CONFIG_ATEMPO_FILTER) += fate-atempo-simd
+fate-atempo-simd: libavfilter/af_atempo-test$(EXESUF)
+fate-atempo-simd: CMD = run libavfilter/af_atempo-test
+fate-atempo-simd: REF = /dev/null
+fate-atempo-simd: CMP = null
+
+FATE_LIBAVFILTER-$(CONFIG_HQDN3D_FILTER) += fate-hqdn3d-simd
+fate-hqdn3d-simd: libavfilter/vf_hqdn3d-test$(EXESUF)
+fate-hqdn3d-simd: CMD = run libavfilter/vf_hqdn3d-test
+fate-hqdn3d-simd: REF = /dev/null
+fate-hqdn3d-simd: CMP = null
+
+FATE_LIBAVFILTER-$(CONFIG_VOLUME_FILTER) += fate-volume-simd
+fate-volume-simd: libavfilter/af_volume-test$(EXESUF)
+fate-volume-simd: CMD = run libavfilter/af_volume-test
+fate-volume-simd: REF = /dev/null
+fate-volume-simd: CMP = null
+
+FATE_LIBAVFILTER-$(CONFIG_YADIF_FILTER) += fate-yadif-simd
+fate-yadif-simd: libavfilter/vf_yadif-test$(EXESUF)
+fate-yadif-simd: CMD = run libavfilter/vf_yadif-test
+fate-yadif-simd: REF = /dev/null
+fate-yadif-simd: CMP = null
+
+FATE_LIBAVFILTER += $(FATE_LIBAVFILTER-yes)
+fate-libavfilter: $(FATE_LIBAVFILTER)
@@ -0,0 +1,11 @@
+FATE_LIBSWRESAMPLE += fate-swr-threads
+fate-swr-threads: libswresample/swresample-test$(EXESUF)
+fate-swr-threads: CMD = run libswresample/swresample-test -threads
+fate-swr-threads: REF = /dev/null
+
+FATE_LIBSWRESAMPLE += fate-swr-dither
+fate-swr-dither: libswresample/swresample-test$(EXESUF)
+fate-swr-dither: CMD = run libswresample/swresample-test -dither
+fate-swr-dither: REF = /dev/null
+
+fate-libswresample: $(FATE_LIBSWRESAMPLE)
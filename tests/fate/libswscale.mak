@@ -0,0 +1,5 @@
+FATE_LIBSWSCALE += fate-sws-batch
+fate-sws-batch: libswscale/swscale-test$(EXESUF)
+fate-sws-batch: CMD = run libswscale/swscale-test -batch 4
+
+fate-libswscale: $(FATE_LIBSWSCALE)
@@ -0,0 +1,10 @@
+FATE_TEE += fate-tee-threads
+fate-tee-threads: CMD = ffmpeg -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -map 0 -c:a pcm_s16le -f tee "[f=framecrc]md5:|[f=framemd5]md5:"
+
+FATE_TEE += fate-tee-sync
+fate-tee-sync: CMD = ffmpeg -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -map 0 -c:a pcm_s16le -tee_queue_size 0 -f tee "[f=framecrc]md5:|[f=framemd5]md5:"
+
+$(FATE_TEE): tests/data/asynth-44100-2.wav
+
+FATE_FFMPEG-$(CONFIG_TEE_MUXER) += $(FATE_TEE)
+fate-tee: $(FATE_TEE)
@@ -111,6 +111,15 @@ do_lavf mov "" "-movflags +rtphint -acodec pcm_alaw -vcodec mpeg4"
 do_lavf_timecode mov "-acodec pcm_alaw -vcodec mpeg4"
 fi
 
+if [ -n "$do_mov_faststart" ] ; then
+do_lavf faststart.mov "" "-movflags +faststart -acodec pcm_alaw -vcodec mpeg4"
+fi
+
+# two samples per audio packet, for more entries than one index block holds
+if [ -n "$do_mov_spill" ] ; then
+do_lavf spill.mov "" "-movflags +spill_index -af asetnsamples=n=2 -acodec pcm_alaw -vcodec mpeg4"
+fi
+
 if [ -n "$do_ismv" ] ; then
 do_lavf_timecode ismv "-an -vcodec mpeg4"
 fi
@@ -135,6 +144,15 @@ if [ -n "$do_mkv" ] ; then
 do_lavf mkv "" "-acodec mp2 -ab 64k -vcodec mpeg4"
 fi
 
+if [ -n "$do_mkv_nocues" ] ; then
+# written to a pipe, so that the muxer leaves out the cues
+file=${outfile}lavf.nocues.mkv
+run_avconv $DEC_OPTS -f image2 -vcodec pgmyuv -i $raw_src $DEC_OPTS -ar 44100 -f s16le -i $pcm_src $ENC_OPTS -b:a 64k -t 1 -qscale:v 10 -acodec mp2 -vcodec mpeg4 -g 5 -f matroska pipe: > $target_path/$file
+do_md5sum $file
+echo $(wc -c $file)
+do_avconv_crc $file $DEC_OPTS -i $target_path/$file
+fi
+
 if [ -n "$do_mp3" ] ; then
 do_lavf_fate mp3 "mp3-conformance/he_32khz.bit" "-acodec copy"
 fi
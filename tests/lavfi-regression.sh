@@ -32,6 +32,22 @@ do_lavfi() {
     do_lavfi_plain $1 "slicify=random,$2"
 }
 
+# run a test under the label of another one, whose reference it must match
+do_lavfi_as() {
+    if [ $test = $1 ] ; then
+        do_video_filter $2 "slicify=random,$3"
+    fi
+}
+
+# Fifos forward whole frames, so the chain is not slicified to make the
+# output independent from where the pipeline cuts it. Both tests use the
+# same label and must match the same reference.
+do_lavfi_pipeline() {
+    if [ $test = $1 ] ; then
+        do_video_filter pipeline "$2" -filter_threads $3
+    fi
+}
+
 do_lavfi_colormatrix() {
     do_lavfi "${1}1" "$1=$4:$5,$1=$5:$3,$1=$3:$4,$1=$4:$3,$1=$3:$5,$1=$5:$2"
     do_lavfi "${1}2" "$1=$2:$3,$1=$3:$2,$1=$2:$4,$1=$4:$2,$1=$2:$5,$1=$5:$4"
@@ -43,8 +59,11 @@ do_lavfi "crop_scale_vflip"   "null,null,crop=iw-200:ih-200:200:200,crop=iw-20:i
 do_lavfi "crop_vflip"         "crop=iw-100:ih-100:100:100,vflip"
 do_lavfi "drawbox"            "drawbox=224:24:88:72:#FF8010@0.5"
 do_lavfi "fade"               "fade=in:5:15,fade=out:30:15"
+do_lavfi "hqdn3d"             "hqdn3d=8:6:10:8"
 do_lavfi "null"               "null"
 do_lavfi "overlay"            "split[m],scale=88:72,pad=96:80:4:4[o2];[m]fifo[o1],[o1][o2]overlay=240:16"
+# yuva420p overlay with opaque, transparent and varying alpha rows
+do_lavfi "overlay_alpha"      "split[m],scale=88:64,split[o][a],[a]lutrgb=r=(val-64)*2:g=(val-64)*2:b=(val-64)*2,format=gray,pad=96:64:4:0:black,pad=96:80:0:8:white,pad=96:88:0:0:black[alpha],[o]pad=96:88:4:8,format=yuva420p[ov],[ov][alpha]alphamerge[o2];[m]fifo[o1],[o1][o2]overlay=241:17"
 do_lavfi "pad"                "pad=iw*1.5:ih*1.5:iw*0.3:ih*0.2"
 do_lavfi "pp"                 "mp=pp=be/de/tn/l5/al"
 do_lavfi "pp2"                "mp=pp=be/fq:16/fa/lb"
@@ -52,7 +71,12 @@ do_lavfi "pp3"                "mp=pp=be/fq:8/ac/li"
 do_lavfi "pp4"                "mp=pp=be/ci"
 do_lavfi "pp5"                "mp=pp=md"
 do_lavfi "pp6"                "mp=pp=be/fd"
+do_lavfi "scale_crop_pad"     "crop=200:150:30:20,scale=173:121,pad=240:180:36:24"
+do_lavfi_as "scale_fused" "scale_crop_pad" "scale=173:121:crop_w=200:crop_h=150:crop_x=30:crop_y=20:pad_w=240:pad_h=180:pad_x=36:pad_y=24"
 do_lavfi "scale200"           "scale=200:200"
+# rgb24 is listed first, but the formats are chosen for the whole graph, so
+# the chain must stay in yuv420p and match scale200 bit for bit
+do_lavfi_as "scale_noconv" "scale200" "scale=200:200,format=rgb24:bgr24:yuv420p,hflip,scale=200:200,hflip"
 do_lavfi "scale500"           "scale=500:500"
 do_lavfi "select"             "select=not(eq(mod(n\,2)\,0)+eq(mod(n\,3)\,0))"
 do_lavfi "setdar"             "setdar=16/9"
@@ -64,24 +88,36 @@ do_lavfi "unsharp"            "unsharp=10:10:-1.5:10:10:-1.5"
 do_lavfi "vflip"              "vflip"
 do_lavfi "vflip_crop"         "vflip,crop=iw-100:ih-100:100:100"
 do_lavfi "vflip_vflip"        "vflip,vflip"
+do_lavfi "yadif_threads"      "yadif=1:-1:0:3"
 
 do_lavfi_plain "alphamerge_rgb"     "[in]slicify=random,format=bgra,split,alphamerge[out]"
 do_lavfi_plain "alphamerge_yuv"     "[in]slicify=random,format=yuv420p,split,alphamerge[out]"
 do_lavfi_plain "alphaextract_rgb"   "[in]slicify=random,format=bgra,split,alphamerge,slicify=random,split[o3][o4];[o4]alphaextract[alpha];[o3][alpha]alphamerge[out]"
 do_lavfi_plain "alphaextract_yuv"   "[in]slicify=random,format=yuv420p,split,alphamerge,slicify=random,split[o3][o4];[o4]alphaextract[alpha];[o3][alpha]alphamerge[out]"
+multiscale_filters="[in]slicify=random,format=yuyv422,multiscale=200x200|100x-1|0x0[o1][o2][o3]"
+do_lavfi_plain "multiscale1"        "$multiscale_filters;[o2]nullsink;[o3]nullsink;[o1]null[out]"
+do_lavfi_plain "multiscale2"        "$multiscale_filters;[o1]nullsink;[o3]nullsink;[o2]null[out]"
+do_lavfi_plain "multiscale3"        "$multiscale_filters;[o1]nullsink;[o2]nullsink;[o3]null[out]"
+
+pipeline_filters="crop=iw-20:ih-20:20:20,scale=250:250,vflip,unsharp,transpose,crop=iw-100:ih-100:100:100,vflip,scale=200:200,hflip"
+do_lavfi_pipeline "pipeline"          "$pipeline_filters" 1
+do_lavfi_pipeline "pipeline_threads"  "$pipeline_filters" 4
 
 do_lavfi_colormatrix "colormatrix" bt709 fcc bt601 smpte240m
 
+# the optional $3 is inserted before the format filter of each run, and
+# the optional $4 is appended to the test name
 do_lavfi_pixfmts(){
-    test ${test%_[bl]e} = pixfmts_$1 || return 0
+    test ${test%_[bl]e} = pixfmts_$1$4 || return 0
     filter=$1
     filter_args=$2
+    prefilter=$3
 
     showfiltfmts="$target_exec $target_path/libavfilter/filtfmts-test"
-    scale_exclude_fmts=${outfile}${1}_scale_exclude_fmts
-    scale_in_fmts=${outfile}${1}_scale_in_fmts
-    scale_out_fmts=${outfile}${1}_scale_out_fmts
-    in_fmts=${outfile}${1}_in_fmts
+    scale_exclude_fmts=${outfile}${1}${4}_scale_exclude_fmts
+    scale_in_fmts=${outfile}${1}${4}_scale_in_fmts
+    scale_out_fmts=${outfile}${1}${4}_scale_out_fmts
+    in_fmts=${outfile}${1}${4}_in_fmts
 
     # exclude pixel formats which are not supported as input
     $showfiltfmts scale | awk -F '[ \r]' '/^INPUT/{ fmt=substr($3, 5); print fmt }' | sort >$scale_in_fmts
@@ -92,7 +128,7 @@ do_lavfi_pixfmts(){
     pix_fmts=$(comm -12 $scale_exclude_fmts $in_fmts)
 
     for pix_fmt in $pix_fmts; do
-        do_video_filter $pix_fmt "slicify=random,format=$pix_fmt,$filter=$filter_args" -pix_fmt $pix_fmt
+        do_video_filter $pix_fmt "slicify=random,${prefilter}format=$pix_fmt,$filter=$filter_args" -pix_fmt $pix_fmt
     done
 
     rm $in_fmts $scale_in_fmts $scale_out_fmts $scale_exclude_fmts
@@ -102,12 +138,15 @@ do_lavfi_pixfmts(){
 do_lavfi_pixfmts "copy"    ""
 do_lavfi_pixfmts "crop"    "100:100:100:100"
 do_lavfi_pixfmts "hflip"   ""
+do_lavfi_pixfmts "hqdn3d"  ""
 do_lavfi_pixfmts "null"    ""
+do_lavfi_pixfmts "null"    "" "scale=iw:ih:threads=4:flags=bicubic+accurate_rnd+bitexact," "_threads"
 do_lavfi_pixfmts "pad"     "500:400:20:20"
 do_lavfi_pixfmts "pixdesctest" ""
 do_lavfi_pixfmts "scale"   "200:100"
 do_lavfi_pixfmts "super2xsai" ""
 do_lavfi_pixfmts "vflip"   ""
+do_lavfi_pixfmts "yadif"   ""
 
 do_lavfi_lavd() {
     label=$1